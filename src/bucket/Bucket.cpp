@@ -31,8 +31,13 @@
 #include "util/XDRStream.h"
 #include "util/make_unique.h"
 #include "xdrpp/message.h"
+#include <atomic>
 #include <cassert>
+#include <condition_variable>
+#include <exception>
+#include <functional>
 #include <future>
+#include <mutex>
 
 namespace stellar
 {
@@ -48,6 +53,13 @@ Bucket::Bucket(std::string const& filename, Hash const& hash)
     }
 }
 
+Bucket::Bucket(std::string const& filename, Hash const& hash,
+               std::unique_ptr<BucketIndex> index)
+    : Bucket(filename, hash)
+{
+    mIndex = std::move(index);
+}
+
 Bucket::Bucket()
 {
 }
@@ -64,6 +76,62 @@ Bucket::getFilename() const
     return mFilename;
 }
 
+BucketIndex const&
+Bucket::getIndex() const
+{
+    assert(!mFilename.empty());
+    std::call_once(mIndexOnce, [this]() {
+        if (mIndex)
+        {
+            return;
+        }
+        auto indexFilename = BucketIndex::indexFilename(mFilename);
+        mIndex = BucketIndex::load(indexFilename);
+        if (!mIndex)
+        {
+            CLOG(DEBUG, "Bucket") << "Building index of " << mFilename;
+            mIndex = BucketIndex::build(mFilename);
+            mIndex->save(indexFilename);
+        }
+    });
+    return *mIndex;
+}
+
+std::shared_ptr<BucketEntry>
+Bucket::getEntry(LedgerKey const& key) const
+{
+    if (mFilename.empty())
+    {
+        return nullptr;
+    }
+
+    auto const& index = getIndex();
+    size_t offset;
+    if (!index.mayContain(key) || !index.findPage(key, offset))
+    {
+        return nullptr;
+    }
+
+    // only a page worth of data is needed, don't read ahead a whole block
+    XDRInputFileStream in(0, BucketIndex::PAGE_BYTES);
+    in.open(mFilename);
+    in.seek(offset);
+    BucketEntryIdCmp cmp;
+    auto be = std::make_shared<BucketEntry>();
+    while (in.readOne(*be))
+    {
+        if (cmp(key, *be))
+        {
+            break;
+        }
+        if (!cmp(*be, key))
+        {
+            return be;
+        }
+    }
+    return nullptr;
+}
+
 bool
 Bucket::containsBucketIdentity(BucketEntry const& id) const
 {
@@ -101,9 +169,9 @@ Bucket::countLiveAndDeadEntries() const
 }
 
 void
-Bucket::apply(Database& db) const
+Bucket::apply(Application& app) const
 {
-    BucketApplicator applicator(db, shared_from_this());
+    BucketApplicator applicator(app, shared_from_this());
     while (applicator)
     {
         applicator.advance();
@@ -183,39 +251,39 @@ maybePut(BucketOutputIterator& out, BucketEntry const& entry,
     out.put(entry);
 }
 
-std::shared_ptr<Bucket>
-Bucket::merge(BucketManager& bucketManager,
-              std::shared_ptr<Bucket> const& oldBucket,
-              std::shared_ptr<Bucket> const& newBucket,
-              std::vector<std::shared_ptr<Bucket>> const& shadows,
-              bool keepDeadEntries)
+namespace
 {
-    // This is the key operation in the scheme: merging two (read-only)
-    // buckets together into a new 3rd bucket, while calculating its hash,
-    // in a single pass.
-
-    assert(oldBucket);
-    assert(newBucket);
-
-    BucketInputIterator oi(oldBucket);
-    BucketInputIterator ni(newBucket);
-
-    std::vector<BucketInputIterator> shadowIterators(shadows.begin(),
-                                                     shadows.end());
-
-    auto timer = bucketManager.getMergeTimer().TimeScope();
-    BucketOutputIterator out(bucketManager.getTmpDir(), keepDeadEntries);
+// minimum number of index pages of the largest input of a merge for each of
+// the key ranges it's split into
+const size_t MIN_MERGE_RANGE_PAGES = 256;
 
+// Merges the entries of `oi` and `ni` that come before `end`, or all of them
+// if it's null, into `out`.
+void
+mergeRange(BucketInputIterator& oi, BucketInputIterator& ni,
+           std::vector<BucketInputIterator>& shadowIterators,
+           LedgerKey const* end, BucketOutputIterator& out)
+{
     BucketEntryIdCmp cmp;
-    while (oi || ni)
+    auto inRange = [&](BucketInputIterator& iter) {
+        return iter && (!end || cmp(*iter, *end));
+    };
+
+    for (;;)
     {
-        if (!ni)
+        bool oiInRange = inRange(oi);
+        bool niInRange = inRange(ni);
+        if (!oiInRange && !niInRange)
+        {
+            break;
+        }
+        else if (!niInRange)
         {
             // Out of new entries, take old entries.
             maybePut(out, *oi, shadowIterators);
             ++oi;
         }
-        else if (!oi)
+        else if (!oiInRange)
         {
             // Out of old entries, take new entries.
             maybePut(out, *ni, shadowIterators);
@@ -241,6 +309,167 @@ Bucket::merge(BucketManager& bucketManager,
             ++ni;
         }
     }
+}
+
+// Returns the keys splitting the merge of `oldBucket` and `newBucket` in key
+// ranges to merge concurrently, or nothing if they are too small for it.
+std::vector<LedgerKey>
+getMergeSplitKeys(BucketManager& bucketManager,
+                  std::shared_ptr<Bucket> const& oldBucket,
+                  std::shared_ptr<Bucket> const& newBucket)
+{
+    auto parallelism = bucketManager.getMergeParallelism();
+    if (parallelism <= 1)
+    {
+        return {};
+    }
+
+    // the index of the largest input tells how to split the work evenly
+    std::shared_ptr<Bucket> largest;
+    size_t pages = 0;
+    for (auto const& b : {oldBucket, newBucket})
+    {
+        if (!b->getFilename().empty() && b->getIndex().countPages() > pages)
+        {
+            largest = b;
+            pages = b->getIndex().countPages();
+        }
+    }
+    auto nbRanges =
+        std::min<size_t>(parallelism, pages / MIN_MERGE_RANGE_PAGES);
+    if (nbRanges <= 1)
+    {
+        return {};
+    }
+    return largest->getIndex().getSplitKeys(nbRanges);
+}
+
+// Key ranges of a merge, that are merged by the thread calling Bucket::merge
+// and by worker threads until there are none left. It's shared with the
+// tasks posted to worker threads, as some may only start after the merge is
+// done.
+struct MergeRangesState
+{
+    std::vector<std::function<void()>> mRanges;
+    std::atomic<size_t> mNextRange{0};
+
+    std::mutex mMutex;
+    std::condition_variable mDone;
+    size_t mMerged{0};
+    std::exception_ptr mError;
+
+    // merges ranges until there are none left, returns once all the ranges
+    // claimed by this thread are merged
+    void
+    run()
+    {
+        size_t i;
+        while ((i = mNextRange++) < mRanges.size())
+        {
+            std::exception_ptr error;
+            try
+            {
+                mRanges[i]();
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (error && !mError)
+            {
+                mError = error;
+            }
+            if (++mMerged == mRanges.size())
+            {
+                mDone.notify_all();
+            }
+        }
+    }
+};
+}
+
+std::shared_ptr<Bucket>
+Bucket::merge(BucketManager& bucketManager,
+              std::shared_ptr<Bucket> const& oldBucket,
+              std::shared_ptr<Bucket> const& newBucket,
+              std::vector<std::shared_ptr<Bucket>> const& shadows,
+              bool keepDeadEntries)
+{
+    // This is the key operation in the scheme: merging two (read-only)
+    // buckets together into a new 3rd bucket, while calculating its hash,
+    // in a single pass.
+
+    assert(oldBucket);
+    assert(newBucket);
+
+    auto timer = bucketManager.getMergeTimer().TimeScope();
+    BucketOutputIterator out(bucketManager.getTmpDir(), keepDeadEntries);
+
+    auto splitKeys = getMergeSplitKeys(bucketManager, oldBucket, newBucket);
+    if (splitKeys.empty())
+    {
+        BucketInputIterator oi(oldBucket);
+        BucketInputIterator ni(newBucket);
+        std::vector<BucketInputIterator> shadowIterators(shadows.begin(),
+                                                         shadows.end());
+        mergeRange(oi, ni, shadowIterators, nullptr, out);
+        return out.getBucket(bucketManager);
+    }
+
+    // Large buckets are split in key ranges that are merged concurrently,
+    // each into its own file. The files are then concatenated in order,
+    // which gives the same bucket (and hash) as a single pass would.
+    auto state = std::make_shared<MergeRangesState>();
+    std::vector<std::unique_ptr<BucketOutputIterator>> rangeOuts;
+    for (size_t i = 0; i <= splitKeys.size(); ++i)
+    {
+        rangeOuts.emplace_back(make_unique<BucketOutputIterator>(
+            bucketManager.getTmpDir(), keepDeadEntries));
+        auto rangeOut = rangeOuts.back().get();
+        auto begin = i == 0 ? nullptr : &splitKeys[i - 1];
+        auto end = i == splitKeys.size() ? nullptr : &splitKeys[i];
+        state->mRanges.emplace_back([&, rangeOut, begin, end]() {
+            BucketInputIterator oi(oldBucket);
+            BucketInputIterator ni(newBucket);
+            std::vector<BucketInputIterator> shadowIterators(shadows.begin(),
+                                                             shadows.end());
+            if (begin)
+            {
+                oi.seek(*begin);
+                ni.seek(*begin);
+                for (auto& si : shadowIterators)
+                {
+                    si.seek(*begin);
+                }
+            }
+            mergeRange(oi, ni, shadowIterators, end, *rangeOut);
+        });
+    }
+
+    for (size_t i = 1; i < state->mRanges.size(); ++i)
+    {
+        bucketManager.postMergeTask([state]() { state->run(); });
+    }
+    // the calling thread takes part, so that this never waits on tasks that
+    // did not start: it only waits for ranges that are being merged
+    state->run();
+    {
+        std::unique_lock<std::mutex> lock(state->mMutex);
+        state->mDone.wait(lock, [&state]() {
+            return state->mMerged == state->mRanges.size();
+        });
+        if (state->mError)
+        {
+            std::rethrow_exception(state->mError);
+        }
+    }
+
+    for (auto& rangeOut : rangeOuts)
+    {
+        out.append(*rangeOut);
+    }
     return out.getBucket(bucketManager);
 }
 
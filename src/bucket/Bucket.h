@@ -4,11 +4,14 @@
 // under the Apache License, Version 2.0. See the COPYING file at the root
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
+#include "bucket/BucketIndex.h"
 #include "bucket/LedgerCmp.h"
 #include "crypto/Hex.h"
 #include "overlay/StellarXDR.h"
 #include "util/NonCopyable.h"
 #include "util/XDRStream.h"
+#include <memory>
+#include <mutex>
 #include <string>
 
 namespace medida
@@ -30,6 +33,7 @@ namespace stellar
  * merged in sorted order, and all elements are hashed while being added.
  */
 
+class Application;
 class BucketManager;
 class BucketList;
 class Database;
@@ -41,6 +45,11 @@ class Bucket : public std::enable_shared_from_this<Bucket>,
     std::string const mFilename;
     Hash const mHash;
 
+    // index used by getEntry, loaded on first use unless it was given at
+    // construction
+    mutable std::once_flag mIndexOnce;
+    mutable std::unique_ptr<BucketIndex> mIndex;
+
   public:
     // Create an empty bucket. The empty bucket has hash '000000...' and its
     // filename is the empty string.
@@ -51,9 +60,23 @@ class Bucket : public std::enable_shared_from_this<Bucket>,
     // needs to ensure that.
     Bucket(std::string const& filename, Hash const& hash);
 
+    // Same as above, with an index of the file, built while writing it.
+    Bucket(std::string const& filename, Hash const& hash,
+           std::unique_ptr<BucketIndex> index);
+
     Hash const& getHash() const;
     std::string const& getFilename() const;
 
+    // Returns the index of the bucket file, loading it from disk (or
+    // rebuilding it, if it's missing) on first use. Must not be called on the
+    // empty bucket.
+    BucketIndex const& getIndex() const;
+
+    // Returns the entry for `key` in this bucket (either live or dead), or
+    // nullptr if the bucket doesn't have one. Only reads the page of the file
+    // that may hold `key`, if any.
+    std::shared_ptr<BucketEntry> getEntry(LedgerKey const& key) const;
+
     // Returns true if a BucketEntry that is key-wise identical to the given
     // BucketEntry exists in the bucket. For testing.
     bool containsBucketIdentity(BucketEntry const& id) const;
@@ -66,7 +89,7 @@ class Bucket : public std::enable_shared_from_this<Bucket>,
     // the entry is live, creates or updates the corresponding entry in the
     // database; if the entry is dead (a tombstone), deletes the corresponding
     // entry in the database.
-    void apply(Database& db) const;
+    void apply(Application& app) const;
 
     // Create a fresh bucket from a given vector of live LedgerEntries and
     // dead LedgerEntryKeys. The bucket will be sorted, hashed, and adopted
@@ -5,54 +5,149 @@
 #include "util/asio.h"
 #include "bucket/BucketApplicator.h"
 #include "bucket/Bucket.h"
-#include "ledger/LedgerDelta.h"
+#include "ledger/EntryFrame.h"
+#include "main/Application.h"
 #include "util/Logging.h"
+#include <atomic>
+#include <future>
 
 namespace stellar
 {
 
-BucketApplicator::BucketApplicator(Database& db,
+const size_t BucketApplicator::BATCH_SIZE = 1024;
+
+// A batch of entries read by a worker thread, or by the applicator itself if
+// no worker picked it up by the time it's needed.
+struct BucketApplicator::PendingBatch
+{
+    std::atomic<bool> mClaimed{false};
+    std::promise<std::vector<BucketEntry>> mEntries;
+};
+
+namespace
+{
+std::vector<BucketEntry>
+readBatch(BucketInputIterator& iter)
+{
+    std::vector<BucketEntry> res;
+    res.reserve(BucketApplicator::BATCH_SIZE);
+    for (; iter && res.size() < BucketApplicator::BATCH_SIZE; ++iter)
+    {
+        res.emplace_back(*iter);
+    }
+    return res;
+}
+
+void
+fulfill(std::promise<std::vector<BucketEntry>>& promise,
+        BucketInputIterator& iter)
+{
+    try
+    {
+        promise.set_value(readBatch(iter));
+    }
+    catch (...)
+    {
+        promise.set_exception(std::current_exception());
+    }
+}
+}
+
+BucketApplicator::BucketApplicator(Application& app,
                                    std::shared_ptr<const Bucket> bucket)
-    : mDb(db), mBucketIter(bucket)
+    : mApp(app), mDb(app.getDatabase()), mBucketIter(bucket)
 {
+    mBatch = readBatch(mBucketIter);
 }
 
 BucketApplicator::operator bool() const
 {
-    return (bool)mBucketIter;
+    return !mBatch.empty();
+}
+
+std::shared_ptr<BucketApplicator::PendingBatch>
+BucketApplicator::readNextBatch()
+{
+    auto pending = std::make_shared<PendingBatch>();
+    if (mBucketIter)
+    {
+        auto iter = &mBucketIter;
+        mApp.getWorkerIOService().post([pending, iter]() {
+            if (!pending->mClaimed.exchange(true))
+            {
+                fulfill(pending->mEntries, *iter);
+            }
+        });
+    }
+    else
+    {
+        pending->mClaimed = true;
+        pending->mEntries.set_value({});
+    }
+    return pending;
+}
+
+std::vector<BucketEntry>
+BucketApplicator::waitForBatch(PendingBatch& pending)
+{
+    auto entries = pending.mEntries.get_future();
+    if (!pending.mClaimed.exchange(true))
+    {
+        fulfill(pending.mEntries, mBucketIter);
+    }
+    return entries.get();
 }
 
 void
 BucketApplicator::advance()
 {
-    soci::transaction sqlTx(mDb.getSession());
-    while (mBucketIter)
+    auto pending = readNextBatch();
+    try
     {
-        LedgerHeader lh;
-        LedgerDelta delta(lh, mDb, false);
+        soci::transaction sqlTx(mDb.getSession());
 
-        auto const& entry = *mBucketIter;
-        if (entry.type() == LIVEENTRY)
+        std::vector<LedgerKey> keys;
+        std::vector<LedgerEntry> liveEntries;
+        keys.reserve(mBatch.size());
+        for (auto const& entry : mBatch)
         {
-            EntryFrame::pointer ep = EntryFrame::FromXDR(entry.liveEntry());
-            ep->storeAddOrChange(delta, mDb);
+            if (entry.type() == LIVEENTRY)
+            {
+                keys.emplace_back(LedgerEntryKey(entry.liveEntry()));
+                liveEntries.emplace_back(entry.liveEntry());
+            }
+            else
+            {
+                keys.emplace_back(entry.deadEntry());
+            }
         }
-        else
+        EntryFrame::storeDeleteBulk(mDb, keys);
+        EntryFrame::storeAddBulk(mDb, liveEntries);
+
+        mSize += mBatch.size();
+        sqlTx.commit();
+    }
+    catch (...)
+    {
+        // the worker may still be reading from mBucketIter
+        try
         {
-            EntryFrame::storeDelete(delta, mDb, entry.deadEntry());
+            waitForBatch(*pending);
         }
-        ++mBucketIter;
-        // No-op, just to avoid needless rollback.
-        delta.commit();
-        if ((++mSize & 0xff) == 0xff)
+        catch (...)
         {
-            break;
         }
+        throw;
+    }
+
+    mBatch = waitForBatch(*pending);
+    if (mBatch.empty())
+    {
+        // release the statements (open cursors in sqlite) once done
+        mDb.clearPreparedStatementCache();
     }
-    sqlTx.commit();
-    mDb.clearPreparedStatementCache();
 
-    if (!mBucketIter || (mSize & 0xfff) == 0xfff)
+    if (mBatch.empty() || (mSize / BATCH_SIZE) % 4 == 0)
     {
         CLOG(INFO, "Bucket")
             << "Bucket-apply: committed " << mSize << " entries";
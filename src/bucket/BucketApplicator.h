@@ -9,24 +9,43 @@
 #include "database/Database.h"
 #include "util/XDRStream.h"
 #include <memory>
+#include <vector>
 
 namespace stellar
 {
 
+class Application;
 class Database;
 
 // Class that represents a single apply-bucket-to-database operation in
 // progress. Used during history catchup to split up the task of applying
 // bucket into scheduler-friendly, bite-sized pieces.
+//
+// Each call to advance() writes one batch of entries in a single SQL
+// transaction: the rows of all the keys of the batch are deleted, then the
+// live entries are inserted, with one statement per table for each. Meanwhile
+// the next batch is decoded from the bucket file on a worker thread.
 
 class BucketApplicator
 {
+  public:
+    static const size_t BATCH_SIZE;
+
+  private:
+    struct PendingBatch;
+
+    Application& mApp;
     Database& mDb;
+    // only accessed by whoever reads the next batch
     BucketInputIterator mBucketIter;
+    std::vector<BucketEntry> mBatch;
     size_t mSize{0};
 
+    std::shared_ptr<PendingBatch> readNextBatch();
+    std::vector<BucketEntry> waitForBatch(PendingBatch& pending);
+
   public:
-    BucketApplicator(Database& db, std::shared_ptr<const Bucket> bucket);
+    BucketApplicator(Application& app, std::shared_ptr<const Bucket> bucket);
     operator bool() const;
     void advance();
 };
@@ -0,0 +1,241 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "bucket/BucketIndex.h"
+#include "bucket/LedgerCmp.h"
+#include "ledger/EntryFrame.h"
+#include "util/Logging.h"
+#include "util/XDRStream.h"
+#include "util/make_unique.h"
+#include "xdrpp/marshal.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <sodium.h>
+
+namespace stellar
+{
+
+const size_t BucketIndex::PAGE_BYTES = 16 * 1024;
+const size_t BucketIndex::BLOOM_BITS_PER_KEY = 10;
+const uint32_t BucketIndex::BLOOM_HASHES = 7;
+const uint32_t BucketIndex::FORMAT_VERSION = 1;
+
+namespace
+{
+// bit set by the `i`-th hash function for a key hashing to `h`, using double
+// hashing (h1 + i * h2) to derive the functions from a single hash
+size_t
+bloomBit(uint64_t h, uint32_t i, size_t nbBits)
+{
+    uint64_t h1 = h & 0xffffffff;
+    uint64_t h2 = (h >> 32) | 1;
+    return static_cast<size_t>((h1 + i * h2) % nbBits);
+}
+}
+
+uint64_t
+BucketIndex::hashKey(LedgerKey const& key)
+{
+    // the index is persisted, so the hash must not depend on the process:
+    // SipHash with a fixed key
+    static const unsigned char sipKey[crypto_shorthash_KEYBYTES] = {0};
+    auto bytes = xdr::xdr_to_opaque(key);
+    unsigned char out[crypto_shorthash_BYTES];
+    crypto_shorthash(out, bytes.data(), bytes.size(), sipKey);
+    uint64_t res = 0;
+    for (size_t i = 0; i < sizeof(res); ++i)
+    {
+        res = (res << 8) | out[i];
+    }
+    return res;
+}
+
+void
+BucketIndex::add(BucketEntry const& entry, size_t offset)
+{
+    auto key = entry.type() == LIVEENTRY ? LedgerEntryKey(entry.liveEntry())
+                                         : entry.deadEntry();
+    assert(mPageKeys.empty() || LedgerEntryIdCmp{}(mPageKeys.back(), key));
+    if (mPageOffsets.empty() || offset - mPageOffsets.back() >= PAGE_BYTES)
+    {
+        mPageKeys.emplace_back(key);
+        mPageOffsets.emplace_back(offset);
+    }
+    mKeyHashes.emplace_back(hashKey(key));
+}
+
+void
+BucketIndex::append(BucketIndex const& other, size_t offset)
+{
+    assert(mBloomBits.empty() && other.mBloomBits.empty());
+    assert(mPageKeys.empty() || other.mPageKeys.empty() ||
+           LedgerEntryIdCmp{}(mPageKeys.back(), other.mPageKeys.front()));
+    mPageKeys.insert(mPageKeys.end(), other.mPageKeys.begin(),
+                     other.mPageKeys.end());
+    for (auto o : other.mPageOffsets)
+    {
+        mPageOffsets.emplace_back(o + offset);
+    }
+    mKeyHashes.insert(mKeyHashes.end(), other.mKeyHashes.begin(),
+                      other.mKeyHashes.end());
+}
+
+void
+BucketIndex::finish()
+{
+    auto nbBits = mKeyHashes.size() * BLOOM_BITS_PER_KEY;
+    mBloomBits.assign(std::max<size_t>((nbBits + 63) / 64, 1), 0);
+    nbBits = mBloomBits.size() * 64;
+    for (auto h : mKeyHashes)
+    {
+        for (uint32_t i = 0; i < BLOOM_HASHES; ++i)
+        {
+            auto bit = bloomBit(h, i, nbBits);
+            mBloomBits[bit / 64] |= uint64_t(1) << (bit % 64);
+        }
+    }
+    mKeyHashes.clear();
+    mKeyHashes.shrink_to_fit();
+}
+
+bool
+BucketIndex::mayContain(LedgerKey const& key) const
+{
+    if (mBloomBits.empty())
+    {
+        return false;
+    }
+    auto nbBits = mBloomBits.size() * 64;
+    auto h = hashKey(key);
+    for (uint32_t i = 0; i < BLOOM_HASHES; ++i)
+    {
+        auto bit = bloomBit(h, i, nbBits);
+        if ((mBloomBits[bit / 64] & (uint64_t(1) << (bit % 64))) == 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool
+BucketIndex::findPage(LedgerKey const& key, size_t& offset) const
+{
+    auto it = std::upper_bound(mPageKeys.begin(), mPageKeys.end(), key,
+                               LedgerEntryIdCmp{});
+    if (it == mPageKeys.begin())
+    {
+        return false;
+    }
+    offset = mPageOffsets[std::distance(mPageKeys.begin(), it) - 1];
+    return true;
+}
+
+std::vector<LedgerKey>
+BucketIndex::getSplitKeys(size_t nbRanges) const
+{
+    std::vector<LedgerKey> res;
+    size_t last = 0;
+    for (size_t i = 1; i < nbRanges; ++i)
+    {
+        auto page = i * mPageKeys.size() / nbRanges;
+        if (page > last)
+        {
+            res.emplace_back(mPageKeys[page]);
+            last = page;
+        }
+    }
+    return res;
+}
+
+std::string
+BucketIndex::indexFilename(std::string const& bucketFilename)
+{
+    return bucketFilename + ".index";
+}
+
+std::unique_ptr<BucketIndex>
+BucketIndex::build(std::string const& bucketFilename)
+{
+    auto res = make_unique<BucketIndex>();
+    XDRInputFileStream in;
+    in.open(bucketFilename);
+    BucketEntry e;
+    size_t offset = in.pos();
+    while (in.readOne(e))
+    {
+        res->add(e, offset);
+        offset = in.pos();
+    }
+    res->finish();
+    return res;
+}
+
+std::unique_ptr<BucketIndex>
+BucketIndex::load(std::string const& filename)
+{
+    std::ifstream exists(filename);
+    if (!exists)
+    {
+        return nullptr;
+    }
+
+    try
+    {
+        auto res = make_unique<BucketIndex>();
+        XDRInputFileStream in;
+        in.open(filename);
+        uint32_t version = 0, nbHashes = 0;
+        xdr::xvector<uint64_t> bloomBits, pageOffsets;
+        xdr::xvector<LedgerKey> pageKeys;
+        if (!in.readOne(version) || version != FORMAT_VERSION ||
+            !in.readOne(nbHashes) || nbHashes != BLOOM_HASHES ||
+            !in.readOne(bloomBits) || !in.readOne(pageKeys) ||
+            !in.readOne(pageOffsets) || pageKeys.size() != pageOffsets.size())
+        {
+            CLOG(WARNING, "Bucket") << "Ignoring invalid index " << filename;
+            return nullptr;
+        }
+        res->mBloomBits = std::move(bloomBits);
+        res->mPageKeys = std::move(pageKeys);
+        res->mPageOffsets = std::move(pageOffsets);
+        return res;
+    }
+    catch (std::exception& e)
+    {
+        CLOG(WARNING, "Bucket")
+            << "Ignoring unreadable index " << filename << ": " << e.what();
+        return nullptr;
+    }
+}
+
+void
+BucketIndex::save(std::string const& filename) const
+{
+    assert(mKeyHashes.empty());
+    // write to a temporary file first, so that a crash never leaves a
+    // truncated index behind
+    auto tmpFilename = filename + ".tmp";
+    {
+        XDROutputFileStream out;
+        out.open(tmpFilename);
+        xdr::xvector<uint64_t> bloomBits(mBloomBits.begin(), mBloomBits.end());
+        xdr::xvector<LedgerKey> pageKeys(mPageKeys.begin(), mPageKeys.end());
+        xdr::xvector<uint64_t> pageOffsets(mPageOffsets.begin(),
+                                           mPageOffsets.end());
+        out.writeOne(FORMAT_VERSION);
+        out.writeOne(BLOOM_HASHES);
+        out.writeOne(bloomBits);
+        out.writeOne(pageKeys);
+        out.writeOne(pageOffsets);
+        out.close();
+    }
+    if (std::rename(tmpFilename.c_str(), filename.c_str()) != 0)
+    {
+        CLOG(WARNING, "Bucket") << "Failed to save index " << filename;
+        std::remove(tmpFilename.c_str());
+    }
+}
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "overlay/StellarXDR.h"
+#include "util/NonCopyable.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace stellar
+{
+
+/**
+ * Side-car index of a bucket file, used for point lookups of LedgerKeys
+ * without scanning the whole file.
+ *
+ * It is made of:
+ *   - a sparse index: the key and file offset of the first entry of every
+ *     page, a page being a run of entries spanning about PAGE_BYTES of the
+ *     file;
+ *   - a bloom filter of all the keys of the bucket, so that most lookups of
+ *     keys that are not in the bucket don't read the file at all.
+ *
+ * An index is built while the bucket file is written (see
+ * BucketOutputIterator) or by scanning the file, and is persisted next to it
+ * as "<bucket file>.index".
+ */
+class BucketIndex : NonMovableOrCopyable
+{
+  public:
+    // approximate size of the part of the file read by a lookup
+    static const size_t PAGE_BYTES;
+
+  private:
+    static const size_t BLOOM_BITS_PER_KEY;
+    static const uint32_t BLOOM_HASHES;
+    static const uint32_t FORMAT_VERSION;
+
+    std::vector<LedgerKey> mPageKeys;
+    std::vector<uint64_t> mPageOffsets;
+
+    std::vector<uint64_t> mBloomBits;
+    // hashes of the keys added so far, until the bloom filter is built
+    std::vector<uint64_t> mKeyHashes;
+
+    static uint64_t hashKey(LedgerKey const& key);
+
+  public:
+    BucketIndex() = default;
+
+    // adds `entry`, at `offset` in the file: entries must be added in order
+    void add(BucketEntry const& entry, size_t offset);
+    // adds all the entries of `other`, that must follow the entries added so
+    // far and start at `offset` in the file: both indexes must not be finished
+    void append(BucketIndex const& other, size_t offset);
+
+    // builds the bloom filter, once all entries are added
+    void finish();
+
+    // returns false if `key` is certainly not in the bucket
+    bool mayContain(LedgerKey const& key) const;
+
+    // sets `offset` to the offset of the page that may contain `key`, returns
+    // false if `key` comes before the first entry of the bucket
+    bool findPage(LedgerKey const& key, size_t& offset) const;
+
+    size_t
+    countPages() const
+    {
+        return mPageKeys.size();
+    }
+
+    // returns up to `nbRanges - 1` keys splitting the bucket in ranges of
+    // about the same size in the file
+    std::vector<LedgerKey> getSplitKeys(size_t nbRanges) const;
+
+    static std::string indexFilename(std::string const& bucketFilename);
+
+    // returns the index of the bucket file `bucketFilename`, built by
+    // scanning it
+    static std::unique_ptr<BucketIndex>
+    build(std::string const& bucketFilename);
+
+    // returns the index persisted in `filename`, or nullptr if there is none
+    // or it can't be read
+    static std::unique_ptr<BucketIndex> load(std::string const& filename);
+
+    void save(std::string const& filename) const;
+};
+}
@@ -51,6 +51,27 @@ BucketInputIterator::~BucketInputIterator()
     mIn.close();
 }
 
+void
+BucketInputIterator::seek(LedgerKey const& key)
+{
+    BucketEntryIdCmp cmp;
+    if (!mEntryPtr || !cmp(*mEntryPtr, key))
+    {
+        return;
+    }
+
+    size_t offset;
+    if (mBucket->getIndex().findPage(key, offset) && offset > mIn.pos())
+    {
+        mIn.seek(offset);
+        loadEntry();
+    }
+    while (mEntryPtr && cmp(*mEntryPtr, key))
+    {
+        ++(*this);
+    }
+}
+
 BucketInputIterator& BucketInputIterator::operator++()
 {
     if (mIn)
@@ -39,5 +39,9 @@ class BucketInputIterator
     ~BucketInputIterator();
 
     BucketInputIterator& operator++();
+
+    // Moves to the first entry that doesn't come before `key`, skipping the
+    // parts of the file that can't hold it. Can only move forward.
+    void seek(LedgerKey const& key);
 };
 }
@@ -119,8 +119,7 @@ BucketLevel::prepare(Application& app, uint32_t currLedger,
         }
     }
 
-    mNextCurr = FutureBucket(app, curr, snap, shadows,
-                             BucketList::keepDeadEntries(mLevel));
+    mNextCurr = FutureBucket(app, curr, snap, shadows, mLevel);
     assert(mNextCurr.isMerging());
 }
 
@@ -294,6 +293,27 @@ BucketList::getHash() const
     return hsh->finish();
 }
 
+std::shared_ptr<LedgerEntry>
+BucketList::getEntry(LedgerKey const& key) const
+{
+    for (auto const& lev : mLevels)
+    {
+        for (auto const& b : {lev.getCurr(), lev.getSnap()})
+        {
+            auto be = b->getEntry(key);
+            if (be)
+            {
+                if (be->type() == DEADENTRY)
+                {
+                    return nullptr;
+                }
+                return std::make_shared<LedgerEntry>(be->liveEntry());
+            }
+        }
+    }
+    return nullptr;
+}
+
 bool
 BucketList::levelShouldSpill(uint32_t ledger, uint32_t level)
 {
@@ -431,7 +451,7 @@ BucketList::restartMerges(Application& app)
         auto& next = level.getNext();
         if (next.hasHashes() && !next.isLive())
         {
-            next.makeLive(app, keepDeadEntries(i));
+            next.makeLive(app, i);
             if (next.isMerging())
             {
                 CLOG(INFO, "Bucket")
@@ -339,6 +339,11 @@ class BucketList
     // of the concatenation of the hashes of the `curr` and `snap` buckets.
     Hash getHash() const;
 
+    // Return the current state of the entry for `key`, looking it up in every
+    // bucket from the newest to the oldest: nullptr if the newest bucket
+    // having `key` holds a dead entry, or if no bucket has it.
+    std::shared_ptr<LedgerEntry> getEntry(LedgerKey const& key) const;
+
     // Restart any merges that might be running on background worker threads,
     // merging buckets between levels. This needs to be called after forcing a
     // BucketList to adopt a new state, either at application restart or when
@@ -5,8 +5,10 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "bucket/Bucket.h"
+#include "bucket/BucketIndex.h"
 #include "overlay/StellarXDR.h"
 #include "util/NonCopyable.h"
+#include <functional>
 #include <memory>
 
 #include "medida/timer_context.h"
@@ -56,6 +58,13 @@ class BucketManager : NonMovableOrCopyable
 
     virtual medida::Timer& getMergeTimer() = 0;
 
+    // Maximum number of key ranges that a merge of large buckets is split
+    // into, to be merged concurrently (see Bucket::merge).
+    virtual uint32_t getMergeParallelism() const = 0;
+
+    // Run `task` on a worker thread, to merge a key range.
+    virtual void postMergeTask(std::function<void()> task) = 0;
+
     // Get a reference to a persistent bucket (in the BucketManager's bucket
     // directory), from the BucketManager's shared bucket-set.
     //
@@ -64,12 +73,16 @@ class BucketManager : NonMovableOrCopyable
     // otherwise move `filename` to the bucket directory, stored under `hash`,
     // and return a new bucket pointing to that.
     //
+    // If `index` is set, it's the index of `filename` (see BucketIndex) and is
+    // persisted next to the adopted bucket.
+    //
     // This method is mostly-threadsafe -- assuming you don't destruct the
     // BucketManager mid-call -- and is intended to be called from both main and
     // worker threads. Very carefully.
     virtual std::shared_ptr<Bucket>
     adoptFileAsBucket(std::string const& filename, uint256 const& hash,
-                      size_t nObjects = 0, size_t nBytes = 0) = 0;
+                      size_t nObjects = 0, size_t nBytes = 0,
+                      std::unique_ptr<BucketIndex> index = nullptr) = 0;
 
     // Return a bucket by hash if we have it, else return nullptr.
     virtual std::shared_ptr<Bucket> getBucketByHash(uint256 const& hash) = 0;
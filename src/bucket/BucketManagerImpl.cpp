@@ -2,10 +2,16 @@
 // under the Apache License, Version 2.0. See the COPYING file at the root
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
+// ASIO is somewhat particular about when it gets included -- it wants to be the
+// first to include <windows.h> -- so we try to include it before everything
+// else.
+#include "util/asio.h"
 #include "bucket/BucketManagerImpl.h"
 #include "bucket/BucketList.h"
 #include "crypto/Hex.h"
+#include "database/Database.h"
 #include "history/HistoryManager.h"
+#include "ledger/BucketListReader.h"
 #include "main/Application.h"
 #include "main/Config.h"
 #include "overlay/StellarXDR.h"
@@ -82,7 +88,7 @@ bucketBasename(std::string const& bucketHexHash)
 bool
 isBucketFile(std::string const& name)
 {
-    static std::regex re("^bucket-[a-z0-9]{64}\\.xdr(\\.gz)?$");
+    static std::regex re("^bucket-[a-z0-9]{64}\\.xdr(\\.gz|\\.index)?$");
     return std::regex_match(name, re);
 };
 
@@ -160,10 +166,23 @@ BucketManagerImpl::getMergeTimer()
     return mBucketSnapMerge;
 }
 
+uint32_t
+BucketManagerImpl::getMergeParallelism() const
+{
+    return mApp.getConfig().BUCKET_MERGE_PARALLELISM;
+}
+
+void
+BucketManagerImpl::postMergeTask(std::function<void()> task)
+{
+    mApp.getWorkerIOService().post(std::move(task));
+}
+
 std::shared_ptr<Bucket>
 BucketManagerImpl::adoptFileAsBucket(std::string const& filename,
                                      uint256 const& hash, size_t nObjects,
-                                     size_t nBytes)
+                                     size_t nBytes,
+                                     std::unique_ptr<BucketIndex> index)
 {
     std::lock_guard<std::recursive_mutex> lock(mBucketMutex);
     // Check to see if we have an existing bucket (either in-memory or on-disk)
@@ -188,7 +207,11 @@ BucketManagerImpl::adoptFileAsBucket(std::string const& filename,
             throw std::runtime_error(err);
         }
 
-        b = std::make_shared<Bucket>(canonicalName, hash);
+        if (index)
+        {
+            index->save(BucketIndex::indexFilename(canonicalName));
+        }
+        b = std::make_shared<Bucket>(canonicalName, hash, std::move(index));
         {
             mSharedBuckets.insert(std::make_pair(hash, b));
             mSharedBucketsSize.set_count(mSharedBuckets.size());
@@ -320,6 +343,8 @@ BucketManagerImpl::forgetUnreferencedBuckets()
                 std::remove(filename.c_str());
                 auto gzfilename = filename + ".gz";
                 std::remove(gzfilename.c_str());
+                auto indexFilename = BucketIndex::indexFilename(filename);
+                std::remove(indexFilename.c_str());
             }
             mSharedBuckets.erase(j);
         }
@@ -334,6 +359,7 @@ BucketManagerImpl::addBatch(Application& app, uint32_t currLedger,
 {
     auto timer = mBucketAddBatch.TimeScope();
     mBucketList.addBatch(app, currLedger, liveEntries, deadEntries);
+    mApp.getDatabase().getBucketListReader().batchAdded();
 }
 
 // updates the given LedgerHeader to reflect the current state of the bucket
@@ -404,6 +430,7 @@ BucketManagerImpl::assumeState(HistoryArchiveState const& has)
 
     mBucketList.restartMerges(mApp);
     cleanupStaleFiles();
+    mApp.getDatabase().getBucketListReader().stateAssumed();
 }
 
 void
@@ -61,10 +61,12 @@ class BucketManagerImpl : public BucketManager
     std::string const& getBucketDir() override;
     BucketList& getBucketList() override;
     medida::Timer& getMergeTimer() override;
-    std::shared_ptr<Bucket> adoptFileAsBucket(std::string const& filename,
-                                              uint256 const& hash,
-                                              size_t nObjects,
-                                              size_t nBytes) override;
+    uint32_t getMergeParallelism() const override;
+    void postMergeTask(std::function<void()> task) override;
+    std::shared_ptr<Bucket>
+    adoptFileAsBucket(std::string const& filename, uint256 const& hash,
+                      size_t nObjects, size_t nBytes,
+                      std::unique_ptr<BucketIndex> index) override;
     std::shared_ptr<Bucket> getBucketByHash(uint256 const& hash) override;
 
     void forgetUnreferencedBuckets() override;
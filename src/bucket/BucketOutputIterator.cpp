@@ -4,6 +4,7 @@
 
 #include "bucket/BucketOutputIterator.h"
 #include "bucket/Bucket.h"
+#include "bucket/BucketIndex.h"
 #include "bucket/BucketManager.h"
 #include "crypto/Random.h"
 #include "util/make_unique.h"
@@ -38,6 +39,7 @@ BucketOutputIterator::BucketOutputIterator(std::string const& tmpDir,
     : mFilename(randomBucketName(tmpDir))
     , mBuf(nullptr)
     , mHasher(SHA256::create())
+    , mIndex(make_unique<BucketIndex>())
     , mKeepDeadEntries(keepDeadEntries)
 {
     CLOG(TRACE, "Bucket") << "BucketOutputIterator opening file to write: "
@@ -45,6 +47,20 @@ BucketOutputIterator::BucketOutputIterator(std::string const& tmpDir,
     mOut.open(mFilename);
 }
 
+BucketOutputIterator::~BucketOutputIterator()
+{
+}
+
+void
+BucketOutputIterator::writeOne(BucketEntry const& e)
+{
+    // the index is built along the way, so that it doesn't need another scan
+    // of the file
+    mIndex->add(e, mBytesPut);
+    mOut.writeOne(e, mHasher.get(), &mBytesPut);
+    mObjectsPut++;
+}
+
 void
 BucketOutputIterator::put(BucketEntry const& e)
 {
@@ -64,8 +80,7 @@ BucketOutputIterator::put(BucketEntry const& e)
         // merely replace (same identity), the buffered entry.
         if (mCmp(*mBuf, e))
         {
-            mOut.writeOne(*mBuf, mHasher.get(), &mBytesPut);
-            mObjectsPut++;
+            writeOne(*mBuf);
         }
     }
     else
@@ -77,16 +92,57 @@ BucketOutputIterator::put(BucketEntry const& e)
     *mBuf = e;
 }
 
-std::shared_ptr<Bucket>
-BucketOutputIterator::getBucket(BucketManager& bucketManager)
+void
+BucketOutputIterator::writeBuffered()
 {
-    assert(mOut);
     if (mBuf)
     {
-        mOut.writeOne(*mBuf, mHasher.get(), &mBytesPut);
-        mObjectsPut++;
+        writeOne(*mBuf);
         mBuf.reset();
     }
+}
+
+void
+BucketOutputIterator::append(BucketOutputIterator& other)
+{
+    writeBuffered();
+    other.writeBuffered();
+    other.mOut.close();
+
+    std::ifstream in(other.mFilename, std::ifstream::binary);
+    std::vector<char> buf(256 * 1024);
+    size_t copied = 0;
+    while (in)
+    {
+        in.read(buf.data(), buf.size());
+        auto n = static_cast<size_t>(in.gcount());
+        if (n == 0)
+        {
+            break;
+        }
+        mHasher->add(ByteSlice(buf.data(), n));
+        mOut.writeBytes(buf.data(), n);
+        copied += n;
+    }
+    if (copied != other.mBytesPut)
+    {
+        throw std::runtime_error("failed to read bucket file " +
+                                 other.mFilename);
+    }
+
+    mIndex->append(*other.mIndex, mBytesPut);
+    mBytesPut += other.mBytesPut;
+    mObjectsPut += other.mObjectsPut;
+    other.mBytesPut = 0;
+    other.mObjectsPut = 0;
+    std::remove(other.mFilename.c_str());
+}
+
+std::shared_ptr<Bucket>
+BucketOutputIterator::getBucket(BucketManager& bucketManager)
+{
+    assert(mOut);
+    writeBuffered();
 
     mOut.close();
     if (mObjectsPut == 0 || mBytesPut == 0)
@@ -97,7 +153,9 @@ BucketOutputIterator::getBucket(BucketManager& bucketManager)
         std::remove(mFilename.c_str());
         return std::make_shared<Bucket>();
     }
+    mIndex->finish();
     return bucketManager.adoptFileAsBucket(mFilename, mHasher->finish(),
-                                           mObjectsPut, mBytesPut);
+                                           mObjectsPut, mBytesPut,
+                                           std::move(mIndex));
 }
 }
@@ -15,6 +15,7 @@ namespace stellar
 {
 
 class Bucket;
+class BucketIndex;
 class BucketManager;
 
 // Helper class that writes new elements to a file and returns a bucket
@@ -26,15 +27,25 @@ class BucketOutputIterator
     BucketEntryIdCmp mCmp;
     std::unique_ptr<BucketEntry> mBuf;
     std::unique_ptr<SHA256> mHasher;
+    std::unique_ptr<BucketIndex> mIndex;
     size_t mBytesPut{0};
     size_t mObjectsPut{0};
     bool mKeepDeadEntries{true};
 
+    void writeOne(BucketEntry const& e);
+    void writeBuffered();
+
   public:
     BucketOutputIterator(std::string const& tmpDir, bool keepDeadEntries);
+    ~BucketOutputIterator();
 
     void put(BucketEntry const& e);
 
+    // Appends the entries put in `other`, that must all come after the
+    // entries put so far, and deletes its file. Entries are copied as is, so
+    // that the result is the same as if they had been put here.
+    void append(BucketOutputIterator& other);
+
     std::shared_ptr<Bucket> getBucket(BucketManager& bucketManager);
 };
 }
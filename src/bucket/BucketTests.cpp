@@ -7,6 +7,8 @@
 // else.
 #include "util/asio.h"
 #include "bucket/Bucket.h"
+#include "bucket/BucketApplicator.h"
+#include "bucket/BucketIndex.h"
 #include "bucket/BucketInputIterator.h"
 #include "bucket/BucketList.h"
 #include "bucket/BucketManager.h"
@@ -15,6 +17,7 @@
 #include "crypto/Hex.h"
 #include "database/Database.h"
 #include "herder/LedgerCloseData.h"
+#include "ledger/EntryFrame.h"
 #include "ledger/LedgerManager.h"
 #include "ledger/LedgerTestUtils.h"
 #include "lib/catch.hpp"
@@ -30,8 +33,11 @@
 #include "util/TmpDir.h"
 #include "util/types.h"
 #include "xdrpp/autocheck.h"
+#include "xdrpp/marshal.h"
 #include <algorithm>
+#include <chrono>
 #include <future>
+#include <map>
 
 using namespace stellar;
 
@@ -492,6 +498,265 @@ TEST_CASE("file-backed buckets", "[bucket][bucketbench]")
     CLOG(DEBUG, "Bucket") << "Spill file size: " << fileSize(b1->getFilename());
 }
 
+TEST_CASE("bucket merge throughput", "[bucket][bucketbench][bench][!hide]")
+{
+    VirtualClock clock;
+    Config const& cfg = getTestConfig();
+    Application::pointer app = createTestApplication(clock, cfg);
+    auto& bm = app->getBucketManager();
+
+    // each bucket is built from batches of entries to bound memory use;
+    // raise nBatches to benchmark multi-GB buckets
+    size_t const batchSize = 100000;
+    size_t const nBatches = 10;
+    auto makeBucket = [&]() {
+        std::shared_ptr<Bucket> b = std::make_shared<Bucket>();
+        std::vector<LedgerEntry> live(batchSize);
+        for (size_t i = 0; i < nBatches; ++i)
+        {
+            for (auto& e : live)
+            {
+                e = LedgerTestUtils::generateValidLedgerEntry(3);
+            }
+            b = Bucket::merge(bm, b, Bucket::fresh(bm, live, {}));
+        }
+        return b;
+    };
+
+    CLOG(INFO, "Bucket") << "Generating 2 buckets of " << batchSize * nBatches
+                         << " entries";
+    auto b1 = makeBucket();
+    auto b2 = makeBucket();
+    size_t entries = countEntries(b1) + countEntries(b2);
+    double bytes = static_cast<double>(fileSize(b1->getFilename())) +
+                   static_cast<double>(fileSize(b2->getFilename()));
+
+    auto start = std::chrono::steady_clock::now();
+    auto merged = Bucket::merge(bm, b1, b2);
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    CLOG(INFO, "Bucket") << "Merged " << entries << " entries ("
+                         << bytes / (1024 * 1024) << " MB) in "
+                         << elapsed.count() << "s: "
+                         << entries / elapsed.count() << " entries/s, "
+                         << bytes / (1024 * 1024) / elapsed.count() << " MB/s";
+    REQUIRE(countEntries(merged) <= entries);
+}
+
+TEST_CASE("parallel bucket merge", "[bucket][bucketmerge]")
+{
+    VirtualClock clock;
+    Config const& cfg = getTestConfig();
+    REQUIRE(cfg.BUCKET_MERGE_PARALLELISM > 1);
+    Application::pointer app = createTestApplication(clock, cfg);
+    auto& bm = app->getBucketManager();
+
+    // the old bucket must be large enough to be split in several ranges
+    std::map<LedgerKey, LedgerEntry, LedgerEntryIdCmp> entries;
+    size_t bytes = 0;
+    while (bytes < 3 * 256 * BucketIndex::PAGE_BYTES)
+    {
+        auto e = LedgerTestUtils::generateValidLedgerEntry(3);
+        bytes += xdr::xdr_size(e);
+        entries[LedgerEntryKey(e)] = e;
+    }
+    std::vector<LedgerEntry> oldLive;
+    for (auto const& kv : entries)
+        oldLive.emplace_back(kv.second);
+    auto oldBucket = Bucket::fresh(bm, oldLive, {});
+    REQUIRE(oldBucket->getIndex().countPages() >= 2 * 256);
+
+    // the new bucket updates a third of the entries, deletes another third
+    // and adds a few
+    std::vector<LedgerEntry> newLive;
+    std::vector<LedgerKey> newDead;
+    size_t i = 0;
+    for (auto& kv : entries)
+    {
+        if (i % 3 == 0)
+        {
+            kv.second.lastModifiedLedgerSeq++;
+            newLive.emplace_back(kv.second);
+        }
+        else if (i % 3 == 1)
+        {
+            newDead.emplace_back(kv.first);
+        }
+        ++i;
+    }
+    for (auto const& k : newDead)
+    {
+        entries.erase(k);
+    }
+    for (i = 0; i < 1000; ++i)
+    {
+        auto e = LedgerTestUtils::generateValidLedgerEntry(3);
+        if (entries.find(LedgerEntryKey(e)) == entries.end())
+        {
+            entries[LedgerEntryKey(e)] = e;
+            newLive.emplace_back(e);
+        }
+    }
+    auto newBucket = Bucket::fresh(bm, newLive, newDead);
+
+    // a single pass over the expected content gives the reference hash
+    std::vector<LedgerEntry> expectedLive;
+    for (auto const& kv : entries)
+        expectedLive.emplace_back(kv.second);
+    auto expected = Bucket::fresh(bm, expectedLive, newDead);
+
+    auto merged = Bucket::merge(bm, oldBucket, newBucket);
+    REQUIRE(merged->getHash() == expected->getHash());
+    REQUIRE(countEntries(merged) == expectedLive.size() + newDead.size());
+
+    // the index of the concatenated output is usable for lookups
+    for (auto const& e : newLive)
+    {
+        auto found = merged->getEntry(LedgerEntryKey(e));
+        REQUIRE(found);
+        REQUIRE(found->type() == LIVEENTRY);
+        REQUIRE(found->liveEntry() == e);
+    }
+    for (auto const& k : newDead)
+    {
+        auto found = merged->getEntry(k);
+        REQUIRE(found);
+        REQUIRE(found->type() == DEADENTRY);
+    }
+}
+
+TEST_CASE("bucket point lookups", "[bucket][bucketindex]")
+{
+    VirtualClock clock;
+    Config const& cfg = getTestConfig();
+    Application::pointer app = createTestApplication(clock, cfg);
+    auto& bm = app->getBucketManager();
+
+    autocheck::generator<LedgerKey> deadGen;
+    std::vector<LedgerEntry> live(5000);
+    std::vector<LedgerKey> dead(500);
+    for (auto& e : live)
+        e = LedgerTestUtils::generateValidLedgerEntry(3);
+    for (auto& e : dead)
+        e = deadGen(3);
+    auto b = Bucket::fresh(bm, live, dead);
+    REQUIRE(b->getIndex().countPages() > 1);
+
+    auto checkLookups = [&](std::shared_ptr<Bucket> bucket) {
+        for (BucketInputIterator iter(b); iter; ++iter)
+        {
+            auto const& be = *iter;
+            auto key = be.type() == LIVEENTRY
+                           ? LedgerEntryKey(be.liveEntry())
+                           : be.deadEntry();
+            auto found = bucket->getEntry(key);
+            REQUIRE(found);
+            REQUIRE(*found == be);
+        }
+
+        for (int i = 0; i < 100; ++i)
+        {
+            REQUIRE(!bucket->getEntry(deadGen(3)));
+        }
+    };
+
+    SECTION("index built while writing")
+    {
+        REQUIRE(fs::exists(BucketIndex::indexFilename(b->getFilename())));
+        checkLookups(b);
+    }
+
+    SECTION("index loaded from disk")
+    {
+        auto loaded =
+            BucketIndex::load(BucketIndex::indexFilename(b->getFilename()));
+        REQUIRE(loaded);
+        REQUIRE(loaded->countPages() == b->getIndex().countPages());
+        checkLookups(std::make_shared<Bucket>(b->getFilename(), b->getHash()));
+    }
+
+    SECTION("index rebuilt when missing or invalid")
+    {
+        auto indexFilename = BucketIndex::indexFilename(b->getFilename());
+        std::remove(indexFilename.c_str());
+        checkLookups(std::make_shared<Bucket>(b->getFilename(), b->getHash()));
+        REQUIRE(fs::exists(indexFilename));
+
+        {
+            std::ofstream out(indexFilename, std::ofstream::trunc);
+            out << "garbage";
+        }
+        REQUIRE(!BucketIndex::load(indexFilename));
+        checkLookups(std::make_shared<Bucket>(b->getFilename(), b->getHash()));
+    }
+
+    SECTION("empty bucket")
+    {
+        REQUIRE(!std::make_shared<Bucket>()->getEntry(deadGen(3)));
+    }
+}
+
+TEST_CASE("bucket list point lookups", "[bucket][bucketindex]")
+{
+    VirtualClock clock;
+    Config const& cfg = getTestConfig();
+    Application::pointer app = createTestApplication(clock, cfg);
+    BucketList bl;
+
+    auto alice = LedgerTestUtils::generateValidAccountEntry(5);
+    auto bob = LedgerTestUtils::generateValidAccountEntry(5);
+    LedgerEntry aliceEntry, bobEntry;
+    aliceEntry.data.type(ACCOUNT);
+    aliceEntry.data.account() = alice;
+    bobEntry.data.type(ACCOUNT);
+    bobEntry.data.account() = bob;
+    auto aliceKey = LedgerEntryKey(aliceEntry);
+    auto bobKey = LedgerEntryKey(bobEntry);
+
+    autocheck::generator<std::vector<LedgerKey>> deadGen;
+    for (uint32_t i = 1; !app->getClock().getIOService().stopped() && i < 300;
+         ++i)
+    {
+        app->getClock().crank(false);
+        auto liveBatch = LedgerTestUtils::generateValidLedgerEntries(5);
+        auto deadBatch = deadGen(5);
+        if (i == 1)
+        {
+            liveBatch.push_back(bobEntry);
+        }
+        if (i == 200)
+        {
+            deadBatch.push_back(bobKey);
+        }
+        // alice changes often, so her entry is spread over many buckets
+        if (i % 7 == 0)
+        {
+            alice.balance++;
+            aliceEntry.data.account() = alice;
+            liveBatch.push_back(aliceEntry);
+        }
+        bl.addBatch(*app, i, liveBatch, deadBatch);
+
+        if (i >= 7)
+        {
+            auto found = bl.getEntry(aliceKey);
+            REQUIRE(found);
+            REQUIRE(*found == aliceEntry);
+        }
+        auto found = bl.getEntry(bobKey);
+        if (i < 200)
+        {
+            REQUIRE(found);
+            REQUIRE(*found == bobEntry);
+        }
+        else
+        {
+            REQUIRE(!found);
+        }
+    }
+}
+
 TEST_CASE("merging bucket entries", "[bucket]")
 {
     VirtualClock clock;
@@ -1098,45 +1363,123 @@ TEST_CASE("bucket apply", "[bucket]")
 
     CLOG(INFO, "Bucket") << "Applying bucket with " << live.size()
                          << " live entries";
-    birth->apply(db);
+    birth->apply(*app);
     auto count = AccountFrame::countObjects(sess);
     REQUIRE(count == live.size() + 1 /* root account */);
 
     CLOG(INFO, "Bucket") << "Applying bucket with " << dead.size()
                          << " dead entries";
-    death->apply(db);
+    death->apply(*app);
     count = AccountFrame::countObjects(sess);
     REQUIRE(count == 1);
 }
 
+TEST_CASE("bucket apply replaces existing entries", "[bucket]")
+{
+    VirtualClock clock;
+    Config cfg(getTestConfig());
+    Application::pointer app = createTestApplication(clock, cfg);
+    app->start();
+    auto& db = app->getDatabase();
+
+    // spans several batches of the applicator
+    std::map<LedgerKey, LedgerEntry, LedgerEntryIdCmp> entries;
+    for (auto const& e : LedgerTestUtils::generateValidLedgerEntries(
+             3 * BucketApplicator::BATCH_SIZE))
+    {
+        entries[LedgerEntryKey(e)] = e;
+    }
+    std::vector<LedgerEntry> live;
+    for (auto const& kv : entries)
+        live.emplace_back(kv.second);
+    Bucket::fresh(app->getBucketManager(), live, {})->apply(*app);
+    for (auto const& e : live)
+    {
+        REQUIRE(EntryFrame::checkAgainstDatabase(e, db) == "");
+    }
+
+    // updates half of the entries and deletes the other half
+    std::vector<LedgerEntry> changed;
+    std::vector<LedgerKey> dead;
+    size_t i = 0;
+    for (auto& kv : entries)
+    {
+        if (i++ % 2 == 0)
+        {
+            auto& e = kv.second;
+            e.lastModifiedLedgerSeq++;
+            if (e.data.type() == ACCOUNT)
+            {
+                e.data.account().signers.clear();
+            }
+            changed.emplace_back(e);
+        }
+        else
+        {
+            dead.emplace_back(kv.first);
+        }
+    }
+    Bucket::fresh(app->getBucketManager(), changed, dead)->apply(*app);
+    for (auto const& e : changed)
+    {
+        REQUIRE(EntryFrame::checkAgainstDatabase(e, db) == "");
+    }
+    for (auto const& k : dead)
+    {
+        REQUIRE(!EntryFrame::exists(db, k));
+    }
+}
+
 TEST_CASE("bucket apply bench", "[bucketbench][!hide]")
 {
-    auto runtest = [](Config::TestDbMode mode) {
+    // buckets are applied oldest first, as catchup does, and each one
+    // updates some of the entries of the previous one; raise nBuckets and
+    // bucketSize to benchmark mainnet-sized states
+    size_t const nBuckets = 8;
+    size_t const bucketSize = 250000;
+
+    auto runtest = [&](Config::TestDbMode mode) {
         VirtualClock clock;
         Config cfg(getTestConfig(0, mode));
         Application::pointer app = createTestApplication(clock, cfg);
         app->start();
-
-        std::vector<LedgerEntry> live(100000);
-        std::vector<LedgerKey> noDead;
-
-        for (auto& l : live)
+        auto& bm = app->getBucketManager();
+
+        CLOG(INFO, "Bucket") << "Generating " << nBuckets << " buckets of "
+                             << bucketSize << " entries";
+        std::vector<std::shared_ptr<Bucket>> buckets;
+        std::vector<LedgerEntry> previous;
+        size_t entries = 0;
+        for (size_t i = 0; i < nBuckets; ++i)
         {
-            l.data.type(ACCOUNT);
-            auto& a = l.data.account();
-            a = LedgerTestUtils::generateValidAccountEntry(5);
+            std::vector<LedgerEntry> live;
+            live.reserve(bucketSize);
+            for (size_t j = 0; j < previous.size() / 4; ++j)
+            {
+                live.emplace_back(previous[j]);
+                live.back().lastModifiedLedgerSeq++;
+            }
+            while (live.size() < bucketSize)
+            {
+                live.emplace_back(LedgerTestUtils::generateValidLedgerEntry(5));
+            }
+            buckets.emplace_back(Bucket::fresh(bm, live, {}));
+            entries += countEntries(buckets.back());
+            previous = std::move(live);
         }
 
-        std::shared_ptr<Bucket> birth =
-            Bucket::fresh(app->getBucketManager(), live, noDead);
-
-        auto& db = app->getDatabase();
-
-        CLOG(INFO, "Bucket")
-            << "Applying bucket with " << live.size() << " live entries";
-        // note: we do not wrap the `apply` call inside a transaction
+        // note: we do not wrap the `apply` calls inside a transaction
         // as bucket applicator commits to the database incrementally
-        birth->apply(db);
+        auto start = std::chrono::steady_clock::now();
+        for (auto const& b : buckets)
+        {
+            b->apply(*app);
+        }
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+        CLOG(INFO, "Bucket") << "Applied " << entries << " entries in "
+                             << elapsed.count() << "s: "
+                             << entries / elapsed.count() << " entries/s";
     };
 
     SECTION("sqlite")
@@ -8,10 +8,13 @@
 #include "util/asio.h"
 
 #include "bucket/Bucket.h"
+#include "bucket/BucketList.h"
 #include "bucket/BucketManager.h"
 #include "bucket/FutureBucket.h"
 #include "crypto/Hex.h"
 #include "main/Application.h"
+#include "medida/metrics_registry.h"
+#include "medida/timer.h"
 #include "util/Logging.h"
 
 #include <chrono>
@@ -23,7 +26,7 @@ FutureBucket::FutureBucket(Application& app,
                            std::shared_ptr<Bucket> const& curr,
                            std::shared_ptr<Bucket> const& snap,
                            std::vector<std::shared_ptr<Bucket>> const& shadows,
-                           bool keepDeadEntries)
+                           uint32_t level)
     : mState(FB_LIVE_INPUTS)
     , mInputCurrBucket(curr)
     , mInputSnapBucket(snap)
@@ -40,7 +43,7 @@ FutureBucket::FutureBucket(Application& app,
     {
         mInputShadowBucketHashes.push_back(binToHex(b->getHash()));
     }
-    startMerge(app, keepDeadEntries);
+    startMerge(app, level);
 }
 
 void
@@ -244,7 +247,7 @@ FutureBucket::getOutputHash() const
 }
 
 void
-FutureBucket::startMerge(Application& app, bool keepDeadEntries)
+FutureBucket::startMerge(Application& app, uint32_t level)
 {
     // NB: startMerge starts with FutureBucket in a half-valid state; the inputs
     // are live but the merge is not yet running. So you can't call checkState()
@@ -265,15 +268,22 @@ FutureBucket::startMerge(Application& app, bool keepDeadEntries)
                           << " with snap=" << hexAbbrev(snap->getHash());
 
     BucketManager& bm = app.getBucketManager();
+    bool keepDeadEntries = BucketList::keepDeadEntries(level);
+    // wall time of the merges of each level, including the time spent
+    // waiting for a worker thread
+    auto& mergeTime = app.getMetrics().NewTimer(
+        {"bucket", "merge-time", "level-" + std::to_string(level)});
+    auto start = std::chrono::steady_clock::now();
 
     using task_t = std::packaged_task<std::shared_ptr<Bucket>()>;
-    std::shared_ptr<task_t> task =
-        std::make_shared<task_t>([curr, snap, &bm, shadows, keepDeadEntries]() {
+    std::shared_ptr<task_t> task = std::make_shared<task_t>(
+        [curr, snap, &bm, shadows, keepDeadEntries, &mergeTime, start]() {
             CLOG(TRACE, "Bucket")
                 << "Worker merging curr=" << hexAbbrev(curr->getHash())
                 << " with snap=" << hexAbbrev(snap->getHash());
 
             auto res = Bucket::merge(bm, curr, snap, shadows, keepDeadEntries);
+            mergeTime.Update(std::chrono::steady_clock::now() - start);
 
             CLOG(TRACE, "Bucket")
                 << "Worker finished merging curr=" << hexAbbrev(curr->getHash())
@@ -288,7 +298,7 @@ FutureBucket::startMerge(Application& app, bool keepDeadEntries)
 }
 
 void
-FutureBucket::makeLive(Application& app, bool keepDeadEntries)
+FutureBucket::makeLive(Application& app, uint32_t level)
 {
     checkState();
     assert(!isLive());
@@ -314,7 +324,7 @@ FutureBucket::makeLive(Application& app, bool keepDeadEntries)
             mInputShadowBuckets.push_back(b);
         }
         mState = FB_LIVE_INPUTS;
-        startMerge(app, keepDeadEntries);
+        startMerge(app, level);
         assert(isLive());
     }
 }
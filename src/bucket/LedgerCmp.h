@@ -90,7 +90,7 @@ struct LedgerEntryIdCmp
 /**
  * Compare two BucketEntries for identity by comparing their respective
  * LedgerEntries (ignoring their hashes, as the LedgerEntryIdCmp ignores their
- * bodies).
+ * bodies). BucketEntries can also be compared with LedgerKeys.
  */
 struct BucketEntryIdCmp
 {
@@ -124,5 +124,31 @@ struct BucketEntryIdCmp
             }
         }
     }
+
+    bool
+    operator()(BucketEntry const& a, LedgerKey const& b) const
+    {
+        if (a.type() == LIVEENTRY)
+        {
+            return LedgerEntryIdCmp{}(a.liveEntry().data, b);
+        }
+        else
+        {
+            return LedgerEntryIdCmp{}(a.deadEntry(), b);
+        }
+    }
+
+    bool
+    operator()(LedgerKey const& a, BucketEntry const& b) const
+    {
+        if (b.type() == LIVEENTRY)
+        {
+            return LedgerEntryIdCmp{}(a, b.liveEntry().data);
+        }
+        else
+        {
+            return LedgerEntryIdCmp{}(a, b.deadEntry());
+        }
+    }
 };
 }
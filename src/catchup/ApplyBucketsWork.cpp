@@ -106,7 +106,7 @@ ApplyBucketsWork::onStart()
     {
         mSnapBucket = getBucket(i.snap);
         mSnapApplicator =
-            make_unique<BucketApplicator>(mApp.getDatabase(), mSnapBucket);
+            make_unique<BucketApplicator>(mApp, mSnapBucket);
         CLOG(DEBUG, "History") << "ApplyBuckets : starting level[" << mLevel
                                << "].snap = " << i.snap;
         mApplying = true;
@@ -116,7 +116,7 @@ ApplyBucketsWork::onStart()
     {
         mCurrBucket = getBucket(i.curr);
         mCurrApplicator =
-            make_unique<BucketApplicator>(mApp.getDatabase(), mCurrBucket);
+            make_unique<BucketApplicator>(mApp, mCurrBucket);
         CLOG(DEBUG, "History") << "ApplyBuckets : starting level[" << mLevel
                                << "].curr = " << i.curr;
         mApplying = true;
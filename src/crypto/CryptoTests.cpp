@@ -11,10 +11,14 @@
 #include "lib/catch.hpp"
 #include "test/test.h"
 #include "util/Logging.h"
+#include <algorithm>
+#include <atomic>
 #include <autocheck/autocheck.hpp>
+#include <chrono>
 #include <map>
 #include <regex>
 #include <sodium.h>
+#include <thread>
 
 using namespace stellar;
 
@@ -115,6 +119,10 @@ TEST_CASE("HMAC test vector", "[crypto]")
     auto v = hmacSha256(k, s);
     REQUIRE(h == v.mac);
     REQUIRE(hmacSha256Verify(v, k, s));
+
+    auto parts = hmacSha256(k, {"The quick brown fox ", "",
+                                "jumps over the lazy dog"});
+    REQUIRE(h == parts.mac);
 }
 
 TEST_CASE("HKDF test vector", "[crypto]")
@@ -208,6 +216,121 @@ TEST_CASE("sign and verify benchmarking", "[crypto-bench][bench][!hide]")
     }
 }
 
+TEST_CASE("verify signature cache", "[crypto]")
+{
+    PubKeyUtils::clearVerifySigCache();
+    uint64_t hits, misses;
+    PubKeyUtils::flushVerifySigCacheCounts(hits, misses);
+
+    size_t const n = 200;
+    std::vector<SignVerifyTestcase> cases;
+    for (size_t i = 0; i < n; ++i)
+    {
+        cases.push_back(SignVerifyTestcase::create());
+        cases.back().sign();
+    }
+
+    size_t const nbThreads = 4;
+    std::atomic<size_t> verified{0};
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < nbThreads; ++t)
+    {
+        threads.emplace_back([&cases, &verified]() {
+            for (auto const& c : cases)
+            {
+                if (PubKeyUtils::verifySig(c.pub, c.sig, c.msg))
+                {
+                    ++verified;
+                }
+            }
+        });
+    }
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+    REQUIRE(verified == n * nbThreads);
+
+    uint64_t shardHits = 0, shardMisses = 0;
+    for (auto const& c : PubKeyUtils::getVerifySigCacheShardCounts())
+    {
+        shardHits += c.first;
+        shardMisses += c.second;
+    }
+    PubKeyUtils::flushVerifySigCacheCounts(hits, misses);
+    REQUIRE(hits == shardHits);
+    REQUIRE(misses == shardMisses);
+    REQUIRE(hits + misses == n * nbThreads);
+    // threads may race to verify a signature before it is cached
+    REQUIRE(misses >= n);
+    REQUIRE(misses <= n * nbThreads);
+
+    for (auto const& c : cases)
+    {
+        CHECK(PubKeyUtils::verifySig(c.pub, c.sig, c.msg));
+    }
+    PubKeyUtils::flushVerifySigCacheCounts(hits, misses);
+    REQUIRE(hits == n);
+    REQUIRE(misses == 0);
+}
+
+TEST_CASE("verify signature cache scaling", "[crypto-bench][bench][!hide]")
+{
+    size_t const n = 20000;
+    std::vector<SignVerifyTestcase> cases;
+    for (size_t i = 0; i < n; ++i)
+    {
+        cases.push_back(SignVerifyTestcase::create());
+        cases.back().sign();
+    }
+
+    auto maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    auto run = [&cases](size_t nbThreads) {
+        std::vector<std::thread> threads;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t t = 0; t < nbThreads; ++t)
+        {
+            threads.emplace_back([&cases, t, nbThreads]() {
+                for (size_t i = t; i < cases.size(); i += nbThreads)
+                {
+                    auto const& c = cases[i];
+                    PubKeyUtils::verifySig(c.pub, c.sig, c.msg);
+                }
+            });
+        }
+        for (auto& t : threads)
+        {
+            t.join();
+        }
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+        return cases.size() / elapsed.count();
+    };
+
+    for (size_t nbThreads = 1; nbThreads <= maxThreads; nbThreads *= 2)
+    {
+        PubKeyUtils::clearVerifySigCache();
+        auto missRate = run(nbThreads);
+        auto hitRate = run(nbThreads);
+        LOG(INFO) << nbThreads << " threads: " << missRate
+                  << " verifications/s (cache misses), " << hitRate
+                  << " verifications/s (cache hits)";
+    }
+
+    auto shardCounts = PubKeyUtils::getVerifySigCacheShardCounts();
+    auto lookups = [](std::pair<uint64_t, uint64_t> const& c) {
+        return c.first + c.second;
+    };
+    auto minmax = std::minmax_element(
+        shardCounts.begin(), shardCounts.end(),
+        [&](std::pair<uint64_t, uint64_t> const& a,
+            std::pair<uint64_t, uint64_t> const& b) {
+            return lookups(a) < lookups(b);
+        });
+    LOG(INFO) << "lookups per shard: min " << lookups(*minmax.first)
+              << ", max " << lookups(*minmax.second);
+}
+
 TEST_CASE("StrKey tests", "[crypto]")
 {
     std::regex b32("^([A-Z2-7])+$");
@@ -98,6 +98,32 @@ hmacSha256(HmacSha256Key const& key, ByteSlice const& bin)
     return out;
 }
 
+HmacSha256Mac
+hmacSha256(HmacSha256Key const& key, std::vector<ByteSlice> const& bins)
+{
+    HmacSha256Mac out;
+    crypto_auth_hmacsha256_state state;
+    if (crypto_auth_hmacsha256_init(&state, key.key.data(), key.key.size()) !=
+        0)
+    {
+        throw std::runtime_error("error from crypto_auth_hmacsha256_init");
+    }
+    for (auto const& bin : bins)
+    {
+        if (crypto_auth_hmacsha256_update(&state, bin.data(), bin.size()) !=
+            0)
+        {
+            throw std::runtime_error(
+                "error from crypto_auth_hmacsha256_update");
+        }
+    }
+    if (crypto_auth_hmacsha256_final(&state, out.mac.data()) != 0)
+    {
+        throw std::runtime_error("error from crypto_auth_hmacsha256_final");
+    }
+    return out;
+}
+
 bool
 hmacSha256Verify(HmacSha256Mac const& hmac, HmacSha256Key const& key,
                  ByteSlice const& bin)
@@ -7,6 +7,7 @@
 #include "crypto/ByteSlice.h"
 #include "xdr/Stellar-types.h"
 #include <memory>
+#include <vector>
 
 namespace stellar
 {
@@ -28,6 +29,10 @@ class SHA256
 // HMAC-SHA256 (keyed)
 HmacSha256Mac hmacSha256(HmacSha256Key const& key, ByteSlice const& bin);
 
+// HMAC-SHA256 of the concatenation of `bins`, without copying them.
+HmacSha256Mac hmacSha256(HmacSha256Key const& key,
+                         std::vector<ByteSlice> const& bins);
+
 // Use this rather than HMAC-output ==, to avoid timing leaks.
 bool hmacSha256Verify(HmacSha256Mac const& hmac, HmacSha256Key const& key,
                       ByteSlice const& bin);
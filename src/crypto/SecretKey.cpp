@@ -12,10 +12,14 @@
 #include "util/HashOfHash.h"
 #include "util/lrucache.hpp"
 #include "util/make_unique.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <memory>
 #include <mutex>
 #include <sodium.h>
 #include <type_traits>
+#include <unordered_set>
 
 namespace stellar
 {
@@ -26,12 +30,37 @@ namespace stellar
 // to the state of the process; caching its results centrally
 // makes all signature-verification in the program faster and
 // has no effect on correctness.
+//
+// It is split into shards (selected by the cache key, itself a hash) that
+// each have their own lock, LRU list and hit/miss counters, so that
+// signatures can be verified from several threads without contending on a
+// single lock.
+
+static const size_t VERIFY_SIG_CACHE_SHARDS = 64;
 
-static std::mutex gVerifySigCacheMutex;
-static cache::lru_cache<Hash, bool> gVerifySigCache(0xffff);
-static std::unique_ptr<SHA256> gHasher = SHA256::create();
-static uint64_t gVerifyCacheHit = 0;
-static uint64_t gVerifyCacheMiss = 0;
+namespace
+{
+struct VerifySigCacheShard
+{
+    std::mutex mMutex;
+    std::unique_ptr<cache::lru_cache<Hash, bool>> mCache{
+        make_unique<cache::lru_cache<Hash, bool>>(
+            PubKeyUtils::DEFAULT_VERIFY_SIG_CACHE_SIZE /
+            VERIFY_SIG_CACHE_SHARDS)};
+    uint64_t mHits{0};
+    uint64_t mMisses{0};
+};
+}
+
+static std::mutex gVerifySigCacheSizeMutex;
+static size_t gVerifySigCacheSize = PubKeyUtils::DEFAULT_VERIFY_SIG_CACHE_SIZE;
+static VerifySigCacheShard gVerifySigCacheShards[VERIFY_SIG_CACHE_SHARDS];
+
+static VerifySigCacheShard&
+verifySigCacheShard(Hash const& cacheKey)
+{
+    return gVerifySigCacheShards[cacheKey[0] % VERIFY_SIG_CACHE_SHARDS];
+}
 
 static Hash
 verifySigCacheKey(PublicKey const& key, Signature const& signature,
@@ -39,11 +68,13 @@ verifySigCacheKey(PublicKey const& key, Signature const& signature,
 {
     assert(key.type() == PUBLIC_KEY_TYPE_ED25519);
 
-    gHasher->reset();
-    gHasher->add(key.ed25519());
-    gHasher->add(signature);
-    gHasher->add(bin);
-    return gHasher->finish();
+    // signatures may be verified from worker threads
+    static thread_local std::unique_ptr<SHA256> hasher = SHA256::create();
+    hasher->reset();
+    hasher->add(key.ed25519());
+    hasher->add(signature);
+    hasher->add(bin);
+    return hasher->finish();
 }
 
 SecretKey::SecretKey() : mKeyType(PUBLIC_KEY_TYPE_ED25519)
@@ -188,18 +219,57 @@ SecretKey::fromStrKeySeed(std::string const& strKeySeed)
 void
 PubKeyUtils::clearVerifySigCache()
 {
-    std::lock_guard<std::mutex> guard(gVerifySigCacheMutex);
-    gVerifySigCache.clear();
+    for (auto& shard : gVerifySigCacheShards)
+    {
+        std::lock_guard<std::mutex> guard(shard.mMutex);
+        shard.mCache->clear();
+    }
+}
+
+void
+PubKeyUtils::setVerifySigCacheSize(size_t size)
+{
+    std::lock_guard<std::mutex> sizeGuard(gVerifySigCacheSizeMutex);
+    if (size == gVerifySigCacheSize)
+    {
+        return;
+    }
+    gVerifySigCacheSize = size;
+
+    auto shardSize = std::max<size_t>(size / VERIFY_SIG_CACHE_SHARDS, 1);
+    for (auto& shard : gVerifySigCacheShards)
+    {
+        std::lock_guard<std::mutex> guard(shard.mMutex);
+        shard.mCache = make_unique<cache::lru_cache<Hash, bool>>(shardSize);
+    }
 }
 
 void
 PubKeyUtils::flushVerifySigCacheCounts(uint64_t& hits, uint64_t& misses)
 {
-    std::lock_guard<std::mutex> guard(gVerifySigCacheMutex);
-    hits = gVerifyCacheHit;
-    misses = gVerifyCacheMiss;
-    gVerifyCacheHit = 0;
-    gVerifyCacheMiss = 0;
+    hits = 0;
+    misses = 0;
+    for (auto& shard : gVerifySigCacheShards)
+    {
+        std::lock_guard<std::mutex> guard(shard.mMutex);
+        hits += shard.mHits;
+        misses += shard.mMisses;
+        shard.mHits = 0;
+        shard.mMisses = 0;
+    }
+}
+
+std::vector<std::pair<uint64_t, uint64_t>>
+PubKeyUtils::getVerifySigCacheShardCounts()
+{
+    std::vector<std::pair<uint64_t, uint64_t>> res;
+    res.reserve(VERIFY_SIG_CACHE_SHARDS);
+    for (auto& shard : gVerifySigCacheShards)
+    {
+        std::lock_guard<std::mutex> guard(shard.mMutex);
+        res.emplace_back(shard.mHits, shard.mMisses);
+    }
+    return res;
 }
 
 std::string
@@ -269,6 +339,19 @@ KeyFunctions<PublicKey>::getKeyValue(PublicKey const& key)
     }
 }
 
+static bool
+verifyAndCache(PublicKey const& key, Signature const& signature,
+               ByteSlice const& bin, Hash const& cacheKey,
+               VerifySigCacheShard& shard)
+{
+    bool ok =
+        (crypto_sign_verify_detached(signature.data(), bin.data(), bin.size(),
+                                     key.ed25519().data()) == 0);
+    std::lock_guard<std::mutex> guard(shard.mMutex);
+    shard.mCache->put(cacheKey, ok);
+    return ok;
+}
+
 bool
 PubKeyUtils::verifySig(PublicKey const& key, Signature const& signature,
                        ByteSlice const& bin)
@@ -280,23 +363,124 @@ PubKeyUtils::verifySig(PublicKey const& key, Signature const& signature,
     }
 
     auto cacheKey = verifySigCacheKey(key, signature, bin);
+    auto& shard = verifySigCacheShard(cacheKey);
 
     {
-        std::lock_guard<std::mutex> guard(gVerifySigCacheMutex);
-        if (gVerifySigCache.exists(cacheKey))
+        std::lock_guard<std::mutex> guard(shard.mMutex);
+        if (shard.mCache->exists(cacheKey))
         {
-            ++gVerifyCacheHit;
-            return gVerifySigCache.get(cacheKey);
+            ++shard.mHits;
+            return shard.mCache->get(cacheKey);
         }
+        ++shard.mMisses;
     }
 
-    ++gVerifyCacheMiss;
-    bool ok =
-        (crypto_sign_verify_detached(signature.data(), bin.data(), bin.size(),
-                                     key.ed25519().data()) == 0);
-    std::lock_guard<std::mutex> guard(gVerifySigCacheMutex);
-    gVerifySigCache.put(cacheKey, ok);
-    return ok;
+    return verifyAndCache(key, signature, bin, cacheKey, shard);
+}
+
+namespace
+{
+// number of signatures verified by a thread at a time
+const size_t VERIFY_SIGS_CHUNK_SIZE = 16;
+
+// shared with the tasks running on other threads, that may start after
+// verifySigs has returned
+struct VerifySigsState
+{
+    std::vector<PubKeyUtils::SignatureToVerify> mSigs;
+    std::vector<Hash> mCacheKeys;
+    std::atomic<size_t> mNextChunk{0};
+
+    std::mutex mMutex;
+    std::condition_variable mDone;
+    size_t mVerified{0};
+    std::chrono::nanoseconds mVerifyTime{0};
+
+    // verifies chunks until there are none left, returns once all the
+    // chunks claimed by this thread are verified
+    void
+    run()
+    {
+        size_t i;
+        while ((i = mNextChunk++ * VERIFY_SIGS_CHUNK_SIZE) < mSigs.size())
+        {
+            auto end = std::min(i + VERIFY_SIGS_CHUNK_SIZE, mSigs.size());
+            auto start = std::chrono::steady_clock::now();
+            for (auto j = i; j < end; ++j)
+            {
+                auto const& s = mSigs[j];
+                verifyAndCache(s.key, s.signature, s.data, mCacheKeys[j],
+                               verifySigCacheShard(mCacheKeys[j]));
+            }
+            auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start);
+
+            std::lock_guard<std::mutex> lock(mMutex);
+            mVerifyTime += elapsed;
+            mVerified += end - i;
+            if (mVerified == mSigs.size())
+            {
+                mDone.notify_all();
+            }
+        }
+    }
+};
+}
+
+std::chrono::nanoseconds
+PubKeyUtils::verifySigs(std::vector<SignatureToVerify> sigs,
+                        std::function<void(std::function<void()>)> const& post,
+                        size_t nbTasks)
+{
+    // only verify signatures that are neither cached nor repeated
+    auto state = std::make_shared<VerifySigsState>();
+    std::unordered_set<Hash> seen;
+    for (auto& s : sigs)
+    {
+        assert(s.key.type() == PUBLIC_KEY_TYPE_ED25519);
+        if (s.signature.size() != 64)
+        {
+            continue;
+        }
+        auto cacheKey = verifySigCacheKey(s.key, s.signature, s.data);
+        if (!seen.insert(cacheKey).second)
+        {
+            continue;
+        }
+        auto& shard = verifySigCacheShard(cacheKey);
+        {
+            std::lock_guard<std::mutex> guard(shard.mMutex);
+            if (shard.mCache->exists(cacheKey))
+            {
+                continue;
+            }
+            ++shard.mMisses;
+        }
+        state->mSigs.emplace_back(std::move(s));
+        state->mCacheKeys.emplace_back(cacheKey);
+    }
+    if (state->mSigs.empty())
+    {
+        return std::chrono::nanoseconds::zero();
+    }
+
+    auto chunks = (state->mSigs.size() + VERIFY_SIGS_CHUNK_SIZE - 1) /
+                  VERIFY_SIGS_CHUNK_SIZE;
+    nbTasks = std::min(nbTasks, chunks - 1);
+    for (size_t i = 0; i < nbTasks; ++i)
+    {
+        post([state]() { state->run(); });
+    }
+
+    // the calling thread takes part, so that this never waits on tasks that
+    // did not start (other threads may be busy): it only waits for chunks
+    // that are being verified
+    state->run();
+    std::unique_lock<std::mutex> lock(state->mMutex);
+    state->mDone.wait(lock, [&state]() {
+        return state->mVerified == state->mSigs.size();
+    });
+    return state->mVerifyTime;
 }
 
 PublicKey
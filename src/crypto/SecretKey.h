@@ -9,8 +9,11 @@
 #include "xdr/Stellar-types.h"
 
 #include <array>
+#include <chrono>
 #include <functional>
 #include <ostream>
+#include <utility>
+#include <vector>
 
 namespace stellar
 {
@@ -101,8 +104,37 @@ namespace PubKeyUtils
 bool verifySig(PublicKey const& key, Signature const& signature,
                ByteSlice const& bin);
 
+// A signature to check against `data` under `key`, for verifying signatures
+// ahead of the time they are needed.
+struct SignatureToVerify
+{
+    PublicKey key;
+    Signature signature;
+    std::vector<uint8_t> data;
+};
+
+// Verifies `sigs` as a batch, filling the verification cache so that later
+// calls to verifySig for them are cache hits. Signatures that are already
+// cached or repeated in the batch are only verified once. The work is shared
+// between the calling thread and up to `nbTasks` tasks handed to `post`, that
+// must run them on other threads. Returns the time spent verifying, summed
+// over all threads.
+std::chrono::nanoseconds
+verifySigs(std::vector<SignatureToVerify> sigs,
+           std::function<void(std::function<void()>)> const& post,
+           size_t nbTasks);
+
+// Number of verification results kept in cache unless configured otherwise.
+size_t const DEFAULT_VERIFY_SIG_CACHE_SIZE = 0xffff;
+
 void clearVerifySigCache();
+// Sets the number of verification results kept in cache (clears it if the
+// size changes).
+void setVerifySigCacheSize(size_t size);
+// Returns the total hit and miss counts since the last call, and resets them.
 void flushVerifySigCacheCounts(uint64_t& hits, uint64_t& misses);
+// Returns the (hits, misses) of each shard of the cache since the last flush.
+std::vector<std::pair<uint64_t, uint64_t>> getVerifySigCacheShardCounts();
 
 PublicKey random();
 }
@@ -18,9 +18,13 @@
 #include "herder/HerderPersistence.h"
 #include "history/HistoryManager.h"
 #include "ledger/AccountFrame.h"
+#include "ledger/AccountWriteBuffer.h"
 #include "ledger/DataFrame.h"
+#include "ledger/BucketListReader.h"
+#include "ledger/LedgerEntryCache.h"
 #include "ledger/LedgerHeaderFrame.h"
 #include "ledger/OfferFrame.h"
+#include "ledger/OrderBook.h"
 #include "ledger/TrustFrame.h"
 #include "main/ExternalQueue.h"
 #include "main/PersistentState.h"
@@ -29,6 +33,7 @@
 #include "transactions/TransactionFrame.h"
 
 #include "medida/counter.h"
+#include "medida/meter.h"
 #include "medida/metrics_registry.h"
 #include "medida/timer.h"
 
@@ -80,9 +85,12 @@ Database::Database(Application& app)
     : mApp(app)
     , mQueryMeter(
           app.getMetrics().NewMeter({"database", "query", "exec"}, "query"))
+    , mDemandLoadMeter(app.getMetrics().NewMeter(
+          {"ledger", "prefetch", "demand-load"}, "entry"))
     , mStatementsSize(
           app.getMetrics().NewCounter({"database", "memory", "statements"}))
-    , mEntryCache(4096)
+    , mEntryCache(make_unique<LedgerEntryCache>(
+          app.getMetrics(), app.getConfig().ENTRY_CACHE_SIZE_MB * 1024 * 1024))
     , mExcludedQueryTime(0)
     , mExcludedTotalTime(0)
     , mLastIdleQueryTime(0)
@@ -105,6 +113,14 @@ Database::Database(Application& app)
     {
         setSerializable(mSession);
     }
+
+    mOrderBook = make_unique<OrderBook>(app, *this);
+    mBucketListReader = make_unique<BucketListReader>(app);
+    mAccountWriteBuffer = make_unique<AccountWriteBuffer>(app);
+}
+
+Database::~Database()
+{
 }
 
 void
@@ -205,10 +221,18 @@ Database::getAppSchemaVersion()
     return SCHEMA_VERSION;
 }
 
+void
+Database::addEntityType(std::string const& entityName)
+{
+    // timers may be acquired from worker threads through a PoolSession
+    std::lock_guard<std::mutex> lock(mEntityTypesMutex);
+    mEntityTypes.insert(entityName);
+}
+
 medida::TimerContext
 Database::getInsertTimer(std::string const& entityName)
 {
-    mEntityTypes.insert(entityName);
+    addEntityType(entityName);
     mQueryMeter.Mark();
     return mApp.getMetrics()
         .NewTimer({"database", "insert", entityName})
@@ -218,7 +242,7 @@ Database::getInsertTimer(std::string const& entityName)
 medida::TimerContext
 Database::getSelectTimer(std::string const& entityName)
 {
-    mEntityTypes.insert(entityName);
+    addEntityType(entityName);
     mQueryMeter.Mark();
     return mApp.getMetrics()
         .NewTimer({"database", "select", entityName})
@@ -228,7 +252,7 @@ Database::getSelectTimer(std::string const& entityName)
 medida::TimerContext
 Database::getDeleteTimer(std::string const& entityName)
 {
-    mEntityTypes.insert(entityName);
+    addEntityType(entityName);
     mQueryMeter.Mark();
     return mApp.getMetrics()
         .NewTimer({"database", "delete", entityName})
@@ -238,7 +262,7 @@ Database::getDeleteTimer(std::string const& entityName)
 medida::TimerContext
 Database::getUpdateTimer(std::string const& entityName)
 {
-    mEntityTypes.insert(entityName);
+    addEntityType(entityName);
     mQueryMeter.Mark();
     return mApp.getMetrics()
         .NewTimer({"database", "update", entityName})
@@ -281,6 +305,15 @@ Database::clearPreparedStatementCache()
     }
     mStatements.clear();
     mStatementsSize.set_count(mStatements.size());
+
+    for (auto& statements : mPoolStatements)
+    {
+        for (auto st : statements)
+        {
+            st.second->clean_up(true);
+        }
+        statements.clear();
+    }
 }
 
 void
@@ -308,6 +341,11 @@ Database::initialize()
 soci::session&
 Database::getSession()
 {
+    auto poolSession = PoolSession::get(*this);
+    if (poolSession)
+    {
+        return poolSession->session();
+    }
     // global session can only be used from the main thread
     assertThreadIsMain();
     return mSession;
@@ -329,6 +367,7 @@ Database::getPool()
         LOG(INFO) << "Establishing " << n << "-entry connection pool to: "
                   << removePasswordFromConnectionString(c.value);
         mPool = make_unique<soci::connection_pool>(n);
+        mPoolStatements.resize(n);
         for (size_t i = 0; i < n; ++i)
         {
             LOG(DEBUG) << "Opening pool entry " << i;
@@ -344,10 +383,66 @@ Database::getPool()
     return *mPool;
 }
 
-cache::lru_cache<std::string, std::shared_ptr<LedgerEntry const>>&
+namespace
+{
+// at most one pooled session is bound to a thread at a time
+thread_local Database::PoolSession const* gThreadPoolSession = nullptr;
+}
+
+Database::PoolSession::PoolSession(Database& db)
+    : mDb(db), mPosition(db.getPool().lease())
+{
+    assert(gThreadPoolSession == nullptr);
+    gThreadPoolSession = this;
+}
+
+Database::PoolSession::~PoolSession()
+{
+    gThreadPoolSession = nullptr;
+    mDb.getPool().give_back(mPosition);
+}
+
+Database::PoolSession const*
+Database::PoolSession::get(Database const& db)
+{
+    auto res = gThreadPoolSession;
+    return res && &res->mDb == &db ? res : nullptr;
+}
+
+soci::session&
+Database::PoolSession::session() const
+{
+    return mDb.getPool().at(mPosition);
+}
+
+Database::StatementCache&
+Database::PoolSession::statements() const
+{
+    return mDb.mPoolStatements.at(mPosition);
+}
+
+LedgerEntryCache&
 Database::getEntryCache()
 {
-    return mEntryCache;
+    return *mEntryCache;
+}
+
+OrderBook&
+Database::getOrderBook()
+{
+    return *mOrderBook;
+}
+
+BucketListReader&
+Database::getBucketListReader()
+{
+    return *mBucketListReader;
+}
+
+AccountWriteBuffer&
+Database::getAccountWriteBuffer()
+{
+    return *mAccountWriteBuffer;
 }
 
 class SQLLogContext : NonCopyable
@@ -389,15 +484,21 @@ class SQLLogContext : NonCopyable
 StatementContext
 Database::getPreparedStatement(std::string const& query)
 {
-    auto i = mStatements.find(query);
+    auto poolSession = PoolSession::get(*this);
+    auto& statements = poolSession ? poolSession->statements() : mStatements;
+    auto i = statements.find(query);
     std::shared_ptr<soci::statement> p;
-    if (i == mStatements.end())
+    if (i == statements.end())
     {
-        p = std::make_shared<soci::statement>(mSession);
+        p = std::make_shared<soci::statement>(
+            poolSession ? poolSession->session() : mSession);
         p->alloc();
         p->prepare(query);
-        mStatements.insert(std::make_pair(query, p));
-        mStatementsSize.set_count(mStatements.size());
+        statements.insert(std::make_pair(query, p));
+        if (!poolSession)
+        {
+            mStatementsSize.set_count(mStatements.size());
+        }
     }
     else
     {
@@ -419,11 +520,18 @@ Database::getQueryMeter()
     return mQueryMeter;
 }
 
+medida::Meter&
+Database::getDemandLoadMeter()
+{
+    return mDemandLoadMeter;
+}
+
 std::chrono::nanoseconds
 Database::totalQueryTime() const
 {
     std::vector<std::string> qtypes = {"insert", "delete", "select", "update"};
     std::chrono::nanoseconds nsq(0);
+    std::lock_guard<std::mutex> lock(mEntityTypesMutex);
     for (auto const& q : qtypes)
     {
         for (auto const& e : mEntityTypes)
@@ -8,10 +8,12 @@
 #include "overlay/StellarXDR.h"
 #include "util/NonCopyable.h"
 #include "util/Timer.h"
-#include "util/lrucache.hpp"
+#include <map>
+#include <mutex>
 #include <set>
 #include <soci.h>
 #include <string>
+#include <vector>
 
 namespace medida
 {
@@ -22,7 +24,11 @@ class Counter;
 
 namespace stellar
 {
+class AccountWriteBuffer;
 class Application;
+class BucketListReader;
+class LedgerEntryCache;
+class OrderBook;
 class SQLLogContext;
 
 /**
@@ -84,20 +90,32 @@ class StatementContext : NonCopyable
  */
 class Database : NonMovableOrCopyable
 {
+    typedef std::map<std::string, std::shared_ptr<soci::statement>>
+        StatementCache;
+
     Application& mApp;
     medida::Meter& mQueryMeter;
+    medida::Meter& mDemandLoadMeter;
     soci::session mSession;
     std::unique_ptr<soci::connection_pool> mPool;
 
-    std::map<std::string, std::shared_ptr<soci::statement>> mStatements;
+    StatementCache mStatements;
     medida::Counter& mStatementsSize;
+    // statements prepared on each session of mPool
+    std::vector<StatementCache> mPoolStatements;
+
+    std::unique_ptr<LedgerEntryCache> mEntryCache;
+
+    std::unique_ptr<OrderBook> mOrderBook;
+
+    std::unique_ptr<BucketListReader> mBucketListReader;
 
-    cache::lru_cache<std::string, std::shared_ptr<LedgerEntry const>>
-        mEntryCache;
+    std::unique_ptr<AccountWriteBuffer> mAccountWriteBuffer;
 
     // Helpers for maintaining the total query time and calculating
     // idle percentage.
     std::set<std::string> mEntityTypes;
+    mutable std::mutex mEntityTypesMutex;
     std::chrono::nanoseconds mExcludedQueryTime;
     std::chrono::nanoseconds mExcludedTotalTime;
     std::chrono::nanoseconds mLastIdleQueryTime;
@@ -107,15 +125,43 @@ class Database : NonMovableOrCopyable
     static void registerDrivers();
     void applySchemaUpgrade(unsigned long vers);
 
+    void addEntityType(std::string const& entityName);
+
   public:
+    // Binds a session of the connection pool to the calling thread while in
+    // scope: getSession and getPreparedStatement then use it rather than the
+    // main session, so that entries can be loaded from worker threads while
+    // the main thread waits for them. getPool must have been called on the
+    // main thread first.
+    class PoolSession : NonMovableOrCopyable
+    {
+        Database& mDb;
+        size_t mPosition;
+
+      public:
+        explicit PoolSession(Database& db);
+        ~PoolSession();
+
+        // session bound to the calling thread for `db`, nullptr if none
+        static PoolSession const* get(Database const& db);
+
+        soci::session& session() const;
+        StatementCache& statements() const;
+    };
+
     // Instantiate object and connect to app.getConfig().DATABASE;
     // if there is a connection error, this will throw.
     Database(Application& app);
+    ~Database();
 
     // Return a crude meter of total queries to the db, for use in
     // overlay/LoadManager.
     medida::Meter& getQueryMeter();
 
+    // Meter of the accounts and trust lines loaded one at a time from the
+    // database, as they were neither cached nor prefetched.
+    medida::Meter& getDemandLoadMeter();
+
     // Number of nanoseconds spent processing queries since app startup,
     // without any reference to excluded time or running counters.
     // Strictly a sum of measured time.
@@ -182,7 +228,8 @@ class Database : NonMovableOrCopyable
     // Check schema version and apply any upgrades if necessary.
     void upgradeToCurrentSchema();
 
-    // Access the underlying SOCI session object
+    // Access the underlying SOCI session object (the pooled session bound to
+    // the calling thread if any, see PoolSession)
     soci::session& getSession();
 
     // Access the optional SOCI connection pool available for worker
@@ -192,9 +239,19 @@ class Database : NonMovableOrCopyable
     // Access the LedgerEntry cache. Note: clients are responsible for
     // invalidating entries in this cache as they perform statements
     // against the database. It's kept here only for ease of access.
-    typedef cache::lru_cache<std::string, std::shared_ptr<LedgerEntry const>>
-        EntryCache;
-    EntryCache& getEntryCache();
+    LedgerEntryCache& getEntryCache();
+
+    // Access the in-memory index of the offers table. Like the entry cache,
+    // it's kept up to date by the store methods of OfferFrame.
+    OrderBook& getOrderBook();
+
+    // Access the view of the BucketList that entries are loaded from, when
+    // enabled, instead of querying the database.
+    BucketListReader& getBucketListReader();
+
+    // Access the account updates not written to the database yet, while
+    // charging fees.
+    AccountWriteBuffer& getAccountWriteBuffer();
 };
 
 class DBTimeExcluder : NonCopyable
@@ -121,6 +121,47 @@ class Herder
                                            const SCPQuorumSet& qset,
                                            TxSetFrame txset) = 0;
 
+    // Envelopes received between these calls (which may nest) are only
+    // processed at the end, so that the ones ready together are processed in
+    // the same batch. abortEnvelopeBatch leaves a batch without processing
+    // anything: envelopes that became ready stay queued until the next batch
+    // ends or the queue is processed.
+    virtual void beginEnvelopeBatch() = 0;
+    virtual void endEnvelopeBatch() = 0;
+    virtual void abortEnvelopeBatch() = 0;
+
+    // begins an envelope batch for its lifetime: commit ends it, processing
+    // the envelopes, otherwise the destructor (reached while unwinding from
+    // an exception) only aborts it
+    class EnvelopeBatch
+    {
+        Herder& mHerder;
+        bool mEnded{false};
+
+      public:
+        explicit EnvelopeBatch(Herder& herder) : mHerder(herder)
+        {
+            mHerder.beginEnvelopeBatch();
+        }
+        ~EnvelopeBatch()
+        {
+            if (!mEnded)
+            {
+                mHerder.abortEnvelopeBatch();
+            }
+        }
+        EnvelopeBatch(EnvelopeBatch const&) = delete;
+        EnvelopeBatch& operator=(EnvelopeBatch const&) = delete;
+
+        void
+        commit()
+        {
+            // the batch is left even if processing the envelopes throws
+            mEnded = true;
+            mHerder.endEnvelopeBatch();
+        }
+    };
+
     // a peer needs our SCP state
     virtual void sendSCPStateToPeer(uint32 ledgerSeq, PeerPtr peer) = 0;
 
@@ -24,8 +24,10 @@
 #include "util/make_unique.h"
 
 #include "medida/counter.h"
+#include "medida/histogram.h"
 #include "medida/meter.h"
 #include "medida/metrics_registry.h"
+#include "medida/timer.h"
 #include "util/Decoder.h"
 #include "util/XDRStream.h"
 #include "xdrpp/marshal.h"
@@ -52,6 +54,10 @@ HerderImpl::SCPMetrics::SCPMetrics(Application& app)
           app.getMetrics().NewMeter({"scp", "envelope", "emit"}, "envelope"))
     , mEnvelopeReceive(
           app.getMetrics().NewMeter({"scp", "envelope", "receive"}, "envelope"))
+    , mEnvelopeBatchSize(
+          app.getMetrics().NewHistogram({"scp", "envelope", "batch-size"}))
+    , mEnvelopeBatchTime(
+          app.getMetrics().NewTimer({"scp", "envelope", "batch"}))
 
     , mKnownSlotsSize(
           app.getMetrics().NewCounter({"scp", "memory", "known-slots"}))
@@ -73,6 +79,8 @@ HerderImpl::HerderImpl(Application& app)
     : mPendingTransactions(4)
     , mPendingEnvelopes(app, *this)
     , mHerderSCPDriver(app, *this, mUpgrades, mPendingEnvelopes)
+    , mEnvelopeBatchDepth(0)
+    , mEnvelopesReadyInBatch(false)
     , mLastSlotSaved(0)
     , mTrackingTimer(app)
     , mTriggerTimer(app)
@@ -417,7 +425,14 @@ HerderImpl::recvSCPEnvelope(SCPEnvelope const& envelope)
     auto status = mPendingEnvelopes.recvSCPEnvelope(envelope);
     if (status == Herder::ENVELOPE_STATUS_READY)
     {
-        processSCPQueue();
+        if (mEnvelopeBatchDepth > 0)
+        {
+            mEnvelopesReadyInBatch = true;
+        }
+        else
+        {
+            processSCPQueue();
+        }
     }
     return status;
 }
@@ -433,6 +448,30 @@ HerderImpl::recvSCPEnvelope(SCPEnvelope const& envelope,
     return recvSCPEnvelope(envelope);
 }
 
+void
+HerderImpl::beginEnvelopeBatch()
+{
+    ++mEnvelopeBatchDepth;
+}
+
+void
+HerderImpl::endEnvelopeBatch()
+{
+    assert(mEnvelopeBatchDepth > 0);
+    if (--mEnvelopeBatchDepth == 0 && mEnvelopesReadyInBatch)
+    {
+        mEnvelopesReadyInBatch = false;
+        processSCPQueue();
+    }
+}
+
+void
+HerderImpl::abortEnvelopeBatch()
+{
+    assert(mEnvelopeBatchDepth > 0);
+    --mEnvelopeBatchDepth;
+}
+
 void
 HerderImpl::sendSCPStateToPeer(uint32 ledgerSeq, PeerPtr peer)
 {
@@ -507,16 +546,19 @@ HerderImpl::processSCPQueue()
 void
 HerderImpl::processSCPQueueUpToIndex(uint64 slotIndex)
 {
-    while (true)
+    auto batchSize = mApp.getConfig().SCP_ENVELOPE_BATCH_SIZE;
+    std::vector<SCPEnvelope> envs;
+    while (mPendingEnvelopes.pop(slotIndex, batchSize, envs))
     {
-        SCPEnvelope env;
-        if (mPendingEnvelopes.pop(slotIndex, env))
+        mSCPMetrics.mEnvelopeBatchSize.Update(envs.size());
+        auto timer = mSCPMetrics.mEnvelopeBatchTime.TimeScope();
+        if (envs.size() == 1)
         {
-            getSCP().receiveEnvelope(env);
+            getSCP().receiveEnvelope(envs.front());
         }
         else
         {
-            return;
+            getSCP().receiveEnvelopes(envs);
         }
     }
 }
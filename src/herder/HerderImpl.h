@@ -19,6 +19,7 @@ namespace medida
 {
 class Meter;
 class Counter;
+class Histogram;
 class Timer;
 }
 
@@ -64,6 +65,10 @@ class HerderImpl : public Herder
                                    const SCPQuorumSet& qset,
                                    TxSetFrame txset) override;
 
+    void beginEnvelopeBatch() override;
+    void endEnvelopeBatch() override;
+    void abortEnvelopeBatch() override;
+
     void sendSCPStateToPeer(uint32 ledgerSeq, PeerPtr peer) override;
 
     bool recvSCPQuorumSet(Hash const& hash, const SCPQuorumSet& qset) override;
@@ -112,6 +117,11 @@ class HerderImpl : public Herder
 
     void processSCPQueueUpToIndex(uint64 slotIndex);
 
+    // number of envelope batches in progress, and whether envelopes became
+    // ready during them
+    int mEnvelopeBatchDepth;
+    bool mEnvelopesReadyInBatch;
+
     // 0- tx we got during ledger close
     // 1- one ledger ago. rebroadcast
     // 2- two ledgers ago. rebroadcast
@@ -164,6 +174,10 @@ class HerderImpl : public Herder
         medida::Meter& mEnvelopeEmit;
         medida::Meter& mEnvelopeReceive;
 
+        // envelopes processed together, and time taken to process them
+        medida::Histogram& mEnvelopeBatchSize;
+        medida::Timer& mEnvelopeBatchTime;
+
         // Counters for stuff in parent class (SCP)
         // that we monitor on a best-effort basis from
         // here.
@@ -23,6 +23,8 @@
 namespace stellar
 {
 
+static size_t const MAX_TX_SET_VALIDITY_CACHE_SIZE = 1000;
+
 HerderSCPDriver::SCPMetrics::SCPMetrics(Application& app)
     : mEnvelopeSign(
           app.getMetrics().NewMeter({"scp", "envelope", "sign"}, "envelope"))
@@ -33,6 +35,13 @@ HerderSCPDriver::SCPMetrics::SCPMetrics(Application& app)
     , mValueValid(app.getMetrics().NewMeter({"scp", "value", "valid"}, "value"))
     , mValueInvalid(
           app.getMetrics().NewMeter({"scp", "value", "invalid"}, "value"))
+    , mTxSetValidityHit(app.getMetrics().NewMeter(
+          {"scp", "txset", "validity-cache-hit"}, "txset"))
+    , mTxSetValidityMiss(app.getMetrics().NewMeter(
+          {"scp", "txset", "validity-cache-miss"}, "txset"))
+    , mTxSetValidate(app.getMetrics().NewTimer({"scp", "txset", "validate"}))
+    , mTxSetValidatePerSlot(
+          app.getMetrics().NewTimer({"scp", "txset", "validate-per-slot"}))
     , mValueExternalize(
           app.getMetrics().NewMeter({"scp", "value", "externalize"}, "value"))
     , mQuorumHeard(
@@ -72,6 +81,7 @@ HerderSCPDriver::HerderSCPDriver(Application& app, HerderImpl& herder,
     , mSCP(*this, mApp.getConfig().NODE_SEED.getPublicKey(),
            mApp.getConfig().NODE_IS_VALIDATOR, mApp.getConfig().QUORUM_SET)
     , mSCPMetrics{mApp}
+    , mTxSetValidateTime{0}
     , mLastStateChange{mApp.getClock().now()}
 {
 }
@@ -257,7 +267,7 @@ HerderSCPDriver::validateValueHelper(uint64_t slotIndex,
 
         res = SCPDriver::kInvalidValue;
     }
-    else if (!txSet->checkValid(mApp))
+    else if (!checkTxSetValid(txSet))
     {
         if (Logging::logDebug("Herder"))
             CLOG(DEBUG, "Herder") << "HerderSCPDriver::validateValue"
@@ -277,6 +287,44 @@ HerderSCPDriver::validateValueHelper(uint64_t slotIndex,
     return res;
 }
 
+bool
+HerderSCPDriver::checkTxSetValid(TxSetFramePtr txSet) const
+{
+    auto const& lclHash = mLedgerManager.getLastClosedLedgerHeader().hash;
+    if (lclHash != mTxSetValidityLCL)
+    {
+        // validity depends on the state of the last closed ledger
+        if (mTxSetValidateTime.count() != 0)
+        {
+            mSCPMetrics.mTxSetValidatePerSlot.Update(mTxSetValidateTime);
+        }
+        mTxSetValidity.clear();
+        mTxSetValidityLCL = lclHash;
+        mTxSetValidateTime = std::chrono::nanoseconds::zero();
+    }
+
+    auto txSetHash = txSet->getContentsHash();
+    auto it = mTxSetValidity.find(txSetHash);
+    if (it != mTxSetValidity.end())
+    {
+        mSCPMetrics.mTxSetValidityHit.Mark();
+        return it->second;
+    }
+    mSCPMetrics.mTxSetValidityMiss.Mark();
+
+    auto timer = mSCPMetrics.mTxSetValidate.TimeScope();
+    bool valid = txSet->checkValid(mApp);
+    mTxSetValidateTime += timer.Stop();
+
+    // only a few tx sets are proposed for a ledger, unless peers misbehave
+    if (mTxSetValidity.size() >= MAX_TX_SET_VALIDITY_CACHE_SIZE)
+    {
+        mTxSetValidity.clear();
+    }
+    mTxSetValidity.emplace(txSetHash, valid);
+    return valid;
+}
+
 SCPDriver::ValidationLevel
 HerderSCPDriver::validateValue(uint64_t slotIndex, Value const& value,
                                bool nomination)
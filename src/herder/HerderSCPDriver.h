@@ -7,7 +7,10 @@
 #include "herder/Herder.h"
 #include "herder/TxSetFrame.h"
 #include "scp/SCPDriver.h"
+#include "util/HashOfHash.h"
 #include "xdr/Stellar-ledger.h"
+#include <chrono>
+#include <unordered_map>
 
 namespace medida
 {
@@ -154,6 +157,13 @@ class HerderSCPDriver : public SCPDriver
         medida::Meter& mValueValid;
         medida::Meter& mValueInvalid;
 
+        // tx set validity cache, and time spent validating tx sets (also
+        // accumulated over each slot)
+        medida::Meter& mTxSetValidityHit;
+        medida::Meter& mTxSetValidityMiss;
+        medida::Timer& mTxSetValidate;
+        medida::Timer& mTxSetValidatePerSlot;
+
         medida::Meter& mValueExternalize;
 
         // listeners
@@ -214,6 +224,16 @@ class HerderSCPDriver : public SCPDriver
     SCPDriver::ValidationLevel
     validateValueHelper(uint64_t slotIndex, StellarValue const& sv) const;
 
+    // results of TxSetFrame::checkValid by tx set hash, valid as long as the
+    // last closed ledger is mTxSetValidityLCL: SCP validates the same values
+    // many times
+    mutable std::unordered_map<Hash, bool> mTxSetValidity;
+    mutable Hash mTxSetValidityLCL;
+    // time spent in TxSetFrame::checkValid since mTxSetValidityLCL closed
+    mutable std::chrono::nanoseconds mTxSetValidateTime;
+
+    bool checkTxSetValid(TxSetFramePtr txSet) const;
+
     // returns true if the local instance is in a state compatible with
     // this slot
     bool isSlotCompatibleWithCurrentState(uint64_t slotIndex) const;
@@ -18,6 +18,9 @@
 #include "ledger/LedgerManager.h"
 #include "lib/catch.hpp"
 #include "main/CommandHandler.h"
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+#include "medida/timer.h"
 #include "overlay/OverlayManager.h"
 #include "test/TxTests.h"
 
@@ -365,6 +368,101 @@ TEST_CASE("txset", "[herder]")
     }
 }
 
+// outcome of checking then trimming a transaction set, see checkTxSet
+struct TxSetCheck
+{
+    bool mValid;
+    std::vector<TransactionResultCode> mResults;
+    std::vector<Hash> mTrimmed;
+    std::vector<Hash> mKept;
+    int64_t mParallelChecks;
+};
+
+// builds the same transaction set on a new application, with valid and
+// invalid transactions from several accounts, then checks and trims it
+static TxSetCheck
+checkTxSet(bool parallel)
+{
+    Config cfg(getTestConfig(0, Config::TESTDB_ON_DISK_SQLITE));
+    cfg.PARALLEL_TX_SET_VALIDATION = parallel;
+
+    VirtualClock clock;
+    Application::pointer app = createTestApplication(clock, cfg);
+    app->start();
+
+    auto root = TestAccount::createRoot(*app);
+    auto& lm = app->getLedgerManager();
+    auto minBalance = lm.getMinBalance(0);
+    auto fee = lm.getTxFee();
+
+    auto a0 = root.create("A0", minBalance + 10 * fee);
+    auto a1 = root.create("A1", minBalance + 10 * fee);
+    auto gap = root.create("gap", minBalance + 10 * fee);
+    auto poor = root.create("poor", minBalance + 2 * fee);
+    auto missing = TestAccount{*app, getAccount("missing")};
+
+    TxSetFrame txSet(lm.getLastClosedLedgerHeader().hash);
+    for (int i = 0; i < 3; i++)
+    {
+        txSet.add(a0.tx({payment(root, 1)}));
+        txSet.add(a1.tx({payment(root, 1)}));
+        auto tx = gap.tx({payment(root, 1)});
+        if (i == 1)
+        {
+            tx->getEnvelope().tx.seqNum += 5;
+        }
+        txSet.add(tx);
+    }
+    for (int i = 0; i < 4; i++)
+    {
+        txSet.add(poor.tx({payment(root, 1)}));
+    }
+    txSet.add(missing.tx({payment(root, 1)}));
+    txSet.sortForHash();
+
+    TxSetCheck res;
+    res.mValid = txSet.checkValid(*app);
+    for (auto const& tx : txSet.mTransactions)
+    {
+        res.mResults.push_back(tx->getResultCode());
+    }
+
+    std::vector<TransactionFramePtr> trimmed;
+    txSet.trimInvalid(*app, trimmed);
+    for (auto const& tx : trimmed)
+    {
+        res.mTrimmed.push_back(tx->getFullHash());
+    }
+    for (auto const& tx : txSet.mTransactions)
+    {
+        res.mKept.push_back(tx->getFullHash());
+    }
+    res.mParallelChecks = app->getMetrics()
+                              .NewTimer({"herder", "txset", "check-parallel"})
+                              .count();
+    return res;
+}
+
+TEST_CASE("txset parallel validation", "[herder]")
+{
+    auto serial = checkTxSet(false);
+    auto parallel = checkTxSet(true);
+
+    REQUIRE(serial.mParallelChecks == 0);
+    REQUIRE(parallel.mParallelChecks == 2);
+
+    REQUIRE(!serial.mValid);
+    REQUIRE(parallel.mValid == serial.mValid);
+    REQUIRE(parallel.mResults == serial.mResults);
+
+    // 2 transactions after the gap, those of the account that can't pay
+    // the fees and that of the missing account
+    REQUIRE(serial.mTrimmed.size() == 7);
+    REQUIRE(parallel.mTrimmed == serial.mTrimmed);
+    REQUIRE(serial.mKept.size() == 7);
+    REQUIRE(parallel.mKept == serial.mKept);
+}
+
 // under surge
 // over surge
 // make sure it drops the correct txs
@@ -577,6 +675,33 @@ TEST_CASE("SCP Driver", "[herder]")
         REQUIRE(sv.txSetHash == txSet1->getContentsHash());
     }
 
+    SECTION("tx set validity is cached until the ledger closes")
+    {
+        auto& herder = static_cast<HerderImpl&>(app->getHerder());
+        auto& hits = app->getMetrics().NewMeter(
+            {"scp", "txset", "validity-cache-hit"}, "txset");
+        auto& misses = app->getMetrics().NewMeter(
+            {"scp", "txset", "validity-cache-miss"}, "txset");
+        auto hitsBefore = hits.count();
+        auto missesBefore = misses.count();
+
+        auto slotIndex = lcl.header.ledgerSeq + 1;
+        auto p = makeTxPair(makeTransactions(lcl.hash, 2),
+                            lcl.header.scpValue.closeTime + 1);
+        REQUIRE(herder.recvSCPEnvelope(makeEnvelope(p, {}, slotIndex)) ==
+                Herder::ENVELOPE_STATUS_FETCHING);
+        REQUIRE(herder.recvTxSet(p.second->getContentsHash(), *p.second));
+
+        auto& driver = herder.getHerderSCPDriver();
+        for (int i = 0; i < 2; ++i)
+        {
+            REQUIRE(driver.validateValue(slotIndex, p.first, false) ==
+                    SCPDriver::kFullyValidatedValue);
+        }
+        REQUIRE(misses.count() == missesBefore + 1);
+        REQUIRE(hits.count() >= hitsBefore + 1);
+    }
+
     SECTION("accept qset and txset")
     {
         auto makePublicKey = [](int i) {
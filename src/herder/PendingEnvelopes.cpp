@@ -376,6 +376,29 @@ PendingEnvelopes::pop(uint64 slotIndex, SCPEnvelope& ret)
     return false;
 }
 
+bool
+PendingEnvelopes::pop(uint64 slotIndex, size_t maxCount,
+                      vector<SCPEnvelope>& ret)
+{
+    ret.clear();
+    auto it = mEnvelopes.begin();
+    while (it != mEnvelopes.end() && slotIndex >= it->first)
+    {
+        auto& v = it->second.mReadyEnvelopes;
+        if (v.size() != 0)
+        {
+            while (!v.empty() && ret.size() < maxCount)
+            {
+                ret.emplace_back(std::move(v.back()));
+                v.pop_back();
+            }
+            return true;
+        }
+        it++;
+    }
+    return false;
+}
+
 vector<uint64>
 PendingEnvelopes::readySlots()
 {
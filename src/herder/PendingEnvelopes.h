@@ -122,6 +122,10 @@ class PendingEnvelopes
 
     bool pop(uint64 slotIndex, SCPEnvelope& ret);
 
+    // pops up to @p maxCount ready envelopes of the lowest slot up to
+    // @p slotIndex, in the order they would be popped one by one
+    bool pop(uint64 slotIndex, size_t maxCount, std::vector<SCPEnvelope>& ret);
+
     void eraseBelow(uint64 slotIndex);
 
     void slotClosed(uint64 slotIndex);
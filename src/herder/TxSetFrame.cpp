@@ -10,10 +10,18 @@
 #include "ledger/LedgerManager.h"
 #include "main/Application.h"
 #include "main/Config.h"
+#include "medida/metrics_registry.h"
+#include "medida/timer.h"
 #include "util/Logging.h"
 #include "util/XDROperators.h"
+#include "util/make_unique.h"
 #include "xdrpp/marshal.h"
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
 
 #include "xdrpp/printer.h"
 
@@ -185,6 +193,152 @@ TxSetFrame::surgePricingFilter(LedgerManager const& lm)
     }
 }
 
+namespace
+{
+// outcome of checking the transactions of one source account
+struct AccountTxsCheck
+{
+    // invalid transactions, with the sequence number they were checked
+    // against
+    std::vector<std::pair<TransactionFramePtr, SequenceNumber>> mInvalid;
+    // set if the account can't pay the fees of its valid transactions
+    bool mInsufficientBalance{false};
+};
+
+// checks the transactions of one source account, sorted by sequence number,
+// skipping the invalid ones
+AccountTxsCheck
+checkAccountTxs(Application& app, vector<TransactionFramePtr> const& txs)
+{
+    AccountTxsCheck res;
+    TransactionFramePtr lastTx;
+    SequenceNumber lastSeq = 0;
+    int64_t totFee = 0;
+    for (auto& tx : txs)
+    {
+        if (!tx->checkValid(app, lastSeq))
+        {
+            res.mInvalid.emplace_back(tx, lastSeq);
+            continue;
+        }
+        totFee += tx->getFee();
+
+        lastTx = tx;
+        lastSeq = tx->getSeqNum();
+    }
+    if (lastTx)
+    {
+        // make sure account can pay the fee for all these tx
+        int64_t newBalance = lastTx->getSourceAccount().getBalance() - totFee;
+        res.mInsufficientBalance =
+            newBalance < lastTx->getSourceAccount().getMinimumBalance(
+                             app.getLedgerManager());
+    }
+    return res;
+}
+
+// state shared by checkAccountsInParallel and the tasks it posts, which may
+// only start after it has returned
+struct ParallelCheckState
+{
+    Application& mApp;
+    vector<vector<TransactionFramePtr>> mAccountTxs;
+    vector<AccountTxsCheck> mChecks;
+    std::atomic<size_t> mNext{0};
+
+    std::mutex mMutex;
+    std::condition_variable mDone;
+    size_t mRunning{0};
+    std::exception_ptr mError;
+
+    ParallelCheckState(Application& app) : mApp(app)
+    {
+    }
+
+    bool
+    done() const
+    {
+        return mRunning == 0 && mNext >= mAccountTxs.size();
+    }
+
+    // checks accounts until there are none left; worker threads load
+    // entries through a session of the connection pool, in a read-only
+    // transaction, while the calling thread uses the main session
+    void
+    run(bool pooled)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            ++mRunning;
+        }
+        std::exception_ptr error;
+        try
+        {
+            std::unique_ptr<Database::PoolSession> session;
+            std::unique_ptr<soci::transaction> sqlTx;
+            for (size_t i; (i = mNext++) < mAccountTxs.size();)
+            {
+                if (pooled && !session)
+                {
+                    auto& db = mApp.getDatabase();
+                    session = make_unique<Database::PoolSession>(db);
+                    sqlTx = make_unique<soci::transaction>(db.getSession());
+                    db.setCurrentTransactionReadOnly();
+                }
+                mChecks[i] = checkAccountTxs(mApp, mAccountTxs[i]);
+            }
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+
+        // the pooled session is given back before the caller can resume
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (error && !mError)
+        {
+            mError = error;
+        }
+        if (--mRunning == 0 && done())
+        {
+            mDone.notify_all();
+        }
+    }
+};
+
+// checks the transactions of each account, returns the outcomes in the same
+// order
+vector<AccountTxsCheck>
+checkAccountsInParallel(Application& app,
+                        vector<vector<TransactionFramePtr>> accountTxs)
+{
+    // the pool is created on the main thread, before any task leases from it
+    app.getDatabase().getPool();
+
+    auto state = std::make_shared<ParallelCheckState>(app);
+    state->mAccountTxs = std::move(accountTxs);
+    state->mChecks.resize(state->mAccountTxs.size());
+
+    auto nbTasks = std::min<size_t>(std::thread::hardware_concurrency(),
+                                    state->mAccountTxs.size() - 1);
+    for (size_t i = 0; i < nbTasks; ++i)
+    {
+        app.getWorkerIOService().post([state]() { state->run(true); });
+    }
+
+    // as for signatures, the calling thread takes part so that it never
+    // waits on tasks that did not start
+    state->run(false);
+    std::unique_lock<std::mutex> lock(state->mMutex);
+    state->mDone.wait(lock, [&state]() { return state->done(); });
+    if (state->mError)
+    {
+        std::rethrow_exception(state->mError);
+    }
+    return std::move(state->mChecks);
+}
+}
+
 bool
 TxSetFrame::checkOrTrim(
     Application& app,
@@ -209,39 +363,45 @@ TxSetFrame::checkOrTrim(
         lastHash = tx->getFullHash();
     }
 
+    // order by sequence number
     for (auto& item : accountTxMap)
     {
-        // order by sequence number
         std::sort(item.second.begin(), item.second.end(), SeqSorter);
+    }
 
-        TransactionFramePtr lastTx;
-        SequenceNumber lastSeq = 0;
-        int64_t totFee = 0;
-        for (auto& tx : item.second)
+    vector<AccountTxsCheck> checks;
+    if (app.getConfig().PARALLEL_TX_SET_VALIDATION &&
+        app.getDatabase().canUsePool() && accountTxMap.size() > 1)
+    {
+        auto timer = app.getMetrics()
+                         .NewTimer({"herder", "txset", "check-parallel"})
+                         .TimeScope();
+        vector<vector<TransactionFramePtr>> accountTxs;
+        accountTxs.reserve(accountTxMap.size());
+        for (auto const& item : accountTxMap)
         {
-            if (!tx->checkValid(app, lastSeq))
-            {
-                if (processInvalidTxLambda(tx, lastSeq))
-                    continue;
+            accountTxs.push_back(item.second);
+        }
+        checks = checkAccountsInParallel(app, std::move(accountTxs));
+    }
 
+    // the outcomes are processed in accountTxMap order whichever thread
+    // computed them, so that the lambdas are called as they would be by
+    // checking the accounts one after the other
+    size_t i = 0;
+    for (auto& item : accountTxMap)
+    {
+        auto check = checks.empty() ? checkAccountTxs(app, item.second)
+                                    : std::move(checks[i++]);
+        for (auto const& invalid : check.mInvalid)
+        {
+            if (!processInvalidTxLambda(invalid.first, invalid.second))
                 return false;
-            }
-            totFee += tx->getFee();
-
-            lastTx = tx;
-            lastSeq = tx->getSeqNum();
         }
-        if (lastTx)
+        if (check.mInsufficientBalance)
         {
-            // make sure account can pay the fee for all these tx
-            int64_t newBalance =
-                lastTx->getSourceAccount().getBalance() - totFee;
-            if (newBalance < lastTx->getSourceAccount().getMinimumBalance(
-                                 app.getLedgerManager()))
-            {
-                if (!processInsufficientBalance(item.second))
-                    return false;
-            }
+            if (!processInsufficientBalance(item.second))
+                return false;
         }
     }
 
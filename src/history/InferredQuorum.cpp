@@ -1,10 +1,11 @@
 #include "history/InferredQuorum.h"
 #include "crypto/SHA.h"
-#include "util/BitsetEnumerator.h"
+#include "history/QuorumIntersectionChecker.h"
 #include "util/Logging.h"
 #include "xdrpp/marshal.h"
 #include <fstream>
 #include <sstream>
+#include <thread>
 
 namespace stellar
 {
@@ -78,84 +79,6 @@ InferredQuorum::notePubKey(PublicKey const& pk)
     mPubKeys[pk]++;
 }
 
-static std::shared_ptr<BitsetEnumerator>
-makeQsetEnumerator(SCPQuorumSet const& qset,
-                   std::unordered_map<PublicKey, size_t> const& nodeNumbers)
-{
-    std::vector<std::shared_ptr<BitsetEnumerator>> innerEnums;
-    for (auto const& v : qset.validators)
-    {
-        auto i = nodeNumbers.find(v);
-        assert(i != nodeNumbers.end());
-        innerEnums.push_back(ConstantEnumerator::bitNumber(i->second));
-    }
-    for (auto const& s : qset.innerSets)
-    {
-        innerEnums.push_back(makeQsetEnumerator(s, nodeNumbers));
-    }
-    return std::make_shared<SelectionEnumerator>(
-        std::make_shared<PermutationEnumerator>(qset.threshold,
-                                                innerEnums.size()),
-        innerEnums);
-}
-
-static std::shared_ptr<BitsetEnumerator>
-makeSliceEnumerator(InferredQuorum const& iq, PublicKey const& pk,
-                    std::unordered_map<PublicKey, size_t> const& nodeNumbers)
-{
-    // Enumerating a slice is the cartesian product enumeration of a
-    // constant enumerator (for the node itself) and a selection enumerator
-    // that does n-of-k for its validators and subqsets.
-    std::vector<std::shared_ptr<BitsetEnumerator>> innerEnums;
-
-    auto i = nodeNumbers.find(pk);
-    assert(i != nodeNumbers.end());
-    innerEnums.push_back(ConstantEnumerator::bitNumber(i->second));
-
-    auto qsh = iq.mQsetHashes.find(pk);
-    assert(qsh != iq.mQsetHashes.end());
-
-    auto qs = iq.mQsets.find(qsh->second);
-    assert(qs != iq.mQsets.end());
-
-    innerEnums.push_back(makeQsetEnumerator(qs->second, nodeNumbers));
-    return std::make_shared<CartesianProductEnumerator>(innerEnums);
-}
-
-static bool isQuorum(std::bitset<64> const& q, InferredQuorum const& iq,
-                     std::unordered_map<PublicKey, size_t> const& nodeNumbers,
-                     std::vector<PublicKey> const& revNodeNumbers)
-{
-    for (size_t i = 0; i < q.size(); ++i)
-    {
-        if (q.test(i))
-        {
-            auto e = makeSliceEnumerator(iq, revNodeNumbers.at(i), nodeNumbers);
-            if (!e)
-            {
-                return false;
-            }
-            bool containsSliceForE = false;
-            while (*e)
-            {
-                // If we find _any_ slice in e's slices that
-                // is covered by q, we're good.
-                if ((q | **e) == q)
-                {
-                    containsSliceForE = true;
-                    break;
-                }
-                ++(*e);
-            }
-            if (!containsSliceForE)
-            {
-                return false;
-            }
-        }
-    }
-    return true;
-}
-
 bool
 InferredQuorum::checkQuorumIntersection(Config const& cfg) const
 {
@@ -167,60 +90,21 @@ InferredQuorum::checkQuorumIntersection(Config const& cfg) const
     // iff any two of its quorums share a node—i.e., for all quorums U1 and
     // U2, U1 ∩ U2 =/= ∅.
 
-    // Assign a bit-number to each node
-    std::unordered_map<PublicKey, size_t> nodeNumbers;
-    std::vector<PublicKey> revNodeNumbers;
-    for (auto const& n : mPubKeys)
-    {
-        nodeNumbers.insert(std::make_pair(n.first, nodeNumbers.size()));
-        revNodeNumbers.push_back(n.first);
-    }
-
-    // We're (only) going to scan the powerset of the nodes we _have_ qsets
-    // for, which might be significantly fewer than the total set of nodes;
-    // we can't really tell how nodes we don't have qsets for will behave
-    // in a network; we exclude them.
-    std::unordered_set<size_t> nodesWithQsets;
-    std::vector<std::shared_ptr<BitsetEnumerator>> nodeEnumerators;
+    // We're (only) going to consider the nodes we _have_ qsets for, which
+    // might be significantly fewer than the total set of nodes; we can't
+    // really tell how nodes we don't have qsets for will behave in a
+    // network; we exclude them.
+    std::unordered_map<PublicKey, SCPQuorumSet> qsets;
     for (auto const& n : mQsetHashes)
     {
-        assert(mQsets.find(n.second) != mQsets.end());
-        auto i = nodeNumbers.find(n.first);
-        assert(i != nodeNumbers.end());
-        nodesWithQsets.insert(i->second);
-    }
-    for (auto nwq : nodesWithQsets)
-    {
-        nodeEnumerators.push_back(ConstantEnumerator::bitNumber(nwq));
-    }
-
-    // Build an enumerator for the powerset of the nodes we have qsets for;
-    // this will thus return _candidate_ quorums, each of which we'll check
-    // for quorum-ness.
-    SelectionEnumerator quorumCandidateEnumerator(
-        std::make_shared<PowersetEnumerator>(nodeEnumerators.size()),
-        nodeEnumerators);
-
-    assert(nodeEnumerators.size() < 64);
-    uint64_t lim = 1ULL << nodeEnumerators.size();
-    CLOG(INFO, "History") << "Scanning: " << lim
-                          << " possible node subsets (of "
-                          << nodeEnumerators.size() << " nodes with qsets)";
-
-    // Enumerate all the quorums, de-duplicating into a hashset
-    std::unordered_set<uint64_t> allQuorums;
-    while (quorumCandidateEnumerator)
-    {
-        auto bv = *quorumCandidateEnumerator;
-        if (isQuorum(bv, *this, nodeNumbers, revNodeNumbers))
+        if (qsets.find(n.first) == qsets.end())
         {
-            CLOG(INFO, "History") << "Quorum: " << bv;
-            allQuorums.insert(bv.to_ullong());
+            auto qs = mQsets.find(n.second);
+            assert(qs != mQsets.end());
+            qsets.emplace(n.first, qs->second);
         }
-        ++quorumCandidateEnumerator;
     }
 
-    // Report what we found.
     for (auto const& pk : mPubKeys)
     {
         if (mQsetHashes.find(pk.first) == mQsetHashes.end())
@@ -229,56 +113,53 @@ InferredQuorum::checkQuorumIntersection(Config const& cfg) const
                 << "Node without qset: " << cfg.toShortString(pk.first);
         }
     }
-    CLOG(INFO, "History") << "Found " << nodeNumbers.size() << " nodes total";
-    CLOG(INFO, "History") << "Found " << nodeEnumerators.size()
-                          << " nodes with qsets";
-    CLOG(INFO, "History") << "Found " << allQuorums.size() << " quorums";
+    CLOG(INFO, "History") << "Found " << mPubKeys.size() << " nodes total";
+    CLOG(INFO, "History") << "Found " << qsets.size() << " nodes with qsets";
 
-    bool allOk = true;
-    for (auto const& q : allQuorums)
-    {
-        for (auto const& v : allQuorums)
+    QuorumIntersectionChecker checker(qsets,
+                                      std::thread::hardware_concurrency());
+    bool allOk = checker.networkEnjoysQuorumIntersection();
+    CLOG(INFO, "History") << "Explored " << checker.getBranchCount()
+                          << " branches of the minimal quorum search";
+
+    auto logNodes = [&](std::vector<PublicKey> const& nodes) {
+        for (auto const& n : nodes)
         {
-            if (q != v)
+            auto isAlias = false;
+            auto name = cfg.toStrKey(n, isAlias);
+            if (allOk)
             {
-                if (!(q & v))
-                {
-                    allOk = false;
-                    CLOG(WARNING, "History")
-                        << "Warning: found pair of non-intersecting quorums";
-                    CLOG(WARNING, "History") << std::bitset<64>(q);
-                    CLOG(WARNING, "History") << "vs.";
-                    CLOG(WARNING, "History") << std::bitset<64>(v);
-                }
+                CLOG(INFO, "History")
+                    << "  \"" << (isAlias ? "$" : "") << name << '"';
+            }
+            else
+            {
+                CLOG(WARNING, "History")
+                    << "  \"" << (isAlias ? "$" : "") << name << '"';
             }
         }
-    }
+    };
 
     if (allOk)
     {
-        CLOG(INFO, "History") << "Network of " << nodeEnumerators.size()
+        CLOG(INFO, "History") << "Network of " << qsets.size()
                               << " nodes enjoys quorum intersection: ";
+        std::vector<PublicKey> nodes;
+        for (auto const& q : qsets)
+        {
+            nodes.emplace_back(q.first);
+        }
+        logNodes(nodes);
     }
     else
     {
         CLOG(WARNING, "History")
-            << "Network of " << nodeEnumerators.size()
+            << "Network of " << qsets.size()
             << " nodes DOES NOT enjoy quorum intersection: ";
-    }
-    for (auto n : nodesWithQsets)
-    {
-        auto isAlias = false;
-        auto name = cfg.toStrKey(revNodeNumbers.at(n), isAlias);
-        if (allOk)
-        {
-            CLOG(INFO, "History")
-                << "  \"" << (isAlias ? "$" : "") << name << '"';
-        }
-        else
-        {
-            CLOG(WARNING, "History")
-                << "  \"" << (isAlias ? "$" : "") << name << '"';
-        }
+        CLOG(WARNING, "History") << "Found pair of non-intersecting quorums:";
+        logNodes(checker.getCounterexample().first);
+        CLOG(WARNING, "History") << "vs.";
+        logNodes(checker.getCounterexample().second);
     }
     return allOk;
 }
@@ -0,0 +1,458 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "history/QuorumIntersectionChecker.h"
+#include "util/XDROperators.h"
+#include <algorithm>
+#include <bitset>
+#include <functional>
+#include <limits>
+#include <thread>
+
+namespace stellar
+{
+
+QuorumIntersectionChecker::NodeSet::NodeSet(size_t nNodes)
+    : mBits((nNodes + 63) / 64, 0)
+{
+}
+
+bool
+QuorumIntersectionChecker::NodeSet::test(size_t i) const
+{
+    return (mBits[i / 64] >> (i % 64)) & 1;
+}
+
+void
+QuorumIntersectionChecker::NodeSet::set(size_t i)
+{
+    mBits[i / 64] |= uint64_t(1) << (i % 64);
+}
+
+void
+QuorumIntersectionChecker::NodeSet::reset(size_t i)
+{
+    mBits[i / 64] &= ~(uint64_t(1) << (i % 64));
+}
+
+size_t
+QuorumIntersectionChecker::NodeSet::count() const
+{
+    size_t res = 0;
+    for (auto bits : mBits)
+    {
+        res += std::bitset<64>(bits).count();
+    }
+    return res;
+}
+
+bool
+QuorumIntersectionChecker::NodeSet::empty() const
+{
+    return std::all_of(mBits.begin(), mBits.end(),
+                       [](uint64_t bits) { return bits == 0; });
+}
+
+bool
+QuorumIntersectionChecker::NodeSet::isSubsetOf(NodeSet const& other) const
+{
+    for (size_t i = 0; i < mBits.size(); ++i)
+    {
+        if ((mBits[i] & ~other.mBits[i]) != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+QuorumIntersectionChecker::NodeSet&
+QuorumIntersectionChecker::NodeSet::operator|=(NodeSet const& other)
+{
+    for (size_t i = 0; i < mBits.size(); ++i)
+    {
+        mBits[i] |= other.mBits[i];
+    }
+    return *this;
+}
+
+QuorumIntersectionChecker::NodeSet&
+QuorumIntersectionChecker::NodeSet::operator-=(NodeSet const& other)
+{
+    for (size_t i = 0; i < mBits.size(); ++i)
+    {
+        mBits[i] &= ~other.mBits[i];
+    }
+    return *this;
+}
+
+bool
+QuorumIntersectionChecker::NodeSet::operator==(NodeSet const& other) const
+{
+    return mBits == other.mBits;
+}
+
+std::vector<size_t>
+QuorumIntersectionChecker::NodeSet::indices() const
+{
+    std::vector<size_t> res;
+    for (size_t i = 0; i < mBits.size(); ++i)
+    {
+        for (size_t j = 0; j < 64 && (mBits[i] >> j) != 0; ++j)
+        {
+            if ((mBits[i] >> j) & 1)
+            {
+                res.emplace_back(i * 64 + j);
+            }
+        }
+    }
+    return res;
+}
+
+QuorumIntersectionChecker::QuorumIntersectionChecker(
+    std::unordered_map<PublicKey, SCPQuorumSet> const& qSets, size_t nThreads)
+    : mThreads(std::max<size_t>(nThreads, 1))
+    , mMaxCommitted(0)
+    , mFound(false)
+    , mBranches(0)
+{
+    std::unordered_map<PublicKey, size_t> indices;
+    for (auto const& kv : qSets)
+    {
+        indices.emplace(kv.first, mNodes.size());
+        mNodes.emplace_back(kv.first);
+    }
+    for (auto const& node : mNodes)
+    {
+        mQSets.emplace_back(compile(qSets.at(node), indices));
+    }
+
+    mInDegrees.resize(mNodes.size(), 0);
+    for (auto const& qSet : mQSets)
+    {
+        std::function<void(QSet const&)> countDependencies =
+            [&](QSet const& q) {
+                for (auto n : q.mNodes)
+                {
+                    mInDegrees[n]++;
+                }
+                for (auto const& inner : q.mInnerSets)
+                {
+                    countDependencies(inner);
+                }
+            };
+        countDependencies(qSet);
+    }
+}
+
+QuorumIntersectionChecker::QSet
+QuorumIntersectionChecker::compile(
+    SCPQuorumSet const& qSet,
+    std::unordered_map<PublicKey, size_t> const& indices) const
+{
+    QSet res;
+    res.mThreshold = qSet.threshold;
+    for (auto const& v : qSet.validators)
+    {
+        // nodes without a quorum set are never part of a quorum
+        auto it = indices.find(v);
+        if (it != indices.end())
+        {
+            res.mNodes.emplace_back(it->second);
+        }
+    }
+    for (auto const& inner : qSet.innerSets)
+    {
+        res.mInnerSets.emplace_back(compile(inner, indices));
+    }
+    return res;
+}
+
+bool
+QuorumIntersectionChecker::isSatisfied(QSet const& qSet, NodeSet const& nodes)
+{
+    uint32_t count = 0;
+    for (auto n : qSet.mNodes)
+    {
+        if (count >= qSet.mThreshold)
+        {
+            return true;
+        }
+        count += nodes.test(n);
+    }
+    for (auto const& inner : qSet.mInnerSets)
+    {
+        if (count >= qSet.mThreshold)
+        {
+            return true;
+        }
+        count += isSatisfied(inner, nodes);
+    }
+    return count >= qSet.mThreshold;
+}
+
+std::vector<QuorumIntersectionChecker::NodeSet>
+QuorumIntersectionChecker::findComponents() const
+{
+    // Tarjan's algorithm over the nodes listed by each quorum set
+    std::vector<std::vector<size_t>> edges(mNodes.size());
+    for (size_t i = 0; i < mNodes.size(); ++i)
+    {
+        std::function<void(QSet const&)> addEdges = [&](QSet const& q) {
+            edges[i].insert(edges[i].end(), q.mNodes.begin(), q.mNodes.end());
+            for (auto const& inner : q.mInnerSets)
+            {
+                addEdges(inner);
+            }
+        };
+        addEdges(mQSets[i]);
+    }
+
+    size_t const UNVISITED = std::numeric_limits<size_t>::max();
+    std::vector<size_t> index(mNodes.size(), UNVISITED);
+    std::vector<size_t> lowLink(mNodes.size(), 0);
+    std::vector<bool> onStack(mNodes.size(), false);
+    std::vector<size_t> stack;
+    size_t nextIndex = 0;
+    std::vector<NodeSet> res;
+
+    std::function<void(size_t)> visit = [&](size_t v) {
+        index[v] = lowLink[v] = nextIndex++;
+        stack.emplace_back(v);
+        onStack[v] = true;
+        for (auto w : edges[v])
+        {
+            if (index[w] == UNVISITED)
+            {
+                visit(w);
+                lowLink[v] = std::min(lowLink[v], lowLink[w]);
+            }
+            else if (onStack[w])
+            {
+                lowLink[v] = std::min(lowLink[v], index[w]);
+            }
+        }
+        if (lowLink[v] == index[v])
+        {
+            NodeSet component(mNodes.size());
+            size_t w;
+            do
+            {
+                w = stack.back();
+                stack.pop_back();
+                onStack[w] = false;
+                component.set(w);
+            } while (w != v);
+            res.emplace_back(std::move(component));
+        }
+    };
+    for (size_t v = 0; v < mNodes.size(); ++v)
+    {
+        if (index[v] == UNVISITED)
+        {
+            visit(v);
+        }
+    }
+    return res;
+}
+
+QuorumIntersectionChecker::NodeSet
+QuorumIntersectionChecker::contractToMaximalQuorum(NodeSet nodes) const
+{
+    // nodes without a slice in `nodes` are in no quorum within it
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (auto i : nodes.indices())
+        {
+            if (!isSatisfied(mQSets[i], nodes))
+            {
+                nodes.reset(i);
+                changed = true;
+            }
+        }
+    }
+    return nodes;
+}
+
+bool
+QuorumIntersectionChecker::isQuorum(NodeSet const& nodes) const
+{
+    return !nodes.empty() && contractToMaximalQuorum(nodes) == nodes;
+}
+
+void
+QuorumIntersectionChecker::foundDisjointQuorums(NodeSet const& q1,
+                                                NodeSet const& q2)
+{
+    std::lock_guard<std::mutex> lock(mCounterexampleMutex);
+    if (mFound)
+    {
+        return;
+    }
+    mCounterexample.first.clear();
+    mCounterexample.second.clear();
+    for (auto i : q1.indices())
+    {
+        mCounterexample.first.emplace_back(mNodes[i]);
+    }
+    for (auto i : q2.indices())
+    {
+        mCounterexample.second.emplace_back(mNodes[i]);
+    }
+    mFound = true;
+}
+
+size_t
+QuorumIntersectionChecker::pickSplitNode(NodeSet const& remaining) const
+{
+    // nodes many others depend on complete quorums sooner
+    auto candidates = remaining.indices();
+    return *std::max_element(candidates.begin(), candidates.end(),
+                             [this](size_t a, size_t b) {
+                                 return mInDegrees[a] < mInDegrees[b];
+                             });
+}
+
+void
+QuorumIntersectionChecker::expand(Branch const& branch,
+                                  std::vector<Branch>& children)
+{
+    ++mBranches;
+    auto const& committed = branch.mCommitted;
+
+    // if there are disjoint quorums, the smaller one contains a minimal
+    // quorum of at most half of the nodes
+    if (mFound || committed.count() > mMaxCommitted)
+    {
+        return;
+    }
+
+    // no subset of a minimal quorum is a quorum: stop at the first one
+    if (isQuorum(committed))
+    {
+        auto rest = mSearched;
+        rest -= committed;
+        rest = contractToMaximalQuorum(rest);
+        if (!rest.empty())
+        {
+            foundDisjointQuorums(committed, rest);
+        }
+        return;
+    }
+
+    // quorums extending `committed` are within the largest quorum that can
+    // be formed with the remaining nodes
+    auto perimeter = committed;
+    perimeter |= branch.mRemaining;
+    auto extensions = contractToMaximalQuorum(perimeter);
+    if (!committed.isSubsetOf(extensions))
+    {
+        return;
+    }
+    auto remaining = extensions;
+    remaining -= committed;
+    if (remaining.empty())
+    {
+        return;
+    }
+
+    auto split = pickSplitNode(remaining);
+    remaining.reset(split);
+    children.emplace_back(Branch{committed, remaining});
+    children.emplace_back(Branch{committed, remaining});
+    children.back().mCommitted.set(split);
+}
+
+void
+QuorumIntersectionChecker::search(Branch branch)
+{
+    std::vector<Branch> stack{std::move(branch)};
+    while (!stack.empty() && !mFound)
+    {
+        auto b = std::move(stack.back());
+        stack.pop_back();
+        expand(b, stack);
+    }
+}
+
+bool
+QuorumIntersectionChecker::networkEnjoysQuorumIntersection()
+{
+    // every quorum contains a quorum within a single component: two
+    // components with quorums have disjoint ones
+    NodeSet firstQuorum;
+    for (auto const& component : findComponents())
+    {
+        auto quorum = contractToMaximalQuorum(component);
+        if (quorum.empty())
+        {
+            continue;
+        }
+        if (!firstQuorum.empty())
+        {
+            foundDisjointQuorums(firstQuorum, quorum);
+            return false;
+        }
+        firstQuorum = quorum;
+        mSearched = component;
+    }
+    if (firstQuorum.empty())
+    {
+        return true;
+    }
+    mMaxCommitted = mSearched.count() / 2;
+
+    // expand the top of the search tree to give work to all the threads
+    std::vector<Branch> branches{Branch{NodeSet(mNodes.size()), mSearched}};
+    while (!mFound && !branches.empty() && branches.size() < mThreads * 8)
+    {
+        std::vector<Branch> next;
+        for (auto const& b : branches)
+        {
+            expand(b, next);
+        }
+        branches.swap(next);
+    }
+
+    std::atomic<size_t> nextBranch(0);
+    auto work = [&]() {
+        for (size_t i = nextBranch++; i < branches.size() && !mFound;
+             i = nextBranch++)
+        {
+            search(branches[i]);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < std::min(mThreads, branches.size()); ++i)
+    {
+        threads.emplace_back(work);
+    }
+    work();
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+    return !mFound;
+}
+
+QuorumIntersectionChecker::QuorumPair const&
+QuorumIntersectionChecker::getCounterexample() const
+{
+    return mCounterexample;
+}
+
+size_t
+QuorumIntersectionChecker::getNodeCount() const
+{
+    return mNodes.size();
+}
+
+size_t
+QuorumIntersectionChecker::getBranchCount() const
+{
+    return mBranches;
+}
+}
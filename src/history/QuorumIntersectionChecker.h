@@ -0,0 +1,122 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "crypto/SecretKey.h"
+#include "overlay/StellarXDR.h"
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace stellar
+{
+
+/**
+ * Checks that any two quorums of a network share a node, given the quorum set
+ * of each of its nodes (nodes without one are left out of all quorums).
+ *
+ * Rather than enumerating all the subsets of nodes, it splits the dependency
+ * graph of the nodes into strongly connected components: every quorum
+ * contains a quorum within a single component, so only one of them may
+ * contain quorums. Within that component, it enumerates the minimal quorums
+ * of at most half of its nodes with a branch-and-bound search (any pair of
+ * disjoint quorums contains one), checking that each leaves no quorum in the
+ * rest of the component. Branches that can't be extended into a quorum are
+ * pruned, and subtrees of the search are explored on several threads.
+ */
+class QuorumIntersectionChecker
+{
+  public:
+    // set of node indices
+    class NodeSet
+    {
+        std::vector<uint64_t> mBits;
+
+      public:
+        explicit NodeSet(size_t nNodes = 0);
+
+        bool test(size_t i) const;
+        void set(size_t i);
+        void reset(size_t i);
+        size_t count() const;
+        bool empty() const;
+        bool isSubsetOf(NodeSet const& other) const;
+        NodeSet& operator|=(NodeSet const& other);
+        // removes the nodes of `other`
+        NodeSet& operator-=(NodeSet const& other);
+        bool operator==(NodeSet const& other) const;
+        std::vector<size_t> indices() const;
+    };
+
+    typedef std::pair<std::vector<PublicKey>, std::vector<PublicKey>>
+        QuorumPair;
+
+  private:
+    struct QSet
+    {
+        uint32_t mThreshold;
+        std::vector<size_t> mNodes;
+        std::vector<QSet> mInnerSets;
+    };
+
+    // a subtree of the search: quorums containing `mCommitted` within
+    // `mCommitted` and `mRemaining`
+    struct Branch
+    {
+        NodeSet mCommitted;
+        NodeSet mRemaining;
+    };
+
+    std::vector<PublicKey> mNodes;
+    std::vector<QSet> mQSets;
+    // number of nodes depending on each node
+    std::vector<size_t> mInDegrees;
+    size_t mThreads;
+
+    // component searched for minimal quorums
+    NodeSet mSearched;
+    size_t mMaxCommitted;
+
+    std::atomic<bool> mFound;
+    std::atomic<size_t> mBranches;
+    std::mutex mCounterexampleMutex;
+    QuorumPair mCounterexample;
+
+    QSet compile(SCPQuorumSet const& qSet,
+                 std::unordered_map<PublicKey, size_t> const& indices) const;
+    static bool isSatisfied(QSet const& qSet, NodeSet const& nodes);
+
+    std::vector<NodeSet> findComponents() const;
+    // largest quorum within `nodes`, empty if there is none
+    NodeSet contractToMaximalQuorum(NodeSet nodes) const;
+    bool isQuorum(NodeSet const& nodes) const;
+
+    void foundDisjointQuorums(NodeSet const& q1, NodeSet const& q2);
+    size_t pickSplitNode(NodeSet const& remaining) const;
+    // explores one node of the search tree, adding the subtrees left to
+    // explore to `children`
+    void expand(Branch const& branch, std::vector<Branch>& children);
+    void search(Branch branch);
+
+  public:
+    // `qSets` has the quorum set of each node, searched with `nThreads`
+    QuorumIntersectionChecker(
+        std::unordered_map<PublicKey, SCPQuorumSet> const& qSets,
+        size_t nThreads);
+
+    bool networkEnjoysQuorumIntersection();
+
+    // after networkEnjoysQuorumIntersection returned false, two disjoint
+    // quorums
+    QuorumPair const& getCounterexample() const;
+
+    // number of nodes with a quorum set, and of search tree nodes explored
+    size_t getNodeCount() const;
+    size_t getBranchCount() const;
+};
+}
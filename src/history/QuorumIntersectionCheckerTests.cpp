@@ -0,0 +1,178 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "history/QuorumIntersectionChecker.h"
+#include "lib/catch.hpp"
+#include "util/Logging.h"
+#include "util/XDROperators.h"
+#include <chrono>
+#include <set>
+#include <thread>
+
+using namespace stellar;
+
+namespace
+{
+typedef std::unordered_map<PublicKey, SCPQuorumSet> QSetMap;
+
+// organizations of 3 validators, trusted by a majority of them
+std::vector<SCPQuorumSet>
+makeOrgs(size_t nOrgs)
+{
+    std::vector<SCPQuorumSet> res(nOrgs);
+    for (auto& org : res)
+    {
+        org.threshold = 2;
+        for (int i = 0; i < 3; ++i)
+        {
+            org.validators.emplace_back(SecretKey::random().getPublicKey());
+        }
+    }
+    return res;
+}
+
+// every validator of `orgs` trusts `threshold` of them
+void
+addOrgs(QSetMap& qSets, std::vector<SCPQuorumSet> const& orgs,
+        uint32 threshold)
+{
+    SCPQuorumSet qSet;
+    qSet.threshold = threshold;
+    qSet.innerSets.insert(qSet.innerSets.end(), orgs.begin(), orgs.end());
+    for (auto const& org : orgs)
+    {
+        for (auto const& v : org.validators)
+        {
+            qSets[v] = qSet;
+        }
+    }
+}
+
+// a core of organizations trusting 2/3 of them, and organizations depending
+// on both the core and themselves up to `nNodes` validators
+QSetMap
+makeTieredNetwork(size_t nCoreOrgs, size_t nNodes)
+{
+    QSetMap res;
+    auto core = makeOrgs(nCoreOrgs);
+    SCPQuorumSet coreQSet;
+    coreQSet.threshold = static_cast<uint32>((nCoreOrgs * 2 + 2) / 3);
+    coreQSet.innerSets.insert(coreQSet.innerSets.end(), core.begin(),
+                              core.end());
+    addOrgs(res, core, coreQSet.threshold);
+
+    while (res.size() + 3 <= nNodes)
+    {
+        auto org = makeOrgs(1).front();
+        SCPQuorumSet qSet;
+        qSet.threshold = 2;
+        qSet.innerSets.emplace_back(org);
+        qSet.innerSets.emplace_back(coreQSet);
+        for (auto const& v : org.validators)
+        {
+            res[v] = qSet;
+        }
+    }
+    return res;
+}
+
+bool
+isSatisfied(SCPQuorumSet const& qSet, std::set<PublicKey> const& nodes)
+{
+    uint32 count = 0;
+    for (auto const& v : qSet.validators)
+    {
+        count += nodes.count(v) != 0;
+    }
+    for (auto const& inner : qSet.innerSets)
+    {
+        count += isSatisfied(inner, nodes);
+    }
+    return count >= qSet.threshold;
+}
+
+void
+checkDisjointQuorums(QSetMap const& qSets,
+                     QuorumIntersectionChecker::QuorumPair const& quorums)
+{
+    std::set<PublicKey> q1(quorums.first.begin(), quorums.first.end());
+    std::set<PublicKey> q2(quorums.second.begin(), quorums.second.end());
+    REQUIRE(!q1.empty());
+    REQUIRE(!q2.empty());
+    for (auto const& q : {q1, q2})
+    {
+        for (auto const& n : q)
+        {
+            REQUIRE(isSatisfied(qSets.at(n), q));
+        }
+    }
+    for (auto const& n : q1)
+    {
+        REQUIRE(q2.count(n) == 0);
+    }
+}
+}
+
+TEST_CASE("quorum intersection of large networks",
+          "[history][inferredquorum]")
+{
+    SECTION("core with dependent organizations")
+    {
+        auto qSets = makeTieredNetwork(7, 150);
+        REQUIRE(qSets.size() == 150);
+        QuorumIntersectionChecker checker(qSets, 4);
+        REQUIRE(checker.networkEnjoysQuorumIntersection());
+    }
+
+    SECTION("half of the organizations form a quorum")
+    {
+        QSetMap qSets;
+        addOrgs(qSets, makeOrgs(6), 3);
+        QuorumIntersectionChecker checker(qSets, 4);
+        REQUIRE(!checker.networkEnjoysQuorumIntersection());
+        checkDisjointQuorums(qSets, checker.getCounterexample());
+    }
+
+    SECTION("separate cores")
+    {
+        QSetMap qSets;
+        addOrgs(qSets, makeOrgs(20), 14);
+        addOrgs(qSets, makeOrgs(4), 3);
+        QuorumIntersectionChecker checker(qSets, 4);
+        REQUIRE(!checker.networkEnjoysQuorumIntersection());
+        checkDisjointQuorums(qSets, checker.getCounterexample());
+    }
+
+    SECTION("nodes without quorum sets are left out")
+    {
+        QSetMap qSets;
+        auto orgs = makeOrgs(4);
+        addOrgs(qSets, orgs, 2);
+        // without the first organization, any two of the others intersect
+        for (auto const& v : orgs[0].validators)
+        {
+            qSets.erase(v);
+        }
+        QuorumIntersectionChecker checker(qSets, 4);
+        REQUIRE(checker.networkEnjoysQuorumIntersection());
+    }
+}
+
+TEST_CASE("quorum intersection checker scaling",
+          "[history][inferredquorum][bench][!hide]")
+{
+    for (size_t nNodes : {100, 200, 300})
+    {
+        auto qSets = makeTieredNetwork(7, nNodes);
+        QuorumIntersectionChecker checker(
+            qSets, std::thread::hardware_concurrency());
+        auto start = std::chrono::steady_clock::now();
+        REQUIRE(checker.networkEnjoysQuorumIntersection());
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+        LOG(INFO) << "Checked " << checker.getNodeCount() << " nodes in "
+                  << elapsed.count() << "s, exploring "
+                  << checker.getBranchCount() << " branches";
+    }
+}
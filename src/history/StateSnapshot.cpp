@@ -57,7 +57,7 @@ StateSnapshot::makeLive()
         auto& hb = mLocalState.currentBuckets[i];
         if (hb.next.hasHashes() && !hb.next.isLive())
         {
-            hb.next.makeLive(mApp, BucketList::keepDeadEntries(i));
+            hb.next.makeLive(mApp, i);
         }
     }
 }
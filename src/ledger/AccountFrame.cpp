@@ -9,9 +9,12 @@
 #include "crypto/SecretKey.h"
 #include "crypto/SignerKey.h"
 #include "database/Database.h"
+#include "ledger/AccountWriteBuffer.h"
+#include "ledger/LedgerEntryCache.h"
 #include "ledger/LedgerManager.h"
 #include "ledger/LedgerRange.h"
 #include "lib/util/format.h"
+#include "medida/meter.h"
 #include "util/Decoder.h"
 #include "util/XDROperators.h"
 #include "util/types.h"
@@ -212,11 +215,21 @@ AccountFrame::loadAccount(AccountID const& accountID, Database& db)
     LedgerKey key;
     key.type(ACCOUNT);
     key.account().accountID = accountID;
-    if (cachedEntryExists(key, db))
+    std::shared_ptr<LedgerEntry const> cached;
+    if (db.getAccountWriteBuffer().get(accountID, cached))
     {
-        auto p = getCachedEntry(key, db);
-        return p ? std::make_shared<AccountFrame>(*p) : nullptr;
+        return std::make_shared<AccountFrame>(*cached);
     }
+    if (getCachedEntry(key, cached, db))
+    {
+        return cached ? std::make_shared<AccountFrame>(*cached) : nullptr;
+    }
+    if (getBucketListEntry(key, cached, db))
+    {
+        putCachedEntry(key, cached, db);
+        return cached ? std::make_shared<AccountFrame>(*cached) : nullptr;
+    }
+    db.getDemandLoadMeter().Mark();
 
     std::string actIDStrKey = KeyUtils::toStrKey(accountID);
 
@@ -310,10 +323,152 @@ AccountFrame::loadSigners(Database& db, std::string const& actIDStrKey)
     return res;
 }
 
+size_t
+AccountFrame::prefetch(Database& db, std::vector<LedgerKey> const& keys)
+{
+    size_t res = 0;
+    std::vector<std::string> actIDStrKeys;
+    for (auto const& key : keys)
+    {
+        std::shared_ptr<LedgerEntry const> entry;
+        if (cachedEntryExists(key, db))
+        {
+            continue;
+        }
+        if (getBucketListEntry(key, entry, db))
+        {
+            putCachedEntry(key, entry, db);
+            ++res;
+            continue;
+        }
+        actIDStrKeys.emplace_back(KeyUtils::toStrKey(key.account().accountID));
+    }
+
+    for (size_t i = 0; i < actIDStrKeys.size(); i += PREFETCH_BATCH_SIZE)
+    {
+        auto end = std::min(i + PREFETCH_BATCH_SIZE, actIDStrKeys.size());
+        std::vector<std::string> batch(actIDStrKeys.begin() + i,
+                                       actIDStrKeys.begin() + end);
+        // the statements have a fixed number of placeholders, so that they
+        // are prepared once
+        batch.resize(PREFETCH_BATCH_SIZE, batch.back());
+
+        std::unordered_map<std::string, LedgerEntry> found;
+        {
+            std::string actIDStrKey, inflationDest, homeDomain, thresholds;
+            soci::indicator inflationDestInd;
+            LedgerEntry le;
+            le.data.type(ACCOUNT);
+            auto& account = le.data.account();
+
+            auto prep = db.getPreparedStatement(
+                "SELECT accountid, balance, seqnum, numsubentries, "
+                "inflationdest, homedomain, thresholds, flags, lastmodified "
+                "FROM accounts WHERE accountid IN " +
+                prefetchPlaceholders());
+            auto& st = prep.statement();
+            st.exchange(into(actIDStrKey));
+            st.exchange(into(account.balance));
+            st.exchange(into(account.seqNum));
+            st.exchange(into(account.numSubEntries));
+            st.exchange(into(inflationDest, inflationDestInd));
+            st.exchange(into(homeDomain));
+            st.exchange(into(thresholds));
+            st.exchange(into(account.flags));
+            st.exchange(into(le.lastModifiedLedgerSeq));
+            for (auto& id : batch)
+            {
+                st.exchange(use(id));
+            }
+            st.define_and_bind();
+            {
+                auto timer = db.getSelectTimer("account");
+                st.execute(true);
+            }
+            while (st.got_data())
+            {
+                account.accountID =
+                    KeyUtils::fromStrKey<PublicKey>(actIDStrKey);
+                account.homeDomain = homeDomain;
+                decoder::decode_b64(thresholds.begin(), thresholds.end(),
+                                    account.thresholds.begin());
+                account.inflationDest.reset();
+                if (inflationDestInd == soci::i_ok)
+                {
+                    account.inflationDest.activate() =
+                        KeyUtils::fromStrKey<PublicKey>(inflationDest);
+                }
+                found.emplace(actIDStrKey, le);
+                st.fetch();
+            }
+        }
+
+        if (!found.empty())
+        {
+            std::string actIDStrKey, pubKey;
+            Signer signer;
+
+            auto prep = db.getPreparedStatement(
+                "SELECT accountid, publickey, weight FROM signers "
+                "WHERE accountid IN " +
+                prefetchPlaceholders());
+            auto& st = prep.statement();
+            st.exchange(into(actIDStrKey));
+            st.exchange(into(pubKey));
+            st.exchange(into(signer.weight));
+            for (auto& id : batch)
+            {
+                st.exchange(use(id));
+            }
+            st.define_and_bind();
+            {
+                auto timer = db.getSelectTimer("signer");
+                st.execute(true);
+            }
+            while (st.got_data())
+            {
+                // like loadAccount, only accounts with sub entries have
+                // signers
+                auto it = found.find(actIDStrKey);
+                if (it != found.end() &&
+                    it->second.data.account().numSubEntries != 0)
+                {
+                    signer.key = KeyUtils::fromStrKey<SignerKey>(pubKey);
+                    it->second.data.account().signers.push_back(signer);
+                }
+                st.fetch();
+            }
+        }
+
+        for (auto j = i; j < end; ++j)
+        {
+            LedgerKey key;
+            key.type(ACCOUNT);
+            key.account().accountID =
+                KeyUtils::fromStrKey<PublicKey>(actIDStrKeys[j]);
+            auto it = found.find(actIDStrKeys[j]);
+            if (it == found.end())
+            {
+                putCachedEntry(key, nullptr, db);
+            }
+            else
+            {
+                AccountFrame account(it->second);
+                account.normalize();
+                account.putCachedEntry(db);
+            }
+            ++res;
+        }
+    }
+    return res;
+}
+
 bool
 AccountFrame::exists(Database& db, LedgerKey const& key)
 {
-    if (cachedEntryExists(key, db) && getCachedEntry(key, db) != nullptr)
+    std::shared_ptr<LedgerEntry const> cached;
+    if (db.getAccountWriteBuffer().get(key.account().accountID, cached) ||
+        (getCachedEntry(key, cached, db) && cached))
     {
         return true;
     }
@@ -356,7 +511,7 @@ void
 AccountFrame::deleteAccountsModifiedOnOrAfterLedger(Database& db,
                                                     uint32_t oldestLedger)
 {
-    db.getEntryCache().erase_if(
+    db.getEntryCache().eraseIf(
         [oldestLedger](std::shared_ptr<LedgerEntry const> le) -> bool {
             return le && le->data.type() == ACCOUNT &&
                    le->lastModifiedLedgerSeq >= oldestLedger;
@@ -392,6 +547,7 @@ AccountFrame::storeDelete(LedgerDelta& delta, Database& db,
                           LedgerKey const& key)
 {
     flushCachedEntry(key, db);
+    db.getAccountWriteBuffer().erase(key.account().accountID);
 
     std::string actIDStrKey = KeyUtils::toStrKey(key.account().accountID);
     {
@@ -415,6 +571,181 @@ AccountFrame::storeDelete(LedgerDelta& delta, Database& db,
     delta.deleteEntry(key);
 }
 
+void
+AccountFrame::storeDeleteBulk(Database& db, std::vector<LedgerKey> const& keys)
+{
+    std::vector<std::string> actIDStrKeys;
+    actIDStrKeys.reserve(keys.size());
+    for (auto const& key : keys)
+    {
+        flushCachedEntry(key, db);
+        actIDStrKeys.emplace_back(KeyUtils::toStrKey(key.account().accountID));
+    }
+    {
+        auto timer = db.getDeleteTimer("account");
+        auto prep = db.getPreparedStatement(
+            "DELETE from accounts where accountid= :v1");
+        auto& st = prep.statement();
+        st.exchange(soci::use(actIDStrKeys));
+        st.define_and_bind();
+        st.execute(true);
+    }
+    {
+        auto timer = db.getDeleteTimer("signer");
+        auto prep =
+            db.getPreparedStatement("DELETE from signers where accountid= :v1");
+        auto& st = prep.statement();
+        st.exchange(soci::use(actIDStrKeys));
+        st.define_and_bind();
+        st.execute(true);
+    }
+}
+
+namespace
+{
+// columns of the accounts table for a batch of entries, bound as vectors
+struct AccountColumns
+{
+    std::vector<std::string> mActIDStrKeys, mInflationDests, mHomeDomains,
+        mThresholds;
+    std::vector<soci::indicator> mInflationDestInds;
+    std::vector<long long> mBalances, mSeqNums;
+    std::vector<int> mNumSubEntries, mFlags, mLastModifieds;
+
+    explicit AccountColumns(std::vector<LedgerEntry> const& entries)
+    {
+        for (auto const& entry : entries)
+        {
+            auto const& account = entry.data.account();
+            mActIDStrKeys.emplace_back(KeyUtils::toStrKey(account.accountID));
+            if (account.inflationDest)
+            {
+                mInflationDests.emplace_back(
+                    KeyUtils::toStrKey(*account.inflationDest));
+                mInflationDestInds.emplace_back(soci::i_ok);
+            }
+            else
+            {
+                mInflationDests.emplace_back();
+                mInflationDestInds.emplace_back(soci::i_null);
+            }
+            mHomeDomains.emplace_back(account.homeDomain);
+            mThresholds.emplace_back(decoder::encode_b64(account.thresholds));
+            mBalances.emplace_back(account.balance);
+            mSeqNums.emplace_back(account.seqNum);
+            mNumSubEntries.emplace_back(account.numSubEntries);
+            mFlags.emplace_back(account.flags);
+            mLastModifieds.emplace_back(entry.lastModifiedLedgerSeq);
+        }
+    }
+
+    // binds the columns to :id and :v1 to :v8, as in storeUpdate
+    void
+    bind(soci::statement& st)
+    {
+        st.exchange(use(mActIDStrKeys, "id"));
+        st.exchange(use(mBalances, "v1"));
+        st.exchange(use(mSeqNums, "v2"));
+        st.exchange(use(mNumSubEntries, "v3"));
+        st.exchange(use(mInflationDests, mInflationDestInds, "v4"));
+        st.exchange(use(mHomeDomains, "v5"));
+        st.exchange(use(mThresholds, "v6"));
+        st.exchange(use(mFlags, "v7"));
+        st.exchange(use(mLastModifieds, "v8"));
+        st.define_and_bind();
+    }
+};
+}
+
+void
+AccountFrame::storeAddBulk(Database& db,
+                           std::vector<LedgerEntry> const& entries)
+{
+    for (auto const& entry : entries)
+    {
+        flushCachedEntry(LedgerEntryKey(entry), db);
+    }
+    AccountColumns columns(entries);
+
+    {
+        auto prep = db.getPreparedStatement(
+            "INSERT INTO accounts ( accountid, balance, seqnum, "
+            "numsubentries, inflationdest, homedomain, thresholds, flags, "
+            "lastmodified ) "
+            "VALUES ( :id, :v1, :v2, :v3, :v4, :v5, :v6, :v7, :v8 )");
+        auto& st = prep.statement();
+        columns.bind(st);
+        {
+            auto timer = db.getInsertTimer("account");
+            st.execute(true);
+        }
+        if (st.get_affected_rows() != static_cast<long long>(entries.size()))
+        {
+            throw std::runtime_error("Could not update data in SQL");
+        }
+    }
+
+    std::vector<std::string> signerActIDStrKeys, signerStrKeys;
+    std::vector<int> weights;
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        for (auto const& signer : entries[i].data.account().signers)
+        {
+            signerActIDStrKeys.emplace_back(columns.mActIDStrKeys[i]);
+            signerStrKeys.emplace_back(KeyUtils::toStrKey(signer.key));
+            weights.emplace_back(signer.weight);
+        }
+    }
+    // SOCI does not accept empty vectors
+    if (!weights.empty())
+    {
+        auto prep = db.getPreparedStatement("INSERT INTO signers "
+                                            "(accountid,publickey,weight) "
+                                            "VALUES (:v1,:v2,:v3)");
+        auto& st = prep.statement();
+        st.exchange(use(signerActIDStrKeys));
+        st.exchange(use(signerStrKeys));
+        st.exchange(use(weights));
+        st.define_and_bind();
+        {
+            auto timer = db.getInsertTimer("signer");
+            st.execute(true);
+        }
+        if (st.get_affected_rows() != static_cast<long long>(weights.size()))
+        {
+            throw std::runtime_error("Could not update data in SQL");
+        }
+    }
+}
+
+void
+AccountFrame::storeUpdateBulk(Database& db,
+                              std::vector<LedgerEntry> const& entries)
+{
+    for (auto const& entry : entries)
+    {
+        flushCachedEntry(LedgerEntryKey(entry), db);
+    }
+    AccountColumns columns(entries);
+
+    auto prep = db.getPreparedStatement(
+        "UPDATE accounts SET balance = :v1, seqnum = :v2, "
+        "numsubentries = :v3, "
+        "inflationdest = :v4, homedomain = :v5, thresholds = :v6, "
+        "flags = :v7, lastmodified = :v8 WHERE accountid = :id");
+    auto& st = prep.statement();
+    columns.bind(st);
+    {
+        auto timer = db.getUpdateTimer("account");
+        st.execute(true);
+    }
+
+    if (st.get_affected_rows() != static_cast<long long>(entries.size()))
+    {
+        throw std::runtime_error("Could not update data in SQL");
+    }
+}
+
 void
 AccountFrame::storeUpdate(LedgerDelta& delta, Database& db, bool insert)
 {
@@ -422,6 +753,19 @@ AccountFrame::storeUpdate(LedgerDelta& delta, Database& db, bool insert)
 
     flushCachedEntry(db);
 
+    auto& writeBuffer = db.getAccountWriteBuffer();
+    if (writeBuffer.isActive())
+    {
+        if (!insert && !mUpdateSigners)
+        {
+            writeBuffer.put(mEntry);
+            delta.modEntry(*this);
+            return;
+        }
+        // the statements below supersede the buffered state
+        writeBuffer.erase(mAccountEntry.accountID);
+    }
+
     std::string actIDStrKey = KeyUtils::toStrKey(mAccountEntry.accountID);
     std::string sql;
 
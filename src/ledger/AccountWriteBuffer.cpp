@@ -0,0 +1,103 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "ledger/AccountWriteBuffer.h"
+#include "ledger/AccountFrame.h"
+#include "main/Application.h"
+#include "main/Config.h"
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+#include "util/XDROperators.h"
+#include <cassert>
+
+namespace stellar
+{
+
+AccountWriteBuffer::Scope::Scope(AccountWriteBuffer& buffer) : mBuffer(buffer)
+{
+    mBuffer.mActive = mBuffer.mEnabled;
+}
+
+AccountWriteBuffer::Scope::~Scope()
+{
+    mBuffer.discard();
+}
+
+void
+AccountWriteBuffer::Scope::flush()
+{
+    mBuffer.flush();
+}
+
+AccountWriteBuffer::AccountWriteBuffer(Application& app)
+    : mApp(app)
+    , mEnabled(app.getConfig().DEFER_ACCOUNT_WRITES)
+    , mBuffered(app.getMetrics().NewMeter(
+          {"ledger", "account-write-buffer", "buffered"}, "entry"))
+    , mWritten(app.getMetrics().NewMeter(
+          {"ledger", "account-write-buffer", "written"}, "entry"))
+{
+}
+
+bool
+AccountWriteBuffer::isActive() const
+{
+    return mActive;
+}
+
+bool
+AccountWriteBuffer::get(AccountID const& accountID,
+                        std::shared_ptr<LedgerEntry const>& entry) const
+{
+    auto it = mPending.find(accountID);
+    if (it == mPending.end())
+    {
+        return false;
+    }
+    entry = it->second;
+    return true;
+}
+
+void
+AccountWriteBuffer::put(LedgerEntry const& entry)
+{
+    assert(mActive);
+    mBuffered.Mark();
+    mPending[entry.data.account().accountID] =
+        std::make_shared<LedgerEntry const>(entry);
+}
+
+void
+AccountWriteBuffer::erase(AccountID const& accountID)
+{
+    mPending.erase(accountID);
+}
+
+void
+AccountWriteBuffer::flush()
+{
+    mActive = false;
+    if (mPending.empty())
+    {
+        return;
+    }
+
+    std::vector<LedgerEntry> entries;
+    entries.reserve(mPending.size());
+    for (auto const& kv : mPending)
+    {
+        entries.emplace_back(*kv.second);
+    }
+    mPending.clear();
+    mWritten.Mark(entries.size());
+    AccountFrame::storeUpdateBulk(mApp.getDatabase(), entries);
+}
+
+void
+AccountWriteBuffer::discard()
+{
+    mActive = false;
+    mPending.clear();
+}
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "overlay/StellarXDR.h"
+#include "util/NonCopyable.h"
+#include <memory>
+#include <unordered_map>
+
+namespace medida
+{
+class Meter;
+}
+
+namespace stellar
+{
+class Application;
+
+/**
+ * Account updates held in memory rather than written to the database one
+ * statement each, while fees and sequence numbers are charged at the start
+ * of a ledger: an account is updated once per transaction it is the source
+ * of, and only its final state needs to be written.
+ *
+ * While active, updates that only change the accounts table (and not the
+ * signers) are kept here by AccountFrame, which loads buffered accounts from
+ * here as well. flush() then writes the final state of each account with a
+ * single batched statement. Nothing may read the accounts table with SQL
+ * directly in between.
+ *
+ * Like the LedgerEntry cache, it's owned by the Database for ease of access.
+ */
+class AccountWriteBuffer : NonMovableOrCopyable
+{
+    Application& mApp;
+    bool const mEnabled;
+    bool mActive{false};
+    std::unordered_map<AccountID, std::shared_ptr<LedgerEntry const>> mPending;
+
+    medida::Meter& mBuffered;
+    medida::Meter& mWritten;
+
+  public:
+    // buffers account updates while in scope, dropping them if they were
+    // not flushed (when the changes are rolled back)
+    class Scope : NonMovableOrCopyable
+    {
+        AccountWriteBuffer& mBuffer;
+
+      public:
+        explicit Scope(AccountWriteBuffer& buffer);
+        ~Scope();
+
+        void flush();
+    };
+
+    explicit AccountWriteBuffer(Application& app);
+
+    bool isActive() const;
+
+    // returns true if `accountID` is buffered, setting `entry` to its state
+    bool get(AccountID const& accountID,
+             std::shared_ptr<LedgerEntry const>& entry) const;
+    // keeps `entry` as the state of its account to write
+    void put(LedgerEntry const& entry);
+    // forgets `accountID`, when its state is written or deleted otherwise
+    void erase(AccountID const& accountID);
+
+    // writes the buffered accounts to the database and stops buffering
+    void flush();
+    // drops the buffered accounts and stops buffering
+    void discard();
+};
+}
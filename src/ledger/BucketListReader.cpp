@@ -0,0 +1,95 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "ledger/BucketListReader.h"
+#include "bucket/BucketList.h"
+#include "bucket/BucketManager.h"
+#include "main/Application.h"
+#include "main/Config.h"
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+#include "util/Logging.h"
+#include "util/XDROperators.h"
+
+namespace stellar
+{
+
+const size_t BucketListReader::MAX_DIRTY_KEYS = 1000000;
+
+BucketListReader::Bypass::Bypass(BucketListReader& reader) : mReader(reader)
+{
+    ++mReader.mBypassCount;
+}
+
+BucketListReader::Bypass::~Bypass()
+{
+    --mReader.mBypassCount;
+}
+
+BucketListReader::BucketListReader(Application& app)
+    : mApp(app)
+    , mEnabled(app.getConfig().BUCKET_LIST_READS)
+    , mLoads(app.getMetrics().NewMeter({"ledger", "bucket-read", "load"},
+                                       "entry"))
+    , mFallbacks(app.getMetrics().NewMeter(
+          {"ledger", "bucket-read", "fallback"}, "entry"))
+{
+}
+
+bool
+BucketListReader::isEnabled() const
+{
+    return mEnabled;
+}
+
+bool
+BucketListReader::load(LedgerKey const& key,
+                       std::shared_ptr<LedgerEntry const>& entry)
+{
+    if (!mEnabled || mBypassCount != 0)
+    {
+        return false;
+    }
+    if (!mSynced || mDirtyKeys.find(key) != mDirtyKeys.end())
+    {
+        mFallbacks.Mark();
+        return false;
+    }
+
+    mLoads.Mark();
+    entry = mApp.getBucketManager().getBucketList().getEntry(key);
+    return true;
+}
+
+void
+BucketListReader::markDirty(LedgerKey const& key)
+{
+    if (!mSynced)
+    {
+        return;
+    }
+
+    mDirtyKeys.insert(key);
+    if (mDirtyKeys.size() > MAX_DIRTY_KEYS)
+    {
+        CLOG(INFO, "Ledger") << "Too many changes not in the BucketList, "
+                                "loading entries from the database";
+        mSynced = false;
+        mDirtyKeys.clear();
+    }
+}
+
+void
+BucketListReader::batchAdded()
+{
+    mDirtyKeys.clear();
+}
+
+void
+BucketListReader::stateAssumed()
+{
+    mSynced = mEnabled;
+    mDirtyKeys.clear();
+}
+}
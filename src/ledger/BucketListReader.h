@@ -0,0 +1,82 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "ledger/LedgerHashUtils.h"
+#include "overlay/StellarXDR.h"
+#include "util/NonCopyable.h"
+#include <memory>
+#include <unordered_set>
+
+namespace medida
+{
+class Meter;
+}
+
+namespace stellar
+{
+class Application;
+
+/**
+ * Read-only view of the ledger state held by the BucketList, used to load
+ * entries by key without querying the database.
+ *
+ * The BucketList only receives the changes made by a ledger once it's
+ * closed, while the database sees them as transactions are applied: keys
+ * changed since the last batch was added to the BucketList are tracked as
+ * "dirty" (see LedgerDelta) and keep being read from the database, which
+ * holds their in-flight state.
+ *
+ * Reads from the BucketList are only done once it's known to match the
+ * database, that is once its state was assumed from the database's last
+ * closed ledger or the genesis ledger was created; bulk changes (such as
+ * applying buckets during catchup) make too many keys dirty and disable it
+ * until then.
+ *
+ * Like the LedgerEntry cache, it's owned by the Database for ease of access.
+ */
+class BucketListReader : NonMovableOrCopyable
+{
+    static const size_t MAX_DIRTY_KEYS;
+
+    Application& mApp;
+    bool const mEnabled;
+    bool mSynced{false};
+    std::unordered_set<LedgerKey> mDirtyKeys;
+    int mBypassCount{0};
+
+    medida::Meter& mLoads;
+    medida::Meter& mFallbacks;
+
+  public:
+    // forces loads to go to the database while in scope, typically to compare
+    // the database with the BucketList
+    class Bypass : NonMovableOrCopyable
+    {
+        BucketListReader& mReader;
+
+      public:
+        explicit Bypass(BucketListReader& reader);
+        ~Bypass();
+    };
+
+    explicit BucketListReader(Application& app);
+
+    bool isEnabled() const;
+
+    // returns true if `key` can be loaded from the BucketList, setting `entry`
+    // to its value (nullptr if it doesn't exist)
+    bool load(LedgerKey const& key, std::shared_ptr<LedgerEntry const>& entry);
+
+    // called when `key` is changed in the database
+    void markDirty(LedgerKey const& key);
+
+    // called when the changes of a ledger are added to the BucketList
+    void batchAdded();
+
+    // called when the BucketList is known to match the database
+    void stateAssumed();
+};
+}
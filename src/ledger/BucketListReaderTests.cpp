@@ -0,0 +1,115 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "database/Database.h"
+#include "ledger/AccountFrame.h"
+#include "ledger/BucketListReader.h"
+#include "ledger/EntryFrame.h"
+#include "ledger/LedgerDelta.h"
+#include "ledger/LedgerManager.h"
+#include "lib/catch.hpp"
+#include "main/Application.h"
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+#include "test/TestAccount.h"
+#include "test/TestUtils.h"
+#include "test/TxTests.h"
+#include "test/test.h"
+
+using namespace stellar;
+using namespace stellar::txtest;
+
+TEST_CASE("bucket list reads", "[ledger][bucketlistreads]")
+{
+    Config cfg = getTestConfig();
+    cfg.BUCKET_LIST_READS = true;
+    VirtualClock clock;
+    Application::pointer app = createTestApplication(clock, cfg);
+    app->start();
+
+    auto& db = app->getDatabase();
+    auto& reader = db.getBucketListReader();
+    REQUIRE(reader.isEnabled());
+    auto& loads = app->getMetrics().NewMeter(
+        {"ledger", "bucket-read", "load"}, "entry");
+    auto& fallbacks = app->getMetrics().NewMeter(
+        {"ledger", "bucket-read", "fallback"}, "entry");
+
+    auto root = TestAccount::createRoot(*app);
+    auto a1 = TestAccount{*app, getAccount("a1")};
+    auto minBalance = app->getLedgerManager().getMinBalance(2) + 1000;
+    closeLedgerOn(*app, 2, 1, 1, 2016,
+                  {root.tx({createAccount(a1, minBalance)})});
+    DataValue value;
+    value.resize(4, 1);
+    closeLedgerOn(*app, 3, 1, 1, 2016, {a1.tx({manageData("data", &value)})});
+
+    auto accountKey = [](PublicKey const& pk) {
+        LedgerKey key;
+        key.type(ACCOUNT);
+        key.account().accountID = pk;
+        return key;
+    };
+    LedgerKey dataKey;
+    dataKey.type(DATA);
+    dataKey.data().accountID = a1;
+    dataKey.data().dataName = "data";
+
+    // loads `key` with and without the bucket list
+    auto checkLoad = [&](LedgerKey const& key) {
+        EntryFrame::flushCachedEntry(key, db);
+        auto loaded = EntryFrame::storeLoad(key, db);
+        EntryFrame::pointer fromDb;
+        {
+            BucketListReader::Bypass bypass(reader);
+            EntryFrame::flushCachedEntry(key, db);
+            fromDb = EntryFrame::storeLoad(key, db);
+        }
+        REQUIRE(!loaded == !fromDb);
+        if (fromDb)
+        {
+            REQUIRE(loaded->mEntry == fromDb->mEntry);
+        }
+        return loaded;
+    };
+
+    SECTION("loads match the database")
+    {
+        auto before = loads.count();
+        REQUIRE(checkLoad(accountKey(root)));
+        REQUIRE(checkLoad(accountKey(a1)));
+        REQUIRE(checkLoad(dataKey));
+        REQUIRE(!checkLoad(accountKey(getAccount("missing").getPublicKey())));
+        REQUIRE(loads.count() == before + 4);
+    }
+
+    SECTION("changed entries are loaded from the database")
+    {
+        {
+            soci::transaction sqlTx(db.getSession());
+            LedgerHeader lh(app->getLedgerManager().getCurrentLedgerHeader());
+            LedgerDelta delta(lh, db);
+            auto account = AccountFrame::loadAccount(delta, a1, db);
+            account->getAccount().balance += 1;
+            account->storeChange(delta, db);
+
+            auto before = fallbacks.count();
+            EntryFrame::flushCachedEntry(accountKey(a1), db);
+            auto loaded = AccountFrame::loadAccount(a1, db);
+            REQUIRE(loaded->getBalance() == account->getBalance());
+            REQUIRE(fallbacks.count() == before + 1);
+        }
+
+        // rolled back, the entry is still read from the database until the
+        // next ledger closes
+        auto before = fallbacks.count();
+        checkLoad(accountKey(a1));
+        REQUIRE(fallbacks.count() == before + 1);
+
+        closeLedgerOn(*app, 4, 1, 1, 2016);
+        before = loads.count();
+        checkLoad(accountKey(a1));
+        REQUIRE(loads.count() == before + 1);
+    }
+}
@@ -8,6 +8,7 @@
 #include "crypto/SHA.h"
 #include "crypto/SecretKey.h"
 #include "database/Database.h"
+#include "ledger/LedgerEntryCache.h"
 #include "ledger/LedgerRange.h"
 #include "transactions/ManageDataOpFrame.h"
 #include "util/Decoder.h"
@@ -79,6 +80,20 @@ DataFrame::loadData(AccountID const& accountID, std::string dataName,
 {
     DataFrame::pointer retData;
 
+    LedgerKey key;
+    key.type(DATA);
+    key.data().accountID = accountID;
+    key.data().dataName = dataName;
+    std::shared_ptr<LedgerEntry const> fromBuckets;
+    if (getBucketListEntry(key, fromBuckets, db))
+    {
+        if (fromBuckets)
+        {
+            retData = make_shared<DataFrame>(*fromBuckets);
+        }
+        return retData;
+    }
+
     std::string actIDStrKey = KeyUtils::toStrKey(accountID);
 
     std::string sql = dataColumnSelector;
@@ -191,7 +206,7 @@ void
 DataFrame::deleteDataModifiedOnOrAfterLedger(Database& db,
                                              uint32_t oldestLedger)
 {
-    db.getEntryCache().erase_if(
+    db.getEntryCache().eraseIf(
         [oldestLedger](std::shared_ptr<LedgerEntry const> le) -> bool {
             return le && le->data.type() == DATA &&
                    le->lastModifiedLedgerSeq >= oldestLedger;
@@ -229,6 +244,64 @@ DataFrame::storeDelete(LedgerDelta& delta, Database& db, LedgerKey const& key)
     delta.deleteEntry(key);
 }
 
+void
+DataFrame::storeDeleteBulk(Database& db, std::vector<LedgerKey> const& keys)
+{
+    std::vector<std::string> actIDStrKeys;
+    std::vector<std::string> dataNames;
+    actIDStrKeys.reserve(keys.size());
+    dataNames.reserve(keys.size());
+    for (auto const& key : keys)
+    {
+        actIDStrKeys.emplace_back(KeyUtils::toStrKey(key.data().accountID));
+        dataNames.emplace_back(key.data().dataName);
+    }
+
+    auto timer = db.getDeleteTimer("data");
+    auto prep = db.getPreparedStatement(
+        "DELETE FROM accountdata WHERE accountid=:id AND dataname=:s");
+    auto& st = prep.statement();
+    st.exchange(use(actIDStrKeys));
+    st.exchange(use(dataNames));
+    st.define_and_bind();
+    st.execute(true);
+}
+
+void
+DataFrame::storeAddBulk(Database& db, std::vector<LedgerEntry> const& entries)
+{
+    std::vector<std::string> actIDStrKeys, dataNames, dataValues;
+    std::vector<int> lastModifieds;
+    for (auto const& entry : entries)
+    {
+        auto const& data = entry.data.data();
+        actIDStrKeys.emplace_back(KeyUtils::toStrKey(data.accountID));
+        dataNames.emplace_back(data.dataName);
+        dataValues.emplace_back(decoder::encode_b64(data.dataValue));
+        lastModifieds.emplace_back(entry.lastModifiedLedgerSeq);
+    }
+
+    auto prep = db.getPreparedStatement(
+        "INSERT INTO accountdata "
+        "(accountid,dataname,datavalue,lastmodified)"
+        " VALUES (:aid,:dn,:dv,:lm)");
+    auto& st = prep.statement();
+    st.exchange(use(actIDStrKeys, "aid"));
+    st.exchange(use(dataNames, "dn"));
+    st.exchange(use(dataValues, "dv"));
+    st.exchange(use(lastModifieds, "lm"));
+    st.define_and_bind();
+    {
+        auto timer = db.getInsertTimer("data");
+        st.execute(true);
+    }
+
+    if (st.get_affected_rows() != static_cast<long long>(entries.size()))
+    {
+        throw std::runtime_error("could not update SQL");
+    }
+}
+
 void
 DataFrame::storeChange(LedgerDelta& delta, Database& db)
 {
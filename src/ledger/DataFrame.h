@@ -67,6 +67,10 @@ class DataFrame : public EntryFrame
     // Static helpers that don't assume an instance.
     static void storeDelete(LedgerDelta& delta, Database& db,
                             LedgerKey const& key);
+    static void storeDeleteBulk(Database& db,
+                                std::vector<LedgerKey> const& keys);
+    static void storeAddBulk(Database& db,
+                             std::vector<LedgerEntry> const& entries);
     static bool exists(Database& db, LedgerKey const& key);
     static uint64_t countObjects(soci::session& sess);
     static uint64_t countObjects(soci::session& sess,
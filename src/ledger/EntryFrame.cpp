@@ -4,10 +4,11 @@
 
 #include "ledger/EntryFrame.h"
 #include "LedgerManager.h"
-#include "crypto/Hex.h"
 #include "database/Database.h"
 #include "ledger/AccountFrame.h"
+#include "ledger/BucketListReader.h"
 #include "ledger/DataFrame.h"
+#include "ledger/LedgerEntryCache.h"
 #include "ledger/LedgerDelta.h"
 #include "ledger/OfferFrame.h"
 #include "ledger/TrustFrame.h"
@@ -108,30 +109,36 @@ EntryFrame::touch(LedgerDelta const& delta)
 void
 EntryFrame::flushCachedEntry(LedgerKey const& key, Database& db)
 {
-    auto s = binToHex(xdr::xdr_to_opaque(key));
-    db.getEntryCache().erase_if_exists(s);
+    db.getEntryCache().erase(key);
 }
 
 bool
 EntryFrame::cachedEntryExists(LedgerKey const& key, Database& db)
 {
-    auto s = binToHex(xdr::xdr_to_opaque(key));
-    return db.getEntryCache().exists(s);
+    return db.getEntryCache().exists(key);
 }
 
-std::shared_ptr<LedgerEntry const>
-EntryFrame::getCachedEntry(LedgerKey const& key, Database& db)
+bool
+EntryFrame::getCachedEntry(LedgerKey const& key,
+                           std::shared_ptr<LedgerEntry const>& entry,
+                           Database& db)
 {
-    auto s = binToHex(xdr::xdr_to_opaque(key));
-    return db.getEntryCache().get(s);
+    return db.getEntryCache().get(key, entry);
 }
 
 void
 EntryFrame::putCachedEntry(LedgerKey const& key,
                            std::shared_ptr<LedgerEntry const> p, Database& db)
 {
-    auto s = binToHex(xdr::xdr_to_opaque(key));
-    db.getEntryCache().put(s, p);
+    db.getEntryCache().put(key, std::move(p));
+}
+
+bool
+EntryFrame::getBucketListEntry(LedgerKey const& key,
+                               std::shared_ptr<LedgerEntry const>& entry,
+                               Database& db)
+{
+    return db.getBucketListReader().load(key, entry);
 }
 
 void
@@ -151,6 +158,7 @@ EntryFrame::checkAgainstDatabase(LedgerEntry const& entry, Database& db)
 {
     auto key = LedgerEntryKey(entry);
     flushCachedEntry(key, db);
+    BucketListReader::Bypass bypass(db.getBucketListReader());
     auto const& fromDb = EntryFrame::storeLoad(key, db);
     if (fromDb != nullptr)
     {
@@ -245,6 +253,122 @@ EntryFrame::storeDelete(LedgerDelta& delta, Database& db, LedgerKey const& key)
     }
 }
 
+void
+EntryFrame::storeDeleteBulk(Database& db, std::vector<LedgerKey> const& keys)
+{
+    std::vector<LedgerKey> accounts, trustLines, offers, data;
+    for (auto const& key : keys)
+    {
+        switch (key.type())
+        {
+        case ACCOUNT:
+            accounts.emplace_back(key);
+            break;
+        case TRUSTLINE:
+            trustLines.emplace_back(key);
+            break;
+        case OFFER:
+            offers.emplace_back(key);
+            break;
+        case DATA:
+            data.emplace_back(key);
+            break;
+        }
+    }
+
+    // SOCI does not accept empty vectors
+    if (!accounts.empty())
+    {
+        AccountFrame::storeDeleteBulk(db, accounts);
+    }
+    if (!trustLines.empty())
+    {
+        TrustFrame::storeDeleteBulk(db, trustLines);
+    }
+    if (!offers.empty())
+    {
+        OfferFrame::storeDeleteBulk(db, offers);
+    }
+    if (!data.empty())
+    {
+        DataFrame::storeDeleteBulk(db, data);
+    }
+}
+
+void
+EntryFrame::storeAddBulk(Database& db, std::vector<LedgerEntry> const& entries)
+{
+    std::vector<LedgerEntry> accounts, trustLines, offers, data;
+    for (auto const& entry : entries)
+    {
+        switch (entry.data.type())
+        {
+        case ACCOUNT:
+            accounts.emplace_back(entry);
+            break;
+        case TRUSTLINE:
+            trustLines.emplace_back(entry);
+            break;
+        case OFFER:
+            offers.emplace_back(entry);
+            break;
+        case DATA:
+            data.emplace_back(entry);
+            break;
+        }
+    }
+
+    // SOCI does not accept empty vectors
+    if (!accounts.empty())
+    {
+        AccountFrame::storeAddBulk(db, accounts);
+    }
+    if (!trustLines.empty())
+    {
+        TrustFrame::storeAddBulk(db, trustLines);
+    }
+    if (!offers.empty())
+    {
+        OfferFrame::storeAddBulk(db, offers);
+    }
+    if (!data.empty())
+    {
+        DataFrame::storeAddBulk(db, data);
+    }
+}
+
+size_t
+EntryFrame::prefetch(Database& db, std::vector<LedgerKey> const& keys)
+{
+    std::vector<LedgerKey> accounts, trustLines;
+    for (auto const& key : keys)
+    {
+        if (key.type() == ACCOUNT)
+        {
+            accounts.emplace_back(key);
+        }
+        else if (key.type() == TRUSTLINE)
+        {
+            trustLines.emplace_back(key);
+        }
+    }
+    return AccountFrame::prefetch(db, accounts) +
+           TrustFrame::prefetch(db, trustLines);
+}
+
+const size_t EntryFrame::PREFETCH_BATCH_SIZE = 64;
+
+std::string
+EntryFrame::prefetchPlaceholders()
+{
+    std::string res = "( :v0";
+    for (size_t i = 1; i < PREFETCH_BATCH_SIZE; ++i)
+    {
+        res += ", :v" + std::to_string(i);
+    }
+    return res + " )";
+}
+
 LedgerKey
 LedgerEntryKey(LedgerEntry const& e)
 {
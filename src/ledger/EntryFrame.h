@@ -31,6 +31,11 @@ class EntryFrame : public NonMovableOrCopyable
         mKeyCalculated = false;
     }
 
+    // number of values bound to each statement loading entries in bulk
+    static const size_t PREFETCH_BATCH_SIZE;
+    // "( :v0, :v1, ... )" with PREFETCH_BATCH_SIZE placeholders
+    static std::string prefetchPlaceholders();
+
   public:
     typedef std::shared_ptr<EntryFrame> pointer;
 
@@ -45,12 +50,22 @@ class EntryFrame : public NonMovableOrCopyable
     // Static helpers for working with the DB LedgerEntry cache.
     static void flushCachedEntry(LedgerKey const& key, Database& db);
     static bool cachedEntryExists(LedgerKey const& key, Database& db);
-    static std::shared_ptr<LedgerEntry const>
-    getCachedEntry(LedgerKey const& key, Database& db);
+    // returns true if the key is cached, setting entry to the cached value
+    // (nullptr if the entry is known not to exist)
+    static bool getCachedEntry(LedgerKey const& key,
+                               std::shared_ptr<LedgerEntry const>& entry,
+                               Database& db);
     static void putCachedEntry(LedgerKey const& key,
                                std::shared_ptr<LedgerEntry const> p,
                                Database& db);
 
+    // returns true if the key can be loaded from the BucketList rather than
+    // from the database (see BucketListReader), setting entry to its value
+    // (nullptr if the entry doesn't exist)
+    static bool getBucketListEntry(LedgerKey const& key,
+                                   std::shared_ptr<LedgerEntry const>& entry,
+                                   Database& db);
+
     // helpers to get/set the last modified field
     uint32 getLastModified() const;
     uint32& getLastModified();
@@ -79,6 +94,19 @@ class EntryFrame : public NonMovableOrCopyable
     static bool exists(Database& db, LedgerKey const& key);
     static void storeDelete(LedgerDelta& delta, Database& db,
                             LedgerKey const& key);
+    // deletes the entries of `keys` that exist with one statement per table,
+    // without recording the changes in a LedgerDelta (used to load buckets)
+    static void storeDeleteBulk(Database& db,
+                                std::vector<LedgerKey> const& keys);
+    // inserts entries that don't exist with one statement per table, without
+    // recording the changes in a LedgerDelta (used to load buckets)
+    static void storeAddBulk(Database& db,
+                             std::vector<LedgerEntry> const& entries);
+    // loads the accounts and trust lines of `keys` that are not cached yet
+    // into the LedgerEntry cache, with a few statements per table rather
+    // than one per key (other keys are ignored); returns the number of
+    // entries added to the cache
+    static size_t prefetch(Database& db, std::vector<LedgerKey> const& keys);
 };
 
 // static helper for getting a LedgerKey from a LedgerEntry.
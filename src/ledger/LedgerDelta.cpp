@@ -3,6 +3,9 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "ledger/LedgerDelta.h"
+#include "database/Database.h"
+#include "ledger/BucketListReader.h"
+#include "ledger/OrderBook.h"
 #include "main/Application.h"
 #include "main/Config.h"
 #include "medida/meter.h"
@@ -10,6 +13,9 @@
 #include "util/XDROperators.h"
 #include "xdr/Stellar-ledger.h"
 #include "xdrpp/printer.h"
+#include <algorithm>
+#include <limits>
+#include <unordered_set>
 
 namespace stellar
 {
@@ -18,9 +24,14 @@ LedgerDelta::LedgerDelta(LedgerDelta& outerDelta)
     , mHeader(&outerDelta.getHeader())
     , mCurrentHeader(outerDelta.getHeader())
     , mPreviousHeaderValue(outerDelta.getHeader())
+    , mLog(outerDelta.mLog)
+    , mUndoStart(outerDelta.mLog->mUndo.size())
+    , mViews{std::numeric_limits<uint64_t>::max()}
     , mDb(outerDelta.mDb)
     , mUpdateLastModified(outerDelta.mUpdateLastModified)
 {
+    assert(mLog->mInnermost == &outerDelta);
+    mLog->mInnermost = this;
 }
 
 LedgerDelta::LedgerDelta(LedgerHeader& header, Database& db,
@@ -29,9 +40,13 @@ LedgerDelta::LedgerDelta(LedgerHeader& header, Database& db,
     , mHeader(&header)
     , mCurrentHeader(header)
     , mPreviousHeaderValue(header)
+    , mLog(std::make_shared<ChangeLog>())
+    , mUndoStart(0)
+    , mViews{std::numeric_limits<uint64_t>::max()}
     , mDb(db)
     , mUpdateLastModified(updateLastModified)
 {
+    mLog->mInnermost = this;
 }
 
 LedgerDelta::~LedgerDelta()
@@ -100,24 +115,46 @@ LedgerDelta::recordEntry(EntryFrame const& entry)
     recordEntry(entry.copy());
 }
 
+LedgerDelta::EntryChange&
+LedgerDelta::logChange(LedgerKey const& key)
+{
+    // changes of an outer delta would be undone with the nested one
+    assert(mLog->mInnermost == this);
+    auto& changes = mLog->mChanges;
+    auto it = changes.find(key);
+    if (it == changes.end())
+    {
+        EntryChange unchanged{UNCHANGED, nullptr, nullptr};
+        mLog->mUndo.emplace_back(UndoRecord{key, false, unchanged});
+        it = changes.emplace(key, unchanged).first;
+    }
+    else
+    {
+        mLog->mUndo.emplace_back(UndoRecord{key, true, it->second});
+    }
+    ++mLog->mVersion;
+    return it->second;
+}
+
 void
 LedgerDelta::addEntry(EntryFrame::pointer entry)
 {
     checkState();
     auto k = entry->getKey();
-    auto del_it = mDelete.find(k);
-    if (del_it != mDelete.end())
+    mDb.getBucketListReader().markDirty(k);
+    auto& change = logChange(k);
+    if (change.mState == DELETED)
     {
         // delete + new is an update
-        mDelete.erase(del_it);
-        mMod[k] = entry;
+        change.mState = MODIFIED;
     }
     else
     {
-        assert(mNew.find(k) == mNew.end()); // double new
-        assert(mMod.find(k) == mMod.end()); // mod + new is invalid
-        mNew[k] = entry;
+        // double new or mod + new is invalid
+        assert(change.mState == UNCHANGED);
+        change.mState = ADDED;
     }
+    change.mCurrent = entry;
 }
 
 void
@@ -131,22 +168,23 @@ void
 LedgerDelta::deleteEntry(LedgerKey const& k)
 {
     checkState();
-    auto new_it = mNew.find(k);
-    if (new_it != mNew.end())
+    mDb.getBucketListReader().markDirty(k);
+    auto& change = logChange(k);
+    if (change.mState == ADDED)
     {
         // new + delete -> don't add it in the first place
-        mNew.erase(new_it);
+        change.mState = UNCHANGED;
     }
     else
     {
         // double delete here means there is buggy code upstream
         // and we cannot keep going as this may corrupt the bucket list
-        assert(mDelete.find(k) == mDelete.end());
+        assert(change.mState != DELETED);
 
         // mod + delete -> delete
-        mMod.erase(k);
-        mDelete.insert(k);
+        change.mState = DELETED;
     }
+    change.mCurrent.reset();
 }
 
 void
@@ -154,26 +192,16 @@ LedgerDelta::modEntry(EntryFrame::pointer entry)
 {
     checkState();
     auto k = entry->getKey();
-    auto mod_it = mMod.find(k);
-    if (mod_it != mMod.end())
+    mDb.getBucketListReader().markDirty(k);
+    auto& change = logChange(k);
+    // delete + mod is illegal
+    assert(change.mState != DELETED);
+    if (change.mState == UNCHANGED)
     {
-        // collapse mod
-        mod_it->second = entry;
-    }
-    else
-    {
-        auto new_it = mNew.find(k);
-        if (new_it != mNew.end())
-        {
-            // new + mod = new (with latest value)
-            new_it->second = entry;
-        }
-        else
-        {
-            assert(mDelete.find(k) == mDelete.end()); // delete + mod is illegal
-            mMod[k] = entry;
-        }
+        change.mState = MODIFIED;
     }
+    // new + mod = new (with latest value), mod + mod = mod
+    change.mCurrent = entry;
 }
 
 void
@@ -181,36 +209,11 @@ LedgerDelta::recordEntry(EntryFrame::pointer entry)
 {
     checkState();
     // keeps the old one around
-    mPrevious.insert(std::make_pair(entry->getKey(), entry));
-}
-
-void
-LedgerDelta::mergeEntries(LedgerDelta& other)
-{
-    checkState();
-
-    // propagates mPrevious for deleted & modified entries
-    for (auto& d : other.mDelete)
-    {
-        deleteEntry(d);
-        auto it = other.mPrevious.find(d);
-        if (it != other.mPrevious.end())
-        {
-            recordEntry(*it->second);
-        }
-    }
-    for (auto& n : other.mNew)
+    auto const& k = entry->getKey();
+    auto it = mLog->mChanges.find(k);
+    if (it == mLog->mChanges.end() || !it->second.mPrevious)
     {
-        addEntry(n.second);
-    }
-    for (auto& m : other.mMod)
-    {
-        modEntry(m.second);
-        auto it = other.mPrevious.find(m.first);
-        if (it != other.mPrevious.end())
-        {
-            recordEntry(*it->second);
-        }
+        logChange(k).mPrevious = entry;
     }
 }
 
@@ -227,9 +230,16 @@ LedgerDelta::commit()
 
     if (mOuterDelta)
     {
-        mOuterDelta->mergeEntries(*this);
+        // changes are already in the log shared with mOuterDelta
+        mOuterDelta->checkState();
+        mLog->mInnermost = mOuterDelta;
         mOuterDelta = nullptr;
     }
+    else
+    {
+        mLog->mInnermost = nullptr;
+        mDb.getOrderBook().forgetRemovedOffers();
+    }
     *mHeader = mCurrentHeader.mHeader;
     mHeader = nullptr;
 }
@@ -240,30 +250,144 @@ LedgerDelta::rollback()
     checkState();
     mHeader = nullptr;
 
-    for (auto& d : mDelete)
+    auto& orderBook = mDb.getOrderBook();
+    auto& changes = mLog->mChanges;
+    auto& undo = mLog->mUndo;
+    while (undo.size() > mUndoStart)
     {
-        EntryFrame::flushCachedEntry(d, mDb);
+        auto& record = undo.back();
+        auto it = changes.find(record.mKey);
+        assert(it != changes.end());
+        if (it->second.mState != record.mChange.mState ||
+            it->second.mCurrent != record.mChange.mCurrent)
+        {
+            EntryFrame::flushCachedEntry(record.mKey, mDb);
+            if (record.mKey.type() == OFFER)
+            {
+                orderBook.invalidateOffer(record.mKey);
+            }
+        }
+        if (record.mTracked)
+        {
+            it->second = record.mChange;
+        }
+        else
+        {
+            changes.erase(it);
+        }
+        undo.pop_back();
     }
-    for (auto& n : mNew)
+    ++mLog->mVersion;
+    mLog->mInnermost = mOuterDelta;
+
+    if (!mOuterDelta)
     {
-        EntryFrame::flushCachedEntry(n.first, mDb);
+        orderBook.forgetRemovedOffers();
     }
-    for (auto& m : mMod)
+}
+
+LedgerDelta::EntryChange
+LedgerDelta::changeSince(UndoRecord const& before, EntryChange const& after)
+{
+    auto const& prev = before.mChange;
+    if (!before.mTracked || prev.mState == UNCHANGED)
+    {
+        // changes of the outermost delta and of this one are the same
+        return after;
+    }
+
+    bool existed = prev.mState != DELETED;
+    bool exists = after.mState == ADDED || after.mState == MODIFIED;
+    EntryChange res{UNCHANGED, after.mCurrent, prev.mCurrent};
+    if (existed && exists)
+    {
+        // each change stores a new copy of the entry
+        if (after.mCurrent != prev.mCurrent)
+        {
+            res.mState = MODIFIED;
+        }
+    }
+    else if (existed)
+    {
+        res.mState = DELETED;
+    }
+    else if (exists)
+    {
+        res.mState = ADDED;
+    }
+    return res;
+}
+
+LedgerDelta::Views const&
+LedgerDelta::getViews() const
+{
+    if (mViews.mVersion == mLog->mVersion)
+    {
+        return mViews;
+    }
+
+    mViews.mAdded.clear();
+    mViews.mModified.clear();
+    mViews.mDeleted.clear();
+    auto addView = [this](LedgerKey const& key, EntryChange const& change) {
+        switch (change.mState)
+        {
+        case ADDED:
+            mViews.mAdded.emplace_back(key, change);
+            break;
+        case MODIFIED:
+            mViews.mModified.emplace_back(key, change);
+            break;
+        case DELETED:
+            mViews.mDeleted.emplace_back(key, change);
+            break;
+        case UNCHANGED:
+            break;
+        }
+    };
+
+    auto const& changes = mLog->mChanges;
+    if (mUndoStart == 0)
+    {
+        // nothing was changed before this delta began
+        for (auto const& kv : changes)
+        {
+            addView(kv.first, kv.second);
+        }
+    }
+    else
     {
-        EntryFrame::flushCachedEntry(m.first, mDb);
+        // the first record of each key is its state when this delta began
+        std::unordered_set<LedgerKey> seen;
+        auto const& undo = mLog->mUndo;
+        for (size_t i = mUndoStart; i < undo.size(); ++i)
+        {
+            auto const& key = undo[i].mKey;
+            if (seen.insert(key).second)
+            {
+                addView(key, changeSince(undo[i], changes.at(key)));
+            }
+        }
     }
+
+    auto byKey = [](KeyChange const& a, KeyChange const& b) {
+        return LedgerEntryIdCmp{}(a.first, b.first);
+    };
+    std::sort(mViews.mAdded.begin(), mViews.mAdded.end(), byKey);
+    std::sort(mViews.mModified.begin(), mViews.mModified.end(), byKey);
+    std::sort(mViews.mDeleted.begin(), mViews.mDeleted.end(), byKey);
+    mViews.mVersion = mLog->mVersion;
+    return mViews;
 }
 
 void
 LedgerDelta::addCurrentMeta(LedgerEntryChanges& changes,
-                            LedgerKey const& key) const
+                            EntryChange const& change)
 {
-    auto it = mPrevious.find(key);
-    if (it != mPrevious.end())
+    if (change.mPrevious)
     {
-        auto const& e = it->second->mEntry;
         changes.emplace_back(LEDGER_ENTRY_STATE);
-        changes.back().state() = e;
+        changes.back().state() = change.mPrevious->mEntry;
     }
 }
 
@@ -271,24 +395,25 @@ LedgerEntryChanges
 LedgerDelta::getChanges() const
 {
     LedgerEntryChanges changes;
+    auto const& views = getViews();
 
-    for (auto const& k : mNew)
+    for (auto const& k : views.mAdded)
     {
         changes.emplace_back(LEDGER_ENTRY_CREATED);
-        changes.back().created() = k.second->mEntry;
+        changes.back().created() = k.second.mCurrent->mEntry;
     }
-    for (auto const& k : mMod)
+    for (auto const& k : views.mModified)
     {
-        addCurrentMeta(changes, k.first);
+        addCurrentMeta(changes, k.second);
         changes.emplace_back(LEDGER_ENTRY_UPDATED);
-        changes.back().updated() = k.second->mEntry;
+        changes.back().updated() = k.second.mCurrent->mEntry;
     }
 
-    for (auto const& k : mDelete)
+    for (auto const& k : views.mDeleted)
     {
-        addCurrentMeta(changes, k);
+        addCurrentMeta(changes, k.second);
         changes.emplace_back(LEDGER_ENTRY_REMOVED);
-        changes.back().removed() = k;
+        changes.back().removed() = k.first;
     }
 
     return changes;
@@ -298,16 +423,17 @@ std::vector<LedgerEntry>
 LedgerDelta::getLiveEntries() const
 {
     std::vector<LedgerEntry> live;
+    auto const& views = getViews();
 
-    live.reserve(mNew.size() + mMod.size());
+    live.reserve(views.mAdded.size() + views.mModified.size());
 
-    for (auto const& k : mNew)
+    for (auto const& k : views.mAdded)
     {
-        live.push_back(k.second->mEntry);
+        live.push_back(k.second.mCurrent->mEntry);
     }
-    for (auto const& k : mMod)
+    for (auto const& k : views.mModified)
     {
-        live.push_back(k.second->mEntry);
+        live.push_back(k.second.mCurrent->mEntry);
     }
 
     return live;
@@ -317,12 +443,13 @@ std::vector<LedgerKey>
 LedgerDelta::getDeadEntries() const
 {
     std::vector<LedgerKey> dead;
+    auto const& views = getViews();
 
-    dead.reserve(mDelete.size());
+    dead.reserve(views.mDeleted.size());
 
-    for (auto const& k : mDelete)
+    for (auto const& k : views.mDeleted)
     {
-        dead.push_back(k);
+        dead.push_back(k.first);
     }
     return dead;
 }
@@ -336,7 +463,8 @@ LedgerDelta::updateLastModified() const
 void
 LedgerDelta::markMeters(Application& app) const
 {
-    for (auto const& ke : mNew)
+    auto const& views = getViews();
+    for (auto const& ke : views.mAdded)
     {
         switch (ke.first.type())
         {
@@ -363,7 +491,7 @@ LedgerDelta::markMeters(Application& app) const
         }
     }
 
-    for (auto const& ke : mMod)
+    for (auto const& ke : views.mModified)
     {
         switch (ke.first.type())
         {
@@ -390,9 +518,9 @@ LedgerDelta::markMeters(Application& app) const
         }
     }
 
-    for (auto const& ke : mDelete)
+    for (auto const& ke : views.mDeleted)
     {
-        switch (ke.type())
+        switch (ke.first.type())
         {
         case ACCOUNT:
             app.getMetrics()
@@ -495,57 +623,67 @@ LedgerDelta::IteratorRange<IterType>::end() const
     return mEnd;
 }
 
-template class LedgerDelta::Iterator<LedgerDelta::KeyEntryMap::const_iterator,
+template class LedgerDelta::Iterator<LedgerDelta::KeyChangeList::const_iterator,
                                      LedgerDelta::AddedLedgerEntry>;
 template class LedgerDelta::IteratorRange<LedgerDelta::AddedIterator>;
 
-LedgerDelta::AddedLedgerEntry::AddedLedgerEntry(
-    LedgerDelta const& delta, KeyEntryMap::value_type const& pair)
-    : key(pair.first), current(pair.second)
+LedgerDelta::AddedLedgerEntry::AddedLedgerEntry(LedgerDelta const& delta,
+                                                KeyChange const& change)
+    : key(change.first), current(change.second.mCurrent)
 {
 }
 
 LedgerDelta::IteratorRange<LedgerDelta::AddedIterator>
 LedgerDelta::added() const
 {
-    return {LedgerDelta::AddedIterator(*this, mNew.cbegin()),
-            LedgerDelta::AddedIterator(*this, mNew.cend())};
+    auto const& views = getViews();
+    return {LedgerDelta::AddedIterator(*this, views.mAdded.cbegin()),
+            LedgerDelta::AddedIterator(*this, views.mAdded.cend())};
 }
 
-template class LedgerDelta::Iterator<LedgerDelta::KeyEntryMap::const_iterator,
+template class LedgerDelta::Iterator<LedgerDelta::KeyChangeList::const_iterator,
                                      LedgerDelta::ModifiedLedgerEntry>;
 template class LedgerDelta::IteratorRange<LedgerDelta::ModifiedIterator>;
 
-LedgerDelta::ModifiedLedgerEntry::ModifiedLedgerEntry(
-    LedgerDelta const& delta, KeyEntryMap::value_type const& pair)
-    : key(pair.first)
-    , current(pair.second)
-    , previous(delta.mPrevious.at(pair.first))
+LedgerDelta::ModifiedLedgerEntry::ModifiedLedgerEntry(LedgerDelta const& delta,
+                                                      KeyChange const& change)
+    : key(change.first)
+    , current(change.second.mCurrent)
+    , previous(change.second.mPrevious)
 {
+    if (!previous)
+    {
+        throw std::runtime_error("no previous value for modified entry");
+    }
 }
 
 LedgerDelta::IteratorRange<LedgerDelta::ModifiedIterator>
 LedgerDelta::modified() const
 {
-    return {LedgerDelta::ModifiedIterator(*this, mMod.cbegin()),
-            LedgerDelta::ModifiedIterator(*this, mMod.cend())};
+    auto const& views = getViews();
+    return {LedgerDelta::ModifiedIterator(*this, views.mModified.cbegin()),
+            LedgerDelta::ModifiedIterator(*this, views.mModified.cend())};
 }
 
-template class LedgerDelta::Iterator<
-    std::set<LedgerKey, LedgerEntryIdCmp>::const_iterator,
-    LedgerDelta::DeletedLedgerEntry>;
+template class LedgerDelta::Iterator<LedgerDelta::KeyChangeList::const_iterator,
+                                     LedgerDelta::DeletedLedgerEntry>;
 template class LedgerDelta::IteratorRange<LedgerDelta::DeletedIterator>;
 
 LedgerDelta::DeletedLedgerEntry::DeletedLedgerEntry(LedgerDelta const& delta,
-                                                    LedgerKey const& value)
-    : key(value), previous(delta.mPrevious.at(value))
+                                                    KeyChange const& change)
+    : key(change.first), previous(change.second.mPrevious)
 {
+    if (!previous)
+    {
+        throw std::runtime_error("no previous value for deleted entry");
+    }
 }
 
 LedgerDelta::IteratorRange<LedgerDelta::DeletedIterator>
 LedgerDelta::deleted() const
 {
-    return {LedgerDelta::DeletedIterator(*this, mDelete.cbegin()),
-            LedgerDelta::DeletedIterator(*this, mDelete.cend())};
+    auto const& views = getViews();
+    return {LedgerDelta::DeletedIterator(*this, views.mDeleted.cbegin()),
+            LedgerDelta::DeletedIterator(*this, views.mDeleted.cend())};
 }
 }
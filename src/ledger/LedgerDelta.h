@@ -6,12 +6,13 @@
 
 #include "bucket/LedgerCmp.h"
 #include "ledger/EntryFrame.h"
+#include "ledger/LedgerHashUtils.h"
 #include "ledger/LedgerHeaderFrame.h"
 #include "xdrpp/marshal.h"
 #include <iterator>
-#include <map>
 #include <memory>
-#include <set>
+#include <unordered_map>
+#include <vector>
 
 namespace stellar
 {
@@ -20,8 +21,61 @@ class Database;
 
 class LedgerDelta
 {
-    typedef std::map<LedgerKey, EntryFrame::pointer, LedgerEntryIdCmp>
-        KeyEntryMap;
+    // what happened to an entry since the beginning of a delta
+    enum EntryState
+    {
+        UNCHANGED,
+        ADDED,
+        MODIFIED,
+        DELETED
+    };
+
+    struct EntryChange
+    {
+        EntryState mState;
+        // value of the entry if it was added or modified
+        EntryFrame::pointer mCurrent;
+        // value recorded before the entry was first changed
+        EntryFrame::pointer mPrevious;
+    };
+
+    // value of an entry change before a delta touched it, to restore it on
+    // rollback
+    struct UndoRecord
+    {
+        LedgerKey mKey;
+        bool mTracked; // false if the key was not in mChanges
+        EntryChange mChange;
+    };
+
+    // changes of the outermost delta, shared with all the deltas nested in
+    // it: nested deltas change entries in place, recording their previous
+    // state in mUndo, so that committing them is free and rolling them back
+    // replays mUndo back to where they began.
+    // Nested deltas must be used as a stack: only the innermost live delta
+    // may record changes.
+    struct ChangeLog
+    {
+        std::unordered_map<LedgerKey, EntryChange> mChanges;
+        std::vector<UndoRecord> mUndo;
+        // bumped on every change to invalidate the views of the deltas
+        uint64_t mVersion;
+        // delta allowed to record changes, nullptr once the outermost one
+        // is committed or rolled back
+        LedgerDelta const* mInnermost;
+    };
+
+    typedef std::pair<LedgerKey, EntryChange> KeyChange;
+    typedef std::vector<KeyChange> KeyChangeList;
+
+    // changes of a delta by type, sorted by key
+    struct Views
+    {
+        uint64_t mVersion;
+        KeyChangeList mAdded;
+        KeyChangeList mModified;
+        KeyChangeList mDeleted;
+    };
 
     LedgerDelta*
         mOuterDelta;       // set when this delta is nested inside another delta
@@ -32,10 +86,9 @@ class LedgerDelta
     LedgerHeaderFrame mCurrentHeader;
     LedgerHeader mPreviousHeaderValue;
     // ledger entries
-    KeyEntryMap mNew;
-    KeyEntryMap mMod;
-    std::set<LedgerKey, LedgerEntryIdCmp> mDelete;
-    KeyEntryMap mPrevious;
+    std::shared_ptr<ChangeLog> mLog;
+    size_t mUndoStart; // size of mLog->mUndo when this delta began
+    mutable Views mViews;
 
     Database& mDb; // Used strictly for rollback of db entry cache.
 
@@ -47,13 +100,19 @@ class LedgerDelta
     void modEntry(EntryFrame::pointer entry);
     void recordEntry(EntryFrame::pointer entry);
 
-    // merge "other" into current ledgerDelta
-    void mergeEntries(LedgerDelta& other);
+    // returns the change of `key` to update after saving it in mUndo
+    EntryChange& logChange(LedgerKey const& key);
+
+    // change of an entry since this delta began, given its state at the
+    // time and its current one
+    static EntryChange changeSince(UndoRecord const& before,
+                                   EntryChange const& after);
+    Views const& getViews() const;
 
     // helper method that adds a meta entry to "changes"
     // with the previous value of an entry if needed
-    void addCurrentMeta(LedgerEntryChanges& changes,
-                        LedgerKey const& key) const;
+    static void addCurrentMeta(LedgerEntryChanges& changes,
+                               EntryChange const& change);
 
   public:
     // keeps an internal reference to the outerDelta,
@@ -137,9 +196,9 @@ class LedgerDelta
         EntryFrame::pointer current;
 
         explicit AddedLedgerEntry(LedgerDelta const& delta,
-                                  KeyEntryMap::value_type const& pair);
+                                  KeyChange const& change);
     };
-    typedef Iterator<KeyEntryMap::const_iterator, AddedLedgerEntry>
+    typedef Iterator<KeyChangeList::const_iterator, AddedLedgerEntry>
         AddedIterator;
     IteratorRange<AddedIterator> added() const;
 
@@ -150,9 +209,9 @@ class LedgerDelta
         EntryFrame::pointer previous;
 
         explicit ModifiedLedgerEntry(LedgerDelta const& delta,
-                                     KeyEntryMap::value_type const& pair);
+                                     KeyChange const& change);
     };
-    typedef Iterator<KeyEntryMap::const_iterator, ModifiedLedgerEntry>
+    typedef Iterator<KeyChangeList::const_iterator, ModifiedLedgerEntry>
         ModifiedIterator;
     IteratorRange<ModifiedIterator> modified() const;
 
@@ -162,10 +221,9 @@ class LedgerDelta
         EntryFrame::pointer previous;
 
         explicit DeletedLedgerEntry(LedgerDelta const& delta,
-                                    LedgerKey const& value);
+                                    KeyChange const& change);
     };
-    typedef Iterator<std::set<LedgerKey, LedgerEntryIdCmp>::const_iterator,
-                     DeletedLedgerEntry>
+    typedef Iterator<KeyChangeList::const_iterator, DeletedLedgerEntry>
         DeletedIterator;
     IteratorRange<DeletedIterator> deleted() const;
 };
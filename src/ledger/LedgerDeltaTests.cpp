@@ -265,6 +265,23 @@ TEST_CASE("Ledger delta", "[ledger][ledgerdelta]")
                              nbAccountsGroupSize, nbAccountsGroupSize * 2,
                              orgAccounts);
             }
+            SECTION("nested commit then rollback")
+            {
+                LedgerDelta delta2(delta);
+                MapAccounts accountsByKey2;
+                {
+                    LedgerDelta delta3(delta2);
+                    addEntries(nbAccountsGroupSize * 3,
+                               nbAccountsGroupSize * 4, delta3,
+                               accountsByKey2);
+                    delta3.commit();
+                }
+                REQUIRE(delta2.getLiveEntries().size() == nbAccountsGroupSize);
+                delta2.rollback();
+                checkChanges(delta, nbAccountsGroupSize, nbAccountsGroupSize,
+                             nbAccountsGroupSize, nbAccountsGroupSize * 2,
+                             orgAccounts);
+            }
         }
         SECTION("modified entries")
         {
@@ -296,6 +313,57 @@ TEST_CASE("Ledger delta", "[ledger][ledgerdelta]")
                              orgAccounts);
             }
         }
+        SECTION("nested modified and deleted entries")
+        {
+            LedgerDelta delta2(delta);
+            MapAccounts accounts2 = accountsByKey;
+
+            // modify entries that were modified, delete entries that were
+            // added
+            modEntries(nbAccountsGroupSize, nbAccountsGroupSize * 2, delta2,
+                       accounts2);
+            delEntries(0, nbAccountsGroupSize, delta2, accounts2);
+
+            accountsByKey = accounts2;
+            checkChanges(delta2, 0, nbAccountsGroupSize, nbAccountsGroupSize,
+                         nbAccountsGroupSize * 2, orgAccountsBeforeD2);
+
+            MapAccounts orgAccountsBeforeD3 = accounts2;
+            orgAccountsBeforeD3.insert(orgAccounts.begin(),
+                                       orgAccounts.end());
+            {
+                LedgerDelta delta3(delta2);
+                MapAccounts accounts3 = accounts2;
+
+                // modify and delete entries that delta2 modified, and
+                // modify entries not tracked so far
+                size_t split = nbAccountsGroupSize + nbAccountsGroupSize / 2;
+                modEntries(nbAccountsGroupSize, split, delta3, accounts3);
+                delEntries(split, nbAccountsGroupSize * 2, delta3, accounts3);
+                modEntries(nbAccountsGroupSize * 3, nbAccountsGroupSize * 4,
+                           delta3, accounts3);
+
+                // previous values are the ones when delta3 began
+                accountsByKey = accounts3;
+                size_t nbMods = split - nbAccountsGroupSize;
+                size_t nbDels = nbAccountsGroupSize * 2 - split;
+                checkChanges(delta3, 0, nbMods + nbAccountsGroupSize, nbDels,
+                             nbMods + nbDels + nbAccountsGroupSize,
+                             orgAccountsBeforeD3);
+
+                delta3.rollback();
+            }
+
+            // delta2 is back to its state before delta3
+            accountsByKey = accounts2;
+            checkChanges(delta2, 0, nbAccountsGroupSize, nbAccountsGroupSize,
+                         nbAccountsGroupSize * 2, orgAccountsBeforeD2);
+
+            delta2.commit();
+            // added then deleted entries are gone
+            checkChanges(delta, 0, nbAccountsGroupSize, nbAccountsGroupSize,
+                         nbAccountsGroupSize * 2, orgAccounts);
+        }
         SECTION("deleted entries")
         {
             LedgerDelta delta2(delta);
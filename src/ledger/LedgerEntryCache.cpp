@@ -0,0 +1,179 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "ledger/LedgerEntryCache.h"
+#include "medida/counter.h"
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+#include "util/XDROperators.h"
+#include "util/make_unique.h"
+#include "xdrpp/marshal.h"
+#include <algorithm>
+#include <iterator>
+
+namespace stellar
+{
+
+const size_t LedgerEntryCache::SHARD_COUNT = 16;
+
+LedgerEntryCache::LedgerEntryCache(medida::MetricsRegistry& metrics,
+                                   size_t maxBytes)
+    : mMaxShardBytes(std::max<size_t>(maxBytes / SHARD_COUNT, 1))
+    , mHits(metrics.NewMeter({"ledger", "entry-cache", "hit"}, "entry"))
+    , mMisses(metrics.NewMeter({"ledger", "entry-cache", "miss"}, "entry"))
+    , mEvictions(metrics.NewMeter({"ledger", "entry-cache", "evict"}, "entry"))
+    , mSize(metrics.NewCounter({"ledger", "entry-cache", "bytes"}))
+{
+    for (size_t i = 0; i < SHARD_COUNT; ++i)
+    {
+        mShards.emplace_back(make_unique<Shard>());
+    }
+}
+
+size_t
+LedgerEntryCache::entrySize(LedgerKey const& key, EntryPtr const& entry)
+{
+    // the key is stored twice (list and index), plus bookkeeping for the
+    // list node, the index node and the shared_ptr control block
+    size_t res = 2 * (sizeof(LedgerKey) + xdr::xdr_size(key)) +
+                 sizeof(EntryPtr) + 8 * sizeof(void*);
+    if (entry)
+    {
+        res += sizeof(LedgerEntry) + xdr::xdr_size(*entry);
+    }
+    return res;
+}
+
+LedgerEntryCache::Shard&
+LedgerEntryCache::getShard(LedgerKey const& key) const
+{
+    return *mShards[std::hash<LedgerKey>()(key) % SHARD_COUNT];
+}
+
+void
+LedgerEntryCache::eraseLocked(Shard& shard, Shard::List::iterator it)
+{
+    auto sz = entrySize(it->first, it->second);
+    shard.mBytes -= sz;
+    mSize.dec(sz);
+    shard.mIndex.erase(it->first);
+    shard.mItems.erase(it);
+}
+
+bool
+LedgerEntryCache::get(LedgerKey const& key, EntryPtr& entry)
+{
+    auto& shard = getShard(key);
+    std::lock_guard<std::mutex> lock(shard.mMutex);
+    auto it = shard.mIndex.find(key);
+    if (it == shard.mIndex.end())
+    {
+        mMisses.Mark();
+        return false;
+    }
+    mHits.Mark();
+    shard.mItems.splice(shard.mItems.begin(), shard.mItems, it->second);
+    entry = it->second->second;
+    return true;
+}
+
+bool
+LedgerEntryCache::exists(LedgerKey const& key) const
+{
+    auto& shard = getShard(key);
+    std::lock_guard<std::mutex> lock(shard.mMutex);
+    return shard.mIndex.find(key) != shard.mIndex.end();
+}
+
+void
+LedgerEntryCache::put(LedgerKey const& key, EntryPtr entry)
+{
+    auto& shard = getShard(key);
+    std::lock_guard<std::mutex> lock(shard.mMutex);
+    auto it = shard.mIndex.find(key);
+    if (it != shard.mIndex.end())
+    {
+        eraseLocked(shard, it->second);
+    }
+
+    auto sz = entrySize(key, entry);
+    shard.mItems.emplace_front(key, std::move(entry));
+    shard.mIndex.emplace(key, shard.mItems.begin());
+    shard.mBytes += sz;
+    mSize.inc(sz);
+
+    // always keep the entry that was just added
+    while (shard.mBytes > mMaxShardBytes && shard.mItems.size() > 1)
+    {
+        eraseLocked(shard, std::prev(shard.mItems.end()));
+        mEvictions.Mark();
+    }
+}
+
+void
+LedgerEntryCache::erase(LedgerKey const& key)
+{
+    auto& shard = getShard(key);
+    std::lock_guard<std::mutex> lock(shard.mMutex);
+    auto it = shard.mIndex.find(key);
+    if (it != shard.mIndex.end())
+    {
+        eraseLocked(shard, it->second);
+    }
+}
+
+void
+LedgerEntryCache::eraseIf(std::function<bool(EntryPtr const&)> const& f)
+{
+    for (auto& shard : mShards)
+    {
+        std::lock_guard<std::mutex> lock(shard->mMutex);
+        for (auto it = shard->mItems.begin(); it != shard->mItems.end();)
+        {
+            auto cur = it++;
+            if (f(cur->second))
+            {
+                eraseLocked(*shard, cur);
+            }
+        }
+    }
+}
+
+void
+LedgerEntryCache::clear()
+{
+    for (auto& shard : mShards)
+    {
+        std::lock_guard<std::mutex> lock(shard->mMutex);
+        mSize.dec(shard->mBytes);
+        shard->mItems.clear();
+        shard->mIndex.clear();
+        shard->mBytes = 0;
+    }
+}
+
+size_t
+LedgerEntryCache::size() const
+{
+    size_t res = 0;
+    for (auto& shard : mShards)
+    {
+        std::lock_guard<std::mutex> lock(shard->mMutex);
+        res += shard->mItems.size();
+    }
+    return res;
+}
+
+size_t
+LedgerEntryCache::getBytes() const
+{
+    size_t res = 0;
+    for (auto& shard : mShards)
+    {
+        std::lock_guard<std::mutex> lock(shard->mMutex);
+        res += shard->mBytes;
+    }
+    return res;
+}
+}
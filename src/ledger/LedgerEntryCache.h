@@ -0,0 +1,87 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "ledger/LedgerHashUtils.h"
+#include "overlay/StellarXDR.h"
+#include "util/NonCopyable.h"
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace medida
+{
+class Counter;
+class Meter;
+class MetricsRegistry;
+}
+
+namespace stellar
+{
+
+/**
+ * LRU cache of LedgerEntries keyed directly by LedgerKey.
+ *
+ * A cached nullptr records that the entry does not exist in the database.
+ *
+ * The cache is bounded by an estimate of the memory used by its entries
+ * rather than by their count, and is split into shards (selected by the hash
+ * of the key) that each have their own lock and LRU list, so that it can be
+ * used from several threads.
+ */
+class LedgerEntryCache : NonMovableOrCopyable
+{
+  public:
+    typedef std::shared_ptr<LedgerEntry const> EntryPtr;
+
+  private:
+    static const size_t SHARD_COUNT;
+
+    struct Shard
+    {
+        typedef std::list<std::pair<LedgerKey, EntryPtr>> List;
+
+        std::mutex mMutex;
+        List mItems;
+        std::unordered_map<LedgerKey, List::iterator> mIndex;
+        size_t mBytes{0};
+    };
+
+    size_t const mMaxShardBytes;
+    std::vector<std::unique_ptr<Shard>> mShards;
+
+    medida::Meter& mHits;
+    medida::Meter& mMisses;
+    medida::Meter& mEvictions;
+    medida::Counter& mSize;
+
+    Shard& getShard(LedgerKey const& key) const;
+    // must be called with the shard lock held
+    void eraseLocked(Shard& shard, Shard::List::iterator it);
+
+  public:
+    LedgerEntryCache(medida::MetricsRegistry& metrics, size_t maxBytes);
+
+    // estimate of the memory used by caching `entry` under `key`
+    static size_t entrySize(LedgerKey const& key, EntryPtr const& entry);
+
+    // returns true if `key` is cached, setting `entry` to its value
+    bool get(LedgerKey const& key, EntryPtr& entry);
+
+    // returns true if `key` is cached, without touching metrics or LRU order
+    bool exists(LedgerKey const& key) const;
+
+    void put(LedgerKey const& key, EntryPtr entry);
+    void erase(LedgerKey const& key);
+    void eraseIf(std::function<bool(EntryPtr const&)> const& f);
+    void clear();
+
+    size_t size() const;
+    size_t getBytes() const;
+};
+}
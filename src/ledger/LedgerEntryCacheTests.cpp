@@ -0,0 +1,112 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "ledger/EntryFrame.h"
+#include "ledger/LedgerEntryCache.h"
+#include "ledger/LedgerTestUtils.h"
+#include "lib/catch.hpp"
+#include "medida/counter.h"
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+
+using namespace stellar;
+
+namespace
+{
+LedgerEntryCache::EntryPtr
+randomAccount()
+{
+    LedgerEntry le;
+    le.data.type(ACCOUNT);
+    le.data.account() = LedgerTestUtils::generateValidAccountEntry(3);
+    return std::make_shared<LedgerEntry const>(le);
+}
+}
+
+TEST_CASE("ledger entry cache", "[ledger][entrycache]")
+{
+    medida::MetricsRegistry metrics;
+    auto& hits = metrics.NewMeter({"ledger", "entry-cache", "hit"}, "entry");
+    auto& misses =
+        metrics.NewMeter({"ledger", "entry-cache", "miss"}, "entry");
+    auto& evictions =
+        metrics.NewMeter({"ledger", "entry-cache", "evict"}, "entry");
+    auto& bytes = metrics.NewCounter({"ledger", "entry-cache", "bytes"});
+
+    SECTION("put, get and erase")
+    {
+        LedgerEntryCache cache(metrics, 1024 * 1024);
+        auto e = randomAccount();
+        auto key = LedgerEntryKey(*e);
+        auto missing = LedgerEntryKey(*randomAccount());
+
+        LedgerEntryCache::EntryPtr res;
+        REQUIRE(!cache.get(key, res));
+        REQUIRE(misses.count() == 1);
+
+        cache.put(key, e);
+        cache.put(missing, nullptr);
+        REQUIRE(cache.size() == 2);
+        REQUIRE(cache.getBytes() ==
+                LedgerEntryCache::entrySize(key, e) +
+                    LedgerEntryCache::entrySize(missing, nullptr));
+        REQUIRE(bytes.count() == static_cast<int64_t>(cache.getBytes()));
+
+        REQUIRE(cache.get(key, res));
+        REQUIRE(*res == *e);
+        REQUIRE(cache.get(missing, res));
+        REQUIRE(!res);
+        REQUIRE(hits.count() == 2);
+
+        cache.erase(key);
+        REQUIRE(!cache.exists(key));
+        REQUIRE(cache.exists(missing));
+
+        cache.eraseIf([](LedgerEntryCache::EntryPtr const& p) { return !p; });
+        REQUIRE(cache.size() == 0);
+        REQUIRE(cache.getBytes() == 0);
+        REQUIRE(bytes.count() == 0);
+    }
+
+    SECTION("bounded by bytes")
+    {
+        std::vector<LedgerEntryCache::EntryPtr> entries;
+        size_t total = 0;
+        for (int i = 0; i < 1000; i++)
+        {
+            entries.emplace_back(randomAccount());
+            total += LedgerEntryCache::entrySize(LedgerEntryKey(*entries[i]),
+                                                 entries[i]);
+        }
+
+        LedgerEntryCache cache(metrics, total / 4);
+        for (auto const& e : entries)
+        {
+            cache.put(LedgerEntryKey(*e), e);
+            REQUIRE(cache.getBytes() <= total / 4);
+        }
+        REQUIRE(cache.size() < entries.size() / 2);
+        REQUIRE(evictions.count() == entries.size() - cache.size());
+
+        // most recently added entries are kept
+        REQUIRE(cache.exists(LedgerEntryKey(*entries.back())));
+    }
+
+    SECTION("least recently used entries are evicted first")
+    {
+        auto first = randomAccount();
+        auto firstKey = LedgerEntryKey(*first);
+        LedgerEntryCache cache(metrics, 64 * 1024);
+        cache.put(firstKey, first);
+
+        LedgerEntryCache::EntryPtr res;
+        for (int i = 0; i < 5000; i++)
+        {
+            auto e = randomAccount();
+            cache.put(LedgerEntryKey(*e), e);
+            REQUIRE(cache.get(firstKey, res));
+        }
+        REQUIRE(evictions.count() > 0);
+    }
+}
@@ -8,10 +8,13 @@
 #include "TrustFrame.h"
 #include "crypto/SecretKey.h"
 #include "database/Database.h"
+#include "ledger/BucketListReader.h"
+#include "ledger/LedgerEntryCache.h"
 #include "ledger/LedgerManager.h"
 #include "ledger/LedgerTestUtils.h"
 #include "lib/catch.hpp"
 #include "main/Application.h"
+#include "medida/meter.h"
 #include "test/TestUtils.h"
 #include "test/test.h"
 #include "util/Logging.h"
@@ -273,5 +276,77 @@ TEST_CASE("Ledger Entry tests", "[ledgerentry]")
 
         app->getLedgerManager().checkDbState();
     }
+
+    SECTION("prefetch")
+    {
+        LedgerHeader lh;
+        LedgerDelta delta(lh, db, false);
+        BucketListReader::Bypass bypass(db.getBucketListReader());
+
+        // more than a batch of each
+        std::vector<LedgerKey> keys;
+        for (int i = 0; i < 100; i++)
+        {
+            LedgerEntry account;
+            account.data.type(ACCOUNT);
+            account.data.account() =
+                LedgerTestUtils::generateValidAccountEntry(5);
+            auto af = std::make_shared<AccountFrame>(account);
+            af->storeAdd(delta, db);
+            keys.emplace_back(af->getKey());
+
+            LedgerEntry line;
+            line.data.type(TRUSTLINE);
+            line.data.trustLine() =
+                LedgerTestUtils::generateValidTrustLineEntry(5);
+            line.data.trustLine().accountID = af->getID();
+            auto tf = std::make_shared<TrustFrame>(line);
+            tf->storeAdd(delta, db);
+            keys.emplace_back(tf->getKey());
+        }
+
+        // entries that don't exist are cached as such
+        LedgerKey missingAccount;
+        missingAccount.type(ACCOUNT);
+        missingAccount.account().accountID =
+            LedgerTestUtils::generateValidAccountEntry(5).accountID;
+        keys.emplace_back(missingAccount);
+        LedgerKey missingLine = keys[1];
+        missingLine.trustLine().accountID =
+            missingAccount.account().accountID;
+        keys.emplace_back(missingLine);
+
+        auto& cache = db.getEntryCache();
+        cache.clear();
+        REQUIRE(EntryFrame::prefetch(db, keys) == keys.size());
+        REQUIRE(EntryFrame::prefetch(db, keys) == 0);
+
+        // prefetched entries, missing ones included, are not loaded on demand
+        auto& demandLoads = db.getDemandLoadMeter();
+        auto demandLoadsBefore = demandLoads.count();
+        for (auto const& key : keys)
+        {
+            EntryFrame::storeLoad(key, db);
+        }
+        REQUIRE(demandLoads.count() == demandLoadsBefore);
+
+        for (auto const& key : keys)
+        {
+            LedgerEntryCache::EntryPtr cached;
+            REQUIRE(cache.get(key, cached));
+            cache.erase(key);
+            auto fromDb = EntryFrame::storeLoad(key, db);
+            if (fromDb)
+            {
+                REQUIRE(cached);
+                REQUIRE(*cached == fromDb->mEntry);
+            }
+            else
+            {
+                REQUIRE(!cached);
+            }
+        }
+        REQUIRE(demandLoads.count() == demandLoadsBefore + keys.size());
+    }
 }
 }
@@ -0,0 +1,85 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "ledger/LedgerHashUtils.h"
+#include "crypto/SecretKey.h"
+#include "util/HashOfHash.h"
+
+namespace
+{
+// same mixing as boost::hash_combine
+void
+hashCombine(size_t& seed, size_t v)
+{
+    seed ^= v + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+template <typename T>
+size_t
+hashBytes(T const& bytes)
+{
+    size_t res = 0;
+    for (auto b : bytes)
+    {
+        res = res * 31 + b;
+    }
+    return res;
+}
+}
+
+namespace std
+{
+
+size_t
+hash<stellar::Asset>::operator()(stellar::Asset const& asset) const noexcept
+{
+    size_t res = asset.type();
+    switch (asset.type())
+    {
+    case stellar::ASSET_TYPE_NATIVE:
+        break;
+    case stellar::ASSET_TYPE_CREDIT_ALPHANUM4:
+        hashCombine(res, hashBytes(asset.alphaNum4().assetCode));
+        hashCombine(res,
+                    std::hash<stellar::PublicKey>()(asset.alphaNum4().issuer));
+        break;
+    case stellar::ASSET_TYPE_CREDIT_ALPHANUM12:
+        hashCombine(res, hashBytes(asset.alphaNum12().assetCode));
+        hashCombine(res,
+                    std::hash<stellar::PublicKey>()(asset.alphaNum12().issuer));
+        break;
+    }
+    return res;
+}
+
+size_t
+hash<stellar::LedgerKey>::operator()(stellar::LedgerKey const& key) const
+    noexcept
+{
+    size_t res = key.type();
+    switch (key.type())
+    {
+    case stellar::ACCOUNT:
+        hashCombine(res, std::hash<stellar::PublicKey>()(
+                             key.account().accountID));
+        break;
+    case stellar::TRUSTLINE:
+        hashCombine(res, std::hash<stellar::PublicKey>()(
+                             key.trustLine().accountID));
+        hashCombine(res, std::hash<stellar::Asset>()(key.trustLine().asset));
+        break;
+    case stellar::OFFER:
+        hashCombine(res,
+                    std::hash<stellar::PublicKey>()(key.offer().sellerID));
+        hashCombine(res, std::hash<uint64_t>()(key.offer().offerID));
+        break;
+    case stellar::DATA:
+        hashCombine(res,
+                    std::hash<stellar::PublicKey>()(key.data().accountID));
+        hashCombine(res, hashBytes(key.data().dataName));
+        break;
+    }
+    return res;
+}
+}
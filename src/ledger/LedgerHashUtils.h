@@ -0,0 +1,21 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "xdr/Stellar-ledger-entries.h"
+#include <functional>
+
+namespace std
+{
+template <> struct hash<stellar::Asset>
+{
+    size_t operator()(stellar::Asset const& asset) const noexcept;
+};
+
+template <> struct hash<stellar::LedgerKey>
+{
+    size_t operator()(stellar::LedgerKey const& key) const noexcept;
+};
+}
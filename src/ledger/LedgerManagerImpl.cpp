@@ -20,6 +20,8 @@
 #include "history/HistoryManager.h"
 #include "invariant/InvariantDoesNotHold.h"
 #include "invariant/InvariantManager.h"
+#include "ledger/AccountWriteBuffer.h"
+#include "ledger/BucketListReader.h"
 #include "ledger/LedgerDelta.h"
 #include "ledger/LedgerHeaderFrame.h"
 #include "main/Application.h"
@@ -31,6 +33,7 @@
 #include "util/make_unique.h"
 
 #include "medida/counter.h"
+#include "medida/histogram.h"
 #include "medida/meter.h"
 #include "medida/metrics_registry.h"
 #include "medida/timer.h"
@@ -39,6 +42,8 @@
 
 #include <chrono>
 #include <sstream>
+#include <thread>
+#include <unordered_set>
 
 /*
 The ledger module:
@@ -122,6 +127,15 @@ LedgerManagerImpl::LedgerManagerImpl(Application& app)
           app.getMetrics().NewCounter({"ledger", "state", "current"}))
     , mLedgerStateChanges(
           app.getMetrics().NewTimer({"ledger", "state", "changes"}))
+    , mSignaturePreverify(
+          app.getMetrics().NewTimer({"ledger", "signature", "preverify"}))
+    , mSignaturePreverifySaved(app.getMetrics().NewHistogram(
+          {"ledger", "signature", "preverify-saved-us"}))
+    , mPrefetch(app.getMetrics().NewTimer({"ledger", "prefetch", "load"}))
+    , mPrefetchLoaded(
+          app.getMetrics().NewHistogram({"ledger", "prefetch", "loaded"}))
+    , mPrefetchDemandLoaded(app.getMetrics().NewHistogram(
+          {"ledger", "prefetch", "demand-loaded"}))
     , mLastClose(mApp.getClock().now())
     , mLastStateChange(mApp.getClock().now())
     , mSyncingLedgersSize(
@@ -208,6 +222,9 @@ LedgerManagerImpl::startNewLedger(LedgerHeader genesisLedger)
     auto ledgerTime = mLedgerClose.TimeScope();
     SecretKey skey = SecretKey::fromSeed(mApp.getNetworkID());
 
+    // the database and the BucketList are both empty at this point
+    getDatabase().getBucketListReader().stateAssumed();
+
     AccountFrame masterAccount(skey.getPublicKey());
     masterAccount.getAccount().balance = genesisLedger.totalCoins;
     LedgerDelta delta(genesisLedger, getDatabase());
@@ -835,6 +852,16 @@ LedgerManagerImpl::closeLedger(LedgerCloseData const& ledgerData)
     // sorted such that sequence numbers are respected
     vector<TransactionFramePtr> txs = ledgerData.getTxSet()->sortForApply();
 
+    // load the entries transactions use in bulk rather than one by one
+    prefetchEntries(txs);
+
+    // verify signatures in parallel so that applying transactions only hits
+    // the signature verification cache
+    preverifySignatures(txs);
+
+    auto& demandLoads = getDatabase().getDemandLoadMeter();
+    auto demandLoadsBefore = demandLoads.count();
+
     // first, charge fees
     processFeesSeqNums(txs, ledgerDelta);
 
@@ -843,6 +870,9 @@ LedgerManagerImpl::closeLedger(LedgerCloseData const& ledgerData)
 
     applyTransactions(txs, ledgerDelta, txResultSet);
 
+    // accounts and trust lines that still had to be loaded one by one
+    mPrefetchDemandLoaded.Update(demandLoads.count() - demandLoadsBefore);
+
     ledgerDelta.getHeader().txSetResultHash =
         sha256(xdr::xdr_to_opaque(txResultSet));
 
@@ -992,6 +1022,60 @@ LedgerManagerImpl::advanceLedgerPointers()
                           << mCurrentLedger->mHeader.ledgerSeq;
 }
 
+void
+LedgerManagerImpl::prefetchEntries(std::vector<TransactionFramePtr> const& txs)
+{
+    std::unordered_set<LedgerKey> keys;
+    for (auto const& tx : txs)
+    {
+        tx->getKeysToPrefetch(keys);
+    }
+
+    auto timer = mPrefetch.TimeScope();
+    auto loaded = EntryFrame::prefetch(
+        getDatabase(), std::vector<LedgerKey>(keys.begin(), keys.end()));
+    mPrefetchLoaded.Update(loaded);
+
+    CLOG(DEBUG, "Ledger") << "Prefetched " << loaded << " of " << keys.size()
+                          << " entries";
+}
+
+void
+LedgerManagerImpl::preverifySignatures(
+    std::vector<TransactionFramePtr> const& txs)
+{
+    std::vector<PubKeyUtils::SignatureToVerify> sigs;
+    for (auto const& tx : txs)
+    {
+        tx->getSignaturesToVerify(getDatabase(), sigs);
+    }
+    if (sigs.empty())
+    {
+        return;
+    }
+
+    auto nbSigs = sigs.size();
+    auto start = std::chrono::steady_clock::now();
+    auto verifyTime = PubKeyUtils::verifySigs(
+        std::move(sigs),
+        [this](std::function<void()> f) {
+            mApp.getWorkerIOService().post(f);
+        },
+        std::thread::hardware_concurrency());
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start);
+    mSignaturePreverify.Update(elapsed);
+
+    // time that verifying signatures one by one during apply would have taken
+    auto saved = std::chrono::duration_cast<std::chrono::microseconds>(
+                     verifyTime - elapsed)
+                     .count();
+    mSignaturePreverifySaved.Update(std::max<int64_t>(saved, 0));
+
+    CLOG(DEBUG, "Ledger") << "Pre-verified " << nbSigs << " signatures, saved "
+                          << saved << "us";
+}
+
 void
 LedgerManagerImpl::processFeesSeqNums(std::vector<TransactionFramePtr>& txs,
                                       LedgerDelta& delta)
@@ -1001,6 +1085,9 @@ LedgerManagerImpl::processFeesSeqNums(std::vector<TransactionFramePtr>& txs,
     try
     {
         soci::transaction sqlTx(mApp.getDatabase().getSession());
+        // source accounts are written once, after all the fees are charged
+        AccountWriteBuffer::Scope writeBuffer(
+            getDatabase().getAccountWriteBuffer());
         for (auto tx : txs)
         {
             LedgerDelta thisTxDelta(delta);
@@ -1008,6 +1095,7 @@ LedgerManagerImpl::processFeesSeqNums(std::vector<TransactionFramePtr>& txs,
             tx->storeTransactionFee(*this, thisTxDelta.getChanges(), ++index);
             thisTxDelta.commit();
         }
+        writeBuffer.flush();
         sqlTx.commit();
     }
     catch (std::exception& e)
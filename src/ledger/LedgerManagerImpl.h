@@ -47,6 +47,11 @@ class LedgerManagerImpl : public LedgerManager
     medida::Counter& mLedgerAge;
     medida::Counter& mLedgerStateCurrent;
     medida::Timer& mLedgerStateChanges;
+    medida::Timer& mSignaturePreverify;
+    medida::Histogram& mSignaturePreverifySaved;
+    medida::Timer& mPrefetch;
+    medida::Histogram& mPrefetchLoaded;
+    medida::Histogram& mPrefetchDemandLoaded;
     VirtualClock::time_point mLastClose;
     VirtualClock::time_point mLastStateChange;
 
@@ -68,6 +73,8 @@ class LedgerManagerImpl : public LedgerManager
                          CatchupWork::ProgressState progressState,
                          LedgerHeaderHistoryEntry const& lastClosed);
 
+    void prefetchEntries(std::vector<TransactionFramePtr> const& txs);
+    void preverifySignatures(std::vector<TransactionFramePtr> const& txs);
     void processFeesSeqNums(std::vector<TransactionFramePtr>& txs,
                             LedgerDelta& delta);
     void applyTransactions(std::vector<TransactionFramePtr>& txs,
@@ -3,23 +3,35 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "LedgerTestUtils.h"
+#include "crypto/SecretKey.h"
+#include "crypto/SignerKey.h"
 #include "database/Database.h"
 #include "herder/LedgerCloseData.h"
+#include "herder/TxSetFrame.h"
 #include "ledger/AccountFrame.h"
+#include "ledger/AccountWriteBuffer.h"
 #include "ledger/EntryFrame.h"
 #include "ledger/LedgerDelta.h"
+#include "ledger/LedgerEntryCache.h"
 #include "ledger/LedgerManager.h"
 #include "lib/catch.hpp"
 #include "main/Application.h"
 #include "main/Config.h"
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+#include "medida/timer.h"
+#include "test/TestAccount.h"
 #include "test/TestUtils.h"
+#include "test/TxTests.h"
 #include "test/test.h"
 #include "util/Logging.h"
 #include "util/Timer.h"
 #include "util/types.h"
+#include <chrono>
 #include <xdrpp/autocheck.h>
 
 using namespace stellar;
+using namespace stellar::txtest;
 
 TEST_CASE("Ledger entry db lifecycle", "[ledger]")
 {
@@ -163,3 +175,186 @@ TEST_CASE("cannot close ledger with unsupported ledger version", "[ledger]")
         app->getLedgerManager(), Config::CURRENT_LEDGER_PROTOCOL_VERSION + 1);
     REQUIRE_THROWS_AS(applyEmptyLedger(), std::runtime_error);
 }
+
+TEST_CASE("signatures verified before apply", "[ledger][preverify]")
+{
+    VirtualClock clock;
+    Application::pointer app = createTestApplication(clock, getTestConfig());
+    app->start();
+
+    auto& lm = app->getLedgerManager();
+    auto root = TestAccount::createRoot(*app);
+    auto a1 = root.create("a1", lm.getMinBalance(1) + 1000000);
+    auto signerKey = SecretKey::random();
+    auto signer =
+        Signer{KeyUtils::convertKey<SignerKey>(signerKey.getPublicKey()), 1};
+    a1.setOptions(nullptr, nullptr, nullptr, nullptr, &signer, nullptr);
+
+    auto txSet = std::make_shared<TxSetFrame>(
+        lm.getLastClosedLedgerHeader().hash);
+    size_t const nbTxs = 20;
+    for (size_t i = 0; i < nbTxs; ++i)
+    {
+        auto tx = a1.tx({payment(root, 1)});
+        if (i % 2)
+        {
+            // signed by the additional signer only
+            tx->getEnvelope().signatures.clear();
+            tx->addSignature(signerKey);
+        }
+        txSet->add(tx);
+    }
+    txSet->sortForHash();
+    REQUIRE(txSet->checkValid(*app));
+
+    auto& preverify =
+        app->getMetrics().NewTimer({"ledger", "signature", "preverify"});
+    auto count = preverify.count();
+
+    PubKeyUtils::clearVerifySigCache();
+    uint64_t hits, misses;
+    PubKeyUtils::flushVerifySigCacheCounts(hits, misses);
+
+    StellarValue sv(txSet->getContentsHash(),
+                    lm.getLastClosedLedgerHeader().header.scpValue.closeTime +
+                        1,
+                    emptyUpgradeSteps, 0);
+    LedgerCloseData ledgerData(lm.getLedgerNum(), txSet, sv);
+    lm.closeLedger(ledgerData);
+
+    REQUIRE(preverify.count() == count + 1);
+    PubKeyUtils::flushVerifySigCacheCounts(hits, misses);
+    // each signature got verified once, ahead of apply
+    REQUIRE(misses == nbTxs);
+    REQUIRE(hits >= nbTxs);
+}
+
+namespace
+{
+// closes a ledger with `nbTxs` payments from each of `accounts`
+void
+closeLedgerWithPayments(Application& app, std::vector<TestAccount>& accounts,
+                        TestAccount& destination, size_t nbTxs)
+{
+    auto& lm = app.getLedgerManager();
+    auto txSet =
+        std::make_shared<TxSetFrame>(lm.getLastClosedLedgerHeader().hash);
+    for (auto& account : accounts)
+    {
+        for (size_t i = 0; i < nbTxs; ++i)
+        {
+            txSet->add(account.tx({payment(destination, 1)}));
+        }
+    }
+    txSet->sortForHash();
+    REQUIRE(txSet->checkValid(app));
+
+    StellarValue sv(txSet->getContentsHash(),
+                    lm.getLastClosedLedgerHeader().header.scpValue.closeTime +
+                        1,
+                    emptyUpgradeSteps, 0);
+    LedgerCloseData ledgerData(lm.getLedgerNum(), txSet, sv);
+    lm.closeLedger(ledgerData);
+}
+}
+
+TEST_CASE("account writes deferred while charging fees",
+          "[ledger][writebuffer]")
+{
+    VirtualClock clock;
+    Application::pointer app = createTestApplication(clock, getTestConfig());
+    app->start();
+
+    auto& lm = app->getLedgerManager();
+    auto root = TestAccount::createRoot(*app);
+    std::vector<TestAccount> accounts{
+        root.create("a1", lm.getMinBalance(0) + 1000000),
+        root.create("a2", lm.getMinBalance(0) + 1000000)};
+    auto destination = root.create("dest", lm.getMinBalance(0));
+
+    std::vector<int64_t> balances;
+    std::vector<SequenceNumber> seqNums;
+    for (auto& account : accounts)
+    {
+        balances.emplace_back(account.getBalance());
+        seqNums.emplace_back(account.loadSequenceNumber());
+    }
+
+    auto& buffered = app->getMetrics().NewMeter(
+        {"ledger", "account-write-buffer", "buffered"}, "entry");
+    auto& written = app->getMetrics().NewMeter(
+        {"ledger", "account-write-buffer", "written"}, "entry");
+    auto bufferedBefore = buffered.count();
+    auto writtenBefore = written.count();
+
+    size_t const nbTxs = 10;
+    closeLedgerWithPayments(*app, accounts, destination, nbTxs);
+
+    // one update per fee charged, one write per account
+    REQUIRE(buffered.count() == bufferedBefore + accounts.size() * nbTxs);
+    REQUIRE(written.count() == writtenBefore + accounts.size());
+    REQUIRE(!app->getDatabase().getAccountWriteBuffer().isActive());
+
+    app->getDatabase().getEntryCache().clear();
+    auto fee = static_cast<int64_t>(lm.getTxFee());
+    for (size_t i = 0; i < accounts.size(); ++i)
+    {
+        REQUIRE(accounts[i].getBalance() ==
+                balances[i] - static_cast<int64_t>(nbTxs) * (fee + 1));
+        REQUIRE(accounts[i].loadSequenceNumber() ==
+                seqNums[i] + static_cast<SequenceNumber>(nbTxs));
+    }
+    lm.checkDbState();
+}
+
+TEST_CASE("ledger close SQL statements", "[ledger][writebuffer][bench][!hide]")
+{
+    size_t const nbAccounts = 100;
+    size_t const nbTxs = 10;
+
+    auto runtest = [&](bool deferAccountWrites) {
+        VirtualClock clock;
+        Config cfg(getTestConfig(0, Config::TESTDB_ON_DISK_SQLITE));
+        cfg.DEFER_ACCOUNT_WRITES = deferAccountWrites;
+        auto app = createTestApplication(clock, cfg);
+        app->start();
+
+        auto& lm = app->getLedgerManager();
+        auto root = TestAccount::createRoot(*app);
+        std::vector<TestAccount> accounts;
+        for (size_t i = 0; i < nbAccounts; ++i)
+        {
+            accounts.emplace_back(root.create("a" + std::to_string(i),
+                                              lm.getMinBalance(0) + 1000000));
+        }
+        auto destination = root.create("dest", lm.getMinBalance(0));
+
+        auto& queries = app->getMetrics().NewMeter(
+            {"database", "query", "exec"}, "query");
+        auto& updates =
+            app->getMetrics().NewTimer({"database", "update", "account"});
+        auto queriesBefore = queries.count();
+        auto updatesBefore = updates.count();
+        auto start = std::chrono::steady_clock::now();
+        closeLedgerWithPayments(*app, accounts, destination, nbTxs);
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start);
+
+        LOG(INFO) << "Closed a ledger of " << nbAccounts * nbTxs
+                  << " payments "
+                  << (deferAccountWrites ? "with" : "without")
+                  << " deferred account writes in " << elapsed.count()
+                  << "ms: " << queries.count() - queriesBefore
+                  << " statements, " << updates.count() - updatesBefore
+                  << " account updates";
+    };
+
+    SECTION("per transaction writes")
+    {
+        runtest(false);
+    }
+    SECTION("deferred account writes")
+    {
+        runtest(true);
+    }
+}
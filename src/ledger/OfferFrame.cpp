@@ -8,7 +8,9 @@
 #include "crypto/SHA.h"
 #include "crypto/SecretKey.h"
 #include "database/Database.h"
+#include "ledger/LedgerEntryCache.h"
 #include "ledger/LedgerRange.h"
+#include "ledger/OrderBook.h"
 #include "transactions/ManageOfferOpFrame.h"
 #include "util/types.h"
 
@@ -124,6 +126,24 @@ OfferFrame::loadOffer(AccountID const& sellerID, uint64_t offerID, Database& db,
 {
     OfferFrame::pointer retOffer;
 
+    LedgerKey key;
+    key.type(OFFER);
+    key.offer().sellerID = sellerID;
+    key.offer().offerID = offerID;
+    std::shared_ptr<LedgerEntry const> fromBuckets;
+    if (getBucketListEntry(key, fromBuckets, db))
+    {
+        if (fromBuckets)
+        {
+            retOffer = make_shared<OfferFrame>(*fromBuckets);
+            if (delta)
+            {
+                delta->recordEntry(*retOffer);
+            }
+        }
+        return retOffer;
+    }
+
     std::string actIDStrKey = KeyUtils::toStrKey(sellerID);
 
     std::string sql = offerColumnSelector;
@@ -241,9 +261,9 @@ OfferFrame::loadOffers(StatementContext& prep,
 }
 
 void
-OfferFrame::loadBestOffers(size_t numOffers, size_t offset,
-                           Asset const& selling, Asset const& buying,
-                           vector<OfferFrame::pointer>& retOffers, Database& db)
+OfferFrame::loadOffersByPrice(
+    size_t numOffers, size_t offset, Asset const& selling, Asset const& buying,
+    std::function<void(LedgerEntry const&)> offerProcessor, Database& db)
 {
     std::string sql = offerColumnSelector;
 
@@ -307,7 +327,11 @@ OfferFrame::loadBestOffers(size_t numOffers, size_t offset,
 
     // price is an approximation of the actual n/d (truncated math, 15 digits)
     // ordering by offerid gives precendence to older offers for fairness
-    sql += " ORDER BY price, offerid LIMIT :n OFFSET :o";
+    sql += " ORDER BY price, offerid";
+    if (numOffers != 0)
+    {
+        sql += " LIMIT :n OFFSET :o";
+    }
 
     auto prep = db.getPreparedStatement(sql);
     auto& st = prep.statement();
@@ -324,13 +348,35 @@ OfferFrame::loadBestOffers(size_t numOffers, size_t offset,
         st.exchange(use(buyingIssuerStrKey));
     }
 
-    st.exchange(use(numOffers));
-    st.exchange(use(offset));
+    if (numOffers != 0)
+    {
+        st.exchange(use(numOffers));
+        st.exchange(use(offset));
+    }
 
     auto timer = db.getSelectTimer("offer");
-    loadOffers(prep, [&retOffers](LedgerEntry const& of) {
-        retOffers.emplace_back(make_shared<OfferFrame>(of));
-    });
+    loadOffers(prep, offerProcessor);
+}
+
+void
+OfferFrame::loadBestOffers(size_t numOffers, size_t offset,
+                           Asset const& selling, Asset const& buying,
+                           vector<OfferFrame::pointer>& retOffers, Database& db)
+{
+    assert(numOffers != 0);
+    loadOffersByPrice(numOffers, offset, selling, buying,
+                      [&retOffers](LedgerEntry const& of) {
+                          retOffers.emplace_back(make_shared<OfferFrame>(of));
+                      },
+                      db);
+}
+
+void
+OfferFrame::loadAllOffersByPrice(
+    Asset const& selling, Asset const& buying,
+    std::function<void(LedgerEntry const&)> offerProcessor, Database& db)
+{
+    loadOffersByPrice(0, 0, selling, buying, offerProcessor, db);
 }
 
 std::unordered_map<AccountID, std::vector<OfferFrame::pointer>>
@@ -389,11 +435,12 @@ void
 OfferFrame::deleteOffersModifiedOnOrAfterLedger(Database& db,
                                                 uint32_t oldestLedger)
 {
-    db.getEntryCache().erase_if(
+    db.getEntryCache().eraseIf(
         [oldestLedger](std::shared_ptr<LedgerEntry const> le) -> bool {
             return le && le->data.type() == OFFER &&
                    le->lastModifiedLedgerSeq >= oldestLedger;
         });
+    db.getOrderBook().clear();
 
     {
         auto prep = db.getPreparedStatement(
@@ -420,13 +467,131 @@ OfferFrame::storeDelete(LedgerDelta& delta, Database& db, LedgerKey const& key)
     st.exchange(use(key.offer().offerID));
     st.define_and_bind();
     st.execute(true);
+    db.getOrderBook().removeOffer(key);
     delta.deleteEntry(key);
 }
 
+void
+OfferFrame::storeDeleteBulk(Database& db, std::vector<LedgerKey> const& keys)
+{
+    std::vector<unsigned long long> offerIDs;
+    offerIDs.reserve(keys.size());
+    for (auto const& key : keys)
+    {
+        offerIDs.emplace_back(key.offer().offerID);
+    }
+
+    auto timer = db.getDeleteTimer("offer");
+    auto prep = db.getPreparedStatement("DELETE FROM offers WHERE offerid=:s");
+    auto& st = prep.statement();
+    st.exchange(use(offerIDs));
+    st.define_and_bind();
+    st.execute(true);
+    // the offers are not tracked individually: drop the loaded books
+    db.getOrderBook().clear();
+}
+
+void
+OfferFrame::storeAddBulk(Database& db, std::vector<LedgerEntry> const& entries)
+{
+    std::vector<std::string> actIDStrKeys;
+    std::vector<unsigned long long> offerIDs;
+    std::vector<int> sellingTypes, buyingTypes;
+    std::vector<std::string> sellingAssetCodes, sellingIssuerStrKeys;
+    std::vector<std::string> buyingAssetCodes, buyingIssuerStrKeys;
+    std::vector<soci::indicator> sellingInds, buyingInds;
+    std::vector<long long> amounts;
+    std::vector<int> priceNs, priceDs, flags, lastModifieds;
+    std::vector<double> prices;
+
+    // code and issuer columns are null for native assets
+    auto addAsset = [](Asset const& asset, std::vector<int>& types,
+                       std::vector<std::string>& assetCodes,
+                       std::vector<std::string>& issuerStrKeys,
+                       std::vector<soci::indicator>& inds) {
+        types.emplace_back(asset.type());
+        assetCodes.emplace_back();
+        issuerStrKeys.emplace_back();
+        inds.emplace_back(soci::i_ok);
+        if (asset.type() == ASSET_TYPE_CREDIT_ALPHANUM4)
+        {
+            issuerStrKeys.back() = KeyUtils::toStrKey(asset.alphaNum4().issuer);
+            assetCodeToStr(asset.alphaNum4().assetCode, assetCodes.back());
+        }
+        else if (asset.type() == ASSET_TYPE_CREDIT_ALPHANUM12)
+        {
+            issuerStrKeys.back() =
+                KeyUtils::toStrKey(asset.alphaNum12().issuer);
+            assetCodeToStr(asset.alphaNum12().assetCode, assetCodes.back());
+        }
+        else
+        {
+            inds.back() = soci::i_null;
+        }
+    };
+
+    for (auto const& entry : entries)
+    {
+        auto const& offer = entry.data.offer();
+        actIDStrKeys.emplace_back(KeyUtils::toStrKey(offer.sellerID));
+        offerIDs.emplace_back(offer.offerID);
+        addAsset(offer.selling, sellingTypes, sellingAssetCodes,
+                 sellingIssuerStrKeys, sellingInds);
+        addAsset(offer.buying, buyingTypes, buyingAssetCodes,
+                 buyingIssuerStrKeys, buyingInds);
+        amounts.emplace_back(offer.amount);
+        priceNs.emplace_back(offer.price.n);
+        priceDs.emplace_back(offer.price.d);
+        prices.emplace_back(computePrice(offer.price));
+        flags.emplace_back(offer.flags);
+        lastModifieds.emplace_back(entry.lastModifiedLedgerSeq);
+    }
+
+    auto prep = db.getPreparedStatement(
+        "INSERT INTO offers (sellerid,offerid,"
+        "sellingassettype,sellingassetcode,sellingissuer,"
+        "buyingassettype,buyingassetcode,buyingissuer,"
+        "amount,pricen,priced,price,flags,lastmodified) VALUES "
+        "(:sid,:oid,:sat,:sac,:si,:bat,:bac,:bi,:a,:pn,:pd,:p,:f,:l)");
+    auto& st = prep.statement();
+    st.exchange(use(actIDStrKeys, "sid"));
+    st.exchange(use(offerIDs, "oid"));
+    st.exchange(use(sellingTypes, "sat"));
+    st.exchange(use(sellingAssetCodes, sellingInds, "sac"));
+    st.exchange(use(sellingIssuerStrKeys, sellingInds, "si"));
+    st.exchange(use(buyingTypes, "bat"));
+    st.exchange(use(buyingAssetCodes, buyingInds, "bac"));
+    st.exchange(use(buyingIssuerStrKeys, buyingInds, "bi"));
+    st.exchange(use(amounts, "a"));
+    st.exchange(use(priceNs, "pn"));
+    st.exchange(use(priceDs, "pd"));
+    st.exchange(use(prices, "p"));
+    st.exchange(use(flags, "f"));
+    st.exchange(use(lastModifieds, "l"));
+    st.define_and_bind();
+    {
+        auto timer = db.getInsertTimer("offer");
+        st.execute(true);
+    }
+
+    if (st.get_affected_rows() != static_cast<long long>(entries.size()))
+    {
+        throw std::runtime_error("could not update SQL");
+    }
+    // as for storeDeleteBulk, the loaded books are dropped
+    db.getOrderBook().clear();
+}
+
 double
 OfferFrame::computePrice() const
 {
-    return double(mOffer.price.n) / double(mOffer.price.d);
+    return computePrice(mOffer.price);
+}
+
+double
+OfferFrame::computePrice(Price const& price)
+{
+    return double(price.n) / double(price.d);
 }
 
 void
@@ -537,10 +702,12 @@ OfferFrame::storeUpdateHelper(LedgerDelta& delta, Database& db, bool insert)
 
     if (insert)
     {
+        db.getOrderBook().addOffer(mEntry);
         delta.addEntry(*this);
     }
     else
     {
+        db.getOrderBook().updateOffer(mEntry);
         delta.modEntry(*this);
     }
 }
@@ -553,5 +720,6 @@ OfferFrame::dropAll(Database& db)
     db.getSession() << kSQLCreateStatement2;
     db.getSession() << kSQLCreateStatement3;
     db.getSession() << kSQLCreateStatement4;
+    db.getOrderBook().clear();
 }
 }
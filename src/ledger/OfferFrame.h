@@ -25,6 +25,14 @@ class OfferFrame : public EntryFrame
     loadOffers(StatementContext& prep,
                std::function<void(LedgerEntry const&)> offerProcessor);
 
+    // loads offers for the pair ordered by price, then offerID; a numOffers
+    // of 0 means no limit
+    static void
+    loadOffersByPrice(size_t numOffers, size_t offset, Asset const& selling,
+                      Asset const& buying,
+                      std::function<void(LedgerEntry const&)> offerProcessor,
+                      Database& db);
+
     double computePrice() const;
 
     OfferEntry& mOffer;
@@ -78,6 +86,10 @@ class OfferFrame : public EntryFrame
     // Static helpers that don't assume an instance.
     static void storeDelete(LedgerDelta& delta, Database& db,
                             LedgerKey const& key);
+    static void storeDeleteBulk(Database& db,
+                                std::vector<LedgerKey> const& keys);
+    static void storeAddBulk(Database& db,
+                             std::vector<LedgerEntry> const& entries);
     static bool exists(Database& db, LedgerKey const& key);
     static uint64_t countObjects(soci::session& sess);
     static uint64_t countObjects(soci::session& sess,
@@ -94,6 +106,14 @@ class OfferFrame : public EntryFrame
                                std::vector<OfferFrame::pointer>& retOffers,
                                Database& db);
 
+    // load all offers for an asset pair, in the same order as loadBestOffers
+    static void loadAllOffersByPrice(
+        Asset const& selling, Asset const& buying,
+        std::function<void(LedgerEntry const&)> offerProcessor, Database& db);
+
+    // price used to order offers, identical to the one stored in the database
+    static double computePrice(Price const& price);
+
     // load all offers from the database (very slow)
     static std::unordered_map<AccountID, std::vector<OfferFrame::pointer>>
     loadAllOffers(Database& db);
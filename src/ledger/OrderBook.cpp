@@ -0,0 +1,231 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "ledger/OrderBook.h"
+#include "database/Database.h"
+#include "ledger/OfferFrame.h"
+#include "main/Application.h"
+#include "main/Config.h"
+#include "medida/counter.h"
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+#include "util/XDROperators.h"
+
+namespace stellar
+{
+
+bool
+OrderBook::AssetPairCmp::operator()(AssetPair const& a,
+                                    AssetPair const& b) const
+{
+    if (a.first < b.first)
+        return true;
+    if (b.first < a.first)
+        return false;
+    return a.second < b.second;
+}
+
+OrderBook::OrderBook(Application& app, Database& db)
+    : mDb(db)
+    , mEnabled(app.getConfig().IN_MEMORY_ORDER_BOOK)
+    , mBookLoads(
+          app.getMetrics().NewMeter({"ledger", "order-book", "load"}, "book"))
+    , mBookInvalidations(app.getMetrics().NewMeter(
+          {"ledger", "order-book", "invalidate"}, "book"))
+    , mLoadedOffers(
+          app.getMetrics().NewCounter({"ledger", "order-book", "offers"}))
+{
+}
+
+bool
+OrderBook::isEnabled() const
+{
+    return mEnabled;
+}
+
+OrderBook::Book&
+OrderBook::loadBook(AssetPair const& pair)
+{
+    auto it = mBooks.find(pair);
+    if (it != mBooks.end())
+    {
+        return it->second;
+    }
+
+    mBookLoads.Mark();
+    auto& book = mBooks[pair];
+    OfferFrame::loadAllOffersByPrice(
+        pair.first, pair.second,
+        [&](LedgerEntry const& le) {
+            auto const& offer = le.data.offer();
+            auto price = OfferFrame::computePrice(offer.price);
+            book.emplace(std::make_pair(price, offer.offerID), le);
+            mOfferLocations[offer.offerID] = OfferLocation{pair, price};
+        },
+        mDb);
+    mLoadedOffers.inc(book.size());
+    return book;
+}
+
+void
+OrderBook::invalidateBook(AssetPair const& pair)
+{
+    auto it = mBooks.find(pair);
+    if (it == mBooks.end())
+    {
+        return;
+    }
+
+    mBookInvalidations.Mark();
+    for (auto const& o : it->second)
+    {
+        mOfferLocations.erase(o.first.second);
+    }
+    mLoadedOffers.dec(it->second.size());
+    mBooks.erase(it);
+}
+
+void
+OrderBook::eraseOffer(uint64_t offerID)
+{
+    auto it = mOfferLocations.find(offerID);
+    if (it == mOfferLocations.end())
+    {
+        mUnlocatedOffers.insert(offerID);
+        return;
+    }
+
+    auto const& loc = it->second;
+    auto bookIt = mBooks.find(loc.mPair);
+    assert(bookIt != mBooks.end());
+    bookIt->second.erase(std::make_pair(loc.mPrice, offerID));
+    mLoadedOffers.dec();
+    mRemovedOffers.emplace(offerID, loc.mPair);
+    mOfferLocations.erase(it);
+}
+
+std::shared_ptr<OfferFrame>
+OrderBook::getBestOffer(Asset const& selling, Asset const& buying,
+                        OfferFrame const* after)
+{
+    assert(mEnabled);
+    auto& book = loadBook(std::make_pair(selling, buying));
+
+    auto it = book.begin();
+    if (after)
+    {
+        it = book.upper_bound(std::make_pair(
+            OfferFrame::computePrice(after->getPrice()), after->getOfferID()));
+    }
+    if (it == book.end())
+    {
+        return nullptr;
+    }
+    return std::make_shared<OfferFrame>(it->second);
+}
+
+void
+OrderBook::storeOffer(LedgerEntry const& le, bool isNew)
+{
+    if (!mEnabled)
+    {
+        return;
+    }
+
+    auto const& offer = le.data.offer();
+    if (!isNew)
+    {
+        eraseOffer(offer.offerID);
+    }
+
+    auto pair = std::make_pair(offer.selling, offer.buying);
+    auto bookIt = mBooks.find(pair);
+    if (bookIt != mBooks.end())
+    {
+        auto price = OfferFrame::computePrice(offer.price);
+        bookIt->second[std::make_pair(price, offer.offerID)] = le;
+        mOfferLocations[offer.offerID] = OfferLocation{pair, price};
+        mLoadedOffers.inc();
+    }
+}
+
+void
+OrderBook::addOffer(LedgerEntry const& offer)
+{
+    storeOffer(offer, true);
+}
+
+void
+OrderBook::updateOffer(LedgerEntry const& offer)
+{
+    storeOffer(offer, false);
+}
+
+void
+OrderBook::removeOffer(LedgerKey const& key)
+{
+    if (!mEnabled)
+    {
+        return;
+    }
+    eraseOffer(key.offer().offerID);
+}
+
+void
+OrderBook::invalidateOffer(LedgerKey const& key)
+{
+    if (!mEnabled)
+    {
+        return;
+    }
+
+    auto offerID = key.offer().offerID;
+    if (mUnlocatedOffers.find(offerID) != mUnlocatedOffers.end())
+    {
+        clear();
+        return;
+    }
+
+    auto it = mOfferLocations.find(offerID);
+    if (it != mOfferLocations.end())
+    {
+        // copy, as invalidateBook erases the location
+        auto pair = it->second.mPair;
+        invalidateBook(pair);
+    }
+
+    auto range = mRemovedOffers.equal_range(offerID);
+    for (auto r = range.first; r != range.second; ++r)
+    {
+        invalidateBook(r->second);
+    }
+}
+
+void
+OrderBook::forgetRemovedOffers()
+{
+    mRemovedOffers.clear();
+    mUnlocatedOffers.clear();
+}
+
+void
+OrderBook::clear()
+{
+    if (!mBooks.empty())
+    {
+        mBookInvalidations.Mark(mBooks.size());
+    }
+    mBooks.clear();
+    mOfferLocations.clear();
+    mRemovedOffers.clear();
+    mUnlocatedOffers.clear();
+    mLoadedOffers.clear();
+}
+
+size_t
+OrderBook::countLoadedOffers() const
+{
+    return mOfferLocations.size();
+}
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "overlay/StellarXDR.h"
+#include "util/NonCopyable.h"
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace medida
+{
+class Counter;
+class Meter;
+}
+
+namespace stellar
+{
+class Application;
+class Database;
+class OfferFrame;
+
+/**
+ * In-memory index of the offers table, organized as one book per
+ * (selling, buying) asset pair with offers sorted by (price, offerID), which
+ * is the order used by OfferFrame::loadBestOffers.
+ *
+ * Books are loaded lazily from the database the first time a pair is
+ * requested and are then kept up to date by OfferFrame's store methods
+ * (write-through). Changes that get undone at the SQL level are reported by
+ * LedgerDelta::rollback via invalidateOffer, which drops the affected books
+ * so that they get reloaded on next access.
+ *
+ * Like the LedgerEntry cache, it's owned by the Database for ease of access.
+ */
+class OrderBook : NonMovableOrCopyable
+{
+    typedef std::pair<Asset, Asset> AssetPair;
+    struct AssetPairCmp
+    {
+        bool operator()(AssetPair const& a, AssetPair const& b) const;
+    };
+
+    // position of an offer in its book
+    typedef std::pair<double, uint64_t> OfferPosition;
+    typedef std::map<OfferPosition, LedgerEntry> Book;
+
+    struct OfferLocation
+    {
+        AssetPair mPair;
+        double mPrice;
+    };
+
+    Database& mDb;
+    bool const mEnabled;
+
+    std::map<AssetPair, Book, AssetPairCmp> mBooks;
+    // offerID -> location, for all offers in loaded books
+    std::unordered_map<uint64_t, OfferLocation> mOfferLocations;
+    // books that offers were removed from (or moved away from) since the last
+    // call to forgetRemovedOffers, needed to invalidate them on rollback
+    std::unordered_multimap<uint64_t, AssetPair> mRemovedOffers;
+    // offers changed or removed while their book was not loaded: as their
+    // previous book is unknown, rolling them back drops all books
+    std::unordered_set<uint64_t> mUnlocatedOffers;
+
+    medida::Meter& mBookLoads;
+    medida::Meter& mBookInvalidations;
+    medida::Counter& mLoadedOffers;
+
+    Book& loadBook(AssetPair const& pair);
+    void invalidateBook(AssetPair const& pair);
+    void eraseOffer(uint64_t offerID);
+    void storeOffer(LedgerEntry const& offer, bool isNew);
+
+  public:
+    OrderBook(Application& app, Database& db);
+
+    // returns true if the order book should be used for crossing offers
+    bool isEnabled() const;
+
+    // returns the best offer selling `selling` for `buying` that comes
+    // strictly after `after` (if set) in the (price, offerID) order, or
+    // nullptr if there is none
+    std::shared_ptr<OfferFrame> getBestOffer(Asset const& selling,
+                                             Asset const& buying,
+                                             OfferFrame const* after);
+
+    // write-through from OfferFrame, called once the database is updated
+    void addOffer(LedgerEntry const& offer);
+    void updateOffer(LedgerEntry const& offer);
+    void removeOffer(LedgerKey const& key);
+
+    // called when a change to `key` may have been rolled back
+    void invalidateOffer(LedgerKey const& key);
+
+    // called once changes can no longer be rolled back
+    void forgetRemovedOffers();
+
+    // drops all books
+    void clear();
+
+    size_t countLoadedOffers() const;
+};
+}
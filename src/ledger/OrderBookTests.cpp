@@ -0,0 +1,166 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "crypto/SecretKey.h"
+#include "database/Database.h"
+#include "ledger/LedgerDelta.h"
+#include "ledger/LedgerTestUtils.h"
+#include "ledger/OfferFrame.h"
+#include "ledger/OrderBook.h"
+#include "lib/catch.hpp"
+#include "main/Application.h"
+#include "test/TestUtils.h"
+#include "test/TxTests.h"
+#include "test/test.h"
+#include "util/Timer.h"
+
+using namespace stellar;
+using namespace stellar::txtest;
+
+namespace
+{
+std::vector<uint64_t>
+walkOrderBook(OrderBook& orderBook, Asset const& selling, Asset const& buying)
+{
+    std::vector<uint64_t> res;
+    OfferFrame::pointer offer;
+    while ((offer = orderBook.getBestOffer(selling, buying, offer.get())))
+    {
+        res.push_back(offer->getOfferID());
+    }
+    return res;
+}
+
+std::vector<uint64_t>
+loadFromDatabase(Database& db, Asset const& selling, Asset const& buying)
+{
+    std::vector<uint64_t> res;
+    OfferFrame::loadAllOffersByPrice(
+        selling, buying,
+        [&](LedgerEntry const& le) { res.push_back(le.data.offer().offerID); },
+        db);
+    return res;
+}
+}
+
+TEST_CASE("order book", "[ledger][orderbook]")
+{
+    VirtualClock clock;
+    Application::pointer app = createTestApplication(clock, getTestConfig());
+    app->start();
+
+    Database& db = app->getDatabase();
+    auto& orderBook = db.getOrderBook();
+    REQUIRE(orderBook.isEnabled());
+
+    auto xlm = makeNativeAsset();
+    auto usd = makeAsset(SecretKey::random(), "USD");
+    auto eur = makeAsset(SecretKey::random(), "EUR");
+
+    LedgerHeader lh;
+    lh.ledgerSeq = 2;
+    LedgerDelta delta(lh, db);
+
+    auto makeOffer = [](uint64_t offerID, Asset const& selling,
+                        Asset const& buying, Price const& price) {
+        LedgerEntry le;
+        le.data.type(OFFER);
+        auto& oe = le.data.offer();
+        oe = LedgerTestUtils::generateValidOfferEntry();
+        oe.offerID = offerID;
+        oe.selling = selling;
+        oe.buying = buying;
+        oe.price = price;
+        return std::make_shared<OfferFrame>(le);
+    };
+
+    // offers with equal prices (1/2 and 2/4) are ordered by offerID
+    std::vector<OfferFrame::pointer> offers = {
+        makeOffer(1, usd, xlm, Price{3, 1}), makeOffer(2, usd, xlm, Price{1, 2}),
+        makeOffer(3, usd, xlm, Price{2, 4}), makeOffer(4, usd, xlm, Price{7, 3}),
+        makeOffer(5, xlm, usd, Price{1, 1}), makeOffer(6, usd, eur, Price{1, 1})};
+    for (auto& o : offers)
+    {
+        o->storeAdd(delta, db);
+    }
+
+    std::vector<uint64_t> expected = {2, 3, 4, 1};
+    REQUIRE(loadFromDatabase(db, usd, xlm) == expected);
+    REQUIRE(walkOrderBook(orderBook, usd, xlm) == expected);
+    REQUIRE(orderBook.countLoadedOffers() == 4);
+
+    SECTION("write-through")
+    {
+        auto offer = offers[1];
+        offer->getOffer().price = Price{5, 2};
+        offer->storeChange(delta, db);
+
+        offers[3]->storeDelete(delta, db);
+
+        auto added = makeOffer(7, usd, xlm, Price{1, 10});
+        added->storeAdd(delta, db);
+
+        // moves to another book
+        offers[0]->getOffer().selling = eur;
+        offers[0]->storeChange(delta, db);
+
+        expected = {7, 3, 2};
+        REQUIRE(loadFromDatabase(db, usd, xlm) == expected);
+        REQUIRE(walkOrderBook(orderBook, usd, xlm) == expected);
+
+        expected = {1};
+        REQUIRE(walkOrderBook(orderBook, eur, xlm) == expected);
+    }
+
+    SECTION("rollback")
+    {
+        auto checkBooks = [&]() {
+            for (auto const& pair :
+                 {std::make_pair(usd, xlm), std::make_pair(xlm, usd),
+                  std::make_pair(usd, eur), std::make_pair(eur, xlm)})
+            {
+                REQUIRE(walkOrderBook(orderBook, pair.first, pair.second) ==
+                        loadFromDatabase(db, pair.first, pair.second));
+            }
+        };
+
+        {
+            soci::transaction sqlTx(db.getSession());
+            LedgerDelta inner(delta);
+
+            offers[1]->storeDelete(inner, db);
+            auto changed = makeOffer(3, usd, xlm, Price{10, 1});
+            changed->storeChange(inner, db);
+            auto moved = makeOffer(1, eur, xlm, Price{3, 1});
+            moved->storeChange(inner, db);
+            makeOffer(7, usd, xlm, Price{1, 10})->storeAdd(inner, db);
+
+            checkBooks();
+        }
+        checkBooks();
+        REQUIRE(walkOrderBook(orderBook, usd, xlm) == expected);
+
+        orderBook.clear();
+        REQUIRE(walkOrderBook(orderBook, usd, xlm) == expected);
+        {
+            soci::transaction sqlTx(db.getSession());
+            LedgerDelta inner(delta);
+
+            // change an offer while its book is not loaded
+            auto changed = makeOffer(6, xlm, eur, Price{1, 1});
+            changed->storeChange(inner, db);
+
+            checkBooks();
+        }
+        checkBooks();
+        REQUIRE(walkOrderBook(orderBook, usd, xlm) == expected);
+    }
+
+    SECTION("cleared with offers table")
+    {
+        OfferFrame::dropAll(db);
+        REQUIRE(orderBook.countLoadedOffers() == 0);
+        REQUIRE(walkOrderBook(orderBook, usd, xlm).empty());
+    }
+}
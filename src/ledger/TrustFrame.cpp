@@ -8,9 +8,13 @@
 #include "crypto/SHA.h"
 #include "crypto/SecretKey.h"
 #include "database/Database.h"
+#include "ledger/LedgerEntryCache.h"
 #include "ledger/LedgerRange.h"
+#include "medida/meter.h"
 #include "util/XDROperators.h"
 #include "util/types.h"
+#include <algorithm>
+#include <unordered_set>
 
 using namespace std;
 using namespace soci;
@@ -141,7 +145,8 @@ TrustFrame::getMaxAmountReceive() const
 bool
 TrustFrame::exists(Database& db, LedgerKey const& key)
 {
-    if (cachedEntryExists(key, db) && getCachedEntry(key, db) != nullptr)
+    std::shared_ptr<LedgerEntry const> cached;
+    if (getCachedEntry(key, cached, db) && cached)
     {
         return true;
     }
@@ -185,7 +190,7 @@ void
 TrustFrame::deleteTrustLinesModifiedOnOrAfterLedger(Database& db,
                                                     uint32_t oldestLedger)
 {
-    db.getEntryCache().erase_if(
+    db.getEntryCache().eraseIf(
         [oldestLedger](std::shared_ptr<LedgerEntry const> le) -> bool {
             return le && le->data.type() == TRUSTLINE &&
                    le->lastModifiedLedgerSeq >= oldestLedger;
@@ -223,6 +228,31 @@ TrustFrame::storeDelete(LedgerDelta& delta, Database& db, LedgerKey const& key)
     delta.deleteEntry(key);
 }
 
+void
+TrustFrame::storeDeleteBulk(Database& db, std::vector<LedgerKey> const& keys)
+{
+    std::vector<std::string> actIDStrKeys(keys.size());
+    std::vector<std::string> issuerStrKeys(keys.size());
+    std::vector<std::string> assetCodes(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        flushCachedEntry(keys[i], db);
+        getKeyFields(keys[i], actIDStrKeys[i], issuerStrKeys[i],
+                     assetCodes[i]);
+    }
+
+    auto timer = db.getDeleteTimer("trust");
+    auto prep = db.getPreparedStatement(
+        "DELETE FROM trustlines "
+        "WHERE accountid=:v1 AND issuer=:v2 AND assetcode=:v3");
+    auto& st = prep.statement();
+    st.exchange(use(actIDStrKeys));
+    st.exchange(use(issuerStrKeys));
+    st.exchange(use(assetCodes));
+    st.define_and_bind();
+    st.execute(true);
+}
+
 void
 TrustFrame::storeChange(LedgerDelta& delta, Database& db)
 {
@@ -305,6 +335,53 @@ TrustFrame::storeAdd(LedgerDelta& delta, Database& db)
     delta.addEntry(*this);
 }
 
+void
+TrustFrame::storeAddBulk(Database& db, std::vector<LedgerEntry> const& entries)
+{
+    std::vector<std::string> actIDStrKeys(entries.size());
+    std::vector<std::string> issuerStrKeys(entries.size());
+    std::vector<std::string> assetCodes(entries.size());
+    std::vector<int> assetTypes, flags, lastModifieds;
+    std::vector<long long> balances, limits;
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        auto const& trustLine = entries[i].data.trustLine();
+        auto key = LedgerEntryKey(entries[i]);
+        flushCachedEntry(key, db);
+        getKeyFields(key, actIDStrKeys[i], issuerStrKeys[i], assetCodes[i]);
+        assetTypes.emplace_back(trustLine.asset.type());
+        balances.emplace_back(trustLine.balance);
+        limits.emplace_back(trustLine.limit);
+        flags.emplace_back(trustLine.flags);
+        lastModifieds.emplace_back(entries[i].lastModifiedLedgerSeq);
+    }
+
+    auto prep = db.getPreparedStatement(
+        "INSERT INTO trustlines "
+        "(accountid, assettype, issuer, assetcode, balance, tlimit, flags, "
+        "lastmodified) "
+        "VALUES (:v1, :v2, :v3, :v4, :v5, :v6, :v7, :v8)");
+    auto& st = prep.statement();
+    st.exchange(use(actIDStrKeys));
+    st.exchange(use(assetTypes));
+    st.exchange(use(issuerStrKeys));
+    st.exchange(use(assetCodes));
+    st.exchange(use(balances));
+    st.exchange(use(limits));
+    st.exchange(use(flags));
+    st.exchange(use(lastModifieds));
+    st.define_and_bind();
+    {
+        auto timer = db.getInsertTimer("trust");
+        st.execute(true);
+    }
+
+    if (st.get_affected_rows() != static_cast<long long>(entries.size()))
+    {
+        throw std::runtime_error("Could not update data in SQL");
+    }
+}
+
 static const char* trustLineColumnSelector =
     "SELECT "
     "accountid,assettype,issuer,assetcode,tlimit,balance,flags,lastmodified "
@@ -346,19 +423,35 @@ TrustFrame::loadTrustLine(AccountID const& accountID, Asset const& asset,
     key.type(TRUSTLINE);
     key.trustLine().accountID = accountID;
     key.trustLine().asset = asset;
-    if (cachedEntryExists(key, db))
+    std::shared_ptr<LedgerEntry const> cached;
+    if (getCachedEntry(key, cached, db))
     {
-        auto p = getCachedEntry(key, db);
-        if (p)
+        if (!cached)
         {
-            pointer ret = std::make_shared<TrustFrame>(*p);
-            if (delta)
-            {
-                delta->recordEntry(*ret);
-            }
-            return ret;
+            return nullptr;
+        }
+        pointer ret = std::make_shared<TrustFrame>(*cached);
+        if (delta)
+        {
+            delta->recordEntry(*ret);
+        }
+        return ret;
+    }
+    if (getBucketListEntry(key, cached, db))
+    {
+        putCachedEntry(key, cached, db);
+        if (!cached)
+        {
+            return nullptr;
+        }
+        pointer ret = std::make_shared<TrustFrame>(*cached);
+        if (delta)
+        {
+            delta->recordEntry(*ret);
         }
+        return ret;
     }
+    db.getDemandLoadMeter().Mark();
 
     std::string accStr, issuerStr, assetStr;
 
@@ -406,6 +499,79 @@ TrustFrame::loadTrustLine(AccountID const& accountID, Asset const& asset,
     return retLine;
 }
 
+size_t
+TrustFrame::prefetch(Database& db, std::vector<LedgerKey> const& keys)
+{
+    size_t res = 0;
+    std::unordered_set<LedgerKey> toLoad;
+    std::unordered_set<std::string> accounts;
+    std::vector<std::string> actIDStrKeys;
+    for (auto const& key : keys)
+    {
+        auto const& tl = key.trustLine();
+        // issuers don't have trust lines for their own assets
+        if (tl.asset.type() == ASSET_TYPE_NATIVE ||
+            tl.accountID == getIssuer(tl.asset) || cachedEntryExists(key, db))
+        {
+            continue;
+        }
+        std::shared_ptr<LedgerEntry const> entry;
+        if (getBucketListEntry(key, entry, db))
+        {
+            putCachedEntry(key, entry, db);
+            ++res;
+            continue;
+        }
+        auto actIDStrKey = KeyUtils::toStrKey(tl.accountID);
+        if (accounts.insert(actIDStrKey).second)
+        {
+            actIDStrKeys.emplace_back(actIDStrKey);
+        }
+        toLoad.emplace(key);
+    }
+
+    // loads all the trust lines of the accounts, only caching the ones asked
+    // for
+    auto query = std::string(trustLineColumnSelector);
+    query += " WHERE accountid IN " + prefetchPlaceholders();
+    for (size_t i = 0; i < actIDStrKeys.size(); i += PREFETCH_BATCH_SIZE)
+    {
+        auto end = std::min(i + PREFETCH_BATCH_SIZE, actIDStrKeys.size());
+        std::vector<std::string> batch(actIDStrKeys.begin() + i,
+                                       actIDStrKeys.begin() + end);
+        // the statement has a fixed number of placeholders, so that it is
+        // prepared once
+        batch.resize(PREFETCH_BATCH_SIZE, batch.back());
+
+        auto prep = db.getPreparedStatement(query);
+        auto& st = prep.statement();
+        for (auto& id : batch)
+        {
+            st.exchange(use(id));
+        }
+
+        auto timer = db.getSelectTimer("trust");
+        loadLines(prep, [&](LedgerEntry const& trust) {
+            auto it = toLoad.find(LedgerEntryKey(trust));
+            if (it != toLoad.end())
+            {
+                putCachedEntry(*it, std::make_shared<LedgerEntry const>(trust),
+                               db);
+                toLoad.erase(it);
+                ++res;
+            }
+        });
+    }
+
+    // the others don't exist
+    for (auto const& key : toLoad)
+    {
+        putCachedEntry(key, nullptr, db);
+        ++res;
+    }
+    return res;
+}
+
 std::pair<TrustFrame::pointer, AccountFrame::pointer>
 TrustFrame::loadTrustLineIssuer(AccountID const& accountID, Asset const& asset,
                                 Database& db, LedgerDelta& delta)
@@ -64,6 +64,12 @@ class TrustFrame : public EntryFrame
     // Static helper that don't assume an instance.
     static void storeDelete(LedgerDelta& delta, Database& db,
                             LedgerKey const& key);
+    static void storeDeleteBulk(Database& db,
+                                std::vector<LedgerKey> const& keys);
+    static void storeAddBulk(Database& db,
+                             std::vector<LedgerEntry> const& entries);
+    // see EntryFrame::prefetch
+    static size_t prefetch(Database& db, std::vector<LedgerKey> const& keys);
     static bool exists(Database& db, LedgerKey const& key);
     static uint64_t countObjects(soci::session& sess);
     static uint64_t countObjects(soci::session& sess,
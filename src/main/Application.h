@@ -117,6 +117,11 @@ void validateNetworkPassphrase(std::shared_ptr<Application> app);
  * thread's io_service (held in the VirtualClock), or else deliver their results
  * to the Application through std::futures or similar standard
  * thread-synchronization primitives.
+ *
+ * If NETWORK_IO_THREADS is set, the Application also owns a "network"
+ * asio::io_service, served by that many threads, that runs the socket I/O of
+ * TCP peers (including decoding and authenticating incoming messages), which
+ * then hand the messages over to the main thread.
  */
 
 class Application
@@ -213,6 +218,11 @@ class Application
     // with caution.
     virtual asio::io_service& getWorkerIOService() = 0;
 
+    // Get the network IO service, served by the network threads, or nullptr if
+    // sockets are served by the main thread (see NETWORK_IO_THREADS). It's
+    // shared with the sockets using it, as they can outlive the Application.
+    virtual std::shared_ptr<asio::io_service> getNetworkIOService() = 0;
+
     // Perform actions necessary to transition from BOOTING_STATE to other
     // states. In particular: either reload or reinitialize the database, and
     // either restart or begin reacquiring SCP consensus (as instructed by
@@ -63,6 +63,7 @@ ApplicationImpl::ApplicationImpl(VirtualClock& clock, Config const& cfg)
     , mWorkerIOService(std::thread::hardware_concurrency())
     , mWork(make_unique<asio::io_service::work>(mWorkerIOService))
     , mWorkerThreads()
+    , mNetworkThreads()
     , mStopSignals(clock.getIOService(), SIGINT)
     , mStopping(false)
     , mStoppingTimer(*this)
@@ -82,6 +83,7 @@ ApplicationImpl::ApplicationImpl(VirtualClock& clock, Config const& cfg)
     std::srand(static_cast<uint32>(clock.now().time_since_epoch().count()));
 
     mNetworkID = sha256(mConfig.NETWORK_PASSPHRASE);
+    PubKeyUtils::setVerifySigCacheSize(mConfig.SIGNATURE_CACHE_SIZE);
 
     unsigned t = std::thread::hardware_concurrency();
     LOG(DEBUG) << "Application constructing "
@@ -98,6 +100,21 @@ ApplicationImpl::ApplicationImpl(VirtualClock& clock, Config const& cfg)
     {
         mWorkerThreads.emplace_back([this, t]() { this->runWorkerThread(t); });
     }
+
+    if (mConfig.NETWORK_IO_THREADS > 0)
+    {
+        LOG(DEBUG) << "Application constructing "
+                   << "(network threads: " << mConfig.NETWORK_IO_THREADS
+                   << ")";
+        mNetworkIOService =
+            std::make_shared<asio::io_service>(mConfig.NETWORK_IO_THREADS);
+        mNetworkWork = make_unique<asio::io_service::work>(*mNetworkIOService);
+        auto io = mNetworkIOService;
+        for (uint32_t i = 0; i < mConfig.NETWORK_IO_THREADS; ++i)
+        {
+            mNetworkThreads.emplace_back([io]() { io->run(); });
+        }
+    }
 }
 
 void
@@ -465,6 +482,20 @@ ApplicationImpl::joinAllThreads()
         w.join();
     }
     LOG(DEBUG) << "Joined all " << mWorkerThreads.size() << " threads";
+
+    // Unlike the worker io_service, the network io_service is stopped right
+    // away: it always has pending reads on connected sockets. Socket
+    // operations that did not complete are dropped along with the io_service.
+    if (mNetworkIOService)
+    {
+        mNetworkWork.reset();
+        mNetworkIOService->stop();
+    }
+    for (auto& t : mNetworkThreads)
+    {
+        t.join();
+    }
+    mNetworkThreads.clear();
 }
 
 bool
@@ -748,6 +779,12 @@ ApplicationImpl::getWorkerIOService()
     return mWorkerIOService;
 }
 
+std::shared_ptr<asio::io_service>
+ApplicationImpl::getNetworkIOService()
+{
+    return mNetworkIOService;
+}
+
 void
 ApplicationImpl::enableInvariantsFromConfig()
 {
@@ -72,6 +72,7 @@ class ApplicationImpl : public Application
     virtual StatusManager& getStatusManager() override;
 
     virtual asio::io_service& getWorkerIOService() override;
+    virtual std::shared_ptr<asio::io_service> getNetworkIOService() override;
 
     void newDB() override;
     virtual void start() override;
@@ -129,6 +130,8 @@ class ApplicationImpl : public Application
 
     asio::io_service mWorkerIOService;
     std::unique_ptr<asio::io_service::work> mWork;
+    std::shared_ptr<asio::io_service> mNetworkIOService;
+    std::unique_ptr<asio::io_service::work> mNetworkWork;
 
     std::unique_ptr<Database> mDatabase;
     std::unique_ptr<TmpDirManager> mTmpDirManager;
@@ -150,6 +153,7 @@ class ApplicationImpl : public Application
     std::unique_ptr<StatusManager> mStatusManager;
 
     std::vector<std::thread> mWorkerThreads;
+    std::vector<std::thread> mNetworkThreads;
 
     asio::signal_set mStopSignals;
 
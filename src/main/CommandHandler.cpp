@@ -496,6 +496,15 @@ CommandHandler::peers(std::string const&, std::string& retStr)
             (int)peer.second->getRemoteOverlayVersion();
         root["authenticated_peers"][counter]["id"] =
             mApp.getConfig().toStrKey(peer.first);
+        root["authenticated_peers"][counter]["flow_control"] =
+            peer.second->isFlowControlled();
+
+        auto stats = peer.second->getOutboundQueueStats();
+        auto& queue = root["authenticated_peers"][counter]["outbound_queue"];
+        queue["messages"] = (Json::UInt64)stats.mMessages;
+        queue["bytes"] = (Json::UInt64)stats.mBytes;
+        queue["dropped_messages"] = (Json::UInt64)stats.mDroppedMessages;
+        queue["dropped_bytes"] = (Json::UInt64)stats.mDroppedBytes;
 
         counter++;
     }
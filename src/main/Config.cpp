@@ -6,6 +6,7 @@
 #include "main/Config.h"
 #include "crypto/Hex.h"
 #include "crypto/KeyUtils.h"
+#include "crypto/SecretKey.h"
 #include "herder/Herder.h"
 #include "history/HistoryArchive.h"
 #include "ledger/LedgerManager.h"
@@ -34,7 +35,7 @@ Config::Config() : NODE_SEED(SecretKey::random())
     LEDGER_PROTOCOL_VERSION = CURRENT_LEDGER_PROTOCOL_VERSION;
 
     OVERLAY_PROTOCOL_MIN_VERSION = 5;
-    OVERLAY_PROTOCOL_VERSION = 6;
+    OVERLAY_PROTOCOL_VERSION = 8;
 
     VERSION_STR = STELLAR_CORE_VERSION;
 
@@ -52,6 +53,7 @@ Config::Config() : NODE_SEED(SecretKey::random())
     ALLOW_LOCALHOST_FOR_TESTING = false;
     USE_CONFIG_FOR_GENESIS = false;
     FAILURE_SAFETY = -1;
+    SCP_ENVELOPE_BATCH_SIZE = 100;
     UNSAFE_QUORUM = false;
 
     LOG_FILE_PATH = "stellar-core.%datetime{%Y.%M.%d-%H:%m:%s}.log";
@@ -72,13 +74,27 @@ Config::Config() : NODE_SEED(SecretKey::random())
     PEER_AUTHENTICATION_TIMEOUT = 2;
     PEER_TIMEOUT = 30;
     PREFERRED_PEERS_ONLY = false;
+    NETWORK_IO_THREADS = 0;
+    NETWORK_IO_QUEUE_SIZE = 256;
+    OUTBOUND_TX_QUEUE_BYTE_LIMIT = 3 * 1024 * 1024;
+    PEER_FLOOD_READING_CAPACITY = 200;
+    FLOW_CONTROL_SEND_MORE_BATCH_SIZE = 40;
+    FLOOD_ADVERT_PERIOD_MS = std::chrono::milliseconds{100};
 
     MINIMUM_IDLE_PERCENT = 0;
 
+    IN_MEMORY_ORDER_BOOK = true;
+    BUCKET_LIST_READS = false;
+    DEFER_ACCOUNT_WRITES = true;
+    PARALLEL_TX_SET_VALIDATION = true;
+
     MAX_CONCURRENT_SUBPROCESSES = 16;
+    BUCKET_MERGE_PARALLELISM = 4;
     NODE_IS_VALIDATOR = false;
 
     DATABASE = SecretValue{"sqlite3://:memory:"};
+    ENTRY_CACHE_SIZE_MB = 64;
+    SIGNATURE_CACHE_SIZE = PubKeyUtils::DEFAULT_VERIFY_SIG_CACHE_SIZE;
     NTP_SERVER = "pool.ntp.org";
 }
 
@@ -383,6 +399,31 @@ Config::load(std::string const& filename)
             {
                 PEER_TIMEOUT = readInt<unsigned short>(item, 1, UINT16_MAX);
             }
+            else if (item.first == "NETWORK_IO_THREADS")
+            {
+                NETWORK_IO_THREADS = readInt<uint32_t>(item, 0, 64);
+            }
+            else if (item.first == "NETWORK_IO_QUEUE_SIZE")
+            {
+                NETWORK_IO_QUEUE_SIZE = readInt<uint32_t>(item, 1);
+            }
+            else if (item.first == "OUTBOUND_TX_QUEUE_BYTE_LIMIT")
+            {
+                OUTBOUND_TX_QUEUE_BYTE_LIMIT = readInt<uint32_t>(item, 1);
+            }
+            else if (item.first == "PEER_FLOOD_READING_CAPACITY")
+            {
+                PEER_FLOOD_READING_CAPACITY = readInt<uint32_t>(item, 1);
+            }
+            else if (item.first == "FLOW_CONTROL_SEND_MORE_BATCH_SIZE")
+            {
+                FLOW_CONTROL_SEND_MORE_BATCH_SIZE = readInt<uint32_t>(item, 1);
+            }
+            else if (item.first == "FLOOD_ADVERT_PERIOD_MS")
+            {
+                FLOOD_ADVERT_PERIOD_MS =
+                    std::chrono::milliseconds{readInt<uint32_t>(item, 1)};
+            }
             else if (item.first == "PREFERRED_PEERS")
             {
                 PREFERRED_PEERS = readStringArray(item);
@@ -412,6 +453,40 @@ Config::load(std::string const& filename)
                 MAX_CONCURRENT_SUBPROCESSES =
                     static_cast<size_t>(readInt<int>(item, 1));
             }
+            else if (item.first == "SCP_ENVELOPE_BATCH_SIZE")
+            {
+                SCP_ENVELOPE_BATCH_SIZE = readInt<uint32_t>(item, 1);
+            }
+            else if (item.first == "BUCKET_MERGE_PARALLELISM")
+            {
+                BUCKET_MERGE_PARALLELISM = readInt<uint32_t>(item, 1);
+            }
+            else if (item.first == "ENTRY_CACHE_SIZE_MB")
+            {
+                ENTRY_CACHE_SIZE_MB =
+                    static_cast<size_t>(readInt<int>(item, 1));
+            }
+            else if (item.first == "SIGNATURE_CACHE_SIZE")
+            {
+                SIGNATURE_CACHE_SIZE =
+                    static_cast<size_t>(readInt<int>(item, 1));
+            }
+            else if (item.first == "IN_MEMORY_ORDER_BOOK")
+            {
+                IN_MEMORY_ORDER_BOOK = readBool(item);
+            }
+            else if (item.first == "BUCKET_LIST_READS")
+            {
+                BUCKET_LIST_READS = readBool(item);
+            }
+            else if (item.first == "DEFER_ACCOUNT_WRITES")
+            {
+                DEFER_ACCOUNT_WRITES = readBool(item);
+            }
+            else if (item.first == "PARALLEL_TX_SET_VALIDATION")
+            {
+                PARALLEL_TX_SET_VALIDATION = readBool(item);
+            }
             else if (item.first == "MINIMUM_IDLE_PERCENT")
             {
                 MINIMUM_IDLE_PERCENT = readInt<uint32_t>(item, 0, 100);
@@ -538,6 +613,13 @@ Config::load(std::string const& filename)
             std::min(MAX_PEER_CONNECTIONS, MAX_PENDING_CONNECTIONS);
         TARGET_PEER_CONNECTIONS =
             std::min(TARGET_PEER_CONNECTIONS, MAX_PEER_CONNECTIONS);
+
+        if (FLOW_CONTROL_SEND_MORE_BATCH_SIZE > PEER_FLOOD_READING_CAPACITY)
+        {
+            throw std::invalid_argument(
+                "FLOW_CONTROL_SEND_MORE_BATCH_SIZE must not exceed "
+                "PEER_FLOOD_READING_CAPACITY");
+        }
         validateConfig();
     }
     catch (cpptoml::toml_parse_exception& ex)
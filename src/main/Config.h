@@ -133,6 +133,11 @@ class Config : public std::enable_shared_from_this<Config>
     //  aren't concerned with byzantine failures.
     bool UNSAFE_QUORUM;
 
+    // Maximum number of ready SCP envelopes of a slot processed together,
+    // running the ballot protocol checks once for all of them. 1 processes
+    // envelopes one at a time.
+    uint32_t SCP_ENVELOPE_BATCH_SIZE;
+
     // Set of cursors added at each startup with value '1'.
     std::vector<std::string> KNOWN_CURSORS;
 
@@ -173,6 +178,27 @@ class Config : public std::enable_shared_from_this<Config>
     // Whether to exclude peers that are not preferred.
     bool PREFERRED_PEERS_ONLY;
 
+    // Number of threads serving the sockets of peers; 0 serves them from
+    // the main thread
+    uint32_t NETWORK_IO_THREADS;
+
+    // Maximum number of messages read from a peer and waiting to be processed
+    // by the main thread, beyond which reading from the peer is paused
+    uint32_t NETWORK_IO_QUEUE_SIZE;
+
+    // Maximum number of bytes of transactions waiting to be sent to a peer,
+    // beyond which the oldest ones are dropped
+    uint32_t OUTBOUND_TX_QUEUE_BYTE_LIMIT;
+
+    // Number of transactions a peer may send before we ask for more (overlay
+    // flow control), and number of them that are processed before we do
+    uint32_t PEER_FLOOD_READING_CAPACITY;
+    uint32_t FLOW_CONTROL_SEND_MORE_BATCH_SIZE;
+
+    // Period over which the hashes of transactions to flood are gathered
+    // before advertising them to peers that pull transactions
+    std::chrono::milliseconds FLOOD_ADVERT_PERIOD_MS;
+
     // Percentage, between 0 and 100, of system activity (measured in terms
     // of both event-loop cycles and database time) below-which the system
     // will consider itself "loaded" and attempt to shed load. Set this
@@ -181,9 +207,30 @@ class Config : public std::enable_shared_from_this<Config>
     // totally insensitive to overloading.
     uint32_t MINIMUM_IDLE_PERCENT;
 
+    // If set, offers are crossed using an in-memory index of the order book
+    // instead of paging through the offers table
+    bool IN_MEMORY_ORDER_BOOK;
+
+    // If set, ledger entries are loaded by key from the BucketList instead of
+    // the database, when it's known to hold the same state
+    bool BUCKET_LIST_READS;
+
+    // If set, the accounts updated while charging fees are written to the
+    // database once each, with a batched statement, after all the fees were
+    // charged
+    bool DEFER_ACCOUNT_WRITES;
+
+    // If set, the transactions of each source account of a transaction set
+    // are validated on worker threads, each loading entries through its own
+    // session of the database connection pool (when it can be used)
+    bool PARALLEL_TX_SET_VALIDATION;
+
     // process-management config
     size_t MAX_CONCURRENT_SUBPROCESSES;
 
+    // Maximum number of worker threads merging a pair of large buckets
+    uint32_t BUCKET_MERGE_PARALLELISM;
+
     // SCP config
     SecretKey NODE_SEED;
     bool NODE_IS_VALIDATOR;
@@ -200,6 +247,14 @@ class Config : public std::enable_shared_from_this<Config>
     // Database config
     SecretValue DATABASE;
 
+    // Approximate amount of memory, in megabytes, used to cache ledger
+    // entries loaded from the database
+    size_t ENTRY_CACHE_SIZE_MB;
+
+    // Number of signature verification results kept in the process-wide
+    // verification cache
+    size_t SIGNATURE_CACHE_SIZE;
+
     std::vector<std::string> COMMANDS;
     std::vector<std::string> REPORT_METRICS;
 
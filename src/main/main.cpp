@@ -550,8 +550,8 @@ loadXdr(Config const& cfg, std::string const& bucketFile)
     if (checkInitialized(app))
     {
         uint256 zero;
-        Bucket bucket(bucketFile, zero);
-        bucket.apply(app->getDatabase());
+        auto bucket = std::make_shared<Bucket>(bucketFile, zero);
+        bucket->apply(*app);
     }
     else
     {
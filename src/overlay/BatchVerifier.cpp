@@ -0,0 +1,73 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "overlay/BatchVerifier.h"
+#include "herder/Herder.h"
+#include "main/Application.h"
+#include "util/Logging.h"
+#include "medida/histogram.h"
+#include "medida/metrics_registry.h"
+#include "medida/timer.h"
+#include <iterator>
+#include <thread>
+
+namespace stellar
+{
+
+BatchVerifier::BatchVerifier(Application& app)
+    : mApp(app)
+    , mTimer(app)
+    , mBatchSize(
+          app.getMetrics().NewHistogram({"overlay", "verify-batch", "size"}))
+    , mBatchVerify(
+          app.getMetrics().NewTimer({"overlay", "verify-batch", "verify"}))
+{
+}
+
+void
+BatchVerifier::add(std::vector<PubKeyUtils::SignatureToVerify> sigs,
+                   std::function<void()> process)
+{
+    mSigs.insert(mSigs.end(), std::make_move_iterator(sigs.begin()),
+                 std::make_move_iterator(sigs.end()));
+    mPending.emplace_back(std::move(process));
+
+    if (!mScheduled)
+    {
+        mScheduled = true;
+        mTimer.expires_from_now(std::chrono::seconds(0));
+        mTimer.async_wait([this]() { processPending(); },
+                          VirtualTimer::onFailureNoop);
+    }
+}
+
+void
+BatchVerifier::processPending()
+{
+    mScheduled = false;
+    auto sigs = std::move(mSigs);
+    auto pending = std::move(mPending);
+    mSigs.clear();
+    mPending.clear();
+
+    mBatchSize.Update(sigs.size());
+    {
+        auto timer = mBatchVerify.TimeScope();
+        PubKeyUtils::verifySigs(
+            std::move(sigs),
+            [this](std::function<void()> f) {
+                mApp.getWorkerIOService().post(f);
+            },
+            std::thread::hardware_concurrency());
+    }
+
+    // envelopes verified together are processed together
+    Herder::EnvelopeBatch batch(mApp.getHerder());
+    for (auto& p : pending)
+    {
+        p();
+    }
+    batch.commit();
+}
+}
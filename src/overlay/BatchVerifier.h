@@ -0,0 +1,54 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "crypto/SecretKey.h"
+#include "util/NonCopyable.h"
+#include "util/Timer.h"
+#include <functional>
+#include <vector>
+
+namespace medida
+{
+class Histogram;
+class Timer;
+}
+
+namespace stellar
+{
+class Application;
+
+/**
+ * Verifies the signatures of flooded messages (transactions and SCP
+ * envelopes) in batches.
+ *
+ * Messages received before the next crank of the main thread are queued
+ * along with their signatures. The signatures are then verified together by
+ * PubKeyUtils::verifySigs, spread over the worker threads, and the messages
+ * are processed in the order they were received: by then, checking their
+ * signatures only hits the verification cache.
+ */
+class BatchVerifier : NonMovableOrCopyable
+{
+    Application& mApp;
+    VirtualTimer mTimer;
+    bool mScheduled{false};
+
+    std::vector<PubKeyUtils::SignatureToVerify> mSigs;
+    std::vector<std::function<void()>> mPending;
+
+    medida::Histogram& mBatchSize;
+    medida::Timer& mBatchVerify;
+
+    void processPending();
+
+  public:
+    explicit BatchVerifier(Application& app);
+
+    // queues `process`, to be called once `sigs` are verified
+    void add(std::vector<PubKeyUtils::SignatureToVerify> sigs,
+             std::function<void()> process);
+};
+}
@@ -0,0 +1,70 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "crypto/Random.h"
+#include "crypto/SecretKey.h"
+#include "overlay/BatchVerifier.h"
+#include "overlay/OverlayManager.h"
+#include "test/TestUtils.h"
+#include "test/test.h"
+#include "util/Timer.h"
+#include <lib/catch.hpp>
+
+using namespace stellar;
+
+TEST_CASE("batch signature verification", "[overlay][batchverify]")
+{
+    VirtualClock clock;
+    auto app = createTestApplication(clock, getTestConfig());
+    auto& verifier = app->getOverlayManager().getBatchVerifier();
+
+    PubKeyUtils::clearVerifySigCache();
+    uint64_t hits, misses;
+    PubKeyUtils::flushVerifySigCacheCounts(hits, misses);
+
+    size_t const n = 100;
+    std::vector<PubKeyUtils::SignatureToVerify> all;
+    for (size_t i = 0; i < n; ++i)
+    {
+        auto sk = SecretKey::random();
+        auto data = randomBytes(64);
+        all.emplace_back(PubKeyUtils::SignatureToVerify{sk.getPublicKey(),
+                                                        sk.sign(data), data});
+    }
+    // an invalid signature
+    all.back().signature[0] ^= 1;
+
+    std::vector<size_t> processed;
+    for (size_t i = 0; i < n; ++i)
+    {
+        // each signature is sent twice, as when flooded by two peers
+        verifier.add({all[i], all[i]}, [&processed, i]() {
+            processed.emplace_back(i);
+        });
+    }
+    REQUIRE(processed.empty());
+
+    while (processed.size() != n)
+    {
+        clock.crank(false);
+    }
+    for (size_t i = 0; i < n; ++i)
+    {
+        REQUIRE(processed[i] == i);
+    }
+
+    PubKeyUtils::flushVerifySigCacheCounts(hits, misses);
+    REQUIRE(misses == n);
+    REQUIRE(hits == 0);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        auto const& s = all[i];
+        REQUIRE(PubKeyUtils::verifySig(s.key, s.signature, s.data) ==
+                (i != n - 1));
+    }
+    PubKeyUtils::flushVerifySigCacheCounts(hits, misses);
+    REQUIRE(hits == n);
+    REQUIRE(misses == 0);
+}
@@ -0,0 +1,79 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "overlay/EncodedMessage.h"
+#include "crypto/SHA.h"
+#include "util/make_unique.h"
+#include "xdrpp/marshal.h"
+#include <cstring>
+
+namespace stellar
+{
+
+namespace
+{
+// big-endian, as XDR encodes integers
+char*
+putUint(char* p, uint64_t v, size_t nbBytes)
+{
+    for (size_t i = 0; i < nbBytes; ++i)
+    {
+        p[i] = static_cast<char>(v >> (8 * (nbBytes - 1 - i)));
+    }
+    return p + nbBytes;
+}
+}
+
+EncodedMessage::EncodedMessage(StellarMessage const& msg)
+    : mMessage(msg), mBody(xdr::xdr_to_opaque(msg))
+{
+}
+
+StellarMessage const&
+EncodedMessage::getMessage() const
+{
+    return mMessage;
+}
+
+xdr::opaque_vec<> const&
+EncodedMessage::getBody() const
+{
+    return mBody;
+}
+
+Hash const&
+EncodedMessage::getHash() const
+{
+    if (!mHash)
+    {
+        mHash = make_unique<Hash>(sha256(mBody));
+    }
+    return *mHash;
+}
+
+xdr::msg_ptr
+EncodedMessage::toAuthenticatedMessage(uint64_t sequence,
+                                       HmacSha256Key const* macKey) const
+{
+    // AuthenticatedMessage v0: discriminant, sequence, message, mac
+    uint8_t seqBytes[sizeof(uint64_t)];
+    putUint(reinterpret_cast<char*>(seqBytes), sequence, sizeof(seqBytes));
+    HmacSha256Mac mac;
+    if (macKey)
+    {
+        mac = hmacSha256(*macKey, {ByteSlice(seqBytes, sizeof(seqBytes)),
+                                   ByteSlice(mBody)});
+    }
+
+    auto res = xdr::message_t::alloc(sizeof(uint32_t) + sizeof(seqBytes) +
+                                     mBody.size() + mac.mac.size());
+    auto p = putUint(res->data(), 0, sizeof(uint32_t));
+    std::memcpy(p, seqBytes, sizeof(seqBytes));
+    p += sizeof(seqBytes);
+    std::memcpy(p, mBody.data(), mBody.size());
+    p += mBody.size();
+    std::memcpy(p, mac.mac.data(), mac.mac.size());
+    return res;
+}
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "overlay/StellarXDR.h"
+#include "util/NonCopyable.h"
+#include "xdrpp/message.h"
+#include <memory>
+
+namespace stellar
+{
+
+/**
+ * A StellarMessage along with its XDR encoding, shared by all the peers it is
+ * sent to so that broadcasting a message encodes and hashes it only once.
+ *
+ * Each peer then frames the shared encoding in its own AuthenticatedMessage,
+ * whose MAC is computed over the sequence number and the encoded message
+ * without encoding them together first.
+ */
+class EncodedMessage : NonMovableOrCopyable
+{
+    StellarMessage const mMessage;
+    xdr::opaque_vec<> const mBody;
+    mutable std::unique_ptr<Hash> mHash;
+
+  public:
+    typedef std::shared_ptr<EncodedMessage const> pointer;
+
+    explicit EncodedMessage(StellarMessage const& msg);
+
+    StellarMessage const& getMessage() const;
+    xdr::opaque_vec<> const& getBody() const;
+
+    // sha256 of the encoded message, computed on first use
+    Hash const& getHash() const;
+
+    // returns the encoding of the AuthenticatedMessage carrying this message
+    // with `sequence`, authenticated with `macKey` if set (the MAC is left
+    // zeroed otherwise), as xdr::xdr_to_msg would produce it
+    xdr::msg_ptr toAuthenticatedMessage(uint64_t sequence,
+                                        HmacSha256Key const* macKey) const;
+};
+}
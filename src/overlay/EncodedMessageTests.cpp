@@ -0,0 +1,129 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "crypto/Random.h"
+#include "crypto/SHA.h"
+#include "crypto/SecretKey.h"
+#include "lib/catch.hpp"
+#include "main/Application.h"
+#include "overlay/EncodedMessage.h"
+#include "overlay/LoopbackPeer.h"
+#include "overlay/OverlayManager.h"
+#include "test/TestUtils.h"
+#include "test/test.h"
+#include "util/Logging.h"
+#include "util/Timer.h"
+#include "util/make_unique.h"
+#include "xdrpp/autocheck.h"
+#include "xdrpp/marshal.h"
+#include <chrono>
+#include <cstring>
+
+using namespace stellar;
+
+namespace
+{
+StellarMessage
+makeTransactionMessage(uint64_t seqNum)
+{
+    StellarMessage msg;
+    msg.type(TRANSACTION);
+    auto& tx = msg.transaction().tx;
+    tx.sourceAccount = SecretKey::random().getPublicKey();
+    tx.fee = 100;
+    tx.seqNum = seqNum;
+    tx.operations.resize(1);
+    auto& op = tx.operations[0].body;
+    op.type(PAYMENT);
+    op.paymentOp().destination = SecretKey::random().getPublicKey();
+    op.paymentOp().amount = 1000;
+    msg.transaction().signatures.resize(1);
+    auto sig = randomBytes(64);
+    msg.transaction().signatures[0].signature.assign(sig.begin(), sig.end());
+    return msg;
+}
+}
+
+TEST_CASE("encoded message framing", "[overlay][encodedmessage]")
+{
+    autocheck::generator<StellarMessage> gen;
+    HmacSha256Key key;
+    auto keyBytes = randomBytes(key.key.size());
+    std::copy(keyBytes.begin(), keyBytes.end(), key.key.begin());
+
+    for (int i = 0; i < 20; ++i)
+    {
+        auto msg = gen(5);
+        EncodedMessage encoded(msg);
+        REQUIRE(encoded.getHash() == sha256(xdr::xdr_to_opaque(msg)));
+
+        AuthenticatedMessage amsg;
+        amsg.v0().message = msg;
+        auto expected = xdr::xdr_to_msg(amsg);
+        auto framed = encoded.toAuthenticatedMessage(0, nullptr);
+        REQUIRE(framed->raw_size() == expected->raw_size());
+        REQUIRE(std::memcmp(framed->raw_data(), expected->raw_data(),
+                            expected->raw_size()) == 0);
+
+        amsg.v0().sequence = i;
+        amsg.v0().mac = hmacSha256(key, xdr::xdr_to_opaque(uint64_t(i), msg));
+        expected = xdr::xdr_to_msg(amsg);
+        framed = encoded.toAuthenticatedMessage(i, &key);
+        REQUIRE(framed->raw_size() == expected->raw_size());
+        REQUIRE(std::memcmp(framed->raw_data(), expected->raw_data(),
+                            expected->raw_size()) == 0);
+    }
+}
+
+TEST_CASE("broadcast to many peers", "[overlay][bench][!hide]")
+{
+    size_t const nPeers = 50;
+    size_t const nMessages = 1000;
+
+    VirtualClock clock;
+    Config cfg0 = getTestConfig(0);
+    cfg0.MAX_PEER_CONNECTIONS = nPeers + 1;
+    cfg0.TARGET_PEER_CONNECTIONS = nPeers + 1;
+    auto app0 = createTestApplication(clock, cfg0);
+
+    std::vector<Application::pointer> apps;
+    std::vector<std::unique_ptr<LoopbackPeerConnection>> conns;
+    for (size_t i = 1; i <= nPeers; ++i)
+    {
+        apps.emplace_back(createTestApplication(clock, getTestConfig(i)));
+        conns.emplace_back(
+            make_unique<LoopbackPeerConnection>(*app0, *apps.back()));
+    }
+    testutil::crankSome(clock);
+    REQUIRE(app0->getOverlayManager().getAuthenticatedPeersCount() == nPeers);
+
+    // only measures the sending side: messages stay queued
+    for (auto& conn : conns)
+    {
+        conn->getInitiator()->setCorked(true);
+    }
+
+    std::vector<StellarMessage> msgs;
+    for (size_t i = 0; i < nMessages; ++i)
+    {
+        msgs.emplace_back(makeTransactionMessage(i + 1));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (auto const& msg : msgs)
+    {
+        app0->getOverlayManager().broadcastMessage(msg);
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    for (auto& conn : conns)
+    {
+        REQUIRE(conn->getInitiator()->getMessagesQueued() >= nMessages);
+        conn->getInitiator()->dropAll();
+    }
+    LOG(INFO) << "Broadcast " << nMessages << " messages to " << nPeers
+              << " peers in " << elapsed.count() << "s: "
+              << nMessages * nPeers / elapsed.count() << " sends/s";
+}
@@ -180,6 +180,50 @@ TEST_CASE("Flooding", "[flood][overlay]")
                                               networkID, cfgGen);
                 test(injectTransaction, ackedTransactions);
             }
+            SECTION("pulling uses less bandwidth than pushing")
+            {
+                auto bytesWritten = [&]() {
+                    int64_t res = 0;
+                    for (auto n : simulation->getNodes())
+                    {
+                        res += Peer::getByteWriteMeter(*n).count();
+                    }
+                    return res;
+                };
+                // bytes written by all nodes per transaction, from the first
+                // one injected until all of them reached every node
+                auto bytesPerTx = [&](uint32_t overlayVersion) {
+                    auto gen = [cfgGen, overlayVersion](int cfgNum) {
+                        Config cfg = cfgGen(cfgNum);
+                        cfg.OVERLAY_PROTOCOL_VERSION = overlayVersion;
+                        return cfg;
+                    };
+                    simulation = Topologies::core(
+                        4, .666f, Simulation::OVER_LOOPBACK, networkID, gen);
+                    sources.clear();
+                    int64_t start = 0;
+                    test(
+                        [&](int i) {
+                            if (i == 0)
+                            {
+                                start = bytesWritten();
+                            }
+                            injectTransaction(i);
+                        },
+                        ackedTransactions);
+                    auto res = bytesWritten() - start;
+                    simulation->stopAllNodes();
+                    return res / nbTx;
+                };
+
+                auto pull =
+                    bytesPerTx(Peer::FIRST_OVERLAY_VERSION_WITH_TX_PULL);
+                auto push =
+                    bytesPerTx(Peer::FIRST_OVERLAY_VERSION_WITH_TX_PULL - 1);
+                LOG(INFO) << "bytes per transaction: " << pull
+                          << " pulling, " << push << " pushing";
+                REQUIRE(pull < push);
+            }
         }
 
         SECTION("outer nodes")
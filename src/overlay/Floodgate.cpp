@@ -9,23 +9,130 @@
 #include "main/Application.h"
 #include "medida/counter.h"
 #include "medida/metrics_registry.h"
+#include "overlay/EncodedMessage.h"
 #include "overlay/OverlayManager.h"
 #include "util/Logging.h"
 #include "util/XDROperators.h"
 #include "xdrpp/marshal.h"
+#include <cstring>
 
 namespace stellar
 {
-Floodgate::FloodRecord::FloodRecord(StellarMessage const& msg, uint32_t ledger,
-                                    Peer::pointer peer)
-    : mLedgerSeq(ledger), mMessage(msg)
+
+namespace
+{
+size_t const MIN_CAPACITY = 64;
+// rough size of a node of mByLedger
+size_t const LEDGER_NODE_BYTES = 64;
+}
+
+bool
+Floodgate::PeerSet::contains(size_t slot) const
+{
+    if (slot < 64)
+    {
+        return (mFirst >> slot) & 1;
+    }
+    auto i = slot / 64 - 1;
+    return i < mRest.size() && ((mRest[i] >> (slot % 64)) & 1);
+}
+
+void
+Floodgate::PeerSet::insert(size_t slot)
+{
+    if (slot < 64)
+    {
+        mFirst |= uint64_t(1) << slot;
+        return;
+    }
+    auto i = slot / 64 - 1;
+    if (i >= mRest.size())
+    {
+        mRest.resize(i + 1);
+    }
+    mRest[i] |= uint64_t(1) << (slot % 64);
+}
+
+void
+Floodgate::PeerSet::erase(size_t slot)
+{
+    if (slot < 64)
+    {
+        mFirst &= ~(uint64_t(1) << slot);
+        return;
+    }
+    auto i = slot / 64 - 1;
+    if (i < mRest.size())
+    {
+        mRest[i] &= ~(uint64_t(1) << (slot % 64));
+    }
+}
+
+size_t
+Floodgate::PeerSet::count() const
+{
+    size_t res = 0;
+    auto countBits = [&res](uint64_t bits) {
+        for (; bits != 0; bits &= bits - 1)
+        {
+            ++res;
+        }
+    };
+    countBits(mFirst);
+    for (auto bits : mRest)
+    {
+        countBits(bits);
+    }
+    return res;
+}
+
+size_t
+Floodgate::PeerSet::getExtraBytes() const
+{
+    return mRest.capacity() * sizeof(uint64_t);
+}
+
+bool
+FloodFilter::contains(Hash const& h) const
 {
-    if (peer)
-        mPeersTold.insert(peer);
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mHashes.find(h) != mHashes.end();
+}
+
+void
+FloodFilter::insert(Hash const& h)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mHashes.insert(h);
+}
+
+void
+FloodFilter::erase(std::vector<Hash> const& hashes)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (auto const& h : hashes)
+    {
+        mHashes.erase(h);
+    }
+}
+
+size_t
+FloodFilter::size() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mHashes.size();
+}
+
+void
+FloodFilter::clear()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mHashes.clear();
 }
 
 Floodgate::Floodgate(Application& app)
-    : mApp(app)
+    : mTransactionFilter(std::make_shared<FloodFilter>())
+    , mApp(app)
     , mFloodMapSize(
           app.getMetrics().NewCounter({"overlay", "memory", "flood-map"}))
     , mSendFromBroadcast(app.getMetrics().NewMeter(
@@ -34,23 +141,151 @@ Floodgate::Floodgate(Application& app)
 {
 }
 
+size_t
+Floodgate::indexOf(Hash const& h) const
+{
+    // the hash is already uniformly distributed
+    uint64_t res;
+    std::memcpy(&res, h.data(), sizeof(res));
+    return static_cast<size_t>(res) & (mRecords.size() - 1);
+}
+
+Floodgate::FloodRecord*
+Floodgate::find(Hash const& h)
+{
+    if (mRecords.empty())
+    {
+        return nullptr;
+    }
+    for (auto i = indexOf(h); mRecords[i].mUsed;
+         i = (i + 1) & (mRecords.size() - 1))
+    {
+        if (mRecords[i].mHash == h)
+        {
+            return &mRecords[i];
+        }
+    }
+    return nullptr;
+}
+
+Floodgate::FloodRecord&
+Floodgate::insert(Hash const& h, uint32_t ledgerSeq)
+{
+    if ((mSize + 1) * 2 > mRecords.size())
+    {
+        resize(std::max(MIN_CAPACITY, mRecords.size() * 2));
+    }
+    auto i = indexOf(h);
+    while (mRecords[i].mUsed)
+    {
+        i = (i + 1) & (mRecords.size() - 1);
+    }
+    auto& record = mRecords[i];
+    record.mHash = h;
+    record.mLedgerSeq = ledgerSeq;
+    record.mUsed = true;
+    ++mSize;
+    mByLedger[ledgerSeq].emplace_back(h);
+    return record;
+}
+
+void
+Floodgate::erase(Hash const& h)
+{
+    auto record = find(h);
+    if (!record)
+    {
+        return;
+    }
+    auto mask = mRecords.size() - 1;
+    size_t i = record - mRecords.data();
+    mPeerSetBytes -= record->mPeersTold.getExtraBytes();
+    mRecords[i] = FloodRecord();
+    --mSize;
+
+    // shift back the following records that can't be found anymore
+    for (auto j = (i + 1) & mask; mRecords[j].mUsed; j = (j + 1) & mask)
+    {
+        auto k = indexOf(mRecords[j].mHash);
+        bool inPlace = i <= j ? (i < k && k <= j) : (i < k || k <= j);
+        if (!inPlace)
+        {
+            mRecords[i] = std::move(mRecords[j]);
+            mRecords[j] = FloodRecord();
+            i = j;
+        }
+    }
+}
+
+void
+Floodgate::addPeerTold(FloodRecord& record, size_t slot)
+{
+    mPeerSetBytes -= record.mPeersTold.getExtraBytes();
+    record.mPeersTold.insert(slot);
+    mPeerSetBytes += record.mPeersTold.getExtraBytes();
+}
+
+void
+Floodgate::resize(size_t capacity)
+{
+    std::vector<FloodRecord> old(capacity);
+    old.swap(mRecords);
+    for (auto& record : old)
+    {
+        if (record.mUsed)
+        {
+            auto i = indexOf(record.mHash);
+            while (mRecords[i].mUsed)
+            {
+                i = (i + 1) & (mRecords.size() - 1);
+            }
+            mRecords[i] = std::move(record);
+        }
+    }
+}
+
+void
+Floodgate::updateSize()
+{
+    mFloodMapSize.set_count(getBytes());
+}
+
 // remove old flood records
 void
 Floodgate::clearBelow(uint32_t currentLedger)
 {
-    for (auto it = mFloodMap.cbegin(); it != mFloodMap.cend();)
+    for (auto it = mByLedger.begin();
+         it != mByLedger.end() && it->first + 10 < currentLedger;)
     {
-        // give one ledger of leeway
-        if (it->second->mLedgerSeq + 10 < currentLedger)
+        for (auto const& h : it->second)
         {
-            mFloodMap.erase(it++);
+            erase(h);
         }
-        else
+        mTransactionFilter->erase(it->second);
+        it = mByLedger.erase(it);
+    }
+    // peers demand transactions shortly after they were advertised
+    for (auto it = mAdvertisedByLedger.begin();
+         it != mAdvertisedByLedger.end() && it->first + 1 < currentLedger;)
+    {
+        for (auto const& h : it->second)
         {
-            ++it;
+            mAdvertised.erase(h);
         }
+        it = mAdvertisedByLedger.erase(it);
     }
-    mFloodMapSize.set_count(mFloodMap.size());
+
+    // give back memory after a flood
+    if (mRecords.size() > MIN_CAPACITY && mSize * 8 < mRecords.size())
+    {
+        auto capacity = MIN_CAPACITY;
+        while (capacity < mSize * 4)
+        {
+            capacity *= 2;
+        }
+        resize(capacity);
+    }
+    updateSize();
 }
 
 bool
@@ -61,19 +296,32 @@ Floodgate::addRecord(StellarMessage const& msg, Peer::pointer peer)
         return false;
     }
     Hash index = sha256(xdr::xdr_to_opaque(msg));
-    auto result = mFloodMap.find(index);
-    if (result == mFloodMap.end())
-    { // we have never seen this message
-        mFloodMap[index] = std::make_shared<FloodRecord>(
-            msg, mApp.getHerder().getCurrentLedgerSeq(), peer);
-        mFloodMapSize.set_count(mFloodMap.size());
-        return true;
+    if (msg.type() == TRANSACTION)
+    {
+        mTransactionFilter->insert(index);
     }
-    else
+    return addRecord(index, peer);
+}
+
+bool
+Floodgate::addRecord(Hash const& index, Peer::pointer peer)
+{
+    if (mShuttingDown)
     {
-        result->second->mPeersTold.insert(peer);
         return false;
     }
+    auto record = find(index);
+    bool res = !record;
+    if (!record)
+    { // we have never seen this message
+        record = &insert(index, mApp.getHerder().getCurrentLedgerSeq());
+    }
+    if (peer && peer->getSlot() != Peer::NO_SLOT)
+    {
+        addPeerTold(*record, peer->getSlot());
+    }
+    updateSize();
+    return res;
 }
 
 // send message to anyone you haven't gotten it from
@@ -84,19 +332,24 @@ Floodgate::broadcast(StellarMessage const& msg, bool force)
     {
         return;
     }
-    Hash index = sha256(xdr::xdr_to_opaque(msg));
+    // encoded and hashed once for all peers
+    auto encoded = std::make_shared<EncodedMessage>(msg);
+    Hash const& index = encoded->getHash();
     CLOG(TRACE, "Overlay") << "broadcast " << hexAbbrev(index);
 
-    auto result = mFloodMap.find(index);
-    if (result == mFloodMap.end() || force)
+    auto record = find(index);
+    if (!record)
     { // no one has sent us this message
-        FloodRecord::pointer record = std::make_shared<FloodRecord>(
-            msg, mApp.getHerder().getCurrentLedgerSeq(), Peer::pointer());
-        result = mFloodMap.insert(std::make_pair(index, record)).first;
-        mFloodMapSize.set_count(mFloodMap.size());
+        record = &insert(index, mApp.getHerder().getCurrentLedgerSeq());
+    }
+    // send it to people that haven't sent it to us, recording them first:
+    // `record` may move once sending gives back control
+    std::vector<Peer::pointer> toTell;
+    bool advertise = msg.type() == TRANSACTION;
+    if (advertise)
+    {
+        mTransactionFilter->insert(index);
     }
-    // send it to people that haven't sent it to us
-    std::set<Peer::pointer>& peersTold = result->second->mPeersTold;
 
     // make a copy, in case peers gets modified
     auto peers = mApp.getOverlayManager().getAuthenticatedPeers();
@@ -104,33 +357,104 @@ Floodgate::broadcast(StellarMessage const& msg, bool force)
     for (auto peer : peers)
     {
         assert(peer.second->isAuthenticated());
-        if (peersTold.find(peer.second) == peersTold.end())
+        auto slot = peer.second->getSlot();
+        if (slot != Peer::NO_SLOT && !record->mPeersTold.contains(slot))
         {
-            mSendFromBroadcast.Mark();
-            peer.second->sendMessage(msg);
-            peersTold.insert(peer.second);
+            addPeerTold(*record, slot);
+            toTell.emplace_back(peer.second);
         }
     }
     CLOG(TRACE, "Overlay") << "broadcast " << hexAbbrev(index) << " told "
-                           << peersTold.size();
+                           << record->mPeersTold.count();
+    updateSize();
+
+    for (auto const& peer : toTell)
+    {
+        mSendFromBroadcast.Mark();
+        if (advertise && peer->pullsTransactions())
+        {
+            if (mAdvertised.emplace(index, encoded).second)
+            {
+                auto ledgerSeq = mApp.getHerder().getCurrentLedgerSeq();
+                mAdvertisedByLedger[ledgerSeq].emplace_back(index);
+            }
+            peer->advertiseTransaction(index);
+        }
+        else
+        {
+            peer->sendMessage(encoded);
+        }
+    }
 }
 
 std::set<Peer::pointer>
 Floodgate::getPeersKnows(Hash const& h)
 {
     std::set<Peer::pointer> res;
-    auto record = mFloodMap.find(h);
-    if (record != mFloodMap.end())
+    auto record = find(h);
+    if (record)
     {
-        res = record->second->mPeersTold;
+        for (auto const& peer :
+             mApp.getOverlayManager().getAuthenticatedPeers())
+        {
+            auto slot = peer.second->getSlot();
+            if (slot != Peer::NO_SLOT && record->mPeersTold.contains(slot))
+            {
+                res.insert(peer.second);
+            }
+        }
     }
     return res;
 }
 
+std::shared_ptr<FloodFilter>
+Floodgate::getTransactionFilter() const
+{
+    return mTransactionFilter;
+}
+
+EncodedMessage::pointer
+Floodgate::getAdvertised(Hash const& h) const
+{
+    auto it = mAdvertised.find(h);
+    return it == mAdvertised.end() ? nullptr : it->second;
+}
+
+void
+Floodgate::forgetPeer(size_t slot)
+{
+    for (auto& record : mRecords)
+    {
+        if (record.mUsed)
+        {
+            record.mPeersTold.erase(slot);
+        }
+    }
+}
+
+size_t
+Floodgate::size() const
+{
+    return mSize;
+}
+
+size_t
+Floodgate::getBytes() const
+{
+    return mRecords.size() * sizeof(FloodRecord) + mPeerSetBytes +
+           mByLedger.size() * LEDGER_NODE_BYTES + mSize * sizeof(Hash);
+}
+
 void
 Floodgate::shutdown()
 {
     mShuttingDown = true;
-    mFloodMap.clear();
+    mRecords.clear();
+    mByLedger.clear();
+    mAdvertised.clear();
+    mAdvertisedByLedger.clear();
+    mTransactionFilter->clear();
+    mSize = 0;
+    mPeerSetBytes = 0;
 }
 }
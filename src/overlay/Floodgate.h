@@ -6,7 +6,13 @@
 
 #include "overlay/Peer.h"
 #include "overlay/StellarXDR.h"
+#include "util/HashOfHash.h"
 #include <map>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 /**
  * FloodGate keeps track of which peers have sent us which broadcast messages,
@@ -14,11 +20,24 @@
  * either send M to P once (and only once), or receive M _from_ P (thereby
  * inhibit sending M to P at all).
  *
- * The broadcast message types are TRANSACTION and SCP_MESSAGE.
+ * The broadcast message types are TRANSACTION and SCP_MESSAGE. Peers pulling
+ * transactions (see Peer::FIRST_OVERLAY_VERSION_WITH_TX_PULL) are only sent
+ * the hash of TRANSACTION messages (FLOOD_ADVERT), and the messages are kept
+ * until the ledger after next closes, for peers to demand them (FLOOD_DEMAND).
  *
  * All messages are marked with the ledger sequence number to which they
  * relate, and all flood-management information for a given ledger number
  * is purged from the FloodGate when the ledger closes.
+ *
+ * As there can be a lot of them, records are kept compact: they are stored
+ * in an open-addressing table indexed by the hash of the message (which is
+ * not retained), the peers are tracked as a bitset of their slots (see
+ * Peer::getSlot) and records are grouped by ledger so that expiring them
+ * only visits the expired ones.
+ *
+ * The hashes of the TRANSACTION messages we have are also kept in a
+ * FloodFilter, that peers check (from any thread) before decoding incoming
+ * messages: known transactions only need their sender recorded.
  */
 
 namespace medida
@@ -29,39 +48,97 @@ class Counter;
 namespace stellar
 {
 
+// thread safe set of message hashes
+class FloodFilter
+{
+    mutable std::mutex mMutex;
+    std::unordered_set<Hash> mHashes;
+
+  public:
+    bool contains(Hash const& h) const;
+    void insert(Hash const& h);
+    void erase(std::vector<Hash> const& hashes);
+    size_t size() const;
+    void clear();
+};
+
 class Floodgate
 {
-    class FloodRecord
+    // set of peer slots, with no allocation for the first 64 slots
+    class PeerSet
     {
-      public:
-        typedef std::shared_ptr<FloodRecord> pointer;
+        uint64_t mFirst{0};
+        std::vector<uint64_t> mRest;
 
-        uint32_t mLedgerSeq;
-        StellarMessage mMessage;
-        std::set<Peer::pointer> mPeersTold;
+      public:
+        bool contains(size_t slot) const;
+        void insert(size_t slot);
+        void erase(size_t slot);
+        size_t count() const;
+        size_t getExtraBytes() const;
+    };
 
-        FloodRecord(StellarMessage const& msg, uint32_t ledger,
-                    Peer::pointer peer);
+    struct FloodRecord
+    {
+        Hash mHash;
+        uint32_t mLedgerSeq{0};
+        bool mUsed{false};
+        PeerSet mPeersTold;
     };
 
-    std::map<uint256, FloodRecord::pointer> mFloodMap;
+    // open-addressing table with linear probing, at most half full
+    std::vector<FloodRecord> mRecords;
+    size_t mSize{0};
+    // memory used by the PeerSets beyond the records themselves
+    size_t mPeerSetBytes{0};
+    // hashes of the records, by ledger
+    std::map<uint32_t, std::vector<Hash>> mByLedger;
+    // advertised transactions, and their hashes by ledger
+    std::unordered_map<Hash, EncodedMessage::pointer> mAdvertised;
+    std::map<uint32_t, std::vector<Hash>> mAdvertisedByLedger;
+    // hashes of the TRANSACTION messages we have records of
+    std::shared_ptr<FloodFilter> mTransactionFilter;
+
     Application& mApp;
     medida::Counter& mFloodMapSize;
     medida::Meter& mSendFromBroadcast;
     bool mShuttingDown;
 
+    size_t indexOf(Hash const& h) const;
+    FloodRecord* find(Hash const& h);
+    FloodRecord& insert(Hash const& h, uint32_t ledgerSeq);
+    void erase(Hash const& h);
+    void addPeerTold(FloodRecord& record, size_t slot);
+    void resize(size_t capacity);
+    void updateSize();
+
   public:
     Floodgate(Application& app);
     // Floodgate will be cleared after every ledger close
     void clearBelow(uint32_t currentLedger);
     // returns true if this is a new record
     bool addRecord(StellarMessage const& msg, Peer::pointer fromPeer);
+    // same, for a message identified by its hash (as in FLOOD_ADVERT)
+    bool addRecord(Hash const& index, Peer::pointer fromPeer);
 
     void broadcast(StellarMessage const& msg, bool force);
 
     // returns the list of peers that sent us the item with hash `h`
     std::set<Peer::pointer> getPeersKnows(Hash const& h);
 
+    // hashes of the TRANSACTION messages that were received or broadcast
+    std::shared_ptr<FloodFilter> getTransactionFilter() const;
+
+    // returns the advertised TRANSACTION message with hash `h`, if any
+    EncodedMessage::pointer getAdvertised(Hash const& h) const;
+
+    // called when the slot of a dropped peer is released
+    void forgetPeer(size_t slot);
+
+    // number of records and estimate of the memory they use
+    size_t size() const;
+    size_t getBytes() const;
+
     void shutdown();
 };
 }
@@ -28,6 +28,9 @@
  *  - One-way broadcast messages informing other peers of an event:
  *    TRANSACTION and SCP_MESSAGE
  *
+ *  - Messages advertising transactions by hash, and demanding them:
+ *    FLOOD_ADVERT, FLOOD_DEMAND
+ *
  *  - Two-way anycast messages requesting a value (by hash) or providing it:
  *    GET_TX_SET, TX_SET, GET_SCP_QUORUMSET, SCP_QUORUMSET, GET_SCP_STATE
  *
@@ -37,7 +40,9 @@
  * flooded between peers.
  *
  * Broadcasts are initiated by the Herder and sent to both the Herder _and_ the
- * local FloodGate, for propagation to other peers.
+ * local FloodGate, for propagation to other peers. Peers that support it are
+ * only sent the hashes of transactions, and demand the ones they don't know
+ * through the TxPuller.
  *
  * The OverlayManager tracks its known peers in the Database and shares peer
  * records with other peers when asked.
@@ -46,10 +51,13 @@
 namespace stellar
 {
 
+class BatchVerifier;
+class FloodFilter;
 class PeerAuth;
 class PeerBareAddress;
 class PeerRecord;
 class LoadManager;
+class TxPuller;
 
 class OverlayManager
 {
@@ -76,6 +84,18 @@ class OverlayManager
     virtual void recvFloodedMsg(StellarMessage const& msg,
                                 Peer::pointer peer) = 0;
 
+    // Same as recvFloodedMsg, for a message a peer advertised by its hash.
+    // Returns true if the message was not known yet.
+    virtual bool recvFloodedHash(Hash const& h, Peer::pointer peer) = 0;
+
+    // Return the TRANSACTION message with hash `h` that was advertised to
+    // peers, or nullptr if it is unknown or too old.
+    virtual EncodedMessage::pointer getFloodedTransaction(Hash const& h) = 0;
+
+    // Return the hashes of the TRANSACTION messages we have, which can be
+    // checked from any thread.
+    virtual std::shared_ptr<FloodFilter> getTransactionFilter() = 0;
+
     // Return a list of random peers from the set of authenticated peers.
     virtual std::vector<Peer::pointer> getRandomAuthenticatedPeers() = 0;
 
@@ -134,6 +154,12 @@ class OverlayManager
     // Return the persistent peer-load-accounting cache.
     virtual LoadManager& getLoadManager() = 0;
 
+    // Return the verifier batching signature checks of flooded messages.
+    virtual BatchVerifier& getBatchVerifier() = 0;
+
+    // Return the demands of transactions advertised by peers.
+    virtual TxPuller& getTxPuller() = 0;
+
     // start up all background tasks for overlay
     virtual void start() = 0;
     // drops all connections
@@ -61,6 +61,8 @@ OverlayManagerImpl::OverlayManagerImpl(Application& app)
     : mApp(app)
     , mDoor(mApp)
     , mAuth(mApp)
+    , mBatchVerifier(mApp)
+    , mTxPuller(mApp)
     , mShuttingDown(false)
     , mMessagesReceived(app.getMetrics().NewMeter(
           {"overlay", "message", "flood-receive"}, "message"))
@@ -342,6 +344,10 @@ void
 OverlayManagerImpl::ledgerClosed(uint32_t lastClosedledgerSeq)
 {
     mFloodGate.clearBelow(lastClosedledgerSeq);
+    for (auto const& peer : mAuthenticatedPeers)
+    {
+        peer.second->ledgerClosed(lastClosedledgerSeq);
+    }
 }
 
 void
@@ -386,6 +392,7 @@ OverlayManagerImpl::dropPeer(Peer* peer)
         auto authentiatedIt = mAuthenticatedPeers.find(peer->getPeerID());
         if (authentiatedIt != std::end(mAuthenticatedPeers))
         {
+            releaseSlot(*authentiatedIt->second);
             mAuthenticatedPeers.erase(authentiatedIt);
         }
         else
@@ -420,10 +427,36 @@ OverlayManagerImpl::moveToAuthenticated(Peer::pointer peer)
 
     mPendingPeers.erase(pendingIt);
     mAuthenticatedPeers[peer->getPeerID()] = peer;
+    assignSlot(*peer);
     updateSizeCounters();
     return true;
 }
 
+void
+OverlayManagerImpl::assignSlot(Peer& peer)
+{
+    auto it = std::find(mUsedSlots.begin(), mUsedSlots.end(), false);
+    if (it == mUsedSlots.end())
+    {
+        it = mUsedSlots.insert(it, true);
+    }
+    *it = true;
+    peer.setSlot(it - mUsedSlots.begin());
+}
+
+void
+OverlayManagerImpl::releaseSlot(Peer& peer)
+{
+    auto slot = peer.getSlot();
+    if (slot != Peer::NO_SLOT)
+    {
+        // the next peer getting the slot must start with a clean record
+        mFloodGate.forgetPeer(slot);
+        mUsedSlots[slot] = false;
+        peer.setSlot(Peer::NO_SLOT);
+    }
+}
+
 bool
 OverlayManagerImpl::acceptAuthenticatedPeer(Peer::pointer peer)
 {
@@ -533,6 +566,24 @@ OverlayManagerImpl::recvFloodedMsg(StellarMessage const& msg,
     mFloodGate.addRecord(msg, peer);
 }
 
+bool
+OverlayManagerImpl::recvFloodedHash(Hash const& h, Peer::pointer peer)
+{
+    return mFloodGate.addRecord(h, peer);
+}
+
+EncodedMessage::pointer
+OverlayManagerImpl::getFloodedTransaction(Hash const& h)
+{
+    return mFloodGate.getAdvertised(h);
+}
+
+std::shared_ptr<FloodFilter>
+OverlayManagerImpl::getTransactionFilter()
+{
+    return mFloodGate.getTransactionFilter();
+}
+
 void
 OverlayManagerImpl::broadcastMessage(StellarMessage const& msg, bool force)
 {
@@ -564,6 +615,18 @@ OverlayManagerImpl::getLoadManager()
     return mLoad;
 }
 
+BatchVerifier&
+OverlayManagerImpl::getBatchVerifier()
+{
+    return mBatchVerifier;
+}
+
+TxPuller&
+OverlayManagerImpl::getTxPuller()
+{
+    return mTxPuller;
+}
+
 void
 OverlayManagerImpl::shutdown()
 {
@@ -574,6 +637,7 @@ OverlayManagerImpl::shutdown()
     mShuttingDown = true;
     mDoor.close();
     mFloodGate.shutdown();
+    mTxPuller.shutdown();
     auto pendingPeersToStop = mPendingPeers;
     for (auto& p : pendingPeersToStop)
     {
@@ -4,6 +4,7 @@
 // under the Apache License, Version 2.0. See the COPYING file at the root
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
+#include "BatchVerifier.h"
 #include "LoadManager.h"
 #include "Peer.h"
 #include "PeerAuth.h"
@@ -14,6 +15,7 @@
 #include "overlay/ItemFetcher.h"
 #include "overlay/OverlayManager.h"
 #include "overlay/StellarXDR.h"
+#include "overlay/TxPuller.h"
 #include "util/Timer.h"
 #include <set>
 #include <vector>
@@ -40,9 +42,13 @@ class OverlayManagerImpl : public OverlayManager
     std::vector<Peer::pointer> mPendingPeers;
     // authenticated and connected peers
     std::map<NodeID, Peer::pointer> mAuthenticatedPeers;
+    // slots of authenticated peers in use (see Peer::getSlot)
+    std::vector<bool> mUsedSlots;
     PeerDoor mDoor;
     PeerAuth mAuth;
     LoadManager mLoad;
+    BatchVerifier mBatchVerifier;
+    TxPuller mTxPuller;
     bool mShuttingDown;
 
     medida::Meter& mMessagesReceived;
@@ -71,6 +77,9 @@ class OverlayManagerImpl : public OverlayManager
 
     void ledgerClosed(uint32_t lastClosedledgerSeq) override;
     void recvFloodedMsg(StellarMessage const& msg, Peer::pointer peer) override;
+    bool recvFloodedHash(Hash const& h, Peer::pointer peer) override;
+    EncodedMessage::pointer getFloodedTransaction(Hash const& h) override;
+    std::shared_ptr<FloodFilter> getTransactionFilter() override;
     void broadcastMessage(StellarMessage const& msg,
                           bool force = false) override;
     void connectTo(std::string const& addr) override;
@@ -98,6 +107,8 @@ class OverlayManagerImpl : public OverlayManager
     PeerAuth& getPeerAuth() override;
 
     LoadManager& getLoadManager() override;
+    BatchVerifier& getBatchVerifier() override;
+    TxPuller& getTxPuller() override;
 
     void start() override;
     void shutdown() override;
@@ -110,6 +121,8 @@ class OverlayManagerImpl : public OverlayManager
 
     void orderByPreferredPeers(vector<PeerRecord>& peers);
     bool moveToAuthenticated(Peer::pointer peer);
+    void assignSlot(Peer& peer);
+    void releaseSlot(Peer& peer);
     void updateSizeCounters();
 };
 }
@@ -7,6 +7,7 @@
 #include "main/Config.h"
 
 #include "database/Database.h"
+#include "herder/Herder.h"
 #include "lib/catch.hpp"
 #include "overlay/OverlayManager.h"
 #include "overlay/OverlayManagerImpl.h"
@@ -178,6 +179,51 @@ class OverlayManagerTests
         vector<int> expectedFinal{2, 2, 1, 2, 2};
         REQUIRE(sentCounts(pm) == expectedFinal);
     }
+
+    void
+    test_floodgate()
+    {
+        OverlayManagerStub& pm = app->getOverlayManager();
+
+        pm.storePeerList(fourPeers, false, false);
+        pm.storePeerList(threePeers, false, false);
+        pm.tick();
+        REQUIRE(pm.mAuthenticatedPeers.size() == 5);
+
+        auto a = TestAccount{*app, getAccount("a")};
+        auto b = TestAccount{*app, getAccount("b")};
+        std::vector<StellarMessage> msgs;
+        for (int i = 0; i < 200; i++)
+        {
+            msgs.emplace_back(a.tx({payment(b, i + 1)})->toStellarMessage());
+            pm.broadcastMessage(msgs.back());
+        }
+        REQUIRE(pm.mFloodGate.size() == 200);
+        auto bytes = pm.mFloodGate.getBytes();
+        REQUIRE(bytes > 200 * sizeof(Hash));
+
+        // a peer taking the slot of a dropped one gets all messages again
+        auto dropped = pm.mAuthenticatedPeers.begin()->second;
+        auto slot = dropped->getSlot();
+        pm.dropPeer(dropped.get());
+        REQUIRE(dropped->getSlot() == Peer::NO_SLOT);
+
+        auto peer = std::make_shared<PeerStub>(
+            *app, PeerBareAddress{"127.0.0.1", 2011});
+        pm.addPendingPeer(peer);
+        REQUIRE(pm.acceptAuthenticatedPeer(peer));
+        REQUIRE(peer->getSlot() == slot);
+        pm.broadcastMessage(msgs.front());
+        REQUIRE(peer->sent == 1);
+        REQUIRE(pm.mFloodGate.size() == 200);
+
+        auto ledger = app->getHerder().getCurrentLedgerSeq();
+        pm.mFloodGate.clearBelow(ledger + 10);
+        REQUIRE(pm.mFloodGate.size() == 200);
+        pm.mFloodGate.clearBelow(ledger + 11);
+        REQUIRE(pm.mFloodGate.size() == 0);
+        REQUIRE(pm.mFloodGate.getBytes() < bytes / 4);
+    }
 };
 
 TEST_CASE_METHOD(OverlayManagerTests, "addPeerList() adds", "[overlay]")
@@ -189,4 +235,10 @@ TEST_CASE_METHOD(OverlayManagerTests, "broadcast() broadcasts", "[overlay]")
 {
     test_broadcast();
 }
+
+TEST_CASE_METHOD(OverlayManagerTests, "flood map tracks peer slots",
+                 "[overlay][floodgate]")
+{
+    test_floodgate();
+}
 }
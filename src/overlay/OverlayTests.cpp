@@ -4,7 +4,9 @@
 
 #include "BanManager.h"
 #include "crypto/KeyUtils.h"
+#include "crypto/SHA.h"
 #include "crypto/SecretKey.h"
+#include "ledger/LedgerManager.h"
 #include "lib/catch.hpp"
 #include "main/Application.h"
 #include "main/Config.h"
@@ -23,6 +25,7 @@
 #include "medida/metrics_registry.h"
 #include "medida/timer.h"
 #include "util/format.h"
+#include "xdrpp/marshal.h"
 #include <numeric>
 
 using namespace stellar;
@@ -313,6 +316,126 @@ TEST_CASE("reject peers with incompatible overlay versions", "[overlay]")
     }
 }
 
+TEST_CASE("flow control throttles transactions", "[overlay][flowcontrol]")
+{
+    VirtualClock clock;
+    Config const& cfg1 = getTestConfig(0);
+    Config cfg2 = getTestConfig(1);
+    cfg2.PEER_FLOOD_READING_CAPACITY = 2;
+    cfg2.FLOW_CONTROL_SEND_MORE_BATCH_SIZE = 1;
+
+    auto sendTransactions = [](Peer::pointer peer) {
+        StellarMessage msg;
+        msg.type(TRANSACTION);
+        for (int i = 0; i < 10; i++)
+        {
+            msg.transaction().tx.seqNum = i;
+            peer->sendMessage(msg);
+        }
+    };
+    auto received = [](Application& app) {
+        return app.getMetrics()
+            .NewTimer({"overlay", "recv", "transaction"})
+            .count();
+    };
+
+    SECTION("with an older peer")
+    {
+        cfg2.OVERLAY_PROTOCOL_VERSION =
+            Peer::FIRST_OVERLAY_VERSION_WITH_FLOW_CONTROL - 1;
+        auto app1 = createTestApplication(clock, cfg1);
+        auto app2 = createTestApplication(clock, cfg2);
+        LoopbackPeerConnection conn(*app1, *app2);
+        testutil::crankSome(clock);
+        REQUIRE(conn.getInitiator()->isAuthenticated());
+        REQUIRE(!conn.getInitiator()->isFlowControlled());
+        REQUIRE(!conn.getAcceptor()->isFlowControlled());
+
+        sendTransactions(conn.getInitiator());
+        REQUIRE(conn.getInitiator()->getOutboundQueueStats().mMessages == 0);
+        testutil::crankSome(clock);
+        REQUIRE(received(*app2) == 10);
+    }
+
+    SECTION("with a peer using it")
+    {
+        auto app1 = createTestApplication(clock, cfg1);
+        auto app2 = createTestApplication(clock, cfg2);
+        LoopbackPeerConnection conn(*app1, *app2);
+        testutil::crankSome(clock);
+        auto initiator = conn.getInitiator();
+        REQUIRE(initiator->isAuthenticated());
+        REQUIRE(initiator->isFlowControlled());
+        REQUIRE(conn.getAcceptor()->isFlowControlled());
+
+        // only the two transactions app2 asked for are sent right away
+        sendTransactions(initiator);
+        REQUIRE(initiator->getOutboundQueueStats().mMessages == 8);
+
+        SECTION("the rest once app2 processed them")
+        {
+            testutil::crankSome(clock);
+            REQUIRE(initiator->isConnected());
+            REQUIRE(initiator->getOutboundQueueStats().mMessages == 0);
+            REQUIRE(received(*app2) == 10);
+            // one SEND_MORE after the handshake, then one per transaction
+            REQUIRE(app2->getMetrics()
+                        .NewMeter({"overlay", "send", "send-more"}, "message")
+                        .count() == 11);
+        }
+
+        SECTION("unless a ledger closed meanwhile")
+        {
+            initiator->ledgerClosed(
+                app1->getLedgerManager().getLastClosedLedgerNum() + 1);
+            auto stats = initiator->getOutboundQueueStats();
+            REQUIRE(stats.mMessages == 0);
+            REQUIRE(stats.mBytes == 0);
+            REQUIRE(stats.mDroppedMessages == 8);
+            testutil::crankSome(clock);
+            REQUIRE(initiator->isConnected());
+            REQUIRE(received(*app2) == 2);
+        }
+    }
+}
+
+TEST_CASE("known transactions are not decoded", "[overlay]")
+{
+    VirtualClock clock;
+    Config const& cfg1 = getTestConfig(0);
+    Config const& cfg2 = getTestConfig(1);
+    auto app1 = createTestApplication(clock, cfg1);
+    auto app2 = createTestApplication(clock, cfg2);
+    LoopbackPeerConnection conn(*app1, *app2);
+    testutil::crankSome(clock);
+    REQUIRE(conn.getInitiator()->isAuthenticated());
+
+    StellarMessage known;
+    known.type(TRANSACTION);
+    known.transaction().tx.seqNum = 1;
+    StellarMessage unknown = known;
+    unknown.transaction().tx.seqNum = 2;
+    app2->getOverlayManager().recvFloodedMsg(known, nullptr);
+
+    conn.getInitiator()->sendMessage(known);
+    conn.getInitiator()->sendMessage(unknown);
+    conn.getInitiator()->sendMessage(known);
+    testutil::crankSome(clock);
+
+    REQUIRE(conn.getAcceptor()->isAuthenticated());
+    REQUIRE(app2->getMetrics()
+                .NewMeter({"overlay", "message", "decode-skipped"}, "message")
+                .count() == 2);
+    REQUIRE(app2->getMetrics()
+                .NewTimer({"overlay", "recv", "transaction"})
+                .count() == 1);
+    // the sender was recorded all the same
+    auto peers = app2->getOverlayManager().getPeersKnows(
+        sha256(xdr::xdr_to_opaque(known)));
+    REQUIRE(peers.size() == 1);
+    REQUIRE(*peers.begin() == conn.getAcceptor());
+}
+
 TEST_CASE("reject peers who don't handshake quickly", "[overlay]")
 {
     auto test = [](unsigned short authenticationTimeout) {
@@ -5,6 +5,7 @@
 #include "overlay/Peer.h"
 
 #include "BanManager.h"
+#include "crypto/ByteSlice.h"
 #include "crypto/Hex.h"
 #include "crypto/Random.h"
 #include "crypto/SHA.h"
@@ -14,11 +15,14 @@
 #include "ledger/LedgerManager.h"
 #include "main/Application.h"
 #include "main/Config.h"
+#include "overlay/BatchVerifier.h"
+#include "overlay/Floodgate.h"
 #include "overlay/LoadManager.h"
 #include "overlay/OverlayManager.h"
 #include "overlay/PeerAuth.h"
 #include "overlay/PeerRecord.h"
 #include "overlay/StellarXDR.h"
+#include "overlay/TxPuller.h"
 #include "util/Logging.h"
 #include "util/XDROperators.h"
 
@@ -40,6 +44,8 @@ namespace stellar
 using namespace std;
 using namespace soci;
 
+size_t const Peer::NO_SLOT;
+
 medida::Meter&
 Peer::getByteReadMeter(Application& app)
 {
@@ -56,6 +62,7 @@ Peer::Peer(Application& app, PeerRole role)
     : mApp(app)
     , mRole(role)
     , mState(role == WE_CALLED_REMOTE ? CONNECTING : CONNECTED)
+    , mAdvertTimer(app)
     , mRemoteOverlayVersion(0)
     , mIdleTimer(app)
     , mLastRead(app.getClock().now())
@@ -73,6 +80,8 @@ Peer::Peer(Application& app, PeerRole role)
           app.getMetrics().NewMeter({"overlay", "error", "write"}, "error"))
     , mTimeoutIdle(
           app.getMetrics().NewMeter({"overlay", "timeout", "idle"}, "timeout"))
+    , mDecodeSkipped(app.getMetrics().NewMeter(
+          {"overlay", "message", "decode-skipped"}, "message"))
 
     , mRecvErrorTimer(app.getMetrics().NewTimer({"overlay", "recv", "error"}))
     , mRecvHelloTimer(app.getMetrics().NewTimer({"overlay", "recv", "hello"}))
@@ -95,6 +104,12 @@ Peer::Peer(Application& app, PeerRole role)
           app.getMetrics().NewTimer({"overlay", "recv", "scp-message"}))
     , mRecvGetSCPStateTimer(
           app.getMetrics().NewTimer({"overlay", "recv", "get-scp-state"}))
+    , mRecvSendMoreTimer(
+          app.getMetrics().NewTimer({"overlay", "recv", "send-more"}))
+    , mRecvFloodAdvertTimer(
+          app.getMetrics().NewTimer({"overlay", "recv", "flood-advert"}))
+    , mRecvFloodDemandTimer(
+          app.getMetrics().NewTimer({"overlay", "recv", "flood-demand"}))
 
     , mRecvSCPPrepareTimer(
           app.getMetrics().NewTimer({"overlay", "recv", "scp-prepare"}))
@@ -131,6 +146,14 @@ Peer::Peer(Application& app, PeerRole role)
           {"overlay", "send", "scp-message"}, "message"))
     , mSendGetSCPStateMeter(app.getMetrics().NewMeter(
           {"overlay", "send", "get-scp-state"}, "message"))
+    , mSendSendMoreMeter(app.getMetrics().NewMeter(
+          {"overlay", "send", "send-more"}, "message"))
+    , mSendFloodAdvertMeter(app.getMetrics().NewMeter(
+          {"overlay", "send", "flood-advert"}, "message"))
+    , mSendFloodDemandMeter(app.getMetrics().NewMeter(
+          {"overlay", "send", "flood-demand"}, "message"))
+    , mOutboundQueueDropMeter(app.getMetrics().NewMeter(
+          {"overlay", "outbound-queue", "drop"}, "message"))
     , mDropInConnectHandlerMeter(app.getMetrics().NewMeter(
           {"overlay", "drop", "connect-handler"}, "drop"))
     , mDropInRecvMessageDecodeMeter(app.getMetrics().NewMeter(
@@ -165,11 +188,60 @@ Peer::Peer(Application& app, PeerRole role)
           {"overlay", "drop", "recv-auth-invalid-peer"}, "drop"))
     , mDropInRecvErrorMeter(
           app.getMetrics().NewMeter({"overlay", "drop", "recv-error"}, "drop"))
+    , mDropInRecvFloodCapacityMeter(app.getMetrics().NewMeter(
+          {"overlay", "drop", "recv-flood-capacity"}, "drop"))
+    , mDropInRecvSendMoreUnexpectedMeter(app.getMetrics().NewMeter(
+          {"overlay", "drop", "recv-send-more-unexpected"}, "drop"))
+    , mDropInRecvTxPullUnexpectedMeter(app.getMetrics().NewMeter(
+          {"overlay", "drop", "recv-tx-pull-unexpected"}, "drop"))
 {
     auto bytes = randomBytes(mSendNonce.size());
     std::copy(bytes.begin(), bytes.end(), mSendNonce.begin());
 }
 
+bool
+Peer::isKnownTransaction(ByteSlice const& body, FloodFilter const& filter,
+                         HmacSha256Key const& macKey, uint64_t& sequence,
+                         Hash& hash)
+{
+    // an AuthenticatedMessage is made of its discriminant, the sequence
+    // number, the StellarMessage (starting with its type) and the MAC
+    size_t const headerSize = 4 + 8;
+    size_t const macSize = 32;
+    if (body.size() < headerSize + 4 + macSize)
+    {
+        return false;
+    }
+    auto data = body.data();
+    auto readUint32 = [](unsigned char const* p) {
+        return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) |
+               (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+    };
+    if (readUint32(data) != 0 || readUint32(data + headerSize) != TRANSACTION)
+    {
+        return false;
+    }
+
+    // flood records are keyed by the hash of the StellarMessage
+    auto messageSize = body.size() - headerSize - macSize;
+    hash = sha256(ByteSlice(data + headerSize, messageSize));
+    if (!filter.contains(hash))
+    {
+        return false;
+    }
+
+    HmacSha256Mac mac;
+    std::copy(data + headerSize + messageSize, data + body.size(),
+              mac.mac.begin());
+    if (!hmacSha256Verify(mac, macKey,
+                          ByteSlice(data + 4, headerSize - 4 + messageSize)))
+    {
+        return false;
+    }
+    sequence = (uint64_t(readUint32(data + 4)) << 32) | readUint32(data + 8);
+    return true;
+}
+
 void
 Peer::sendHello()
 {
@@ -407,6 +479,74 @@ Peer::sendPeers()
     sendMessage(newMsg);
 }
 
+void
+Peer::sendSendMore(uint32_t numMessages)
+{
+    StellarMessage newMsg;
+    newMsg.type(SEND_MORE);
+    newMsg.sendMoreMessage().numMessages = numMessages;
+
+    sendMessage(newMsg);
+}
+
+void
+Peer::advertiseTransaction(Hash const& h)
+{
+    mAdvertsToSend.emplace_back(h);
+    if (mAdvertsToSend.size() >= TX_ADVERT_VECTOR_MAX_SIZE)
+    {
+        sendAdverts();
+    }
+    else if (mAdvertsToSend.size() == 1)
+    {
+        std::weak_ptr<Peer> weak = shared_from_this();
+        mAdvertTimer.expires_from_now(mApp.getConfig().FLOOD_ADVERT_PERIOD_MS);
+        mAdvertTimer.async_wait(
+            [weak]() {
+                if (auto self = weak.lock())
+                {
+                    self->sendAdverts();
+                }
+            },
+            VirtualTimer::onFailureNoop);
+    }
+}
+
+void
+Peer::sendAdverts()
+{
+    mAdvertTimer.cancel();
+    if (mAdvertsToSend.empty() || shouldAbort())
+    {
+        mAdvertsToSend.clear();
+        return;
+    }
+
+    StellarMessage newMsg;
+    newMsg.type(FLOOD_ADVERT);
+    newMsg.floodAdvert().txHashes.assign(mAdvertsToSend.begin(),
+                                         mAdvertsToSend.end());
+    mAdvertsToSend.clear();
+
+    sendMessage(newMsg);
+}
+
+void
+Peer::sendFloodDemand(std::vector<Hash> const& hashes)
+{
+    for (size_t i = 0; i < hashes.size(); i += TX_DEMAND_VECTOR_MAX_SIZE)
+    {
+        auto end = std::min<size_t>(hashes.size(),
+                                    i + TX_DEMAND_VECTOR_MAX_SIZE);
+        StellarMessage newMsg;
+        newMsg.type(FLOOD_DEMAND);
+        newMsg.floodDemand().txHashes.assign(hashes.begin() + i,
+                                             hashes.begin() + end);
+
+        sendMessage(newMsg);
+    }
+}
+
 static std::string
 msgSummary(StellarMessage const& msg)
 {
@@ -451,6 +591,12 @@ msgSummary(StellarMessage const& msg)
         }
     case GET_SCP_STATE:
         return "GET_SCP_STATE";
+    case SEND_MORE:
+        return "SEND_MORE";
+    case FLOOD_ADVERT:
+        return "FLOOD_ADVERT";
+    case FLOOD_DEMAND:
+        return "FLOOD_DEMAND";
     }
     return "UNKNOWN";
 }
@@ -458,6 +604,13 @@ msgSummary(StellarMessage const& msg)
 void
 Peer::sendMessage(StellarMessage const& msg)
 {
+    sendMessage(std::make_shared<EncodedMessage>(msg));
+}
+
+void
+Peer::sendMessage(std::shared_ptr<EncodedMessage const> const& encoded)
+{
+    auto const& msg = encoded->getMessage();
     if (Logging::logTrace("Overlay"))
         CLOG(TRACE, "Overlay")
             << "("
@@ -507,18 +660,104 @@ Peer::sendMessage(StellarMessage const& msg)
     case GET_SCP_STATE:
         mSendGetSCPStateMeter.Mark();
         break;
+    case SEND_MORE:
+        mSendSendMoreMeter.Mark();
+        break;
+    case FLOOD_ADVERT:
+        mSendFloodAdvertMeter.Mark();
+        break;
+    case FLOOD_DEMAND:
+        mSendFloodDemandMeter.Mark();
+        break;
     };
 
-    AuthenticatedMessage amsg;
-    amsg.v0().message = msg;
-    if (msg.type() != HELLO && msg.type() != ERROR_MSG)
+    queueMessage(encoded);
+}
+
+void
+Peer::queueMessage(std::shared_ptr<EncodedMessage const> const& encoded)
+{
+    if (mFlowControl && encoded->getMessage().type() == TRANSACTION)
+    {
+        if (mOutboundCredits == 0 || !mHeldTransactions.empty())
+        {
+            mHeldTransactions.emplace_back(
+                encoded, mApp.getLedgerManager().getLastClosedLedgerNum());
+            ++mOutboundStats.mMessages;
+            mOutboundStats.mBytes += encoded->getBody().size();
+            // the oldest transactions are the least likely to still be
+            // useful to the peer
+            while (mOutboundStats.mBytes >
+                       mApp.getConfig().OUTBOUND_TX_QUEUE_BYTE_LIMIT &&
+                   mHeldTransactions.size() > 1)
+            {
+                auto size = mHeldTransactions.front().first->getBody().size();
+                mHeldTransactions.pop_front();
+                --mOutboundStats.mMessages;
+                mOutboundStats.mBytes -= size;
+                ++mOutboundStats.mDroppedMessages;
+                mOutboundStats.mDroppedBytes += size;
+                mOutboundQueueDropMeter.Mark();
+            }
+            return;
+        }
+        --mOutboundCredits;
+    }
+    frameMessage(encoded);
+}
+
+void
+Peer::addOutboundCredits(uint32_t numMessages)
+{
+    mOutboundCredits += numMessages;
+    while (mOutboundCredits > 0 && !mHeldTransactions.empty())
+    {
+        auto encoded = mHeldTransactions.front().first;
+        mHeldTransactions.pop_front();
+        --mOutboundStats.mMessages;
+        mOutboundStats.mBytes -= encoded->getBody().size();
+        --mOutboundCredits;
+        frameMessage(encoded);
+    }
+}
+
+void
+Peer::ledgerClosed(uint32_t lastClosedLedgerSeq)
+{
+    // transactions are queued in order, so the stale ones come first
+    while (!mHeldTransactions.empty() &&
+           mHeldTransactions.front().second < lastClosedLedgerSeq)
+    {
+        auto size = mHeldTransactions.front().first->getBody().size();
+        mHeldTransactions.pop_front();
+        --mOutboundStats.mMessages;
+        mOutboundStats.mBytes -= size;
+        ++mOutboundStats.mDroppedMessages;
+        mOutboundStats.mDroppedBytes += size;
+        mOutboundQueueDropMeter.Mark();
+    }
+}
+
+Peer::OutboundQueueStats
+Peer::getOutboundQueueStats() const
+{
+    return mOutboundStats;
+}
+
+void
+Peer::frameMessage(std::shared_ptr<EncodedMessage const> const& encoded)
+{
+    auto type = encoded->getMessage().type();
+    xdr::msg_ptr xdrBytes;
+    if (type != HELLO && type != ERROR_MSG)
     {
-        amsg.v0().sequence = mSendMacSeq;
-        amsg.v0().mac =
-            hmacSha256(mSendMacKey, xdr::xdr_to_opaque(mSendMacSeq, msg));
+        xdrBytes = encoded->toAuthenticatedMessage(mSendMacSeq, &mSendMacKey);
         ++mSendMacSeq;
     }
-    xdr::msg_ptr xdrBytes(xdr::xdr_to_msg(amsg));
+    else
+    {
+        xdrBytes = encoded->toAuthenticatedMessage(0, nullptr);
+    }
     this->sendMessage(std::move(xdrBytes));
 }
 
@@ -533,6 +772,19 @@ Peer::recvMessage(xdr::msg_ptr const& msg)
     LoadManager::PeerContext loadCtx(mApp, mPeerID);
 
     CLOG(TRACE, "Overlay") << "received xdr::msg_ptr";
+
+    if (isAuthenticated())
+    {
+        uint64_t sequence;
+        Hash hash;
+        auto filter = mApp.getOverlayManager().getTransactionFilter();
+        if (isKnownTransaction(msg, *filter, mRecvMacKey, sequence, hash))
+        {
+            recvKnownTransaction(sequence, hash);
+            return;
+        }
+    }
+
     try
     {
         AuthenticatedMessage am;
@@ -567,7 +819,7 @@ Peer::shouldAbort() const
 }
 
 void
-Peer::recvMessage(AuthenticatedMessage const& msg)
+Peer::recvMessage(AuthenticatedMessage const& msg, bool macVerified)
 {
     if (shouldAbort())
     {
@@ -576,16 +828,13 @@ Peer::recvMessage(AuthenticatedMessage const& msg)
 
     if (mState >= GOT_HELLO && msg.v0().message.type() != ERROR_MSG)
     {
-        if (msg.v0().sequence != mRecvMacSeq)
+        if (!checkRecvSequence(msg.v0().sequence))
         {
-            CLOG(ERROR, "Overlay") << "Unexpected message-auth sequence";
-            mDropInRecvMessageSeqMeter.Mark();
-            ++mRecvMacSeq;
-            drop(ERR_AUTH, "unexpected auth sequence");
             return;
         }
 
-        if (!hmacSha256Verify(
+        if (!macVerified &&
+            !hmacSha256Verify(
                 msg.v0().mac, mRecvMacKey,
                 xdr::xdr_to_opaque(msg.v0().sequence, msg.v0().message)))
         {
@@ -600,6 +849,68 @@ Peer::recvMessage(AuthenticatedMessage const& msg)
     recvMessage(msg.v0().message);
 }
 
+void
+Peer::recvKnownTransaction(uint64_t sequence, Hash const& h)
+{
+    if (shouldAbort())
+    {
+        return;
+    }
+
+    LoadManager::PeerContext loadCtx(mApp, mPeerID);
+
+    if (!checkRecvSequence(sequence))
+    {
+        return;
+    }
+    ++mRecvMacSeq;
+
+    if (!isAuthenticated())
+    {
+        CLOG(WARNING, "Overlay")
+            << "recv: " << TRANSACTION << " before completed handshake";
+        mDropInRecvMessageUnauthMeter.Mark();
+        drop();
+        return;
+    }
+    if (!checkFloodCapacity())
+    {
+        return;
+    }
+
+    mDecodeSkipped.Mark();
+    mApp.getOverlayManager().recvFloodedHash(h, shared_from_this());
+    floodMessageProcessed();
+}
+
+bool
+Peer::checkRecvSequence(uint64_t sequence)
+{
+    if (sequence != mRecvMacSeq)
+    {
+        CLOG(ERROR, "Overlay") << "Unexpected message-auth sequence";
+        mDropInRecvMessageSeqMeter.Mark();
+        ++mRecvMacSeq;
+        drop(ERR_AUTH, "unexpected auth sequence");
+        return false;
+    }
+    return true;
+}
+
+bool
+Peer::checkFloodCapacity()
+{
+    if (mFlowControl && mFloodCapacity == 0)
+    {
+        CLOG(WARNING, "Overlay")
+            << "peer sent more transactions than it was asked for";
+        mDropInRecvFloodCapacityMeter.Mark();
+        drop(ERR_MISC, "unexpected flood message, peer at capacity");
+        return false;
+    }
+    return true;
+}
+
 void
 Peer::recvMessage(StellarMessage const& stellarMsg)
 {
@@ -689,8 +1000,15 @@ Peer::recvMessage(StellarMessage const& stellarMsg)
 
     case TRANSACTION:
     {
-        auto t = mRecvTransactionTimer.TimeScope();
-        recvTransaction(stellarMsg);
+        if (!checkFloodCapacity())
+        {
+            return;
+        }
+        {
+            auto t = mRecvTransactionTimer.TimeScope();
+            recvTransaction(stellarMsg);
+        }
+        floodMessageProcessed();
     }
     break;
 
@@ -721,12 +1039,40 @@ Peer::recvMessage(StellarMessage const& stellarMsg)
         recvGetSCPState(stellarMsg);
     }
     break;
+
+    case SEND_MORE:
+    {
+        auto t = mRecvSendMoreTimer.TimeScope();
+        recvSendMore(stellarMsg);
+    }
+    break;
+
+    case FLOOD_ADVERT:
+    {
+        auto t = mRecvFloodAdvertTimer.TimeScope();
+        recvFloodAdvert(stellarMsg);
+    }
+    break;
+
+    case FLOOD_DEMAND:
+    {
+        auto t = mRecvFloodDemandTimer.TimeScope();
+        recvFloodDemand(stellarMsg);
+    }
+    break;
     }
 }
 
 void
 Peer::recvDontHave(StellarMessage const& msg)
 {
+    if (msg.dontHave().type == TRANSACTION)
+    {
+        // answer to a FLOOD_DEMAND
+        mApp.getOverlayManager().getTxPuller().doesntHave(
+            shared_from_this(), msg.dontHave().reqHash);
+        return;
+    }
     mApp.getHerder().peerDoesntHave(msg.dontHave().type, msg.dontHave().reqHash,
                                     shared_from_this());
 }
@@ -759,25 +1105,46 @@ Peer::recvTxSet(StellarMessage const& msg)
 void
 Peer::recvTransaction(StellarMessage const& msg)
 {
+    auto& puller = mApp.getOverlayManager().getTxPuller();
+    if (puller.size() != 0)
+    {
+        puller.received(sha256(xdr::xdr_to_opaque(msg)));
+    }
+
     TransactionFramePtr transaction = TransactionFrame::makeTransactionFromWire(
         mApp.getNetworkID(), msg.transaction());
     if (transaction)
     {
-        // add it to our current set
-        // and make sure it is valid
-        auto recvRes = mApp.getHerder().recvTransaction(transaction);
+        // signatures get verified along with the ones of other messages
+        // received meanwhile, before the transaction gets processed
+        std::vector<PubKeyUtils::SignatureToVerify> sigs;
+        transaction->getSignaturesToVerify(mApp.getDatabase(), sigs);
+        auto self = shared_from_this();
+        mApp.getOverlayManager().getBatchVerifier().add(
+            std::move(sigs), [self, msg, transaction]() {
+                self->processTransaction(msg, transaction);
+            });
+    }
+}
 
-        if (recvRes == Herder::TX_STATUS_PENDING ||
-            recvRes == Herder::TX_STATUS_DUPLICATE)
-        {
-            // record that this peer sent us this transaction
-            mApp.getOverlayManager().recvFloodedMsg(msg, shared_from_this());
+void
+Peer::processTransaction(StellarMessage const& msg,
+                         std::shared_ptr<TransactionFrame> transaction)
+{
+    // add it to our current set
+    // and make sure it is valid
+    auto recvRes = mApp.getHerder().recvTransaction(transaction);
 
-            if (recvRes == Herder::TX_STATUS_PENDING)
-            {
-                // if it's a new transaction, broadcast it
-                mApp.getOverlayManager().broadcastMessage(msg);
-            }
+    if (recvRes == Herder::TX_STATUS_PENDING ||
+        recvRes == Herder::TX_STATUS_DUPLICATE)
+    {
+        // record that this peer sent us this transaction
+        mApp.getOverlayManager().recvFloodedMsg(msg, shared_from_this());
+
+        if (recvRes == Herder::TX_STATUS_PENDING)
+        {
+            // if it's a new transaction, broadcast it
+            mApp.getOverlayManager().broadcastMessage(msg);
         }
     }
 }
@@ -818,7 +1185,22 @@ Peer::recvSCPMessage(StellarMessage const& msg)
 
     mApp.getOverlayManager().recvFloodedMsg(msg, shared_from_this());
 
-    auto type = msg.envelope().statement.pledges.type();
+    // same data as checked by HerderSCPDriver::verifyEnvelope
+    std::vector<PubKeyUtils::SignatureToVerify> sigs;
+    sigs.emplace_back(PubKeyUtils::SignatureToVerify{
+        envelope.statement.nodeID, envelope.signature,
+        xdr::xdr_to_opaque(mApp.getNetworkID(), ENVELOPE_TYPE_SCP,
+                           envelope.statement)});
+    auto self = shared_from_this();
+    mApp.getOverlayManager().getBatchVerifier().add(
+        std::move(sigs),
+        [self, envelope]() { self->processSCPEnvelope(envelope); });
+}
+
+void
+Peer::processSCPEnvelope(SCPEnvelope const& envelope)
+{
+    auto type = envelope.statement.pledges.type();
     auto t = (type == SCP_ST_PREPARE
                   ? mRecvSCPPrepareTimer.TimeScope()
                   : (type == SCP_ST_CONFIRM
@@ -838,6 +1220,91 @@ Peer::recvGetSCPState(StellarMessage const& msg)
     mApp.getHerder().sendSCPStateToPeer(seq, shared_from_this());
 }
 
+void
+Peer::recvSendMore(StellarMessage const& msg)
+{
+    if (!mFlowControl)
+    {
+        CLOG(WARNING, "Overlay") << "Unexpected SEND_MORE message";
+        mDropInRecvSendMoreUnexpectedMeter.Mark();
+        drop(ERR_MISC, "unexpected SEND_MORE message");
+        return;
+    }
+    addOutboundCredits(msg.sendMoreMessage().numMessages);
+}
+
+void
+Peer::recvFloodAdvert(StellarMessage const& msg)
+{
+    if (!mTxPull)
+    {
+        CLOG(WARNING, "Overlay") << "Unexpected FLOOD_ADVERT message";
+        mDropInRecvTxPullUnexpectedMeter.Mark();
+        drop(ERR_MISC, "unexpected FLOOD_ADVERT message");
+        return;
+    }
+
+    auto self = shared_from_this();
+    auto& overlayManager = mApp.getOverlayManager();
+    auto& puller = overlayManager.getTxPuller();
+    std::vector<Hash> unknown;
+    for (auto const& h : msg.floodAdvert().txHashes)
+    {
+        // transactions still being demanded may be demanded from this peer
+        // too, if the others don't send them
+        if (overlayManager.recvFloodedHash(h, self) || puller.isDemanding(h))
+        {
+            unknown.emplace_back(h);
+        }
+    }
+    if (!unknown.empty())
+    {
+        puller.advertised(self, unknown);
+    }
+}
+
+void
+Peer::recvFloodDemand(StellarMessage const& msg)
+{
+    if (!mTxPull)
+    {
+        CLOG(WARNING, "Overlay") << "Unexpected FLOOD_DEMAND message";
+        mDropInRecvTxPullUnexpectedMeter.Mark();
+        drop(ERR_MISC, "unexpected FLOOD_DEMAND message");
+        return;
+    }
+
+    auto& overlayManager = mApp.getOverlayManager();
+    for (auto const& h : msg.floodDemand().txHashes)
+    {
+        if (auto tx = overlayManager.getFloodedTransaction(h))
+        {
+            sendMessage(tx);
+        }
+        else
+        {
+            sendDontHave(TRANSACTION, h);
+        }
+    }
+}
+
+void
+Peer::floodMessageProcessed()
+{
+    if (!mFlowControl || shouldAbort())
+    {
+        return;
+    }
+
+    --mFloodCapacity;
+    if (++mFloodProcessed >= mApp.getConfig().FLOW_CONTROL_SEND_MORE_BATCH_SIZE)
+    {
+        mFloodCapacity += mFloodProcessed;
+        sendSendMore(mFloodProcessed);
+        mFloodProcessed = 0;
+    }
+}
+
 void
 Peer::recvError(StellarMessage const& msg)
 {
@@ -934,6 +1401,12 @@ Peer::recvHello(Hello const& elo)
                                             mRecvNonce, mRole);
     mRecvMacKey = peerAuth.getReceivingMacKey(elo.cert.pubkey, mSendNonce,
                                               mRecvNonce, mRole);
+    mFlowControl = std::min(mRemoteOverlayVersion,
+                            mApp.getConfig().OVERLAY_PROTOCOL_VERSION) >=
+                   FIRST_OVERLAY_VERSION_WITH_FLOW_CONTROL;
+    mTxPull = std::min(mRemoteOverlayVersion,
+                       mApp.getConfig().OVERLAY_PROTOCOL_VERSION) >=
+              FIRST_OVERLAY_VERSION_WITH_TX_PULL;
 
     mState = GOT_HELLO;
     CLOG(DEBUG, "Overlay") << "recvHello from " << toString();
@@ -1071,6 +1544,13 @@ Peer::recvAuth(StellarMessage const& msg)
 
     noteHandshakeSuccessInPeerRecord();
 
+    if (mFlowControl)
+    {
+        // the peer may send that many transactions before we ask for more
+        mFloodCapacity = mApp.getConfig().PEER_FLOOD_READING_CAPACITY;
+        sendSendMore(mFloodCapacity);
+    }
+
     // send SCP State
     // remove when all known peers implements the next line
     mApp.getHerder().sendSCPStateToPeer(0, self);
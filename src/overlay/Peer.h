@@ -6,11 +6,15 @@
 
 #include "util/asio.h"
 #include "database/Database.h"
+#include "overlay/EncodedMessage.h"
 #include "overlay/PeerBareAddress.h"
 #include "overlay/StellarXDR.h"
 #include "util/NonCopyable.h"
 #include "util/Timer.h"
 #include "xdrpp/message.h"
+#include <cstdint>
+#include <deque>
+#include <vector>
 
 namespace medida
 {
@@ -24,7 +28,10 @@ namespace stellar
 typedef std::shared_ptr<SCPQuorumSet> SCPQuorumSetPtr;
 
 class Application;
+class ByteSlice;
+class FloodFilter;
 class LoopbackPeer;
+class TransactionFrame;
 
 /*
  * Another peer out there that we are connected to
@@ -36,6 +43,27 @@ class Peer : public std::enable_shared_from_this<Peer>,
   public:
     typedef std::shared_ptr<Peer> pointer;
 
+    static size_t const NO_SLOT = SIZE_MAX;
+
+    // overlay version from which peers throttle the transactions they send
+    // each other with SEND_MORE messages
+    static uint32_t const FIRST_OVERLAY_VERSION_WITH_FLOW_CONTROL = 7;
+
+    // overlay version from which peers advertise the transactions they flood
+    // by hash (FLOOD_ADVERT) and send them on demand (FLOOD_DEMAND)
+    static uint32_t const FIRST_OVERLAY_VERSION_WITH_TX_PULL = 8;
+
+    // messages waiting to be sent to the peer, and the transactions that were
+    // dropped instead (because of OUTBOUND_TX_QUEUE_BYTE_LIMIT, or as they were
+    // queued before the last ledger closed)
+    struct OutboundQueueStats
+    {
+        size_t mMessages;
+        size_t mBytes;
+        size_t mDroppedMessages;
+        size_t mDroppedBytes;
+    };
+
     enum PeerState
     {
         CONNECTING = 0,
@@ -54,6 +82,14 @@ class Peer : public std::enable_shared_from_this<Peer>,
     static medida::Meter& getByteReadMeter(Application& app);
     static medida::Meter& getByteWriteMeter(Application& app);
 
+    // checks, without decoding it, whether `body` (an AuthenticatedMessage)
+    // carries a TRANSACTION message that is in `filter` and has a valid MAC,
+    // in which case its sequence number and hash are set
+    static bool isKnownTransaction(ByteSlice const& body,
+                                   FloodFilter const& filter,
+                                   HmacSha256Key const& macKey,
+                                   uint64_t& sequence, Hash& hash);
+
   protected:
     Application& mApp;
 
@@ -68,10 +104,30 @@ class Peer : public std::enable_shared_from_this<Peer>,
     uint64_t mSendMacSeq{0};
     uint64_t mRecvMacSeq{0};
 
+    // set if both ends use flow control, once HELLO was received
+    bool mFlowControl{false};
+    // transactions the peer may still send us, and the ones we processed
+    // since we last asked for more
+    uint32_t mFloodCapacity{0};
+    uint32_t mFloodProcessed{0};
+    // transactions we may still send to the peer
+    uint64_t mOutboundCredits{0};
+    // transactions waiting for credits, with the last closed ledger at the
+    // time they were queued (only used by peers not overriding queueMessage)
+    std::deque<std::pair<EncodedMessage::pointer, uint32_t>> mHeldTransactions;
+    OutboundQueueStats mOutboundStats{0, 0, 0, 0};
+
+    // set if both ends pull transactions, once HELLO was received
+    bool mTxPull{false};
+    // hashes of transactions to advertise, sent every FLOOD_ADVERT_PERIOD_MS
+    std::vector<Hash> mAdvertsToSend;
+    VirtualTimer mAdvertTimer;
+
     std::string mRemoteVersion;
     uint32_t mRemoteOverlayMinVersion;
     uint32_t mRemoteOverlayVersion;
     PeerBareAddress mAddress;
+    size_t mSlot{NO_SLOT};
 
     VirtualTimer mIdleTimer;
     VirtualClock::time_point mLastRead;
@@ -84,6 +140,7 @@ class Peer : public std::enable_shared_from_this<Peer>,
     medida::Meter& mErrorRead;
     medida::Meter& mErrorWrite;
     medida::Meter& mTimeoutIdle;
+    medida::Meter& mDecodeSkipped;
 
     medida::Timer& mRecvErrorTimer;
     medida::Timer& mRecvHelloTimer;
@@ -98,6 +155,9 @@ class Peer : public std::enable_shared_from_this<Peer>,
     medida::Timer& mRecvSCPQuorumSetTimer;
     medida::Timer& mRecvSCPMessageTimer;
     medida::Timer& mRecvGetSCPStateTimer;
+    medida::Timer& mRecvSendMoreTimer;
+    medida::Timer& mRecvFloodAdvertTimer;
+    medida::Timer& mRecvFloodDemandTimer;
 
     medida::Timer& mRecvSCPPrepareTimer;
     medida::Timer& mRecvSCPConfirmTimer;
@@ -117,6 +177,10 @@ class Peer : public std::enable_shared_from_this<Peer>,
     medida::Meter& mSendSCPQuorumSetMeter;
     medida::Meter& mSendSCPMessageSetMeter;
     medida::Meter& mSendGetSCPStateMeter;
+    medida::Meter& mSendSendMoreMeter;
+    medida::Meter& mSendFloodAdvertMeter;
+    medida::Meter& mSendFloodDemandMeter;
+    medida::Meter& mOutboundQueueDropMeter;
 
     medida::Meter& mDropInConnectHandlerMeter;
     medida::Meter& mDropInRecvMessageDecodeMeter;
@@ -135,11 +199,22 @@ class Peer : public std::enable_shared_from_this<Peer>,
     medida::Meter& mDropInRecvAuthRejectMeter;
     medida::Meter& mDropInRecvAuthInvalidPeerMeter;
     medida::Meter& mDropInRecvErrorMeter;
+    medida::Meter& mDropInRecvFloodCapacityMeter;
+    medida::Meter& mDropInRecvSendMoreUnexpectedMeter;
+    medida::Meter& mDropInRecvTxPullUnexpectedMeter;
 
     bool shouldAbort() const;
     void recvMessage(StellarMessage const& msg);
-    void recvMessage(AuthenticatedMessage const& msg);
+    // macVerified is set if the MAC of msg was already checked (by a network
+    // thread), in which case only its sequence number is checked here
+    void recvMessage(AuthenticatedMessage const& msg, bool macVerified = false);
     void recvMessage(xdr::msg_ptr const& xdrBytes);
+    // a TRANSACTION message found by isKnownTransaction: only its sender is
+    // recorded
+    void recvKnownTransaction(uint64_t sequence, Hash const& h);
+    // drop the peer and return false if the message is unexpected
+    bool checkRecvSequence(uint64_t sequence);
+    bool checkFloodCapacity();
 
     virtual void recvError(StellarMessage const& msg);
     // returns false if we should drop this peer
@@ -153,16 +228,27 @@ class Peer : public std::enable_shared_from_this<Peer>,
     void recvGetTxSet(StellarMessage const& msg);
     void recvTxSet(StellarMessage const& msg);
     void recvTransaction(StellarMessage const& msg);
+    void processTransaction(StellarMessage const& msg,
+                            std::shared_ptr<TransactionFrame> transaction);
     void recvGetSCPQuorumSet(StellarMessage const& msg);
     void recvSCPQuorumSet(StellarMessage const& msg);
     void recvSCPMessage(StellarMessage const& msg);
+    void processSCPEnvelope(SCPEnvelope const& envelope);
     void recvGetSCPState(StellarMessage const& msg);
+    void recvSendMore(StellarMessage const& msg);
+    // counts a transaction the peer sent us against the capacity we granted
+    // it, asking for more once enough of them were processed
+    void floodMessageProcessed();
+    void recvFloodAdvert(StellarMessage const& msg);
+    void recvFloodDemand(StellarMessage const& msg);
 
     void sendHello();
     void sendAuth();
     void sendSCPQuorumSet(SCPQuorumSetPtr qSet);
     void sendDontHave(MessageType type, uint256 const& itemID);
     void sendPeers();
+    void sendSendMore(uint32_t numMessages);
+    void sendAdverts();
 
     // NB: This is a move-argument because the write-buffer has to travel
     // with the write-request through the async IO system, and we might have
@@ -172,6 +258,19 @@ class Peer : public std::enable_shared_from_this<Peer>,
     // messages somewhere else. The async write request will point _into_
     // this owned buffer. This is really the best we can do.
     virtual void sendMessage(xdr::msg_ptr&& xdrBytes) = 0;
+
+    // frames `msg` in an AuthenticatedMessage (authenticated with the next
+    // sequence number, unless it's a HELLO or an ERROR_MSG) and sends it.
+    // Peers that reorder their outgoing messages override it to frame them
+    // once they are written, as sequence numbers must follow that order.
+    // With flow control, transactions are held back until the peer lets us
+    // send more of them.
+    virtual void queueMessage(std::shared_ptr<EncodedMessage const> const& msg);
+    void frameMessage(std::shared_ptr<EncodedMessage const> const& msg);
+
+    // called when the peer lets us send `numMessages` more transactions
+    virtual void addOutboundCredits(uint32_t numMessages);
+
     virtual void
     connected()
     {
@@ -200,8 +299,14 @@ class Peer : public std::enable_shared_from_this<Peer>,
     void sendGetQuorumSet(uint256 const& setID);
     void sendGetPeers();
     void sendGetScpState(uint32 ledgerSeq);
+    void sendFloodDemand(std::vector<Hash> const& hashes);
+
+    // queues the hash of a TRANSACTION message to advertise to the peer
+    void advertiseTransaction(Hash const& h);
 
     void sendMessage(StellarMessage const& msg);
+    // sends a message encoded once for all the peers it's sent to
+    void sendMessage(std::shared_ptr<EncodedMessage const> const& msg);
 
     PeerRole
     getRole() const
@@ -248,27 +353,44 @@ class Peer : public std::enable_shared_from_this<Peer>,
         return mPeerID;
     }
 
-    std::string toString();
-
-    // These exist mostly to be overridden in TCPPeer and callable via
-    // shared_ptr<Peer> as a captured shared_from_this().
-    virtual void connectHandler(asio::error_code const& ec);
+    // dense index of the peer among authenticated peers, assigned by the
+    // OverlayManager and reused once the peer is dropped (NO_SLOT if none)
+    size_t
+    getSlot() const
+    {
+        return mSlot;
+    }
 
-    virtual void
-    writeHandler(asio::error_code const& error, size_t bytes_transferred)
+    void
+    setSlot(size_t slot)
     {
+        mSlot = slot;
     }
 
-    virtual void
-    readHeaderHandler(asio::error_code const& error, size_t bytes_transferred)
+    bool
+    isFlowControlled() const
     {
+        return mFlowControl;
     }
 
-    virtual void
-    readBodyHandler(asio::error_code const& error, size_t bytes_transferred)
+    bool
+    pullsTransactions() const
     {
+        return mTxPull;
     }
 
+    virtual OutboundQueueStats getOutboundQueueStats() const;
+
+    // drops the transactions that are still waiting to be sent to the peer
+    // since before `lastClosedLedgerSeq` closed
+    virtual void ledgerClosed(uint32_t lastClosedLedgerSeq);
+
+    std::string toString();
+
+    // This exists mostly to be overridden in TCPPeer and callable via
+    // shared_ptr<Peer> as a captured shared_from_this().
+    virtual void connectHandler(asio::error_code const& ec);
+
     void drop(ErrorCode err, std::string const& msg);
 
     // If force is true, it will drop immediately without waiting for all
@@ -57,8 +57,8 @@ PeerDoor::acceptNextPeer()
     }
 
     CLOG(DEBUG, "Overlay") << "PeerDoor acceptNextPeer()";
-    auto sock =
-        make_shared<TCPPeer::SocketType>(mApp.getClock().getIOService());
+    // the socket is served by the network threads, if any
+    auto sock = TCPPeer::makeSocket(mApp);
     mAcceptor.async_accept(sock->next_layer(),
                            [this, sock](asio::error_code const& ec) {
                                if (ec)
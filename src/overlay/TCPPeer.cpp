@@ -3,11 +3,16 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "overlay/TCPPeer.h"
+#include "crypto/SHA.h"
 #include "database/Database.h"
+#include "ledger/LedgerManager.h"
 #include "main/Application.h"
 #include "main/Config.h"
+#include "medida/histogram.h"
 #include "medida/meter.h"
 #include "medida/metrics_registry.h"
+#include "medida/timer.h"
+#include "overlay/Floodgate.h"
 #include "overlay/LoadManager.h"
 #include "overlay/OverlayManager.h"
 #include "overlay/PeerRecord.h"
@@ -15,6 +20,10 @@
 #include "util/GlobalChecks.h"
 #include "util/Logging.h"
 #include "xdrpp/marshal.h"
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <mutex>
 
 using namespace soci;
 
@@ -23,158 +32,568 @@ namespace stellar
 
 using namespace std;
 
+// messages queued for a peer are written together, up to that many bytes
+static const size_t MAX_WRITE_BATCH_BYTES = 256 * 1024;
+
+// bytes added by the framing of an EncodedMessage: record mark,
+// discriminant, sequence number and MAC
+static const size_t FRAMING_BYTES = 4 + 4 + 8 + 32;
+
 ///////////////////////////////////////////////////////////////////////
-// TCPPeer
+// TCPPeer::Connection
 ///////////////////////////////////////////////////////////////////////
 
-TCPPeer::TCPPeer(Application& app, Peer::PeerRole role,
-                 std::shared_ptr<TCPPeer::SocketType> socket)
-    : Peer(app, role), mSocket(socket)
+// Unless stated otherwise, members are only accessed through mStrand.
+struct TCPPeer::Connection : public enable_shared_from_this<Connection>
+{
+    struct Incoming
+    {
+        AuthenticatedMessage mMessage;
+        // set if the MAC of the message was checked by the connection
+        bool mMacVerified;
+        // set for a TRANSACTION message we already have, that was not
+        // decoded: only the sequence number of mMessage is set
+        bool mKnownTransaction;
+        Hash mHash;
+        size_t mBytes;
+        chrono::steady_clock::time_point mReceivedAt;
+    };
+
+    struct Outgoing
+    {
+        // framed once it gets written, unless mBytes is already set
+        EncodedMessage::pointer mMessage;
+        bool mAuthenticate;
+        // last closed ledger when the message was queued
+        uint32_t mLedgerSeq;
+        xdr::msg_ptr mBytes;
+
+        size_t getSize() const;
+    };
+
+    shared_ptr<SocketType> const mSocket;
+    asio::io_service::strand mStrand;
+    asio::io_service& mMainIOService;
+    size_t const mQueueSize;
+    size_t const mTransactionByteLimit;
+    medida::Meter& mQueueFull;
+    medida::Meter& mTransactionDrops;
+    medida::Histogram& mWriteBatch;
+    shared_ptr<FloodFilter> const mTransactionFilter;
+
+    // set right after construction, only locked on the main thread
+    weak_ptr<TCPPeer> mPeer;
+
+    // shared with the main thread, guarded by mMutex
+    mutex mMutex;
+    deque<Incoming> mIncoming;
+    bool mReadPaused{false};
+    size_t mWrittenMessages{0};
+    size_t mWrittenBytes{0};
+    Peer::OutboundQueueStats mOutboundStats{0, 0, 0, 0};
+
+    vector<uint8_t> mIncomingHeader;
+    vector<uint8_t> mIncomingBody;
+    bool mAuthenticated{false};
+    HmacSha256Key mRecvMacKey;
+
+    // SCP and other control messages are written ahead of transactions
+    deque<Outgoing> mWriteQueue;
+    deque<Outgoing> mTransactionQueue;
+    size_t mTransactionBytes{0};
+    // messages being written
+    vector<xdr::msg_ptr> mWriteBuffers;
+    bool mWriting{false};
+    HmacSha256Key mSendMacKey;
+    uint64_t mSendMacSeq{0};
+    // with flow control, transactions are only sent while we have credits
+    bool mFlowControl{false};
+    uint64_t mOutboundCredits{0};
+    bool mDelayedShutdown{false};
+    bool mShutdownScheduled{false};
+
+    Connection(Application& app, shared_ptr<SocketType> socket);
+
+    // calls `f` on the main thread, if the peer still exists by then
+    void postToPeer(function<void(TCPPeer&)> f);
+
+    void startRead();
+    int getIncomingMsgLength();
+    void readHeaderHandler(asio::error_code const& error,
+                           size_t bytes_transferred);
+    void readBodyHandler(asio::error_code const& error,
+                         size_t bytes_transferred);
+    void pushIncoming(Incoming&& item);
+    void authenticate(HmacSha256Key const& key);
+
+    void queueWrite(Outgoing&& item);
+    void addCredits(uint32_t numMessages);
+    void dropStaleTransactions(uint32_t lastClosedLedgerSeq);
+    // moves messages from `queue` to mWriteBuffers, returns false if it
+    // stopped before emptying `queue`
+    bool gatherWrites(deque<Outgoing>& queue, size_t& bytes);
+    void messageSender();
+    void writeHandler(asio::error_code const& error, size_t bytes_transferred,
+                      size_t messages);
+
+    void close(bool force);
+    void shutdown();
+    void closeSocket();
+};
+
+TCPPeer::Connection::Connection(Application& app,
+                                shared_ptr<SocketType> socket)
+    : mSocket(socket)
+    , mStrand(socket->get_io_service())
+    , mMainIOService(app.getClock().getIOService())
+    , mQueueSize(app.getConfig().NETWORK_IO_QUEUE_SIZE)
+    , mTransactionByteLimit(app.getConfig().OUTBOUND_TX_QUEUE_BYTE_LIMIT)
+    , mQueueFull(app.getMetrics().NewMeter(
+          {"overlay", "inbound-queue", "full"}, "pause"))
+    , mTransactionDrops(app.getMetrics().NewMeter(
+          {"overlay", "outbound-queue", "drop"}, "message"))
+    , mWriteBatch(
+          app.getMetrics().NewHistogram({"overlay", "outbound-queue", "batch"}))
+    , mTransactionFilter(app.getOverlayManager().getTransactionFilter())
 {
 }
 
-TCPPeer::pointer
-TCPPeer::initiate(Application& app, PeerBareAddress const& address)
+size_t
+TCPPeer::Connection::Outgoing::getSize() const
 {
-    assert(address.getType() == PeerBareAddress::Type::IPv4);
+    return mBytes ? mBytes->raw_size()
+                  : mMessage->getBody().size() + FRAMING_BYTES;
+}
 
-    CLOG(DEBUG, "Overlay") << "TCPPeer:initiate"
-                           << " to " << address.toString();
-    assertThreadIsMain();
-    auto socket = make_shared<SocketType>(app.getClock().getIOService());
-    auto result = make_shared<TCPPeer>(app, WE_CALLED_REMOTE, socket);
-    result->mAddress = address;
-    result->startIdleTimer();
-    asio::ip::tcp::endpoint endpoint(
-        asio::ip::address::from_string(address.getIP()), address.getPort());
-    socket->next_layer().async_connect(
-        endpoint, [result](asio::error_code const& error) {
-            asio::error_code ec;
-            if (!error)
-            {
-                asio::ip::tcp::no_delay nodelay(true);
-                result->mSocket->next_layer().set_option(nodelay, ec);
-            }
-            else
-            {
-                ec = error;
-            }
+void
+TCPPeer::Connection::postToPeer(function<void(TCPPeer&)> f)
+{
+    // the last reference to the peer must not be released here
+    auto peer = mPeer;
+    mMainIOService.post([peer, f]() {
+        if (auto p = peer.lock())
+        {
+            f(*p);
+        }
+    });
+}
 
-            result->connectHandler(ec);
+void
+TCPPeer::Connection::startRead()
+{
+    if (mShutdownScheduled)
+    {
+        return;
+    }
+
+    auto self = shared_from_this();
+    mIncomingHeader.resize(4);
+    asio::async_read(*mSocket, asio::buffer(mIncomingHeader),
+                     mStrand.wrap([self](asio::error_code ec, size_t length) {
+                         self->readHeaderHandler(ec, length);
+                     }));
+}
+
+int
+TCPPeer::Connection::getIncomingMsgLength()
+{
+    int length = mIncomingHeader[0];
+    length &= 0x7f; // clear the XDR 'continuation' bit
+    length <<= 8;
+    length |= mIncomingHeader[1];
+    length <<= 8;
+    length |= mIncomingHeader[2];
+    length <<= 8;
+    length |= mIncomingHeader[3];
+    if (length <= 0 ||
+        (!mAuthenticated && (length > MAX_UNAUTH_MESSAGE_SIZE)) ||
+        length > MAX_MESSAGE_SIZE)
+    {
+        postToPeer([length](TCPPeer& peer) { peer.messageSizeError(length); });
+        length = 0;
+    }
+    return (length);
+}
+
+void
+TCPPeer::Connection::readHeaderHandler(asio::error_code const& error,
+                                       size_t bytes_transferred)
+{
+    if (error)
+    {
+        postToPeer([error](TCPPeer& peer) {
+            peer.readError("readHeaderHandler", error);
         });
-    return result;
+        return;
+    }
+
+    int length = getIncomingMsgLength();
+    if (length != 0)
+    {
+        mIncomingBody.resize(length);
+        auto self = shared_from_this();
+        asio::async_read(
+            *mSocket, asio::buffer(mIncomingBody),
+            mStrand.wrap([self](asio::error_code ec, size_t length) {
+                self->readBodyHandler(ec, length);
+            }));
+    }
 }
 
-TCPPeer::pointer
-TCPPeer::accept(Application& app, shared_ptr<TCPPeer::SocketType> socket)
+void
+TCPPeer::Connection::readBodyHandler(asio::error_code const& error,
+                                     size_t bytes_transferred)
 {
-    assertThreadIsMain();
-    shared_ptr<TCPPeer> result;
-    asio::error_code ec;
+    if (error)
+    {
+        postToPeer([error](TCPPeer& peer) {
+            peer.readError("readBodyHandler", error);
+        });
+        return;
+    }
 
-    asio::ip::tcp::no_delay nodelay(true);
-    socket->next_layer().set_option(nodelay, ec);
+    Incoming item;
+    item.mMacVerified = false;
+    item.mKnownTransaction = false;
+    item.mBytes = mIncomingHeader.size() + bytes_transferred;
+    item.mReceivedAt = chrono::steady_clock::now();
 
-    if (!ec)
+    // most flooded transactions were already received from other peers
+    uint64_t sequence;
+    if (mAuthenticated &&
+        Peer::isKnownTransaction(mIncomingBody, *mTransactionFilter,
+                                 mRecvMacKey, sequence, item.mHash))
     {
-        CLOG(DEBUG, "Overlay") << "TCPPeer:accept"
-                               << "@" << app.getConfig().PEER_PORT;
-        result = make_shared<TCPPeer>(app, REMOTE_CALLED_US, socket);
-        result->startIdleTimer();
-        result->startRead();
+        item.mMacVerified = true;
+        item.mKnownTransaction = true;
+        item.mMessage.v0().sequence = sequence;
+        pushIncoming(move(item));
+        return;
     }
-    else
+
+    try
     {
-        CLOG(DEBUG, "Overlay")
-            << "TCPPeer:accept"
-            << "@" << app.getConfig().PEER_PORT << " error " << ec.message();
+        xdr::xdr_get g(mIncomingBody.data(),
+                       mIncomingBody.data() + mIncomingBody.size());
+        xdr::xdr_argpack_archive(g, item.mMessage);
+    }
+    catch (xdr::xdr_runtime_error& e)
+    {
+        string what = e.what();
+        postToPeer([what](TCPPeer& peer) { peer.decodeError(what); });
+        return;
     }
 
-    return result;
+    auto const& v0 = item.mMessage.v0();
+    if (mAuthenticated && v0.message.type() != ERROR_MSG)
+    {
+        // the MAC covers the sequence number and the message, as they were
+        // received: right after the discriminant of the AuthenticatedMessage
+        auto size = sizeof(v0.sequence) + xdr::xdr_size(v0.message);
+        item.mMacVerified = hmacSha256Verify(
+            v0.mac, mRecvMacKey, ByteSlice(mIncomingBody.data() + 4, size));
+    }
+    pushIncoming(move(item));
 }
 
-TCPPeer::~TCPPeer()
+void
+TCPPeer::Connection::pushIncoming(Incoming&& item)
 {
-    assertThreadIsMain();
-    mIdleTimer.cancel();
-    if (mSocket)
+    bool wasEmpty;
+    bool paused;
     {
-        // Ignore: this indicates an attempt to cancel events
-        // on a not-established socket.
-        asio::error_code ec;
+        lock_guard<mutex> lock(mMutex);
+        wasEmpty = mIncoming.empty();
+        mIncoming.emplace_back(move(item));
+        // until authenticated, the main thread resumes reading once it
+        // processed the message
+        paused = !mAuthenticated || mIncoming.size() >= mQueueSize;
+        mReadPaused = paused;
+    }
 
-#ifndef _WIN32
-        // This always fails on windows and ASIO won't
-        // even build it.
-        mSocket->next_layer().cancel(ec);
-#endif
-        mSocket->close(ec);
+    if (wasEmpty)
+    {
+        postToPeer([](TCPPeer& peer) { peer.processIncoming(); });
+    }
+    if (!paused)
+    {
+        startRead();
+    }
+    else if (mAuthenticated)
+    {
+        mQueueFull.Mark();
     }
 }
 
-PeerBareAddress
-TCPPeer::makeAddress(int remoteListeningPort) const
+void
+TCPPeer::Connection::authenticate(HmacSha256Key const& key)
 {
-    asio::error_code ec;
-    auto ep = mSocket->next_layer().remote_endpoint(ec);
-    if (ec || remoteListeningPort <= 0 || remoteListeningPort > UINT16_MAX)
+    mAuthenticated = true;
+    mRecvMacKey = key;
+}
+
+void
+TCPPeer::Connection::queueWrite(Outgoing&& item)
+{
+    if (mShutdownScheduled)
     {
-        return PeerBareAddress{};
+        return;
+    }
+
+    auto size = item.getSize();
+    size_t droppedMessages = 0;
+    size_t droppedBytes = 0;
+    if (item.mMessage &&
+        item.mMessage->getMessage().type() == TRANSACTION)
+    {
+        mTransactionBytes += size;
+        mTransactionQueue.emplace_back(move(item));
+        // transactions can be dropped if the peer does not keep up, the
+        // oldest being the least likely to still be useful to it
+        while (mTransactionBytes > mTransactionByteLimit &&
+               mTransactionQueue.size() > 1)
+        {
+            auto dropped = mTransactionQueue.front().getSize();
+            mTransactionBytes -= dropped;
+            mTransactionQueue.pop_front();
+            mTransactionDrops.Mark();
+            ++droppedMessages;
+            droppedBytes += dropped;
+        }
     }
     else
     {
-        return PeerBareAddress{
-            ep.address().to_string(),
-            static_cast<unsigned short>(remoteListeningPort)};
+        mWriteQueue.emplace_back(move(item));
+    }
+
+    {
+        lock_guard<mutex> lock(mMutex);
+        mOutboundStats.mMessages += 1;
+        mOutboundStats.mMessages -= droppedMessages;
+        mOutboundStats.mBytes += size;
+        mOutboundStats.mBytes -= droppedBytes;
+        mOutboundStats.mDroppedMessages += droppedMessages;
+        mOutboundStats.mDroppedBytes += droppedBytes;
+    }
+
+    if (!mWriting)
+    {
+        mWriting = true;
+        // kick off the async write chain if we're the first one
+        messageSender();
     }
 }
 
 void
-TCPPeer::sendMessage(xdr::msg_ptr&& xdrBytes)
+TCPPeer::Connection::addCredits(uint32_t numMessages)
 {
-    if (mState == CLOSING)
+    if (mShutdownScheduled)
     {
-        CLOG(ERROR, "Overlay")
-            << "Trying to send message to " << toString() << " after drop";
         return;
     }
 
-    if (Logging::logTrace("Overlay"))
-        CLOG(TRACE, "Overlay") << "TCPPeer:sendMessage to " << toString();
-    assertThreadIsMain();
+    mOutboundCredits += numMessages;
+    if (!mWriting)
+    {
+        mWriting = true;
+        messageSender();
+    }
+}
 
-    // places the buffer to write into the write queue
-    auto buf = std::make_shared<xdr::msg_ptr>(std::move(xdrBytes));
+void
+TCPPeer::Connection::dropStaleTransactions(uint32_t lastClosedLedgerSeq)
+{
+    size_t droppedMessages = 0;
+    size_t droppedBytes = 0;
+    // transactions are queued in order, so the stale ones come first
+    while (!mTransactionQueue.empty() &&
+           mTransactionQueue.front().mLedgerSeq < lastClosedLedgerSeq)
+    {
+        auto dropped = mTransactionQueue.front().getSize();
+        mTransactionBytes -= dropped;
+        mTransactionQueue.pop_front();
+        mTransactionDrops.Mark();
+        ++droppedMessages;
+        droppedBytes += dropped;
+    }
 
-    auto self = static_pointer_cast<TCPPeer>(shared_from_this());
+    if (droppedMessages != 0)
+    {
+        lock_guard<mutex> lock(mMutex);
+        mOutboundStats.mMessages -= droppedMessages;
+        mOutboundStats.mBytes -= droppedBytes;
+        mOutboundStats.mDroppedMessages += droppedMessages;
+        mOutboundStats.mDroppedBytes += droppedBytes;
+    }
+}
+
+bool
+TCPPeer::Connection::gatherWrites(deque<Outgoing>& queue, size_t& bytes)
+{
+    bool transactions = &queue == &mTransactionQueue;
+    while (!queue.empty())
+    {
+        auto& item = queue.front();
+        auto size = item.getSize();
+        // always send at least one message, however large
+        if (!mWriteBuffers.empty() && bytes + size > MAX_WRITE_BATCH_BYTES)
+        {
+            return false;
+        }
+        if (transactions && mFlowControl && mOutboundCredits == 0)
+        {
+            return false;
+        }
+
+        // messages are framed in the order they are written, as it
+        // determines their sequence numbers
+        if (!item.mBytes)
+        {
+            if (item.mAuthenticate)
+            {
+                item.mBytes = item.mMessage->toAuthenticatedMessage(
+                    mSendMacSeq++, &mSendMacKey);
+            }
+            else
+            {
+                item.mBytes = item.mMessage->toAuthenticatedMessage(0, nullptr);
+            }
+        }
+        if (transactions)
+        {
+            mTransactionBytes -= size;
+            if (mFlowControl)
+            {
+                --mOutboundCredits;
+            }
+        }
+        bytes += size;
+        mWriteBuffers.emplace_back(move(item.mBytes));
+        queue.pop_front();
+    }
+    return true;
+}
+
+void
+TCPPeer::Connection::messageSender()
+{
+    mWriteBuffers.clear();
+    size_t bytes = 0;
+    if (gatherWrites(mWriteQueue, bytes))
+    {
+        gatherWrites(mTransactionQueue, bytes);
+    }
+
+    if (mWriteBuffers.empty())
+    {
+        mWriting = false;
+        // there is nothing to send and delayed shutdown was requested - time
+        // to perform it
+        if (mDelayedShutdown)
+        {
+            shutdown();
+        }
+        return;
+    }
 
-    self->mWriteQueue.emplace(buf);
+    mWriteBatch.Update(mWriteBuffers.size());
+    {
+        lock_guard<mutex> lock(mMutex);
+        mOutboundStats.mMessages -= mWriteBuffers.size();
+        mOutboundStats.mBytes -= bytes;
+    }
 
-    if (!self->mWriting)
+    vector<asio::const_buffer> buffers;
+    buffers.reserve(mWriteBuffers.size());
+    for (auto const& buf : mWriteBuffers)
     {
-        self->mWriting = true;
-        // kick off the async write chain if we're the first one
-        self->messageSender();
+        buffers.emplace_back(buf->raw_data(), buf->raw_size());
+    }
+
+    // the buffered stream would only copy the batch, so it's written straight
+    // to the socket; mWriteBuffers holds the data until the write completes
+    auto self = shared_from_this();
+    auto messages = mWriteBuffers.size();
+    asio::async_write(
+        mSocket->next_layer(), buffers,
+        mStrand.wrap(
+            [self, messages](asio::error_code const& ec, size_t length) {
+                self->writeHandler(ec, length, messages);
+                if (!ec)
+                {
+                    self->messageSender();
+                }
+            }));
+}
+
+void
+TCPPeer::Connection::writeHandler(asio::error_code const& error,
+                                  size_t bytes_transferred, size_t messages)
+{
+    if (error)
+    {
+        bool delayedShutdown = mDelayedShutdown;
+        if (delayedShutdown)
+        {
+            // delayed shutdown was requested - time to perform it
+            shutdown();
+        }
+        // otherwise, the peer drops normally
+        postToPeer([delayedShutdown](TCPPeer& peer) {
+            peer.writeError(!delayedShutdown);
+        });
+    }
+    else
+    {
+        bool wasIdle;
+        {
+            lock_guard<mutex> lock(mMutex);
+            wasIdle = mWrittenMessages == 0;
+            mWrittenMessages += messages;
+            mWrittenBytes += bytes_transferred;
+        }
+        if (wasIdle)
+        {
+            postToPeer([](TCPPeer& peer) { peer.processWritten(); });
+        }
+    }
+}
+
+void
+TCPPeer::Connection::close(bool force)
+{
+    if (mShutdownScheduled)
+    {
+        return;
+    }
+
+    // if write queue is not empty, messageSender will take care of shutdown
+    if (force || !mWriting)
+    {
+        shutdown();
+    }
+    else
+    {
+        mDelayedShutdown = true;
     }
 }
 
 void
-TCPPeer::shutdown()
+TCPPeer::Connection::shutdown()
 {
     if (mShutdownScheduled)
     {
         // should not happen, leave here for debugging purposes
-        CLOG(ERROR, "Overlay") << "Double schedule of shutdown " << toString();
+        CLOG(ERROR, "Overlay") << "Double schedule of shutdown";
         return;
     }
 
-    mIdleTimer.cancel();
     mShutdownScheduled = true;
-    auto self = static_pointer_cast<TCPPeer>(shared_from_this());
+    auto self = shared_from_this();
 
     // To shutdown, we first queue up our desire to shutdown in the strand,
     // behind any pending read/write calls. We'll let them issue first.
-    self->getApp().getClock().getIOService().post([self]() {
+    mStrand.post([self]() {
         // Gracefully shut down connection: this pushes a FIN packet into TCP
         // which, if we wanted to be really polite about, we would wait for an
         // ACK from by doing repeated reads until we get a 0-read.
@@ -195,7 +614,7 @@ TCPPeer::shutdown()
             CLOG(ERROR, "Overlay")
                 << "TCPPeer::drop shutdown socket failed: " << ec.message();
         }
-        self->getApp().getClock().getIOService().post([self]() {
+        self->mStrand.post([self]() {
             // Close fd associated with socket. Socket is already shut down, but
             // depending on platform (and apparently whether there was unread
             // data when we issued shutdown()) this call might push RST onto the
@@ -217,144 +636,232 @@ TCPPeer::shutdown()
 }
 
 void
-TCPPeer::messageSender()
+TCPPeer::Connection::closeSocket()
 {
-    assertThreadIsMain();
+    mShutdownScheduled = true;
 
-    auto self = static_pointer_cast<TCPPeer>(shared_from_this());
+    // Ignore: this indicates an attempt to cancel events
+    // on a not-established socket.
+    asio::error_code ec;
 
-    // if nothing to do, flush and return
-    if (mWriteQueue.empty())
-    {
-        mSocket->async_flush([self](asio::error_code const& ec, std::size_t) {
-            self->writeHandler(ec, 0);
-            if (!ec)
+#ifndef _WIN32
+    // This always fails on windows and ASIO won't
+    // even build it.
+    mSocket->next_layer().cancel(ec);
+#endif
+    mSocket->close(ec);
+}
+
+///////////////////////////////////////////////////////////////////////
+// TCPPeer
+///////////////////////////////////////////////////////////////////////
+
+TCPPeer::TCPPeer(Application& app, Peer::PeerRole role,
+                 std::shared_ptr<TCPPeer::SocketType> socket)
+    : Peer(app, role)
+    , mNetworkIOService(app.getNetworkIOService())
+    , mConnection(make_shared<Connection>(app, socket))
+    , mQueueDepth(
+          app.getMetrics().NewHistogram({"overlay", "inbound-queue", "depth"}))
+    , mQueueDelay(
+          app.getMetrics().NewTimer({"overlay", "inbound-queue", "delay"}))
+{
+}
+
+shared_ptr<TCPPeer::SocketType>
+TCPPeer::makeSocket(Application& app)
+{
+    auto io = app.getNetworkIOService();
+    return make_shared<SocketType>(io ? *io : app.getClock().getIOService());
+}
+
+TCPPeer::pointer
+TCPPeer::initiate(Application& app, PeerBareAddress const& address)
+{
+    assert(address.getType() == PeerBareAddress::Type::IPv4);
+
+    CLOG(DEBUG, "Overlay") << "TCPPeer:initiate"
+                           << " to " << address.toString();
+    assertThreadIsMain();
+    auto socket = makeSocket(app);
+    auto result = make_shared<TCPPeer>(app, WE_CALLED_REMOTE, socket);
+    result->mConnection->mPeer = result;
+    result->mAddress = address;
+    result->mRemoteEndpoint = asio::ip::tcp::endpoint(
+        asio::ip::address::from_string(address.getIP()), address.getPort());
+    result->startIdleTimer();
+    auto conn = result->mConnection;
+    socket->next_layer().async_connect(
+        result->mRemoteEndpoint,
+        conn->mStrand.wrap([conn](asio::error_code const& error) {
+            asio::error_code ec;
+            if (!error)
             {
-                if (!self->mWriteQueue.empty())
-                {
-                    self->messageSender();
-                }
-                else
-                {
-                    self->mWriting = false;
-                    // there is nothing to send and delayed shutdown was
-                    // requested - time to perform it
-                    if (self->mDelayedShutdown)
-                    {
-                        self->shutdown();
-                    }
-                }
+                asio::ip::tcp::no_delay nodelay(true);
+                conn->mSocket->next_layer().set_option(nodelay, ec);
+            }
+            else
+            {
+                ec = error;
             }
-        });
-        return;
-    }
 
-    // peek the buffer from the queue
-    // do not remove it yet as we need the buffer for the duration of the
-    // write operation
-    auto buf = mWriteQueue.front();
+            conn->postToPeer(
+                [ec](TCPPeer& peer) { peer.connectHandler(ec); });
+        }));
+    return result;
+}
 
-    asio::async_write(*(mSocket.get()),
-                      asio::buffer((*buf)->raw_data(), (*buf)->raw_size()),
-                      [self](asio::error_code const& ec, std::size_t length) {
-                          self->writeHandler(ec, length);
-                          self->mWriteQueue.pop(); // done with front element
+TCPPeer::pointer
+TCPPeer::accept(Application& app, shared_ptr<TCPPeer::SocketType> socket)
+{
+    assertThreadIsMain();
+    shared_ptr<TCPPeer> result;
+    asio::error_code ec;
 
-                          // continue processing the queue/flush
-                          if (!ec)
-                          {
-                              self->messageSender();
-                          }
-                      });
+    asio::ip::tcp::no_delay nodelay(true);
+    socket->next_layer().set_option(nodelay, ec);
+
+    asio::ip::tcp::endpoint endpoint;
+    if (!ec)
+    {
+        endpoint = socket->next_layer().remote_endpoint(ec);
+    }
+
+    if (!ec)
+    {
+        CLOG(DEBUG, "Overlay") << "TCPPeer:accept"
+                               << "@" << app.getConfig().PEER_PORT;
+        result = make_shared<TCPPeer>(app, REMOTE_CALLED_US, socket);
+        result->mConnection->mPeer = result;
+        result->mRemoteEndpoint = endpoint;
+        result->startIdleTimer();
+        result->startRead();
+    }
+    else
+    {
+        CLOG(DEBUG, "Overlay")
+            << "TCPPeer:accept"
+            << "@" << app.getConfig().PEER_PORT << " error " << ec.message();
+    }
+
+    return result;
 }
 
-void
-TCPPeer::writeHandler(asio::error_code const& error,
-                      std::size_t bytes_transferred)
+TCPPeer::~TCPPeer()
 {
     assertThreadIsMain();
-    mLastWrite = mApp.getClock().now();
+    mIdleTimer.cancel();
 
-    if (error)
+    // stops the connection from reading on, as it may outlive the peer
+    if (mNetworkIOService)
     {
-        if (isConnected())
-        {
-            // Only emit a warning if we have an error while connected;
-            // errors during shutdown or connection are common/expected.
-            mErrorWrite.Mark();
-            CLOG(ERROR, "Overlay")
-                << "TCPPeer::writeHandler error to " << toString();
-        }
-        if (mDelayedShutdown)
-        {
-            // delayed shutdown was requested - time to perform it
-            shutdown();
-        }
-        else
-        {
-            // no delayed shutdown - we can drop normally
-            drop();
-        }
+        auto conn = mConnection;
+        conn->mStrand.post([conn]() { conn->closeSocket(); });
     }
-    else if (bytes_transferred != 0)
+    else
     {
-        LoadManager::PeerContext loadCtx(mApp, mPeerID);
-        mMessageWrite.Mark();
-        mByteWrite.Mark(bytes_transferred);
+        mConnection->closeSocket();
+    }
+}
+
+PeerBareAddress
+TCPPeer::makeAddress(int remoteListeningPort) const
+{
+    if (remoteListeningPort <= 0 || remoteListeningPort > UINT16_MAX)
+    {
+        return PeerBareAddress{};
+    }
+    else
+    {
+        return PeerBareAddress{
+            mRemoteEndpoint.address().to_string(),
+            static_cast<unsigned short>(remoteListeningPort)};
     }
 }
 
 void
-TCPPeer::startRead()
+TCPPeer::sendMessage(xdr::msg_ptr&& xdrBytes)
 {
-    assertThreadIsMain();
-    if (shouldAbort())
+    if (mState == CLOSING)
     {
+        CLOG(ERROR, "Overlay")
+            << "Trying to send message to " << toString() << " after drop";
         return;
     }
 
-    auto self = static_pointer_cast<TCPPeer>(shared_from_this());
-
-    assert(self->mIncomingHeader.size() == 0);
-
     if (Logging::logTrace("Overlay"))
-        CLOG(TRACE, "Overlay") << "TCPPeer::startRead to " << self->toString();
-
-    self->mIncomingHeader.resize(4);
-    asio::async_read(*(self->mSocket.get()),
-                     asio::buffer(self->mIncomingHeader),
-                     [self](asio::error_code ec, std::size_t length) {
-                         if (Logging::logTrace("Overlay"))
-                             CLOG(TRACE, "Overlay")
-                                 << "TCPPeer::startRead calledback " << ec
-                                 << " length:" << length;
-                         self->readHeaderHandler(ec, length);
-                     });
+        CLOG(TRACE, "Overlay") << "TCPPeer:sendMessage to " << toString();
+    assertThreadIsMain();
+
+    // places the buffer to write into the write queue
+    auto buf = std::make_shared<xdr::msg_ptr>(std::move(xdrBytes));
+    auto conn = mConnection;
+    conn->mStrand.post([conn, buf]() {
+        conn->queueWrite(Connection::Outgoing{nullptr, false, 0, move(*buf)});
+    });
 }
 
-int
-TCPPeer::getIncomingMsgLength()
+void
+TCPPeer::queueMessage(std::shared_ptr<EncodedMessage const> const& msg)
 {
-    int length = mIncomingHeader[0];
-    length &= 0x7f; // clear the XDR 'continuation' bit
-    length <<= 8;
-    length |= mIncomingHeader[1];
-    length <<= 8;
-    length |= mIncomingHeader[2];
-    length <<= 8;
-    length |= mIncomingHeader[3];
-    if (length <= 0 ||
-        (!isAuthenticated() && (length > MAX_UNAUTH_MESSAGE_SIZE)) ||
-        length > MAX_MESSAGE_SIZE)
+    if (mState == CLOSING)
     {
-        mErrorRead.Mark();
         CLOG(ERROR, "Overlay")
-            << "TCP: message size unacceptable: " << length
-            << (isAuthenticated() ? "" : " while not authenticated");
-        drop();
-        length = 0;
+            << "Trying to send message to " << toString() << " after drop";
+        return;
     }
-    return (length);
+
+    if (Logging::logTrace("Overlay"))
+        CLOG(TRACE, "Overlay") << "TCPPeer:queueMessage to " << toString();
+    assertThreadIsMain();
+
+    auto type = msg->getMessage().type();
+    bool authenticate = type != HELLO && type != ERROR_MSG;
+    auto conn = mConnection;
+    if (authenticate && !mConnectionSendKeyGiven)
+    {
+        // from now on, the connection frames messages with the sending key
+        mConnectionSendKeyGiven = true;
+        auto key = mSendMacKey;
+        auto seq = mSendMacSeq;
+        auto flowControl = mFlowControl;
+        conn->mStrand.post([conn, key, seq, flowControl]() {
+            conn->mSendMacKey = key;
+            conn->mSendMacSeq = seq;
+            conn->mFlowControl = flowControl;
+        });
+    }
+    auto ledgerSeq = mApp.getLedgerManager().getLastClosedLedgerNum();
+    conn->mStrand.post([conn, msg, authenticate, ledgerSeq]() {
+        conn->queueWrite(
+            Connection::Outgoing{msg, authenticate, ledgerSeq, nullptr});
+    });
+}
+
+void
+TCPPeer::addOutboundCredits(uint32_t numMessages)
+{
+    assertThreadIsMain();
+    auto conn = mConnection;
+    conn->mStrand.post(
+        [conn, numMessages]() { conn->addCredits(numMessages); });
+}
+
+void
+TCPPeer::ledgerClosed(uint32_t lastClosedLedgerSeq)
+{
+    assertThreadIsMain();
+    auto conn = mConnection;
+    conn->mStrand.post([conn, lastClosedLedgerSeq]() {
+        conn->dropStaleTransactions(lastClosedLedgerSeq);
+    });
+}
+
+Peer::OutboundQueueStats
+TCPPeer::getOutboundQueueStats() const
+{
+    lock_guard<mutex> lock(mConnection->mMutex);
+    return mConnection->mOutboundStats;
 }
 
 void
@@ -364,95 +871,163 @@ TCPPeer::connected()
 }
 
 void
-TCPPeer::readHeaderHandler(asio::error_code const& error,
-                           std::size_t bytes_transferred)
+TCPPeer::startRead()
 {
     assertThreadIsMain();
-    // LOG(DEBUG) << "TCPPeer::readHeaderHandler "
-    //     << "@" << mApp.getConfig().PEER_PORT
-    //     << " to " << mRemoteListeningPort
-    //     << (error ? "error " : "") << " bytes:" << bytes_transferred;
+    if (shouldAbort())
+    {
+        return;
+    }
 
-    if (!error)
+    if (Logging::logTrace("Overlay"))
+        CLOG(TRACE, "Overlay") << "TCPPeer::startRead to " << toString();
+
+    auto conn = mConnection;
+    if (isAuthenticated() && !mConnectionAuthenticated)
     {
-        receivedBytes(bytes_transferred, false);
-        int length = getIncomingMsgLength();
-        if (length != 0)
-        {
-            mIncomingBody.resize(length);
-            auto self = static_pointer_cast<TCPPeer>(shared_from_this());
-            asio::async_read(*mSocket.get(), asio::buffer(mIncomingBody),
-                             [self](asio::error_code ec, std::size_t length) {
-                                 self->readBodyHandler(ec, length);
-                             });
-        }
+        // from now on, the connection checks MACs
+        mConnectionAuthenticated = true;
+        auto key = mRecvMacKey;
+        conn->mStrand.post([conn, key]() {
+            conn->authenticate(key);
+            conn->startRead();
+        });
     }
     else
     {
-        if (isConnected())
-        {
-            // Only emit a warning if we have an error while connected;
-            // errors during shutdown or connection are common/expected.
-            mErrorRead.Mark();
-            CLOG(ERROR, "Overlay")
-                << "readHeaderHandler error: " << error.message() << " :"
-                << toString();
-        }
-        drop();
+        conn->mStrand.post([conn]() { conn->startRead(); });
     }
 }
 
 void
-TCPPeer::readBodyHandler(asio::error_code const& error,
-                         std::size_t bytes_transferred)
+TCPPeer::processIncoming()
 {
     assertThreadIsMain();
-    // LOG(DEBUG) << "TCPPeer::readBodyHandler "
-    //     << "@" << mApp.getConfig().PEER_PORT
-    //     << " to " << mRemoteListeningPort
-    //     << (error ? "error " : "") << " bytes:" << bytes_transferred;
+    deque<Connection::Incoming> incoming;
+    {
+        lock_guard<mutex> lock(mConnection->mMutex);
+        incoming.swap(mConnection->mIncoming);
+    }
+    if (incoming.empty())
+    {
+        return;
+    }
 
-    if (!error)
+    mQueueDepth.Update(incoming.size());
+    auto now = chrono::steady_clock::now();
+    for (auto const& item : incoming)
     {
-        receivedBytes(bytes_transferred, true);
-        recvMessage();
-        mIncomingHeader.clear();
-        startRead();
+        mQueueDelay.Update(now - item.mReceivedAt);
     }
-    else
+
+    for (auto const& item : incoming)
     {
-        if (isConnected())
+        // remaining messages are dropped along with the peer
+        if (shouldAbort())
         {
-            // Only emit a warning if we have an error while connected;
-            // errors during shutdown or connection are common/expected.
-            mErrorRead.Mark();
-            CLOG(ERROR, "Overlay")
-                << "readBodyHandler error: " << error.message() << " :"
-                << toString();
+            return;
         }
-        drop();
+        receivedBytes(item.mBytes, true);
+        if (item.mKnownTransaction)
+        {
+            recvKnownTransaction(item.mMessage.v0().sequence, item.mHash);
+        }
+        else
+        {
+            recvMessage(item.mMessage, item.mMacVerified);
+        }
+    }
+
+    // if reading is paused and more messages were queued in the meantime,
+    // it's resumed once they are processed
+    bool resume = false;
+    {
+        lock_guard<mutex> lock(mConnection->mMutex);
+        if (mConnection->mReadPaused && mConnection->mIncoming.empty())
+        {
+            mConnection->mReadPaused = false;
+            resume = true;
+        }
+    }
+    if (resume)
+    {
+        startRead();
     }
 }
 
 void
-TCPPeer::recvMessage()
+TCPPeer::processWritten()
 {
     assertThreadIsMain();
-    try
+    size_t messages;
+    size_t bytes;
     {
-        xdr::xdr_get g(mIncomingBody.data(),
-                       mIncomingBody.data() + mIncomingBody.size());
-        AuthenticatedMessage am;
-        xdr::xdr_argpack_archive(g, am);
-        Peer::recvMessage(am);
+        lock_guard<mutex> lock(mConnection->mMutex);
+        messages = mConnection->mWrittenMessages;
+        bytes = mConnection->mWrittenBytes;
+        mConnection->mWrittenMessages = 0;
+        mConnection->mWrittenBytes = 0;
     }
-    catch (xdr::xdr_runtime_error& e)
+
+    LoadManager::PeerContext loadCtx(mApp, mPeerID);
+    mLastWrite = mApp.getClock().now();
+    mMessageWrite.Mark(messages);
+    mByteWrite.Mark(bytes);
+}
+
+void
+TCPPeer::readError(std::string const& where, asio::error_code const& error)
+{
+    assertThreadIsMain();
+    if (isConnected())
     {
-        CLOG(ERROR, "Overlay") << "recvMessage got a corrupt xdr: " << e.what();
-        Peer::drop(ERR_DATA, "received corrupt XDR");
+        // Only emit a warning if we have an error while connected;
+        // errors during shutdown or connection are common/expected.
+        mErrorRead.Mark();
+        CLOG(ERROR, "Overlay") << where << " error: " << error.message()
+                               << " :" << toString();
+    }
+    drop();
+}
+
+void
+TCPPeer::writeError(bool dropPeer)
+{
+    assertThreadIsMain();
+    mLastWrite = mApp.getClock().now();
+    if (isConnected())
+    {
+        // Only emit a warning if we have an error while connected;
+        // errors during shutdown or connection are common/expected.
+        mErrorWrite.Mark();
+        CLOG(ERROR, "Overlay")
+            << "TCPPeer::writeHandler error to " << toString();
+    }
+    if (dropPeer)
+    {
+        drop();
     }
 }
 
+void
+TCPPeer::messageSizeError(int length)
+{
+    assertThreadIsMain();
+    mErrorRead.Mark();
+    CLOG(ERROR, "Overlay")
+        << "TCP: message size unacceptable: " << length
+        << (isAuthenticated() ? "" : " while not authenticated");
+    drop();
+}
+
+void
+TCPPeer::decodeError(std::string const& what)
+{
+    assertThreadIsMain();
+    CLOG(ERROR, "Overlay") << "recvMessage got a corrupt xdr: " << what;
+    Peer::drop(ERR_DATA, "received corrupt XDR");
+}
+
 void
 TCPPeer::drop(bool force)
 {
@@ -466,18 +1041,12 @@ TCPPeer::drop(bool force)
                            << mState << " we called:" << mRole;
 
     mState = CLOSING;
+    mIdleTimer.cancel();
 
     auto self = static_pointer_cast<TCPPeer>(shared_from_this());
     getApp().getOverlayManager().dropPeer(this);
 
-    // if write queue is not empty, messageSender will take care of shutdown
-    if (force || !mWriting)
-    {
-        self->shutdown();
-    }
-    else
-    {
-        self->mDelayedShutdown = true;
-    }
+    auto conn = mConnection;
+    conn->mStrand.post([conn, force]() { conn->close(force); });
 }
 }
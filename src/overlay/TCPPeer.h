@@ -6,11 +6,12 @@
 
 #include "overlay/Peer.h"
 #include "util/Timer.h"
-#include <queue>
 
 namespace medida
 {
+class Histogram;
 class Meter;
+class Timer;
 }
 
 namespace stellar
@@ -20,39 +21,65 @@ static auto const MAX_UNAUTH_MESSAGE_SIZE = 0x1000;
 static auto const MAX_MESSAGE_SIZE = 0x1000000;
 
 // Peer that communicates via a TCP socket.
+//
+// The socket is owned by a Connection, that runs all operations on the socket
+// through a strand of the network io_service (see
+// Application::getNetworkIOService, or the main io_service if there are no
+// network threads): reading, writing and shutting down. Incoming messages are
+// decoded there (except for transactions we already have, see
+// Peer::isKnownTransaction), their MAC is checked once the peer is
+// authenticated, and they are handed over to the main thread through a queue
+// of bounded size: reading stops while the queue is full. Until the peer is
+// authenticated, the next message is only read once the main thread processed
+// the previous one, as it determines how large messages may be.
+//
+// Outgoing messages are framed by the connection as they are written, so
+// that SCP and other control messages can be sent ahead of queued
+// transactions; queued messages are written together with a single
+// scatter-gather write. Once the transactions queued for a peer exceed
+// OUTBOUND_TX_QUEUE_BYTE_LIMIT, the oldest ones are dropped, as are the ones
+// queued before the last ledger closed. With flow control, transactions are
+// only written while the peer lets us send more of them.
+//
+// Socket operations only keep the Connection alive, never the TCPPeer, which
+// must be destroyed on the main thread.
 class TCPPeer : public Peer
 {
   public:
     typedef asio::buffered_stream<asio::ip::tcp::socket> SocketType;
 
   private:
-    std::shared_ptr<SocketType> mSocket;
-    std::vector<uint8_t> mIncomingHeader;
-    std::vector<uint8_t> mIncomingBody;
+    struct Connection;
 
-    std::queue<std::shared_ptr<xdr::msg_ptr>> mWriteQueue;
-    bool mWriting{false};
-    bool mDelayedShutdown{false};
-    bool mShutdownScheduled{false};
+    // declared first, so that the connection (and its socket) goes first
+    std::shared_ptr<asio::io_service> mNetworkIOService;
+    std::shared_ptr<Connection> mConnection;
+    asio::ip::tcp::endpoint mRemoteEndpoint;
+    // set once the MAC key was given to the connection
+    bool mConnectionAuthenticated{false};
+    // set once the sending MAC key was given to the connection
+    bool mConnectionSendKeyGiven{false};
+
+    medida::Histogram& mQueueDepth;
+    medida::Timer& mQueueDelay;
 
     PeerBareAddress makeAddress(int remoteListeningPort) const override;
 
-    void recvMessage();
     void sendMessage(xdr::msg_ptr&& xdrBytes) override;
+    void
+    queueMessage(std::shared_ptr<EncodedMessage const> const& msg) override;
+    void addOutboundCredits(uint32_t numMessages) override;
 
-    void messageSender();
-
-    int getIncomingMsgLength();
     virtual void connected() override;
     void startRead();
 
-    void writeHandler(asio::error_code const& error,
-                      std::size_t bytes_transferred) override;
-    void readHeaderHandler(asio::error_code const& error,
-                           std::size_t bytes_transferred) override;
-    void readBodyHandler(asio::error_code const& error,
-                         std::size_t bytes_transferred) override;
-    void shutdown();
+    // called on the main thread by the connection
+    void processIncoming();
+    void processWritten();
+    void readError(std::string const& where, asio::error_code const& error);
+    void writeError(bool dropPeer);
+    void messageSizeError(int length);
+    void decodeError(std::string const& what);
 
   public:
     typedef std::shared_ptr<TCPPeer> pointer;
@@ -66,8 +93,14 @@ class TCPPeer : public Peer
     static pointer initiate(Application& app, PeerBareAddress const& address);
     static pointer accept(Application& app, std::shared_ptr<SocketType> socket);
 
+    // creates a socket on the io_service serving peers
+    static std::shared_ptr<SocketType> makeSocket(Application& app);
+
     virtual ~TCPPeer();
 
     virtual void drop(bool force = true) override;
+
+    OutboundQueueStats getOutboundQueueStats() const override;
+    void ledgerClosed(uint32_t lastClosedLedgerSeq) override;
 };
 }
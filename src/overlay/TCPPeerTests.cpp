@@ -6,6 +6,10 @@
 #include "lib/catch.hpp"
 #include "main/Application.h"
 #include "main/Config.h"
+#include "medida/histogram.h"
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+#include "medida/timer.h"
 #include "overlay/OverlayManager.h"
 #include "overlay/PeerBareAddress.h"
 #include "overlay/PeerDoor.h"
@@ -19,9 +23,23 @@ namespace stellar
 
 TEST_CASE("TCPPeer can communicate", "[overlay]")
 {
+    uint32_t networkThreads = 0;
+    SECTION("on the main thread")
+    {
+    }
+    SECTION("on network threads")
+    {
+        networkThreads = 2;
+    }
+
     Hash networkID = sha256(getTestConfig().NETWORK_PASSPHRASE);
-    Simulation::pointer s =
-        std::make_shared<Simulation>(Simulation::OVER_TCP, networkID);
+    Simulation::pointer s = std::make_shared<Simulation>(
+        Simulation::OVER_TCP, networkID, [&](int i) {
+            auto cfg = getTestConfig(i);
+            cfg.ARTIFICIALLY_ACCELERATE_TIME_FOR_TESTING = true;
+            cfg.NETWORK_IO_THREADS = networkThreads;
+            return cfg;
+        });
 
     auto v10SecretKey = SecretKey::fromSeed(sha256("v10"));
     auto v11SecretKey = SecretKey::fromSeed(sha256("v11"));
@@ -51,6 +69,23 @@ TEST_CASE("TCPPeer can communicate", "[overlay]")
     REQUIRE(p1);
     REQUIRE(p0->isAuthenticated());
     REQUIRE(p1->isAuthenticated());
+
+    // messages past the handshake went through the MAC checks
+    for (auto app : {n0, n1})
+    {
+        auto& metrics = app->getMetrics();
+        REQUIRE(metrics.NewTimer({"overlay", "inbound-queue", "delay"})
+                    .count() > 2);
+        REQUIRE(metrics
+                    .NewMeter({"overlay", "drop", "recv-message-mac"}, "drop")
+                    .count() == 0);
+        // writes went through the outbound queues, that never overflowed
+        REQUIRE(metrics.NewHistogram({"overlay", "outbound-queue", "batch"})
+                    .count() > 0);
+        REQUIRE(metrics.NewMeter({"overlay", "outbound-queue", "drop"},
+                                 "message")
+                    .count() == 0);
+    }
     s->stopAllNodes();
 }
 }
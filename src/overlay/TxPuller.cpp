@@ -0,0 +1,181 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "overlay/TxPuller.h"
+#include "main/Application.h"
+#include "medida/counter.h"
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+
+namespace stellar
+{
+
+static std::chrono::milliseconds const MS_TO_WAIT_FOR_DEMAND_REPLY{1000};
+// peers kept as fallbacks for each transaction
+static size_t const MAX_PEERS_TO_ASK = 8;
+
+TxPuller::TxPuller(Application& app)
+    : mApp(app)
+    , mTimer(app)
+    , mDemanded(app.getMetrics().NewMeter({"overlay", "tx-pull", "demand"},
+                                          "transaction"))
+    , mRetried(app.getMetrics().NewMeter({"overlay", "tx-pull", "retry"},
+                                         "transaction"))
+    , mAbandoned(app.getMetrics().NewMeter({"overlay", "tx-pull", "abandon"},
+                                           "transaction"))
+    , mPending(app.getMetrics().NewCounter({"overlay", "tx-pull", "pending"}))
+{
+}
+
+void
+TxPuller::advertised(Peer::pointer peer, std::vector<Hash> const& hashes)
+{
+    std::vector<Hash> toDemand;
+    auto now = mApp.getClock().now();
+    for (auto const& h : hashes)
+    {
+        auto it = mDemands.find(h);
+        if (it == mDemands.end())
+        {
+            auto& demand = mDemands[h];
+            demand.mLastAskedPeer = peer;
+            demand.mLastAsked = now;
+            toDemand.emplace_back(h);
+        }
+        else if (it->second.mPeersToAsk.size() < MAX_PEERS_TO_ASK)
+        {
+            it->second.mPeersToAsk.emplace_back(peer);
+        }
+    }
+
+    if (!toDemand.empty())
+    {
+        mDemanded.Mark(toDemand.size());
+        peer->sendFloodDemand(toDemand);
+        scheduleRetries();
+    }
+    updateSize();
+}
+
+bool
+TxPuller::askNextPeer(
+    Hash const& h, Demand& demand,
+    std::unordered_map<Peer::pointer, std::vector<Hash>>& toSend)
+{
+    while (!demand.mPeersToAsk.empty())
+    {
+        auto peer = demand.mPeersToAsk.front().lock();
+        demand.mPeersToAsk.pop_front();
+        if (peer && peer->isAuthenticated())
+        {
+            demand.mLastAskedPeer = peer;
+            demand.mLastAsked = mApp.getClock().now();
+            toSend[peer].emplace_back(h);
+            return true;
+        }
+    }
+    return false;
+}
+
+void
+TxPuller::send(std::unordered_map<Peer::pointer, std::vector<Hash>>& toSend)
+{
+    for (auto const& kv : toSend)
+    {
+        mRetried.Mark(kv.second.size());
+        kv.first->sendFloodDemand(kv.second);
+    }
+}
+
+void
+TxPuller::doesntHave(Peer::pointer peer, Hash const& h)
+{
+    auto it = mDemands.find(h);
+    if (it == mDemands.end() || it->second.mLastAskedPeer.lock() != peer)
+    {
+        return;
+    }
+
+    std::unordered_map<Peer::pointer, std::vector<Hash>> toSend;
+    if (!askNextPeer(h, it->second, toSend))
+    {
+        mAbandoned.Mark();
+        mDemands.erase(it);
+    }
+    send(toSend);
+    updateSize();
+}
+
+void
+TxPuller::received(Hash const& h)
+{
+    if (mDemands.erase(h) != 0)
+    {
+        updateSize();
+    }
+}
+
+bool
+TxPuller::isDemanding(Hash const& h) const
+{
+    return mDemands.find(h) != mDemands.end();
+}
+
+void
+TxPuller::scheduleRetries()
+{
+    if (mTimerScheduled || mDemands.empty())
+    {
+        return;
+    }
+    mTimerScheduled = true;
+    mTimer.expires_from_now(MS_TO_WAIT_FOR_DEMAND_REPLY);
+    mTimer.async_wait([this]() { retry(); }, VirtualTimer::onFailureNoop);
+}
+
+void
+TxPuller::retry()
+{
+    mTimerScheduled = false;
+    auto now = mApp.getClock().now();
+    std::unordered_map<Peer::pointer, std::vector<Hash>> toSend;
+    for (auto it = mDemands.begin(); it != mDemands.end();)
+    {
+        if (now - it->second.mLastAsked < MS_TO_WAIT_FOR_DEMAND_REPLY ||
+            askNextPeer(it->first, it->second, toSend))
+        {
+            ++it;
+        }
+        else
+        {
+            mAbandoned.Mark();
+            it = mDemands.erase(it);
+        }
+    }
+    send(toSend);
+    updateSize();
+    scheduleRetries();
+}
+
+void
+TxPuller::updateSize()
+{
+    mPending.set_count(mDemands.size());
+}
+
+size_t
+TxPuller::size() const
+{
+    return mDemands.size();
+}
+
+void
+TxPuller::shutdown()
+{
+    mTimer.cancel();
+    mTimerScheduled = false;
+    mDemands.clear();
+    updateSize();
+}
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "overlay/Peer.h"
+#include "util/HashOfHash.h"
+#include "util/NonCopyable.h"
+#include "util/Timer.h"
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace medida
+{
+class Counter;
+class Meter;
+}
+
+namespace stellar
+{
+class Application;
+
+/**
+ * Demands (FLOOD_DEMAND) the transactions that peers advertised to us
+ * (FLOOD_ADVERT) and that we haven't seen yet, identified by the hash of the
+ * StellarMessage carrying them.
+ *
+ * Like a Tracker, each transaction is demanded from a single peer at a time:
+ * the first one that advertised it, then the next one if it doesn't have it
+ * anymore (DONT_HAVE) or doesn't send it in time. A transaction is given up
+ * on once all the peers that advertised it were asked.
+ */
+class TxPuller : NonMovableOrCopyable
+{
+    struct Demand
+    {
+        std::weak_ptr<Peer> mLastAskedPeer;
+        VirtualClock::time_point mLastAsked;
+        // peers that advertised the transaction, not asked yet
+        std::deque<std::weak_ptr<Peer>> mPeersToAsk;
+    };
+
+    Application& mApp;
+    std::unordered_map<Hash, Demand> mDemands;
+    VirtualTimer mTimer;
+    bool mTimerScheduled{false};
+
+    medida::Meter& mDemanded;
+    medida::Meter& mRetried;
+    medida::Meter& mAbandoned;
+    medida::Counter& mPending;
+
+    // demands `h` from the next peer to ask, returning false if there is
+    // none left
+    bool askNextPeer(
+        Hash const& h, Demand& demand,
+        std::unordered_map<Peer::pointer, std::vector<Hash>>& toSend);
+    void send(std::unordered_map<Peer::pointer, std::vector<Hash>>& toSend);
+    void scheduleRetries();
+    void retry();
+    void updateSize();
+
+  public:
+    explicit TxPuller(Application& app);
+
+    // `peer` advertised transactions we haven't seen yet
+    void advertised(Peer::pointer peer, std::vector<Hash> const& hashes);
+
+    // `peer` doesn't have the transaction we demanded
+    void doesntHave(Peer::pointer peer, Hash const& h);
+
+    // a transaction was received, from any peer
+    void received(Hash const& h);
+
+    // true if the transaction with hash `h` is being demanded
+    bool isDemanding(Hash const& h) const;
+
+    // number of transactions being demanded
+    size_t size() const;
+
+    void shutdown();
+};
+}
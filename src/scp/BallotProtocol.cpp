@@ -16,6 +16,7 @@
 #include "util/make_unique.h"
 #include "util/types.h"
 #include "xdrpp/marshal.h"
+#include <algorithm>
 #include <functional>
 
 namespace stellar
@@ -150,6 +151,41 @@ BallotProtocol::recordEnvelope(SCPEnvelope const& env)
 
 SCP::EnvelopeState
 BallotProtocol::processEnvelope(SCPEnvelope const& envelope, bool self)
+{
+    bool advance = false;
+    auto res = checkAndRecordEnvelope(envelope, self, advance);
+    if (advance)
+    {
+        advanceSlot(envelope.statement);
+    }
+    return res;
+}
+
+std::vector<SCP::EnvelopeState>
+BallotProtocol::processEnvelopes(
+    std::vector<SCPEnvelope const*> const& envelopes)
+{
+    std::vector<SCP::EnvelopeState> res;
+    std::vector<SCPStatement const*> hints;
+    for (auto envelope : envelopes)
+    {
+        bool advance = false;
+        res.emplace_back(checkAndRecordEnvelope(*envelope, false, advance));
+        if (advance)
+        {
+            hints.emplace_back(&envelope->statement);
+        }
+    }
+    if (!hints.empty())
+    {
+        advanceSlot(hints);
+    }
+    return res;
+}
+
+SCP::EnvelopeState
+BallotProtocol::checkAndRecordEnvelope(SCPEnvelope const& envelope, bool self,
+                                       bool& advance)
 {
     SCP::EnvelopeState res = SCP::EnvelopeState::INVALID;
     dbgAssert(envelope.statement.slotIndex == mSlot.getSlotIndex());
@@ -198,7 +234,7 @@ BallotProtocol::processEnvelope(SCPEnvelope const& envelope, bool self)
 
             recordEnvelope(envelope);
             processed = true;
-            advanceSlot(statement);
+            advance = true;
             res = SCP::EnvelopeState::VALID;
         }
 
@@ -1353,9 +1389,8 @@ BallotProtocol::attemptBump()
                 break;
             }
 
-            bool vBlocking = LocalNode::isVBlocking(
-                getLocalNode()->getQuorumSet(), mLatestEnvelopes,
-                [&](SCPStatement const& st) {
+            bool vBlocking = getLocalNode()->isVBlocking(
+                mLatestEnvelopes, [&](SCPStatement const& st) {
                     bool res;
                     auto const& pl = st.pledges;
                     if (pl.type() == SCP_ST_PREPARE)
@@ -1794,6 +1829,12 @@ BallotProtocol::getExternalizingState() const
 
 void
 BallotProtocol::advanceSlot(SCPStatement const& hint)
+{
+    advanceSlot(std::vector<SCPStatement const*>{&hint});
+}
+
+void
+BallotProtocol::advanceSlot(std::vector<SCPStatement const*> const& hints)
 {
     mCurrentMessageLevel++;
     if (Logging::logDebug("SCP"))
@@ -1815,13 +1856,28 @@ BallotProtocol::advanceSlot(SCPStatement const& hint)
 
     bool didWork = false;
 
-    didWork = attemptPreparedAccept(hint) || didWork;
+    // the attempt* methods only use the pledges of the hint, that are often
+    // the same for many of the nodes
+    std::vector<SCPStatement const*> tried;
+    for (auto hint : hints)
+    {
+        if (std::any_of(tried.begin(), tried.end(),
+                        [hint](SCPStatement const* st) {
+                            return st->pledges == hint->pledges;
+                        }))
+        {
+            continue;
+        }
+        tried.emplace_back(hint);
+
+        didWork = attemptPreparedAccept(*hint) || didWork;
 
-    didWork = attemptPreparedConfirmed(hint) || didWork;
+        didWork = attemptPreparedConfirmed(*hint) || didWork;
 
-    didWork = attemptAcceptCommit(hint) || didWork;
+        didWork = attemptAcceptCommit(*hint) || didWork;
 
-    didWork = attemptConfirmCommit(hint) || didWork;
+        didWork = attemptConfirmCommit(*hint) || didWork;
+    }
 
     // only bump after we're done with everything else
     if (mCurrentMessageLevel == 1)
@@ -2085,9 +2141,10 @@ BallotProtocol::checkHeardFromQuorum()
     // for a given counter on the local node
     if (mCurrentBallot)
     {
-        if (LocalNode::isQuorum(
-                getLocalNode()->getQuorumSet(), mLatestEnvelopes,
-                std::bind(&Slot::getQuorumSetFromStatement, &mSlot, _1),
+        if (getLocalNode()->isQuorum(
+                mLatestEnvelopes,
+                std::bind(&Slot::getCompiledQuorumSetFromStatement, &mSlot,
+                          _1),
                 [&](SCPStatement const& st) {
                     bool res;
                     if (st.pledges.type() == SCP_ST_PREPARE)
@@ -11,6 +11,7 @@
 #include <set>
 #include <string>
 #include <utility>
+#include <vector>
 
 namespace stellar
 {
@@ -66,6 +67,11 @@ class BallotProtocol
     // trigger more potential state changes
     SCP::EnvelopeState processEnvelope(SCPEnvelope const& envelope, bool self);
 
+    // Process envelopes received together from other nodes: they are all
+    // recorded before the slot is advanced once.
+    std::vector<SCP::EnvelopeState>
+    processEnvelopes(std::vector<SCPEnvelope const*> const& envelopes);
+
     void ballotProtocolTimerExpired();
     // abandon's current ballot, move to a new ballot
     // at counter `n` (or, if n == 0, increment current counter)
@@ -112,10 +118,17 @@ class BallotProtocol
     std::vector<SCPEnvelope> getExternalizingState() const;
 
   private:
+    // checks the envelope and records it if valid, setting `advance` if the
+    // slot should then be advanced with its statement as a hint
+    SCP::EnvelopeState checkAndRecordEnvelope(SCPEnvelope const& envelope,
+                                              bool self, bool& advance);
+
     // attempts to make progress using the latest statement as a hint
     // calls into the various attempt* methods, emits message
     // to make progress
     void advanceSlot(SCPStatement const& hint);
+    // same, with the statements of a batch of envelopes as hints
+    void advanceSlot(std::vector<SCPStatement const*> const& hints);
 
     // returns true if all values in statement are valid
     SCPDriver::ValidationLevel validateValues(SCPStatement const& st);
@@ -277,6 +277,31 @@ LocalNode::isQuorum(
     return isQuorumSlice(qSet, pNodes);
 }
 
+bool
+LocalNode::isVBlocking(std::map<NodeID, SCPEnvelope> const& map,
+                       QuorumEvaluator::StatementFilter const& filter)
+{
+    mQuorumEvaluator.trim();
+    auto qSet = mQuorumEvaluator.compile(mQSetHash, mQSet);
+    return mQuorumEvaluator.isVBlocking(*qSet, map, filter);
+}
+
+bool
+LocalNode::isQuorum(std::map<NodeID, SCPEnvelope> const& map,
+                    QuorumEvaluator::QSetFun const& qfun,
+                    QuorumEvaluator::StatementFilter const& filter)
+{
+    mQuorumEvaluator.trim();
+    auto qSet = mQuorumEvaluator.compile(mQSetHash, mQSet);
+    return mQuorumEvaluator.isQuorum(*qSet, map, qfun, filter);
+}
+
+QuorumEvaluator&
+LocalNode::getQuorumEvaluator()
+{
+    return mQuorumEvaluator;
+}
+
 std::vector<NodeID>
 LocalNode::findClosestVBlocking(
     SCPQuorumSet const& qset, std::map<NodeID, SCPEnvelope> const& map,
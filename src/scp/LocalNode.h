@@ -8,6 +8,7 @@
 #include <set>
 #include <vector>
 
+#include "scp/QuorumEvaluator.h"
 #include "scp/SCP.h"
 #include "util/HashOfHash.h"
 
@@ -30,6 +31,8 @@ class LocalNode
 
     SCP* mSCP;
 
+    QuorumEvaluator mQuorumEvaluator;
+
   public:
     LocalNode(NodeID const& nodeID, bool isValidator, SCPQuorumSet const& qSet,
               SCP* scp);
@@ -86,6 +89,17 @@ class LocalNode
              std::function<bool(SCPStatement const&)> const& filter =
                  [](SCPStatement const&) { return true; });
 
+    // same as `isVBlocking` and `isQuorum` for the local quorum set, using
+    // compiled quorum sets. `qfun` returns the compiled quorum set of the node
+    // of a statement, obtained from getQuorumEvaluator()
+    bool isVBlocking(std::map<NodeID, SCPEnvelope> const& map,
+                     QuorumEvaluator::StatementFilter const& filter);
+    bool isQuorum(std::map<NodeID, SCPEnvelope> const& map,
+                  QuorumEvaluator::QSetFun const& qfun,
+                  QuorumEvaluator::StatementFilter const& filter);
+
+    QuorumEvaluator& getQuorumEvaluator();
+
     // computes the distance to the set of v-blocking sets given
     // a set of nodes that agree (but can fail)
     // excluded, if set will be skipped altogether
@@ -0,0 +1,306 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "scp/QuorumEvaluator.h"
+#include "util/XDROperators.h"
+#include <limits>
+
+namespace stellar
+{
+
+size_t const QuorumEvaluator::NO_PARENT = std::numeric_limits<size_t>::max();
+
+namespace
+{
+// past these, the caches are cleared by trim
+size_t const MAX_COMPILED_QSETS = 1000;
+size_t const MAX_NODE_INDEXES = 10000;
+
+typedef QuorumEvaluator::CompiledQSet::InnerSet InnerSet;
+
+bool
+isSliceSatisfied(InnerSet const& s, uint32 count)
+{
+    return s.mThreshold != 0 && count >= s.mThreshold;
+}
+
+bool
+isSetBlocked(InnerSet const& s, uint32 count)
+{
+    // same as LocalNode::isVBlockingInternal, including for insane sets
+    return s.mThreshold != 0 && count != 0 &&
+           int64_t(count) >= 1 + int64_t(s.mSize) - int64_t(s.mThreshold);
+}
+
+// counts, for each set of `qSet`, its validators in `nodes` and its inner
+// sets for which `done` holds
+std::vector<uint32>
+countInSets(QuorumEvaluator::CompiledQSet const& qSet,
+            std::vector<bool> const& nodes,
+            bool (*done)(InnerSet const&, uint32))
+{
+    std::vector<uint32> counts(qSet.mSets.size(), 0);
+    for (size_t i = qSet.mSets.size(); i-- != 0;)
+    {
+        auto const& s = qSet.mSets[i];
+        for (auto v : s.mValidators)
+        {
+            if (v < nodes.size() && nodes[v])
+            {
+                counts[i]++;
+            }
+        }
+        if (s.mParent != QuorumEvaluator::NO_PARENT && done(s, counts[i]))
+        {
+            counts[s.mParent]++;
+        }
+    }
+    return counts;
+}
+
+// takes one member out of set `i`, returning false if the top level set is
+// not satisfied anymore
+bool
+removeFromSet(QuorumEvaluator::CompiledQSet const& qSet,
+              std::vector<uint32>& counts, size_t i)
+{
+    while (true)
+    {
+        auto const& s = qSet.mSets[i];
+        bool wasSatisfied = isSliceSatisfied(s, counts[i]);
+        counts[i]--;
+        if (!wasSatisfied || isSliceSatisfied(s, counts[i]))
+        {
+            return true;
+        }
+        if (s.mParent == QuorumEvaluator::NO_PARENT)
+        {
+            return false;
+        }
+        i = s.mParent;
+    }
+}
+}
+
+size_t
+QuorumEvaluator::getNodeIndex(NodeID const& nodeID)
+{
+    return mNodeIndexes.emplace(nodeID, mNodeIndexes.size()).first->second;
+}
+
+void
+QuorumEvaluator::compileInternal(SCPQuorumSet const& qSet, size_t parent,
+                                 CompiledQSet& res)
+{
+    size_t index = res.mSets.size();
+    res.mSets.emplace_back();
+    auto& s = res.mSets.back();
+    s.mThreshold = qSet.threshold;
+    s.mSize = static_cast<uint32>(qSet.validators.size() +
+                                  qSet.innerSets.size());
+    s.mParent = parent;
+    for (auto const& v : qSet.validators)
+    {
+        auto node = getNodeIndex(v);
+        s.mValidators.emplace_back(node);
+        res.mOccurrences[node].emplace_back(index);
+    }
+    // `s` is invalidated from here
+    for (auto const& inner : qSet.innerSets)
+    {
+        compileInternal(inner, index, res);
+    }
+}
+
+QuorumEvaluator::CompiledQSetPtr
+QuorumEvaluator::getCompiled(Hash const& qSetHash) const
+{
+    auto it = mCompiled.find(qSetHash);
+    return it == mCompiled.end() ? nullptr : it->second;
+}
+
+QuorumEvaluator::CompiledQSetPtr
+QuorumEvaluator::compile(Hash const& qSetHash, SCPQuorumSet const& qSet)
+{
+    auto& res = mCompiled[qSetHash];
+    if (!res)
+    {
+        auto compiled = std::make_shared<CompiledQSet>();
+        compileInternal(qSet, NO_PARENT, *compiled);
+        res = compiled;
+    }
+    return res;
+}
+
+QuorumEvaluator::CompiledQSetPtr
+QuorumEvaluator::compileSingleton(NodeID const& nodeID)
+{
+    auto node = getNodeIndex(nodeID);
+    auto& res = mSingletons[node];
+    if (!res)
+    {
+        auto compiled = std::make_shared<CompiledQSet>();
+        compiled->mSets.emplace_back();
+        auto& s = compiled->mSets.back();
+        s.mThreshold = 1;
+        s.mSize = 1;
+        s.mParent = NO_PARENT;
+        s.mValidators.emplace_back(node);
+        compiled->mOccurrences[node].emplace_back(0);
+        res = compiled;
+    }
+    return res;
+}
+
+void
+QuorumEvaluator::trim()
+{
+    if (mCompiled.size() + mSingletons.size() > MAX_COMPILED_QSETS ||
+        mNodeIndexes.size() > MAX_NODE_INDEXES)
+    {
+        mCompiled.clear();
+        mSingletons.clear();
+        mNodeIndexes.clear();
+    }
+}
+
+bool
+QuorumEvaluator::isQuorumSlice(CompiledQSet const& qSet,
+                               std::vector<bool> const& nodes)
+{
+    auto counts = countInSets(qSet, nodes, isSliceSatisfied);
+    return isSliceSatisfied(qSet.mSets[0], counts[0]);
+}
+
+bool
+QuorumEvaluator::isVBlocking(CompiledQSet const& qSet,
+                             std::vector<bool> const& nodes)
+{
+    auto counts = countInSets(qSet, nodes, isSetBlocked);
+    return isSetBlocked(qSet.mSets[0], counts[0]);
+}
+
+std::vector<bool>
+QuorumEvaluator::filterNodes(std::map<NodeID, SCPEnvelope> const& map,
+                             StatementFilter const& filter)
+{
+    std::vector<size_t> filtered;
+    for (auto const& it : map)
+    {
+        if (filter(it.second.statement))
+        {
+            filtered.emplace_back(getNodeIndex(it.first));
+        }
+    }
+    std::vector<bool> res(mNodeIndexes.size(), false);
+    for (auto node : filtered)
+    {
+        res[node] = true;
+    }
+    return res;
+}
+
+bool
+QuorumEvaluator::isVBlocking(CompiledQSet const& qSet,
+                             std::map<NodeID, SCPEnvelope> const& map,
+                             StatementFilter const& filter)
+{
+    return isVBlocking(qSet, filterNodes(map, filter));
+}
+
+bool
+QuorumEvaluator::isQuorum(CompiledQSet const& qSet,
+                          std::map<NodeID, SCPEnvelope> const& map,
+                          QSetFun const& qfun, StatementFilter const& filter)
+{
+    struct Member
+    {
+        size_t mNode;
+        CompiledQSetPtr mQSet;
+        // see countInSets
+        std::vector<uint32> mCounts;
+        bool mRemoved;
+    };
+
+    std::vector<Member> members;
+    for (auto const& it : map)
+    {
+        if (filter(it.second.statement))
+        {
+            members.emplace_back(Member{getNodeIndex(it.first),
+                                        qfun(it.second.statement),
+                                        std::vector<uint32>(), false});
+        }
+    }
+    std::vector<bool> nodes(mNodeIndexes.size(), false);
+    for (auto const& m : members)
+    {
+        nodes[m.mNode] = true;
+    }
+
+    // members whose quorum set lists each node
+    std::unordered_map<size_t, std::vector<size_t>> dependents;
+    std::vector<size_t> toRemove;
+    for (size_t i = 0; i < members.size(); ++i)
+    {
+        auto& m = members[i];
+        if (m.mQSet)
+        {
+            m.mCounts = countInSets(*m.mQSet, nodes, isSliceSatisfied);
+            m.mRemoved = !isSliceSatisfied(m.mQSet->mSets[0], m.mCounts[0]);
+        }
+        else
+        {
+            m.mRemoved = true;
+        }
+
+        if (m.mRemoved)
+        {
+            toRemove.emplace_back(i);
+        }
+        else
+        {
+            for (auto const& occ : m.mQSet->mOccurrences)
+            {
+                dependents[occ.first].emplace_back(i);
+            }
+        }
+    }
+
+    // removing a node only affects the slices listing it
+    while (!toRemove.empty())
+    {
+        auto node = members[toRemove.back()].mNode;
+        toRemove.pop_back();
+        nodes[node] = false;
+
+        auto it = dependents.find(node);
+        if (it == dependents.end())
+        {
+            continue;
+        }
+        for (auto i : it->second)
+        {
+            auto& m = members[i];
+            if (m.mRemoved)
+            {
+                continue;
+            }
+            for (auto s : m.mQSet->mOccurrences.at(node))
+            {
+                if (!removeFromSet(*m.mQSet, m.mCounts, s))
+                {
+                    m.mRemoved = true;
+                }
+            }
+            if (m.mRemoved)
+            {
+                toRemove.emplace_back(i);
+            }
+        }
+    }
+
+    return isQuorumSlice(qSet, nodes);
+}
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "crypto/SecretKey.h"
+#include "scp/SCP.h"
+#include "util/HashOfHash.h"
+#include "util/NonCopyable.h"
+#include <functional>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace stellar
+{
+
+/**
+ * Evaluates quorum slices, v-blocking sets and quorums over quorum sets
+ * compiled once per quorum set hash: nodes are replaced by small indices and
+ * nested sets are flattened, so that checking a slice is a single pass over
+ * the quorum set against a bitset of nodes.
+ *
+ * `isQuorum` computes the same fixed point as LocalNode::isQuorum, but
+ * incrementally: removing a node that doesn't have a slice only updates the
+ * slices of the nodes that depend on it, instead of checking all the
+ * remaining nodes again.
+ */
+class QuorumEvaluator : NonMovableOrCopyable
+{
+  public:
+    static size_t const NO_PARENT;
+
+    struct CompiledQSet
+    {
+        struct InnerSet
+        {
+            uint32 mThreshold;
+            // number of validators and inner sets
+            uint32 mSize;
+            size_t mParent;
+            std::vector<size_t> mValidators;
+        };
+        // the top level set first, inner sets always after their parent
+        std::vector<InnerSet> mSets;
+        // for each node, the sets listing it (once per occurrence)
+        std::unordered_map<size_t, std::vector<size_t>> mOccurrences;
+    };
+    typedef std::shared_ptr<CompiledQSet const> CompiledQSetPtr;
+
+    // returns the compiled quorum set of the statement's node, nullptr if
+    // unknown
+    typedef std::function<CompiledQSetPtr(SCPStatement const&)> QSetFun;
+    typedef std::function<bool(SCPStatement const&)> StatementFilter;
+
+  private:
+    std::unordered_map<NodeID, size_t> mNodeIndexes;
+    std::unordered_map<Hash, CompiledQSetPtr> mCompiled;
+    std::unordered_map<size_t, CompiledQSetPtr> mSingletons;
+
+    size_t getNodeIndex(NodeID const& nodeID);
+    void compileInternal(SCPQuorumSet const& qSet, size_t parent,
+                         CompiledQSet& res);
+
+    // indices of the nodes of `map` with a statement passing `filter`
+    std::vector<bool> filterNodes(std::map<NodeID, SCPEnvelope> const& map,
+                                  StatementFilter const& filter);
+
+  public:
+    QuorumEvaluator() = default;
+
+    // compiled quorum sets are cached until trim() finds too many of them
+    CompiledQSetPtr getCompiled(Hash const& qSetHash) const;
+    CompiledQSetPtr compile(Hash const& qSetHash, SCPQuorumSet const& qSet);
+    // the quorum set {{ nodeID }}
+    CompiledQSetPtr compileSingleton(NodeID const& nodeID);
+
+    // forgets all compiled quorum sets if there are too many: must only be
+    // called when none is in use
+    void trim();
+
+    static bool isQuorumSlice(CompiledQSet const& qSet,
+                              std::vector<bool> const& nodes);
+    static bool isVBlocking(CompiledQSet const& qSet,
+                            std::vector<bool> const& nodes);
+
+    // see LocalNode::isVBlocking and LocalNode::isQuorum
+    bool isVBlocking(CompiledQSet const& qSet,
+                     std::map<NodeID, SCPEnvelope> const& map,
+                     StatementFilter const& filter);
+    bool isQuorum(CompiledQSet const& qSet,
+                  std::map<NodeID, SCPEnvelope> const& map,
+                  QSetFun const& qfun, StatementFilter const& filter);
+};
+}
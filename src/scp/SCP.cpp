@@ -40,6 +40,38 @@ SCP::receiveEnvelope(SCPEnvelope const& envelope)
     return getSlot(slotIndex, true)->processEnvelope(envelope, false);
 }
 
+std::vector<SCP::EnvelopeState>
+SCP::receiveEnvelopes(std::vector<SCPEnvelope> const& envelopes)
+{
+    std::vector<EnvelopeState> res(envelopes.size(), EnvelopeState::INVALID);
+    std::vector<SCPEnvelope const*> verified;
+    std::vector<size_t> verifiedIndexes;
+    for (size_t i = 0; i < envelopes.size(); ++i)
+    {
+        if (mDriver.verifyEnvelope(envelopes[i]))
+        {
+            verified.emplace_back(&envelopes[i]);
+            verifiedIndexes.emplace_back(i);
+        }
+        else
+        {
+            CLOG(DEBUG, "SCP") << "SCP::receiveEnvelopes invalid";
+        }
+    }
+    if (verified.empty())
+    {
+        return res;
+    }
+
+    uint64 slotIndex = verified.front()->statement.slotIndex;
+    auto slotRes = getSlot(slotIndex, true)->processEnvelopes(verified);
+    for (size_t i = 0; i < slotRes.size(); ++i)
+    {
+        res[verifiedIndexes[i]] = slotRes[i];
+    }
+    return res;
+}
+
 bool
 SCP::nominate(uint64 slotIndex, Value const& value, Value const& previousValue)
 {
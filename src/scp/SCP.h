@@ -58,6 +58,12 @@ class SCP
     // invokes the appropriate methods
     EnvelopeState receiveEnvelope(SCPEnvelope const& envelope);
 
+    // same for envelopes of a single slot received together, that are all
+    // recorded before the ballot protocol makes progress with them: this
+    // saves redundant quorum checks when many are received at once
+    std::vector<EnvelopeState>
+    receiveEnvelopes(std::vector<SCPEnvelope> const& envelopes);
+
     // Submit a value to consider for slotIndex
     // previousValue is the value from slotIndex-1
     bool nominate(uint64 slotIndex, Value const& value,
@@ -690,6 +690,38 @@ TEST_CASE("ballot protocol core5", "[scp][ballotprotocol]")
         verifyPrepare(scp.mEnvs[0], v0SecretKey, qSetHash0, 0, expectedBallot);
     }
 
+    SECTION("envelopes received together")
+    {
+        SCPBallot b(1, xValue);
+        REQUIRE(scp.bumpState(0, xValue));
+        REQUIRE(scp.mEnvs.size() == 1);
+
+        // same transitions as receiving them one by one, emitting only the
+        // latest statement
+        auto res = scp.mSCP.receiveEnvelopes(
+            {makePrepare(v1SecretKey, qSetHash, 0, b),
+             makePrepare(v2SecretKey, qSetHash, 0, b),
+             makePrepare(v3SecretKey, qSetHash, 0, b),
+             makePrepare(v4SecretKey, qSetHash, 0, b)});
+        REQUIRE(res.size() == 4);
+        for (auto r : res)
+        {
+            REQUIRE(r == SCP::EnvelopeState::VALID);
+        }
+        REQUIRE(scp.mEnvs.size() == 2);
+        REQUIRE(scp.mHeardFromQuorums[0].size() == 1);
+        verifyPrepare(scp.mEnvs[1], v0SecretKey, qSetHash0, 0, b, &b);
+
+        scp.mSCP.receiveEnvelopes(
+            {makePrepare(v1SecretKey, qSetHash, 0, b, &b),
+             makePrepare(v2SecretKey, qSetHash, 0, b, &b),
+             makePrepare(v3SecretKey, qSetHash, 0, b, &b),
+             makePrepare(v4SecretKey, qSetHash, 0, b, &b)});
+        REQUIRE(scp.mEnvs.size() == 3);
+        verifyPrepare(scp.mEnvs[2], v0SecretKey, qSetHash0, 0, b, &b, b.counter,
+                      b.counter);
+    }
+
     SECTION("start <1,x>")
     {
         // no timer is set
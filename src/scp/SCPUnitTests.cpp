@@ -1,6 +1,13 @@
+#include "crypto/SHA.h"
 #include "lib/catch.hpp"
 #include "scp/LocalNode.h"
+#include "scp/QuorumEvaluator.h"
 #include "simulation/Simulation.h"
+#include "util/Logging.h"
+#include "util/Math.h"
+#include "xdrpp/marshal.h"
+#include <chrono>
+#include <string>
 
 namespace stellar
 {
@@ -44,4 +51,188 @@ TEST_CASE("nomination weight", "[scp]")
 
     REQUIRE(isNear(result, .6 * .5));
 }
-}
\ No newline at end of file
+
+namespace
+{
+// organizations of validators, each validator trusting a majority of the
+// validators of a majority (or all but one) of the organizations
+class NestedNetwork
+{
+    std::vector<NodeID> mNodes;
+    std::vector<SCPQuorumSetPtr> mQSets;
+    std::vector<Hash> mQSetHashes;
+
+    size_t
+    getQSetIndex(SCPStatement const& st) const
+    {
+        auto const& h = st.pledges.prepare().quorumSetHash;
+        return h == mQSetHashes[0] ? 0 : 1;
+    }
+
+  public:
+    NestedNetwork(size_t nOrgs, size_t orgSize)
+    {
+        std::vector<SCPQuorumSet> orgs(nOrgs);
+        for (size_t i = 0; i < nOrgs; ++i)
+        {
+            orgs[i].threshold = static_cast<uint32>(orgSize / 2 + 1);
+            for (size_t j = 0; j < orgSize; ++j)
+            {
+                auto seed = "NODE_SEED_" + std::to_string(i * orgSize + j);
+                mNodes.emplace_back(
+                    SecretKey::fromSeed(sha256(seed)).getPublicKey());
+                orgs[i].validators.emplace_back(mNodes.back());
+            }
+        }
+        for (auto threshold : {nOrgs / 2 + 1, nOrgs - 1})
+        {
+            auto qSet = std::make_shared<SCPQuorumSet>();
+            qSet->threshold = static_cast<uint32>(threshold);
+            qSet->innerSets = orgs;
+            mQSets.emplace_back(qSet);
+            mQSetHashes.emplace_back(sha256(xdr::xdr_to_opaque(*qSet)));
+        }
+    }
+
+    SCPQuorumSet const&
+    getLocalQSet() const
+    {
+        return *mQSets[0];
+    }
+
+    Hash const&
+    getLocalQSetHash() const
+    {
+        return mQSetHashes[0];
+    }
+
+    // prepare statements at counters 1 to 3 from a random part of the nodes
+    std::map<NodeID, SCPEnvelope>
+    makeEnvelopes(uint32 percentPresent) const
+    {
+        std::map<NodeID, SCPEnvelope> res;
+        for (size_t i = 0; i < mNodes.size(); ++i)
+        {
+            if (rand_uniform<uint32>(1, 100) > percentPresent)
+            {
+                continue;
+            }
+            SCPEnvelope env;
+            env.statement.nodeID = mNodes[i];
+            env.statement.pledges.type(SCP_ST_PREPARE);
+            auto& prep = env.statement.pledges.prepare();
+            prep.quorumSetHash = mQSetHashes[i % mQSetHashes.size()];
+            prep.ballot.counter = rand_uniform<uint32>(1, 3);
+            res.emplace(mNodes[i], env);
+        }
+        return res;
+    }
+
+    SCPQuorumSetPtr
+    getQSet(SCPStatement const& st) const
+    {
+        return mQSets[getQSetIndex(st)];
+    }
+
+    QuorumEvaluator::CompiledQSetPtr
+    getCompiledQSet(QuorumEvaluator& evaluator, SCPStatement const& st) const
+    {
+        auto i = getQSetIndex(st);
+        return evaluator.compile(mQSetHashes[i], *mQSets[i]);
+    }
+};
+
+std::function<bool(SCPStatement const&)>
+atLeastCounter(uint32 counter)
+{
+    return [counter](SCPStatement const& st) {
+        return st.pledges.prepare().ballot.counter >= counter;
+    };
+}
+}
+
+TEST_CASE("compiled quorum evaluation", "[scp]")
+{
+    NestedNetwork net(12, 10);
+    QuorumEvaluator evaluator;
+    auto localQSet =
+        evaluator.compile(net.getLocalQSetHash(), net.getLocalQSet());
+    auto qfun = [&](SCPStatement const& st) { return net.getQSet(st); };
+    auto compiledQfun = [&](SCPStatement const& st) {
+        return net.getCompiledQSet(evaluator, st);
+    };
+
+    size_t quorums = 0;
+    size_t vBlocking = 0;
+    for (int i = 0; i < 100; ++i)
+    {
+        auto envs = net.makeEnvelopes(rand_uniform<uint32>(40, 100));
+        for (uint32 counter = 1; counter <= 3; ++counter)
+        {
+            auto filter = atLeastCounter(counter);
+            bool quorum =
+                LocalNode::isQuorum(net.getLocalQSet(), envs, qfun, filter);
+            REQUIRE(evaluator.isQuorum(*localQSet, envs, compiledQfun,
+                                       filter) == quorum);
+            bool blocking =
+                LocalNode::isVBlocking(net.getLocalQSet(), envs, filter);
+            REQUIRE(evaluator.isVBlocking(*localQSet, envs, filter) ==
+                    blocking);
+            quorums += quorum;
+            vBlocking += blocking;
+        }
+    }
+    // both outcomes were covered
+    REQUIRE(quorums != 0);
+    REQUIRE(quorums != 300);
+    REQUIRE(vBlocking != 0);
+    REQUIRE(vBlocking != 300);
+}
+
+TEST_CASE("quorum evaluation with nested quorum sets",
+          "[scp][bench][!hide]")
+{
+    size_t const nEvaluations = 1000;
+    NestedNetwork net(15, 10);
+    QuorumEvaluator evaluator;
+    auto localQSet =
+        evaluator.compile(net.getLocalQSetHash(), net.getLocalQSet());
+
+    std::vector<std::map<NodeID, SCPEnvelope>> envs;
+    for (size_t i = 0; i < nEvaluations; ++i)
+    {
+        envs.emplace_back(net.makeEnvelopes(80));
+    }
+    auto filter = atLeastCounter(2);
+
+    size_t quorums = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (auto const& e : envs)
+    {
+        quorums += LocalNode::isQuorum(
+            net.getLocalQSet(), e,
+            [&](SCPStatement const& st) { return net.getQSet(st); }, filter);
+    }
+    std::chrono::duration<double> recursive =
+        std::chrono::steady_clock::now() - start;
+
+    size_t compiledQuorums = 0;
+    start = std::chrono::steady_clock::now();
+    for (auto const& e : envs)
+    {
+        compiledQuorums += evaluator.isQuorum(
+            *localQSet, e,
+            [&](SCPStatement const& st) {
+                return net.getCompiledQSet(evaluator, st);
+            },
+            filter);
+    }
+    std::chrono::duration<double> compiled =
+        std::chrono::steady_clock::now() - start;
+
+    REQUIRE(quorums == compiledQuorums);
+    LOG(INFO) << nEvaluations << " quorum evaluations over 150 nodes: "
+              << recursive.count() << "s recursive, " << compiled.count()
+              << "s compiled";
+}
+}
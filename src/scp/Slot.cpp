@@ -142,6 +142,57 @@ Slot::processEnvelope(SCPEnvelope const& envelope, bool self)
     return res;
 }
 
+std::vector<SCP::EnvelopeState>
+Slot::processEnvelopes(std::vector<SCPEnvelope const*> const& envelopes)
+{
+    std::vector<SCP::EnvelopeState> res(envelopes.size(),
+                                        SCP::EnvelopeState::INVALID);
+    // nominations may start the ballot protocol, so they go first
+    std::vector<SCPEnvelope const*> ballots;
+    std::vector<size_t> ballotIndexes;
+    for (size_t i = 0; i < envelopes.size(); ++i)
+    {
+        dbgAssert(envelopes[i]->statement.slotIndex == mSlotIndex);
+        if (envelopes[i]->statement.pledges.type() ==
+            SCPStatementType::SCP_ST_NOMINATE)
+        {
+            res[i] = processEnvelope(*envelopes[i], false);
+        }
+        else
+        {
+            ballots.emplace_back(envelopes[i]);
+            ballotIndexes.emplace_back(i);
+        }
+    }
+    if (ballots.empty())
+    {
+        return res;
+    }
+
+    if (Logging::logDebug("SCP"))
+        CLOG(DEBUG, "SCP") << "Slot::processEnvelopes"
+                           << " i: " << getSlotIndex() << " "
+                           << ballots.size() << " ballot envelopes";
+
+    std::vector<SCP::EnvelopeState> ballotRes;
+    try
+    {
+        ballotRes = mBallotProtocol.processEnvelopes(ballots);
+    }
+    catch (...)
+    {
+        auto info = getJsonInfo();
+        CLOG(ERROR, "SCP") << "Exception in processEnvelopes "
+                           << "state: " << info.toStyledString();
+        throw;
+    }
+    for (size_t i = 0; i < ballotRes.size(); ++i)
+    {
+        res[ballotIndexes[i]] = ballotRes[i];
+    }
+    return res;
+}
+
 bool
 Slot::abandonBallot()
 {
@@ -290,6 +341,28 @@ Slot::getQuorumSetFromStatement(SCPStatement const& st)
     return res;
 }
 
+QuorumEvaluator::CompiledQSetPtr
+Slot::getCompiledQuorumSetFromStatement(SCPStatement const& st)
+{
+    auto& evaluator = getLocalNode()->getQuorumEvaluator();
+    if (st.pledges.type() == SCP_ST_EXTERNALIZE)
+    {
+        return evaluator.compileSingleton(st.nodeID);
+    }
+
+    Hash h = getCompanionQuorumSetHashFromStatement(st);
+    auto res = evaluator.getCompiled(h);
+    if (!res)
+    {
+        auto qSet = getSCPDriver().getQSet(h);
+        if (qSet)
+        {
+            res = evaluator.compile(h, *qSet);
+        }
+    }
+    return res;
+}
+
 Json::Value
 Slot::getJsonInfo()
 {
@@ -338,7 +411,7 @@ Slot::federatedAccept(StatementPredicate voted, StatementPredicate accepted,
 {
     // Checks if the nodes that claimed to accept the statement form a
     // v-blocking set
-    if (LocalNode::isVBlocking(getLocalNode()->getQuorumSet(), envs, accepted))
+    if (getLocalNode()->isVBlocking(envs, accepted))
     {
         return true;
     }
@@ -351,9 +424,8 @@ Slot::federatedAccept(StatementPredicate voted, StatementPredicate accepted,
         return res;
     };
 
-    if (LocalNode::isQuorum(
-            getLocalNode()->getQuorumSet(), envs,
-            std::bind(&Slot::getQuorumSetFromStatement, this, _1),
+    if (getLocalNode()->isQuorum(
+            envs, std::bind(&Slot::getCompiledQuorumSetFromStatement, this, _1),
             ratifyFilter))
     {
         return true;
@@ -366,9 +438,9 @@ bool
 Slot::federatedRatify(StatementPredicate voted,
                       std::map<NodeID, SCPEnvelope> const& envs)
 {
-    return LocalNode::isQuorum(
-        getLocalNode()->getQuorumSet(), envs,
-        std::bind(&Slot::getQuorumSetFromStatement, this, _1), voted);
+    return getLocalNode()->isQuorum(
+        envs, std::bind(&Slot::getCompiledQuorumSetFromStatement, this, _1),
+        voted);
 }
 
 std::shared_ptr<LocalNode>
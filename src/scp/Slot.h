@@ -102,6 +102,11 @@ class Slot : public std::enable_shared_from_this<Slot>
     // triggering more transitions)
     SCP::EnvelopeState processEnvelope(SCPEnvelope const& envelope, bool self);
 
+    // Process envelopes received together from other nodes for this slot,
+    // advancing the ballot protocol once for all of them.
+    std::vector<SCP::EnvelopeState>
+    processEnvelopes(std::vector<SCPEnvelope const*> const& envelopes);
+
     bool abandonBallot();
 
     // bumps the ballot based on the local state and the value passed in:
@@ -151,6 +156,10 @@ class Slot : public std::enable_shared_from_this<Slot>
     // statement (singleton for externalize)
     SCPQuorumSetPtr getQuorumSetFromStatement(SCPStatement const& st);
 
+    // same, compiled by the local node's QuorumEvaluator
+    QuorumEvaluator::CompiledQSetPtr
+    getCompiledQuorumSetFromStatement(SCPStatement const& st);
+
     // wraps a statement in an envelope (sign it, etc)
     SCPEnvelope createEnvelope(SCPStatement const& statement);
 
@@ -6,6 +6,7 @@
 #include "database/Database.h"
 #include "ledger/LedgerDelta.h"
 #include "ledger/LedgerManager.h"
+#include "ledger/OrderBook.h"
 #include "ledger/TrustFrame.h"
 #include "util/Logging.h"
 
@@ -261,80 +262,110 @@ OfferExchange::convertWithOffers(
     wheatReceived = 0;
 
     Database& db = mLedgerManager.getDatabase();
+    OrderBook& orderBook = db.getOrderBook();
 
+    // offers are either walked directly in the in-memory order book, or
+    // loaded from the database in batches
+    OfferFrame::pointer lastOffer;
+    std::vector<OfferFrame::pointer> retList;
+    size_t retIndex = 0;
     size_t offerOffset = 0;
+    bool noMoreOffers = false;
+
+    auto nextOffer = [&]() -> OfferFrame::pointer {
+        if (orderBook.isEnabled())
+        {
+            lastOffer = orderBook.getBestOffer(wheat, sheep, lastOffer.get());
+            return lastOffer;
+        }
+
+        if (retIndex == retList.size())
+        {
+            if (noMoreOffers)
+            {
+                return nullptr;
+            }
+            retList.clear();
+            retIndex = 0;
+            OfferFrame::loadBestOffers(5, offerOffset, wheat, sheep, retList,
+                                       db);
+            offerOffset += retList.size();
+            noMoreOffers = retList.size() < 5;
+            if (retList.empty())
+            {
+                return nullptr;
+            }
+        }
+        return retList[retIndex++];
+    };
 
     bool needMore = (maxWheatReceive > 0 && maxSheepSend > 0);
 
     while (needMore)
     {
-        std::vector<OfferFrame::pointer> retList;
-        OfferFrame::loadBestOffers(5, offerOffset, wheat, sheep, retList, db);
-
-        offerOffset += retList.size();
+        auto wheatOffer = nextOffer();
+        if (!wheatOffer)
+        {
+            // still stuff to fill but no more offers
+            return eOK;
+        }
 
-        for (auto& wheatOffer : retList)
+        if (filter)
         {
-            if (filter)
+            OfferFilterResult r = filter(*wheatOffer);
+            switch (r)
             {
-                OfferFilterResult r = filter(*wheatOffer);
-                switch (r)
-                {
-                case eKeep:
-                    break;
-                case eStop:
-                    return eFilterStop;
-                case eSkip:
-                    continue;
-                }
+            case eKeep:
+                break;
+            case eStop:
+                return eFilterStop;
+            case eSkip:
+                continue;
             }
+        }
 
-            int64_t numWheatReceived;
-            int64_t numSheepSend;
+        int64_t numWheatReceived;
+        int64_t numSheepSend;
 
-            CrossOfferResult cor =
-                crossOffer(*wheatOffer, maxWheatReceive, numWheatReceived,
-                           maxSheepSend, numSheepSend);
+        CrossOfferResult cor =
+            crossOffer(*wheatOffer, maxWheatReceive, numWheatReceived,
+                       maxSheepSend, numSheepSend);
 
-            assert(numSheepSend >= 0);
-            assert(numSheepSend <= maxSheepSend);
-            assert(numWheatReceived >= 0);
-            assert(numWheatReceived <= maxWheatReceive);
+        assert(numSheepSend >= 0);
+        assert(numSheepSend <= maxSheepSend);
+        assert(numWheatReceived >= 0);
+        assert(numWheatReceived <= maxWheatReceive);
 
-            switch (cor)
+        switch (cor)
+        {
+        case eOfferTaken:
+            if (!orderBook.isEnabled())
             {
-            case eOfferTaken:
                 assert(offerOffset > 0);
                 offerOffset--; // adjust offset as an offer was deleted
-                break;
-            case eOfferPartial:
-                break;
-            case eOfferCantConvert:
-                return ePartial;
             }
+            break;
+        case eOfferPartial:
+            break;
+        case eOfferCantConvert:
+            return ePartial;
+        }
 
-            sheepSend += numSheepSend;
-            maxSheepSend -= numSheepSend;
-
-            wheatReceived += numWheatReceived;
-            maxWheatReceive -= numWheatReceived;
+        sheepSend += numSheepSend;
+        maxSheepSend -= numSheepSend;
 
-            needMore = (maxWheatReceive > 0 && maxSheepSend > 0);
-            if (!needMore)
-            {
-                return eOK;
-            }
-            else if (cor == eOfferPartial)
-            {
-                return ePartial;
-            }
-        }
+        wheatReceived += numWheatReceived;
+        maxWheatReceive -= numWheatReceived;
 
-        // still stuff to fill but no more offers
-        if (needMore && retList.size() < 5)
+        needMore = (maxWheatReceive > 0 && maxSheepSend > 0);
+        if (!needMore)
         {
             return eOK;
         }
+        else if (cor == eOfferPartial)
+        {
+            return ePartial;
+        }
     }
     return eOK;
 }
@@ -9,8 +9,10 @@
 #include "test/TestUtils.h"
 #include "test/TxTests.h"
 #include "test/test.h"
+#include "util/Logging.h"
 #include "util/Timer.h"
 
+#include <chrono>
 #include <deque>
 #include <limits>
 
@@ -3811,3 +3813,75 @@ TEST_CASE("pathpayment", "[tx][pathpayment]")
         });
     }
 }
+
+TEST_CASE("pathpayment crossing many offers bench",
+          "[tx][pathpayment][bench][!hide]")
+{
+    size_t const nOffers = 5000;
+    int64_t const offerAmount = 100;
+
+    auto runtest = [&](bool inMemoryOrderBook) {
+        VirtualClock clock;
+        Config cfg(getTestConfig(0, Config::TESTDB_ON_DISK_SQLITE));
+        cfg.IN_MEMORY_ORDER_BOOK = inMemoryOrderBook;
+        auto app = createTestApplication(clock, cfg);
+        app->start();
+
+        auto root = TestAccount::createRoot(*app);
+        auto xlm = makeNativeAsset();
+        auto& lm = app->getLedgerManager();
+        auto txfee = lm.getTxFee();
+
+        auto issuer = root.create("issuer", lm.getMinBalance(0) + 10 * txfee);
+        auto usd = makeAsset(issuer, "USD");
+
+        auto seller =
+            root.create("seller", lm.getMinBalance(nOffers + 1) +
+                                      (nOffers + 10) * txfee);
+        seller.changeTrust(usd, INT64_MAX);
+        issuer.pay(seller, usd, nOffers * offerAmount);
+
+        auto destination =
+            root.create("destination", lm.getMinBalance(1) + 10 * txfee);
+        destination.changeTrust(usd, INT64_MAX);
+
+        // offers get progressively more expensive
+        for (size_t i = 0; i < nOffers; i += 100)
+        {
+            std::vector<Operation> ops;
+            for (size_t j = i; j < std::min(nOffers, i + 100); j++)
+            {
+                ops.emplace_back(manageOffer(
+                    0, usd, xlm, Price{static_cast<int32_t>(1000 + j), 1000},
+                    offerAmount));
+            }
+            applyTx(seller.tx(ops), *app);
+        }
+
+        auto sendMax = static_cast<int64_t>(nOffers) * offerAmount * 10;
+        auto source = root.create("source", lm.getMinBalance(0) + sendMax +
+                                                10 * txfee);
+
+        CLOG(INFO, "Tx") << "Crossing " << nOffers << " offers with "
+                         << (inMemoryOrderBook ? "in-memory order book"
+                                               : "SQL paging");
+        auto start = std::chrono::steady_clock::now();
+        source.pay(destination, xlm, sendMax, usd, nOffers * offerAmount, {});
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start);
+        CLOG(INFO, "Tx") << "Path payment applied in " << elapsed.count()
+                         << "ms";
+
+        REQUIRE(destination.loadTrustLine(usd).balance ==
+                static_cast<int64_t>(nOffers) * offerAmount);
+    };
+
+    SECTION("sql")
+    {
+        runtest(false);
+    }
+    SECTION("in-memory order book")
+    {
+        runtest(true);
+    }
+}
@@ -494,6 +494,146 @@ TransactionFrame::checkValid(Application& app, SequenceNumber current)
     return res;
 }
 
+void
+TransactionFrame::getSignaturesToVerify(
+    Database& db, std::vector<PubKeyUtils::SignatureToVerify>& res) const
+{
+    std::vector<AccountID> accounts{getSourceID()};
+    for (auto const& op : mEnvelope.tx.operations)
+    {
+        if (op.sourceAccount &&
+            std::find(accounts.begin(), accounts.end(), *op.sourceAccount) ==
+                accounts.end())
+        {
+            accounts.emplace_back(*op.sourceAccount);
+        }
+    }
+
+    std::vector<PublicKey> keys;
+    for (auto const& accountID : accounts)
+    {
+        // the master key is a candidate even if the account does not exist
+        // yet, as it may get created earlier in the same ledger
+        keys.emplace_back(accountID);
+        auto account = AccountFrame::loadAccount(accountID, db);
+        if (!account)
+        {
+            continue;
+        }
+        for (auto const& signer : account->getAccount().signers)
+        {
+            if (signer.key.type() == SIGNER_KEY_TYPE_ED25519)
+            {
+                keys.emplace_back(
+                    KeyUtils::convertKey<PublicKey>(signer.key));
+            }
+        }
+    }
+
+    auto const& hash = getContentsHash();
+    for (auto const& sig : mEnvelope.signatures)
+    {
+        for (auto const& key : keys)
+        {
+            if (SignatureUtils::doesHintMatch(key.ed25519(), sig.hint))
+            {
+                res.emplace_back(PubKeyUtils::SignatureToVerify{
+                    key, sig.signature,
+                    std::vector<uint8_t>(hash.begin(), hash.end())});
+            }
+        }
+    }
+}
+
+void
+TransactionFrame::getKeysToPrefetch(std::unordered_set<LedgerKey>& keys) const
+{
+    auto addAccount = [&keys](AccountID const& accountID) {
+        LedgerKey key;
+        key.type(ACCOUNT);
+        key.account().accountID = accountID;
+        keys.emplace(key);
+    };
+    auto addTrustLine = [&](AccountID const& accountID, Asset const& asset) {
+        if (asset.type() == ASSET_TYPE_NATIVE)
+        {
+            return;
+        }
+        addAccount(getIssuer(asset));
+        if (accountID == getIssuer(asset))
+        {
+            return;
+        }
+        LedgerKey key;
+        key.type(TRUSTLINE);
+        key.trustLine().accountID = accountID;
+        key.trustLine().asset = asset;
+        keys.emplace(key);
+    };
+
+    addAccount(getSourceID());
+    for (auto const& op : mEnvelope.tx.operations)
+    {
+        auto const& source =
+            op.sourceAccount ? *op.sourceAccount : getSourceID();
+        addAccount(source);
+
+        auto const& body = op.body;
+        switch (body.type())
+        {
+        case CREATE_ACCOUNT:
+            addAccount(body.createAccountOp().destination);
+            break;
+        case PAYMENT:
+            addAccount(body.paymentOp().destination);
+            addTrustLine(source, body.paymentOp().asset);
+            addTrustLine(body.paymentOp().destination, body.paymentOp().asset);
+            break;
+        case PATH_PAYMENT:
+            addAccount(body.pathPaymentOp().destination);
+            addTrustLine(source, body.pathPaymentOp().sendAsset);
+            addTrustLine(body.pathPaymentOp().destination,
+                         body.pathPaymentOp().destAsset);
+            break;
+        case MANAGE_OFFER:
+            addTrustLine(source, body.manageOfferOp().selling);
+            addTrustLine(source, body.manageOfferOp().buying);
+            break;
+        case CREATE_PASSIVE_OFFER:
+            addTrustLine(source, body.createPassiveOfferOp().selling);
+            addTrustLine(source, body.createPassiveOfferOp().buying);
+            break;
+        case CHANGE_TRUST:
+            addTrustLine(source, body.changeTrustOp().line);
+            break;
+        case ALLOW_TRUST:
+        {
+            auto const& allowTrust = body.allowTrustOp();
+            addAccount(allowTrust.trustor);
+            Asset asset;
+            asset.type(allowTrust.asset.type());
+            if (asset.type() == ASSET_TYPE_CREDIT_ALPHANUM4)
+            {
+                asset.alphaNum4().assetCode = allowTrust.asset.assetCode4();
+                asset.alphaNum4().issuer = source;
+            }
+            else if (asset.type() == ASSET_TYPE_CREDIT_ALPHANUM12)
+            {
+                asset.alphaNum12().assetCode = allowTrust.asset.assetCode12();
+                asset.alphaNum12().issuer = source;
+            }
+            addTrustLine(allowTrust.trustor, asset);
+            break;
+        }
+        case ACCOUNT_MERGE:
+            addAccount(body.destination());
+            break;
+        default:
+            break;
+        }
+    }
+}
+
 void
 TransactionFrame::markResultFailed()
 {
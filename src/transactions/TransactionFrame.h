@@ -4,12 +4,15 @@
 // under the Apache License, Version 2.0. See the COPYING file at the root
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
+#include "crypto/SecretKey.h"
 #include "ledger/AccountFrame.h"
+#include "ledger/LedgerHashUtils.h"
 #include "overlay/StellarXDR.h"
 #include "util/types.h"
 
 #include <memory>
 #include <set>
+#include <unordered_set>
 
 namespace soci
 {
@@ -157,6 +160,17 @@ class TransactionFrame
 
     bool checkValid(Application& app, SequenceNumber current);
 
+    // appends to `res` the signatures of this transaction paired with the
+    // ED25519 signers of its source accounts (and of its operations) that
+    // they are likely to be checked against, based on the current state of
+    // the database
+    void getSignaturesToVerify(
+        Database& db, std::vector<PubKeyUtils::SignatureToVerify>& res) const;
+
+    // adds to `keys` the accounts and trust lines that applying this
+    // transaction is likely to load, to load them ahead in bulk
+    void getKeysToPrefetch(std::unordered_set<LedgerKey>& keys) const;
+
     // collect fee, consume sequence number
     void processFeeSeqNum(LedgerDelta& delta, LedgerManager& ledgerManager);
 
@@ -8,6 +8,7 @@
 #include "crypto/SHA.h"
 #include "util/Logging.h"
 #include "xdrpp/marshal.h"
+#include <cstring>
 #include <fstream>
 #include <string>
 #include <vector>
@@ -18,15 +19,62 @@ namespace stellar
 /**
  * Helper for loading a sequence of XDR objects from a file one at a time,
  * rather than all at once.
+ *
+ * The file is read in large blocks, and objects are decoded in place from the
+ * block buffer, rather than issuing reads for each object.
  */
 class XDRInputFileStream
 {
+    // default size of the blocks read from the file
+    static size_t const DEFAULT_BLOCK_SIZE = 256 * 1024;
+
     std::ifstream mIn;
     std::vector<char> mBuf;
+    // data read from the file and not decoded yet is [mBufPos, mBufEnd)
+    size_t mBufPos{0};
+    size_t mBufEnd{0};
+    // offset in the file of the start of the buffer
+    size_t mBufOffset{0};
     unsigned int mSizeLimit;
+    size_t mBlockSize;
+
+    // makes at least `n` bytes available from mBufPos, reading ahead as much
+    // as fits in the buffer; returns false if the file ends before that
+    bool
+    fill(size_t n)
+    {
+        if (mBufEnd - mBufPos >= n)
+        {
+            return true;
+        }
+
+        if (mBufPos != 0)
+        {
+            std::memmove(mBuf.data(), mBuf.data() + mBufPos,
+                         mBufEnd - mBufPos);
+            mBufEnd -= mBufPos;
+            mBufOffset += mBufPos;
+            mBufPos = 0;
+        }
+        if (mBuf.size() < n)
+        {
+            mBuf.resize(n < mBlockSize ? mBlockSize : n);
+        }
+
+        while (mBufEnd < n && mIn.good())
+        {
+            mIn.read(mBuf.data() + mBufEnd, mBuf.size() - mBufEnd);
+            mBufEnd += static_cast<size_t>(mIn.gcount());
+        }
+        return mBufEnd >= n;
+    }
 
   public:
-    XDRInputFileStream(unsigned int sizeLimit = 0) : mSizeLimit{sizeLimit}
+    // `blockSize` can be lowered for streams used to read a few objects at
+    // random positions
+    XDRInputFileStream(unsigned int sizeLimit = 0,
+                       size_t blockSize = DEFAULT_BLOCK_SIZE)
+        : mSizeLimit{sizeLimit}, mBlockSize{blockSize}
     {
     }
 
@@ -34,6 +82,27 @@ class XDRInputFileStream
     close()
     {
         mIn.close();
+        mBufPos = 0;
+        mBufEnd = 0;
+        mBufOffset = 0;
+    }
+
+    // offset in the file of the next object to read
+    size_t
+    pos() const
+    {
+        return mBufOffset + mBufPos;
+    }
+
+    // moves to `offset` in the file, that must be the offset of an object
+    void
+    seek(size_t offset)
+    {
+        mIn.clear();
+        mIn.seekg(offset);
+        mBufPos = 0;
+        mBufEnd = 0;
+        mBufOffset = offset;
     }
 
     void
@@ -49,25 +118,28 @@ class XDRInputFileStream
             CLOG(ERROR, "Fs") << msg;
             throw std::runtime_error(msg);
         }
+        mBufPos = 0;
+        mBufEnd = 0;
+        mBufOffset = 0;
     }
 
     operator bool() const
     {
-        return mIn.good();
+        return mBufPos < mBufEnd || mIn.good();
     }
 
     template <typename T>
     bool
     readOne(T& out)
     {
-        char szBuf[4];
-        if (!mIn.read(szBuf, 4))
+        if (!fill(4))
         {
             return false;
         }
 
         // Read 4 bytes of size, big-endian, with XDR 'continuation' bit cleared
         // (high bit of high byte).
+        char const* szBuf = mBuf.data() + mBufPos;
         uint32_t sz = 0;
         sz |= static_cast<uint8_t>(szBuf[0] & '\x7f');
         sz <<= 8;
@@ -81,29 +153,57 @@ class XDRInputFileStream
         {
             return false;
         }
-        if (sz > mBuf.size())
-        {
-            mBuf.resize(sz);
-        }
-        if (!mIn.read(mBuf.data(), sz))
+        if (!fill(4 + static_cast<size_t>(sz)))
         {
             throw xdr::xdr_runtime_error("malformed XDR file");
         }
-        xdr::xdr_get g(mBuf.data(), mBuf.data() + sz);
+        char const* data = mBuf.data() + mBufPos + 4;
+        xdr::xdr_get g(data, data + sz);
         xdr::xdr_argpack_archive(g, out);
+        mBufPos += 4 + sz;
         return true;
     }
 };
 
+/**
+ * Helper for writing a sequence of XDR objects to a file.
+ *
+ * Objects are serialized into a large block buffer that is written to the
+ * file once full, on close() or on destruction.
+ */
 class XDROutputFileStream
 {
+    // size of the blocks written to the file
+    static size_t const BLOCK_SIZE = 256 * 1024;
+
     std::ofstream mOut;
     std::vector<char> mBuf;
+    size_t mBufEnd{0};
+
+    bool
+    flushBuffer()
+    {
+        if (mBufEnd != 0)
+        {
+            mOut.write(mBuf.data(), mBufEnd);
+            mBufEnd = 0;
+        }
+        return mOut.good();
+    }
 
   public:
+    ~XDROutputFileStream()
+    {
+        if (mOut.is_open())
+        {
+            close();
+        }
+    }
+
     void
     close()
     {
+        flushBuffer();
         mOut.close();
     }
 
@@ -120,6 +220,7 @@ class XDROutputFileStream
             CLOG(FATAL, "Fs") << msg;
             throw std::runtime_error(msg);
         }
+        mBufEnd = 0;
     }
 
     operator bool() const
@@ -127,6 +228,19 @@ class XDROutputFileStream
         return mOut.good();
     }
 
+    // writes `n` bytes holding objects that are already serialized, such as
+    // the content of another file written by an XDROutputFileStream
+    bool
+    writeBytes(char const* data, size_t n)
+    {
+        if (!flushBuffer())
+        {
+            return false;
+        }
+        mOut.write(data, n);
+        return mOut.good();
+    }
+
     template <typename T>
     bool
     writeOne(T const& t, SHA256* hasher = nullptr, size_t* bytesPut = nullptr)
@@ -134,32 +248,38 @@ class XDROutputFileStream
         uint32_t sz = (uint32_t)xdr::xdr_size(t);
         assert(sz < 0x80000000);
 
-        if (mBuf.size() < sz + 4)
+        size_t needed = static_cast<size_t>(sz) + 4;
+        if (mBufEnd + needed > mBuf.size())
         {
-            mBuf.resize(sz + 4);
+            if (!flushBuffer())
+            {
+                return false;
+            }
+            if (mBuf.size() < needed)
+            {
+                mBuf.resize(needed < BLOCK_SIZE ? size_t(BLOCK_SIZE) : needed);
+            }
         }
 
         // Write 4 bytes of size, big-endian, with XDR 'continuation' bit set on
         // high bit of high byte.
-        mBuf[0] = static_cast<char>((sz >> 24) & 0xFF) | '\x80';
-        mBuf[1] = static_cast<char>((sz >> 16) & 0xFF);
-        mBuf[2] = static_cast<char>((sz >> 8) & 0xFF);
-        mBuf[3] = static_cast<char>(sz & 0xFF);
+        char* buf = mBuf.data() + mBufEnd;
+        buf[0] = static_cast<char>((sz >> 24) & 0xFF) | '\x80';
+        buf[1] = static_cast<char>((sz >> 16) & 0xFF);
+        buf[2] = static_cast<char>((sz >> 8) & 0xFF);
+        buf[3] = static_cast<char>(sz & 0xFF);
 
-        xdr::xdr_put p(mBuf.data() + 4, mBuf.data() + 4 + sz);
+        xdr::xdr_put p(buf + 4, buf + needed);
         xdr_argpack_archive(p, t);
+        mBufEnd += needed;
 
-        if (!mOut.write(mBuf.data(), sz + 4))
-        {
-            return false;
-        }
         if (hasher)
         {
-            hasher->add(ByteSlice(mBuf.data(), sz + 4));
+            hasher->add(ByteSlice(buf, needed));
         }
         if (bytesPut)
         {
-            *bytesPut += (sz + 4);
+            *bytesPut += needed;
         }
         return true;
     }
@@ -90,7 +90,37 @@ enum MessageType
     GET_SCP_STATE = 12,
 
     // new messages
-    HELLO = 13
+    HELLO = 13,
+
+    // flow control, from overlay version 7
+    SEND_MORE = 14,
+
+    // transaction pulling, from overlay version 8
+    FLOOD_ADVERT = 15,
+    FLOOD_DEMAND = 16
+};
+
+struct SendMore
+{
+    uint32 numMessages; // additional flooded messages the sender may send
+};
+
+// transactions are identified by the SHA-256 of the StellarMessage carrying
+// them (of type TRANSACTION)
+const TX_ADVERT_VECTOR_MAX_SIZE = 1000;
+typedef Hash TxAdvertVector<TX_ADVERT_VECTOR_MAX_SIZE>;
+
+struct FloodAdvert
+{
+    TxAdvertVector txHashes; // transactions the sender can send on demand
+};
+
+const TX_DEMAND_VECTOR_MAX_SIZE = 1000;
+typedef Hash TxDemandVector<TX_DEMAND_VECTOR_MAX_SIZE>;
+
+struct FloodDemand
+{
+    TxDemandVector txHashes; // advertised transactions the sender wants
 };
 
 struct DontHave
@@ -131,6 +161,14 @@ case SCP_MESSAGE:
     SCPEnvelope envelope;
 case GET_SCP_STATE:
     uint32 getSCPLedgerSeq; // ledger seq requested ; if 0, requests the latest
+
+case SEND_MORE:
+    SendMore sendMoreMessage;
+
+case FLOOD_ADVERT:
+    FloodAdvert floodAdvert;
+case FLOOD_DEMAND:
+    FloodDemand floodDemand;
 };
 
 union AuthenticatedMessage switch (uint32 v)